@@ -19,6 +19,7 @@ SOURCES += ../../../../src/client/megacmdclient.cpp \
     ../../../../src/megacmdshell/megacmdshellcommunicationsnamedpipes.cpp
 
 HEADERS += ../../../../src/megacmdshell/megacmdshellcommunications.h \
+    ../../../../src/megacmdprotocol.h \
     ../../../../src/megacmdshell/megacmdshellcommunicationsnamedpipes.h \
     ../../../../sdk/include/mega/thread.h
 
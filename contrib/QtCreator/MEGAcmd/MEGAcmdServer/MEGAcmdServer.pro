@@ -61,7 +61,24 @@ SOURCES += ../../../../src/megacmd.cpp \
     ../../../../src/megacmdsandbox.cpp \
     ../../../../src/configurationmanager.cpp \
     ../../../../src/comunicationsmanager.cpp \
-    ../../../../src/megacmdutils.cpp
+    ../../../../src/megacmdutils.cpp \
+    ../../../../src/megacmdworkerpool.cpp \
+    ../../../../src/megacmdpathindex.cpp \
+    ../../../../src/megacmdtreewalker.cpp \
+    ../../../../src/megacmdsizecache.cpp \
+    ../../../../src/megacmdlogringbuffer.cpp \
+    ../../../../src/megacmdlogsink.cpp \
+    ../../../../src/megacmdrecordstore.cpp \
+    ../../../../src/megacmddownloadplanner.cpp \
+    ../../../../src/megacmduploadplanner.cpp \
+    ../../../../src/megacmdfingerprintcache.cpp \
+    ../../../../src/megacmdprogress.cpp \
+    ../../../../src/megacmdtransferhistory.cpp \
+    ../../../../src/megacmdsyncrestarter.cpp \
+    ../../../../src/megacmdsyncstatus.cpp \
+    ../../../../src/megacmdfoldercreator.cpp \
+    ../../../../src/megacmdbulkremover.cpp \
+    ../../../../src/megacmdbatchcopier.cpp
 
 
 HEADERS += ../../../../src/megacmd.h \
@@ -71,9 +88,27 @@ HEADERS += ../../../../src/megacmd.h \
     ../../../../src/megacmdsandbox.h \
     ../../../../src/configurationmanager.h \
     ../../../../src/comunicationsmanager.h \
+    ../../../../src/megacmdprotocol.h \
     ../../../../src/megacmdutils.h \
     ../../../../src/megacmdversion.h \
-    ../../../../src/megacmdplatform.h
+    ../../../../src/megacmdplatform.h \
+    ../../../../src/megacmdworkerpool.h \
+    ../../../../src/megacmdpathindex.h \
+    ../../../../src/megacmdtreewalker.h \
+    ../../../../src/megacmdsizecache.h \
+    ../../../../src/megacmdlogringbuffer.h \
+    ../../../../src/megacmdlogsink.h \
+    ../../../../src/megacmdrecordstore.h \
+    ../../../../src/megacmddownloadplanner.h \
+    ../../../../src/megacmduploadplanner.h \
+    ../../../../src/megacmdfingerprintcache.h \
+    ../../../../src/megacmdprogress.h \
+    ../../../../src/megacmdtransferhistory.h \
+    ../../../../src/megacmdsyncrestarter.h \
+    ../../../../src/megacmdsyncstatus.h \
+    ../../../../src/megacmdfoldercreator.h \
+    ../../../../src/megacmdbulkremover.h \
+    ../../../../src/megacmdbatchcopier.h
 
     SOURCES +=../../../../src/comunicationsmanagerportsockets.cpp
     HEADERS +=../../../../src/comunicationsmanagerportsockets.h
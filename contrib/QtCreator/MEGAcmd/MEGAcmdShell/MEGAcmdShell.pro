@@ -21,6 +21,7 @@ SOURCES += ../../../../src/megacmdshell/megacmdshell.cpp \
 
 HEADERS += ../../../../src/megacmdshell/megacmdshell.h \
     ../../../../src/megacmdshell/megacmdshellcommunications.h \
+    ../../../../src/megacmdprotocol.h \
     ../../../../src/megacmdshell/megacmdshellcommunicationsnamedpipes.h \
     ../../../../sdk/include/mega/thread.h
 
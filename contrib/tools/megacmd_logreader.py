@@ -0,0 +1,77 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Decodes the log files written by mega-cmd-server with "log_file_format=binary" (see
+# src/megacmdlogsink.h for the format), as text lines like the ones in the output of the server
+# or as the JSON lines it writes with "log_file_format=json".
+# Rotated files are read in the order given: e.g. megacmd.log.2 megacmd.log.1 megacmd.log
+#
+# Usage: megacmd_logreader.py [--json] [--petition ID] [--thread ID] [--level LEVEL] FILE...
+
+import sys, struct, json, datetime
+
+MAGIC=b"MCMDLOG"
+VERSION=1
+HEADER=struct.Struct("<7sBqq")
+RECORD=struct.Struct("<qQQBBH") # after the length
+LEVELS=["CRIT", "ERR", "WARN", "INFO", "DBG", "DTL"]
+
+def records(path):
+    with open(path, "rb") as f:
+        data=f.read()
+    if len(data) < HEADER.size:
+        raise Exception(path+": not a MEGAcmd binary log")
+    magic,version,wallclock,monotonic=HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION:
+        raise Exception(path+": not a MEGAcmd binary log (or of an unknown version)")
+    offset=HEADER.size
+    while offset+4 <= len(data):
+        length=struct.unpack_from("<I", data, offset)[0]
+        if length < RECORD.size or offset+4+length > len(data):
+            sys.stderr.write(path+": truncated record at "+str(offset)+"\n")
+            return
+        mono,thread,petition,level,origin,sourcelength=RECORD.unpack_from(data, offset+4)
+        start=offset+4+RECORD.size
+        source=data[start:start+sourcelength].decode("utf-8", "replace")
+        message=data[start+sourcelength:offset+4+length].decode("utf-8", "replace")
+        time=datetime.datetime.utcfromtimestamp((wallclock+mono-monotonic)/1000000.0)
+        yield {"mono":mono, "thread":thread, "petition":petition,
+               "level":LEVELS[level] if level < len(LEVELS) else str(level),
+               "origin":"megacmd" if origin == 0 else "sdk",
+               "time":time.strftime("%Y-%m-%d_%H-%M-%S.%f"), "source":source, "message":message}
+        offset+=4+length
+
+def main():
+    args=sys.argv[1:]
+    asjson=False
+    filters={}
+    files=[]
+    while args:
+        arg=args.pop(0)
+        if arg == "--json":
+            asjson=True
+        elif arg in ("--petition", "--thread") and args:
+            filters[arg[2:]]=int(args.pop(0))
+        elif arg == "--level" and args:
+            filters["level"]=args.pop(0).upper()
+        else:
+            files.append(arg)
+    if not files:
+        print("Usage: "+sys.argv[0]+" [--json] [--petition ID] [--thread ID] [--level LEVEL] FILE...")
+        exit(1)
+
+    for path in files:
+        for r in records(path):
+            if any(r[k] != v for k,v in filters.items()):
+                continue
+            if asjson:
+                line=json.dumps(r, separators=(",", ":"))
+            else:
+                line="[%s%s: %s] [thread %x petition %d %s] %s" % ("API:" if r["origin"] == "sdk" else "", r["level"],
+                                                                  r["time"], r["thread"], r["petition"], r["source"], r["message"])
+            if sys.version_info[0] < 3:
+                line=line.encode("utf-8")
+            print(line)
+
+if __name__ == "__main__":
+    main()
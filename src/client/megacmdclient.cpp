@@ -23,6 +23,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
 #include <memory.h>
 #include <limits.h>
 
@@ -535,6 +536,99 @@ int readconfirmationloop(const char *question)
     }
 }
 
+#ifndef _WIN32
+#define MAXPIPELINEINFLIGHT 8 // well below the petitions the server processes at once
+
+/**
+ * @brief Executes the commands read from stdin (one per line) through a single session.
+ * Up to MAXPIPELINEINFLIGHT commands are sent ahead of their responses, which are printed in the
+ * order the commands were given. Responses are read before sending more: otherwise a server
+ * blocked writing to us would stop reading our commands too.
+ * Confirmations are answered negatively, since stdin is taken.
+ * @return the first non zero outcode
+ */
+int executePipeline(MegaCmdShellCommunications *comms)
+{
+    if (comms->openSession())
+    {
+        return -1;
+    }
+
+    map<uint32_t, size_t> positions;
+    vector<string> outputs;
+    vector<int> outcodes;
+    vector<bool> done;
+
+    int outcode = 0;
+    size_t nextToPrint = 0;
+    int inFlight = 0;
+    bool moreCommands = true;
+    for (;;)
+    {
+        string line;
+        while (moreCommands && inFlight < MAXPIPELINEINFLIGHT)
+        {
+            if (!getline(cin, line))
+            {
+                moreCommands = false;
+                break;
+            }
+            if (!line.size())
+            {
+                continue;
+            }
+
+            long long requestId = comms->sendSessionCommand(line);
+            if (requestId < 0)
+            {
+                comms->closeSession();
+                return -1;
+            }
+            positions[uint32_t(requestId)] = outputs.size();
+            outputs.push_back(string());
+            outcodes.push_back(0);
+            done.push_back(false);
+            inFlight++;
+        }
+
+        if (!inFlight)
+        {
+            break;
+        }
+
+        uint32_t requestId = 0;
+        string output;
+        int code = comms->receiveSessionResponse(&requestId, &output);
+        map<uint32_t, size_t>::iterator it = positions.find(requestId);
+        if (it == positions.end())
+        {
+            comms->closeSession();
+            return -1;
+        }
+
+        outputs[it->second].swap(output);
+        outcodes[it->second] = code;
+        done[it->second] = true;
+        positions.erase(it);
+        inFlight--;
+
+        // print whatever is ready, keeping the order of submission
+        while (nextToPrint < outputs.size() && done[nextToPrint])
+        {
+            cout << outputs[nextToPrint] << flush;
+            string().swap(outputs[nextToPrint]);
+            if (!outcode && outcodes[nextToPrint])
+            {
+                outcode = outcodes[nextToPrint];
+            }
+            nextToPrint++;
+        }
+    }
+
+    comms->closeSession();
+    return outcode;
+}
+#endif
 
 int main(int argc, char* argv[])
 {
@@ -567,6 +661,13 @@ int main(int argc, char* argv[])
     wstring wcommand = parsewArgs(wargc,szArglist);
     int outcode = comms->executeCommandW(wcommand, readconfirmationloop, COUT, false);
 #else
+    if (!strcmp(argv[1], "--pipeline"))
+    {
+        int outcode = executePipeline(comms);
+        delete comms;
+        return outcode;
+    }
+
     string parsedArgs = parseArgs(argc,argv);
     int outcode = comms->executeCommand(parsedArgs, readconfirmationloop, COUT, false);
 #endif
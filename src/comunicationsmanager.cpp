@@ -21,6 +21,56 @@
 using namespace std;
 using namespace mega;
 
+CmdOutputStreamBuf::CmdOutputStreamBuf(ComunicationsManager *cm, CmdPetition *inf, size_t chunkSize)
+{
+    this->cm = cm;
+    this->inf = inf;
+    broken = false;
+    buffer.resize(std::max((size_t)1, chunkSize));
+    setp(&buffer[0], &buffer[0] + buffer.size());
+}
+
+CmdOutputStreamBuf::int_type CmdOutputStreamBuf::overflow(int_type c)
+{
+    flushOutput();
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int CmdOutputStreamBuf::sync()
+{
+    return flushOutput() ? 0 : -1;
+}
+
+bool CmdOutputStreamBuf::flushOutput()
+{
+    if (pptr() > pbase() && !broken)
+    {
+        OUTSTRINGSTREAM s;
+        s.write(pbase(), pptr() - pbase());
+        if (!cm->sendPartialOutput(inf, &s))
+        {
+            LOG_warn << "Unable to stream output to client. Discarding the rest of it";
+            broken = true;
+        }
+    }
+    setp(&buffer[0], &buffer[0] + buffer.size());
+    return !broken;
+}
+
+void CmdOutputStreamBuf::getRemaining(OUTSTRINGSTREAM *s)
+{
+    if (!broken)
+    {
+        s->write(pbase(), pptr() - pbase());
+    }
+    setp(&buffer[0], &buffer[0] + buffer.size());
+}
+
 OUTSTREAMTYPE &operator<<(OUTSTREAMTYPE &os, const CmdPetition& p)
 {
     return os << p.line;
@@ -35,6 +85,7 @@ std::ostream &operator<<(std::ostream &os, const CmdPetition& p)
 
 ComunicationsManager::ComunicationsManager()
 {
+    mtxStateListenersPetitions.init(true);
 }
 
 bool ComunicationsManager::receivedPetition()
@@ -44,6 +95,7 @@ bool ComunicationsManager::receivedPetition()
 
 void ComunicationsManager::registerStateListener(CmdPetition *inf)
 {
+    mtxStateListenersPetitions.lock();
     stateListenersPetitions.push_back(inf);
     if (stateListenersPetitions.size() >MAXCMDSTATELISTENERS && stateListenersPetitions.size()%10 == 0)
     {
@@ -51,6 +103,7 @@ void ComunicationsManager::registerStateListener(CmdPetition *inf)
         string sack="ack";
         informStateListeners(sack);
     }
+    mtxStateListenersPetitions.unlock();
     return;
 }
 
@@ -73,6 +126,7 @@ void ComunicationsManager::informStateListeners(string &s)
 {
     s+=(char)0x1F;
 
+    mtxStateListenersPetitions.lock();
     for (std::vector< CmdPetition * >::iterator it = stateListenersPetitions.begin(); it != stateListenersPetitions.end();)
     {
         if (informStateListener((CmdPetition *)*it, s) <0)
@@ -85,12 +139,14 @@ void ComunicationsManager::informStateListeners(string &s)
              ++it;
         }
     }
+    mtxStateListenersPetitions.unlock();
 }
 
 void ComunicationsManager::informStateListenerByClientId(string &s, int clientID)
 {
     s+=(char)0x1F;
 
+    mtxStateListenersPetitions.lock();
     for (std::vector< CmdPetition * >::iterator it = stateListenersPetitions.begin(); it != stateListenersPetitions.end();)
     {
         if ((clientID == ((CmdPetition *)*it)->clientID ) && informStateListener((CmdPetition *)*it, s) <0)
@@ -103,6 +159,7 @@ void ComunicationsManager::informStateListenerByClientId(string &s, int clientID
              ++it;
         }
     }
+    mtxStateListenersPetitions.unlock();
 }
 int ComunicationsManager::informStateListener(CmdPetition *inf, string &s)
 {
@@ -115,6 +172,21 @@ void ComunicationsManager::returnAndClosePetition(CmdPetition *inf, OUTSTRINGSTR
     return;
 }
 
+bool ComunicationsManager::supportsStateListener(CmdPetition *inf)
+{
+    return true;
+}
+
+bool ComunicationsManager::supportsStreamingOutput(CmdPetition *inf)
+{
+    return false;
+}
+
+bool ComunicationsManager::sendPartialOutput(CmdPetition *inf, OUTSTRINGSTREAM *s)
+{
+    return false;
+}
+
 /**
  * @brief getPetition
  * @return pointer to new CmdPetition. Petition returned must be properly deleted (this can be calling returnAndClosePetition)
@@ -144,13 +216,3 @@ ComunicationsManager::~ComunicationsManager()
         it = stateListenersPetitions.erase(it);
     }
 }
-
-MegaThread *CmdPetition::getPetitionThread() const
-{
-    return petitionThread;
-}
-
-void CmdPetition::setPetitionThread(MegaThread *value)
-{
-    petitionThread = value;
-}
@@ -20,20 +20,25 @@
 #define COMUNICATIONSMANAGER_H
 
 #include "megacmd.h"
+#include "megacmdprotocol.h"
+
+#include <streambuf>
+#include <vector>
 
 static const int MAXCMDSTATELISTENERS = 300;
+static const size_t MAXSTATELISTENERPENDINGBYTES = 512 * 1024; // listeners that fall behind this much are dropped
 
 class CmdPetition
 {
     public:
         char * line;
-        mega::MegaThread * petitionThread;
         int clientID;
+        unsigned long long id; // to tell the petitions apart in logs, 0 if not given
 
         CmdPetition()
         {
             line = NULL;
-            petitionThread = NULL;
+            id = 0;
         }
 
         char *getLine()
@@ -47,9 +52,6 @@ class CmdPetition
                 free(line);
             }
         }
-        mega::MegaThread *getPetitionThread() const;
-        void setPetitionThread(mega::MegaThread *value);
-
 };
 
 OUTSTREAMTYPE &operator<<(OUTSTREAMTYPE &os, CmdPetition const &p);
@@ -58,11 +60,49 @@ OUTSTREAMTYPE &operator<<(OUTSTREAMTYPE &os, CmdPetition const &p);
 std::ostream &operator<<(std::ostream &os, CmdPetition const &p);
 #endif
 
+class ComunicationsManager;
+
+/**
+ * @brief Buffer for the output of a petition that hands it to the client in chunks as it is produced.
+ * No more than chunkSize characters are held: writing blocks while the client is not reading.
+ * Whatever remains at the end is to be returned along with the outcode (see getRemaining).
+ * If the client goes away, the rest of the output is discarded.
+ */
+class CmdOutputStreamBuf : public std::basic_streambuf<OUTSTREAMTYPE::char_type>
+{
+private:
+    ComunicationsManager *cm;
+    CmdPetition *inf;
+    std::vector<char_type> buffer;
+    bool broken;
+
+protected:
+    int_type overflow(int_type c);
+
+    // std::flush and std::endl: what has been buffered is sent right away
+    int sync();
+
+public:
+    CmdOutputStreamBuf(ComunicationsManager *cm, CmdPetition *inf, size_t chunkSize);
+
+    /**
+     * @brief Sends what has been buffered so far
+     * @return false if the client is no longer reachable
+     */
+    bool flushOutput();
+
+    /**
+     * @brief Moves what has not been sent yet into s
+     */
+    void getRemaining(OUTSTRINGSTREAM *s);
+};
+
 class ComunicationsManager
 {
 private:
     fd_set fds;
     std::vector<CmdPetition *> stateListenersPetitions;
+    mega::MegaMutex mtxStateListenersPetitions; // broadcasts come from several threads
 
 public:
     ComunicationsManager();
@@ -83,6 +123,23 @@ public:
      */
     virtual void returnAndClosePetition(CmdPetition *inf, OUTSTRINGSTREAM *s, int);
 
+    /**
+     * @brief Whether the petition can be registered as a state listener
+     */
+    virtual bool supportsStateListener(CmdPetition *inf);
+
+    /**
+     * @brief Whether the client of the petition admits receiving the output in several parts
+     * (see sendPartialOutput)
+     */
+    virtual bool supportsStreamingOutput(CmdPetition *inf);
+
+    /**
+     * @brief Sends part of the output of a petition. The outcode will come with returnAndClosePetition
+     * @return false if it could not be sent
+     */
+    virtual bool sendPartialOutput(CmdPetition *inf, OUTSTRINGSTREAM *s);
+
     /**
      * @brief Sends an status message (e.g. prompt:who@/new/prompt:) to all registered listeners
      * @param s
@@ -18,7 +18,13 @@
 
 #include "comunicationsmanagerfilesockets.h"
 #include "megacmdutils.h"
-#include <sys/ioctl.h>
+#include <fcntl.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
 
 #ifdef __MACH__
 #define MSG_NOSIGNAL 0
@@ -26,6 +32,69 @@
 
 using namespace mega;
 
+static bool sendAll(int socket, const char *data, size_t size)
+{
+    while (size)
+    {
+        ssize_t n = send(socket, data, size, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief Appends to received what the socket has available, without waiting for anything else
+ * @return false if the connection has been closed or has failed
+ */
+static bool recvAvailable(int socket, string *received)
+{
+    char chunk[4096];
+    // bounded, so that a client that keeps writing does not hold up the rest: what is left will be read in the next wait
+    for (int i = 0; i < 16; i++)
+    {
+        ssize_t n = recv(socket, chunk, sizeof( chunk ), MSG_DONTWAIT);
+        if (n > 0)
+        {
+            received->append(chunk, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        return n < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK );
+    }
+    return true;
+}
+
+static bool recvAll(int socket, char *data, size_t size)
+{
+    while (size)
+    {
+        ssize_t n = recv(socket, data, size, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
 int ComunicationsManagerFileSockets::get_next_comm_id()
 {
     mtx->lock();
@@ -123,16 +192,54 @@ int ComunicationsManagerFileSockets::create_new_socket(int *sockId)
 }
 
 
+static void setNonBlocking(int socket)
+{
+    int flags = fcntl(socket, F_GETFL);
+    if (flags != -1)
+    {
+        fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+    }
+}
+
 ComunicationsManagerFileSockets::ComunicationsManagerFileSockets()
 {
     count = 0;
     mtx = new MegaMutex();
+#ifdef __linux__
+    epollfd = -1;
+#else
+    wakeupPipe[0] = wakeupPipe[1] = -1;
+#endif
     initialize();
 }
 
 int ComunicationsManagerFileSockets::initialize()
 {
     mtx->init(false);
+    mtxListeners.init(false);
+
+#ifdef __linux__
+    epollfd = epoll_create(1);
+    if (epollfd < 0)
+    {
+        LOG_fatal << "ERROR creating epoll instance: " << errno;
+    }
+    else
+    {
+        fcntl(epollfd, F_SETFD, FD_CLOEXEC);
+    }
+#else
+    if (pipe(wakeupPipe))
+    {
+        LOG_fatal << "ERROR creating wake up pipe: " << errno;
+        wakeupPipe[0] = wakeupPipe[1] = -1;
+    }
+    else
+    {
+        setNonBlocking(wakeupPipe[0]);
+        setNonBlocking(wakeupPipe[1]);
+    }
+#endif
 
     MegaFileSystemAccess *fsAccess = new MegaFileSystemAccess();
     char csocketsFolder[19]; // enough to hold all numbers up to 64-bits
@@ -188,32 +295,160 @@ int ComunicationsManagerFileSockets::initialize()
             LOG_fatal << "ERROR on listen socket initializing communications manager: " << socketPath << ": " << errno;
             return errno;
         }
+        setNonBlocking(sockfd); // accept must never wait, e.g. for a client that has already gone
+        watchSocket(sockfd, false, false);
     }
     return 0;
 }
 
+void ComunicationsManagerFileSockets::watchSocket(int socket, bool writable, bool alreadyWatched)
+{
+#ifdef __linux__
+    struct epoll_event event;
+    memset(&event, 0, sizeof( event ));
+    event.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0);
+    event.data.fd = socket;
+    if (epoll_ctl(epollfd, alreadyWatched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, socket, &event))
+    {
+        LOG_err << "ERROR watching socket " << socket << ": " << errno;
+    }
+#else
+    // poll gathers the sockets to watch in every wait: have it start over
+    char c = 0;
+    if (wakeupPipe[1] != -1 && write(wakeupPipe[1], &c, 1) < 0 && errno != EAGAIN)
+    {
+        LOG_err << "ERROR waking up poll: " << errno;
+    }
+#endif
+}
+
+void ComunicationsManagerFileSockets::unwatchSocket(int socket)
+{
+#ifdef __linux__
+    struct epoll_event event; // required non NULL by old kernels
+    epoll_ctl(epollfd, EPOLL_CTL_DEL, socket, &event);
+#else
+    watchSocket(socket, false, true);
+#endif
+}
+
 bool ComunicationsManagerFileSockets::receivedPetition()
 {
-    return FD_ISSET(sockfd, &fds);
+    return readyPetitions.size() != 0;
 }
 
 int ComunicationsManagerFileSockets::waitForPetition()
 {
-    FD_ZERO(&fds);
-    if (sockfd)
+    // connections and state listeners are served in here, we only return when there is something to process
+    bool ready = readyPetitions.size() != 0;
+    while (!ready)
+    {
+#ifdef __linux__
+        struct epoll_event events[64];
+        int rc = epoll_wait(epollfd, events, 64, -1);
+#else
+        vector<struct pollfd> pollfds;
+        struct pollfd pfd;
+        pfd.revents = 0;
+        pfd.events = POLLIN;
+
+        pfd.fd = wakeupPipe[0];
+        pollfds.push_back(pfd);
+        pfd.fd = sockfd;
+        pollfds.push_back(pfd);
+        for (map<int, string>::iterator it = incomingConnections.begin(); it != incomingConnections.end(); it++)
+        {
+            pfd.fd = it->first;
+            pollfds.push_back(pfd);
+        }
+        for (unsigned int i = 0; i < sessions.size(); i++)
+        {
+            pfd.fd = sessions[i]->socket;
+            pollfds.push_back(pfd);
+        }
+
+        mtxListeners.lock();
+        for (map<CmdPetition *, statelistener *>::iterator it = stateListeners.begin(); it != stateListeners.end(); it++)
+        {
+            statelistener *l = it->second;
+            if (!l->dropped)
+            {
+                pfd.fd = (l->connectedSocket != -1) ? l->connectedSocket : l->listeningSocket;
+                pfd.events = POLLIN | (l->watchingWrites ? POLLOUT : 0);
+                pollfds.push_back(pfd);
+                pfd.events = POLLIN;
+            }
+        }
+        mtxListeners.unlock();
+
+        int rc = poll(&pollfds[0], pollfds.size(), -1);
+#endif
+        if (rc < 0)
+        {
+            if (errno != EINTR)  //syscall
+            {
+                LOG_fatal << "Error waiting for petitions: " << errno;
+                return errno;
+            }
+            return 0;
+        }
+
+#ifdef __linux__
+        for (int i = 0; i < rc; i++)
+        {
+            ready |= processSocketEvent(events[i].data.fd, events[i].events & EPOLLIN, events[i].events & EPOLLOUT,
+                                        events[i].events & ( EPOLLERR | EPOLLHUP | EPOLLRDHUP ));
+        }
+#else
+        for (unsigned int i = 0; i < pollfds.size(); i++)
+        {
+            if (!pollfds[i].revents)
+            {
+                continue;
+            }
+            if (pollfds[i].fd == wakeupPipe[0])
+            {
+                char drain[64];
+                while (read(wakeupPipe[0], drain, sizeof( drain )) > 0);
+                continue;
+            }
+            ready |= processSocketEvent(pollfds[i].fd, pollfds[i].revents & POLLIN, pollfds[i].revents & POLLOUT,
+                                        pollfds[i].revents & ( POLLERR | POLLHUP ));
+        }
+#endif
+    }
+    return 0;
+}
+
+bool ComunicationsManagerFileSockets::processSocketEvent(int socket, bool readable, bool writable, bool error)
+{
+    if (socket == sockfd)
+    {
+        return acceptConnection();
+    }
+
+    if (incomingConnections.count(socket))
     {
-        FD_SET(sockfd, &fds);
+        return processIncomingConnection(socket);
     }
-    int rc = select(FD_SETSIZE, &fds, NULL, NULL, NULL);
-    if (rc < 0)
+
+    for (unsigned int i = 0; i < sessions.size(); i++)
     {
-        if (errno != EINTR)  //syscall
+        if (sessions[i]->socket == socket)
         {
-            LOG_fatal << "Error at select: " << errno;
-            return errno;
+            // an error or a hang up will be noticed when reading
+            return processSessionInput(sessions[i]);
         }
     }
-    return 0;
+
+    mtxListeners.lock();
+    map<int, statelistener *>::iterator it = stateListenersBySocket.find(socket);
+    if (it != stateListenersBySocket.end())
+    {
+        processStateListenerEvent(it->second, socket, readable, writable, error);
+    }
+    mtxListeners.unlock();
+    return false;
 }
 
 void ComunicationsManagerFileSockets::stopWaiting()
@@ -278,9 +513,57 @@ void ComunicationsManagerFileSockets::registerStateListener(CmdPetition *inf)
  * @brief returnAndClosePetition
  * I will clean struct and close the socket within
  */
+bool ComunicationsManagerFileSockets::sendFrame(int socket, int type, int outCode, const string &payload)
+{
+    mcmdframeheader header;
+    header.type = type;
+    header.outcode = outCode;
+    header.length = uint32_t(payload.size());
+
+    return sendAll(socket, (const char *)&header, sizeof( header ))
+            && sendAll(socket, payload.data(), payload.size());
+}
+
+bool ComunicationsManagerFileSockets::sendSessionFrame(CmdSessionPosixSockets *session, uint32_t requestId, int type, int outCode, const string &payload)
+{
+    // a closed session has its connection shut down: sending fails without blocking
+    mcmdsessionframeheader header;
+    header.requestId = requestId;
+    header.type = type;
+    header.outcode = outCode;
+    header.length = uint32_t(payload.size());
+
+    return sendAll(session->socket, (const char *)&header, sizeof( header ))
+            && sendAll(session->socket, payload.data(), payload.size());
+}
+
 void ComunicationsManagerFileSockets::returnAndClosePetition(CmdPetition *inf, OUTSTRINGSTREAM *s, int outCode)
 {
     LOG_verbose << "Output to write in socket " << ((CmdPetitionPosixSockets *)inf)->outSocket << ": <<" << s->str() << ">>";
+
+    CmdSessionPosixSockets *session = ((CmdPetitionPosixSockets *)inf)->session;
+    if (session)
+    {
+        session->mtx.lock();
+        if (!sendSessionFrame(session, ((CmdPetitionPosixSockets *)inf)->requestId, MCMD_FRAME_RESPONSE, outCode, s->str()))
+        {
+            LOG_err << "ERROR writing response frame to session: " << errno;
+        }
+        session->mtx.unlock();
+        delete inf;
+        return;
+    }
+
+    if (((CmdPetitionPosixSockets *)inf)->protocolVersion == 2)
+    {
+        if (!sendFrame(((CmdPetitionPosixSockets *)inf)->acceptedOutSocket, MCMD_FRAME_RESPONSE, outCode, s->str()))
+        {
+            LOG_err << "ERROR writing response frame to socket: " << errno;
+        }
+        delete inf;
+        return;
+    }
+
     sockaddr_in cliAddr;
     socklen_t cliLength = sizeof( cliAddr );
     int connectedsocket = ((CmdPetitionPosixSockets *)inf)->acceptedOutSocket;
@@ -312,85 +595,235 @@ void ComunicationsManagerFileSockets::returnAndClosePetition(CmdPetition *inf, O
     delete inf;
 }
 
-int ComunicationsManagerFileSockets::informStateListener(CmdPetition *inf, string &s)
+ComunicationsManagerFileSockets::statelistener *ComunicationsManagerFileSockets::getStateListener(CmdPetition *inf)
 {
-    LOG_verbose << "Inform State Listener: Output to write in socket " << ((CmdPetitionPosixSockets *)inf)->outSocket << ": <<" << s << ">>";
+    map<CmdPetition *, statelistener *>::iterator it = stateListeners.find(inf);
+    if (it != stateListeners.end())
+    {
+        return it->second;
+    }
 
-    sockaddr_in cliAddr;
-    socklen_t cliLength = sizeof( cliAddr );
+    statelistener *l = new statelistener;
+    l->petition = (CmdPetitionPosixSockets *)inf;
+    l->listeningSocket = -1;
+    l->connectedSocket = -1;
+    l->watchingWrites = false;
+    l->dropped = false;
+    stateListeners[inf] = l;
+
+    if (l->petition->acceptedOutSocket != -1)
+    {
+        // protocol v2: the connection used for the petition is kept
+        l->connectedSocket = l->petition->acceptedOutSocket;
+    }
+    else
+    {
+        // the listener will connect to the socket created for the petition
+        l->listeningSocket = l->petition->outSocket;
+    }
 
-    static map<int,int> connectedsockets;
+    int socket = ( l->connectedSocket != -1 ) ? l->connectedSocket : l->listeningSocket;
+    if (socket == -1)
+    {
+        dropStateListener(l, "no socket to write to");
+        return l;
+    }
+    setNonBlocking(socket);
+    stateListenersBySocket[socket] = l;
+    watchSocket(socket, false, false);
+    return l;
+}
 
-    int connectedsocket = -1;
-    if (connectedsockets.find(((CmdPetitionPosixSockets *)inf)->outSocket) == connectedsockets.end())
+void ComunicationsManagerFileSockets::processStateListenerEvent(statelistener *l, int socket, bool readable, bool writable, bool error)
+{
+    if (l->dropped)
     {
-        //select with timeout and accept non-blocking, so that things don't get stuck
-        fd_set set;
-        FD_ZERO(&set);
-        FD_SET(((CmdPetitionPosixSockets *)inf)->outSocket, &set);
+        return;
+    }
 
-        struct timeval timeout;
-        timeout.tv_sec = 4;
-        timeout.tv_usec = 0;
-        int rv = select(((CmdPetitionPosixSockets *)inf)->outSocket+1, &set, NULL, NULL, &timeout);
-        if(rv == -1)
+    if (socket == l->listeningSocket)
+    {
+        sockaddr_in cliAddr;
+        socklen_t cliLength = sizeof( cliAddr );
+        int connectedsocket = accept(l->listeningSocket, (struct sockaddr*)&cliAddr, &cliLength);
+        if (connectedsocket == -1)
         {
-            LOG_err << "Informing state listener: Unable to select on outsocket " << ((CmdPetitionPosixSockets *)inf)->outSocket << " error: " << errno;
-            return -1;
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                LOG_err << "Informing state listener: Unable to accept on outsocket " << l->listeningSocket << " error: " << errno;
+                dropStateListener(l, "unable to accept its connection");
+            }
+            return;
         }
-        else if(rv == 0)
+
+        unwatchSocket(l->listeningSocket);
+        stateListenersBySocket.erase(l->listeningSocket);
+        l->listeningSocket = -1;
+
+        l->connectedSocket = connectedsocket;
+        l->petition->acceptedOutSocket = connectedsocket; //So that it gets closed in destructor
+        setNonBlocking(connectedsocket);
+        stateListenersBySocket[connectedsocket] = l;
+        watchSocket(connectedsocket, false, false);
+
+        if (!flushStateListener(l))
         {
-            LOG_warn << "Informing state listener: timeout in select on outsocket " << ((CmdPetitionPosixSockets *)inf)->outSocket;
+            dropStateListener(l, "connection closed");
         }
-        else
+        return;
+    }
+
+    if (readable && !error)
+    {
+        // listeners are not supposed to write: this is either garbage or the end of the connection
+        char discard[256];
+        ssize_t n = recv(socket, discard, sizeof( discard ), MSG_DONTWAIT);
+        if (n == 0 || ( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ))
         {
-            int oldfl = fcntl(sockfd, F_GETFL);
-            fcntl(((CmdPetitionPosixSockets *)inf)->outSocket, F_SETFL, oldfl | O_NONBLOCK);
-            connectedsocket = accept(((CmdPetitionPosixSockets *)inf)->outSocket, (struct sockaddr*)&cliAddr, &cliLength);
-            fcntl(((CmdPetitionPosixSockets *)inf)->outSocket, F_SETFL, oldfl);
+            error = true;
         }
-        connectedsockets[((CmdPetitionPosixSockets *)inf)->outSocket] = connectedsocket;
     }
-    else
+
+    if (error)
     {
-        connectedsocket = connectedsockets[((CmdPetitionPosixSockets *)inf)->outSocket];
+        dropStateListener(l, "connection closed");
     }
+    else if (writable && !flushStateListener(l))
+    {
+        dropStateListener(l, "connection closed");
+    }
+}
 
-    if (connectedsocket == -1)
+bool ComunicationsManagerFileSockets::flushStateListener(statelistener *l)
+{
+    if (l->connectedSocket == -1)
     {
-        if (errno == 32) //socket closed
-        {
-            LOG_debug << "Unregistering no longer listening client. Original petition: " << *inf;
-            connectedsockets.erase(((CmdPetitionPosixSockets *)inf)->outSocket);
-            return -1;
-        }
-        else
+        return true;
+    }
+
+    size_t written = 0;
+    while (written < l->pending.size())
+    {
+        ssize_t n = send(l->connectedSocket, l->pending.data() + written, l->pending.size() - written, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
         {
-            LOG_err << "Informing state listener: Unable to accept on outsocket " << ((CmdPetitionPosixSockets *)inf)->outSocket << " error: " << errno;
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+            return false;
         }
-        return 0;
+        written += n;
     }
+    l->pending.erase(0, written);
 
-#ifdef __MACH__
-#define MSG_NOSIGNAL 0
-#endif
+    bool writable = l->pending.size() != 0;
+    if (writable != l->watchingWrites)
+    {
+        l->watchingWrites = writable;
+        watchSocket(l->connectedSocket, writable, true);
+    }
+    return true;
+}
 
-    int n = send(connectedsocket, s.data(), s.size(), MSG_NOSIGNAL);
-    if (n < 0)
+void ComunicationsManagerFileSockets::dropStateListener(statelistener *l, const char *reason)
+{
+    LOG_debug << "Dropping state listener (" << reason << "). Original petition: " << *l->petition;
+    l->dropped = true;
+    l->pending.clear();
+    if (l->listeningSocket != -1)
+    {
+        unwatchSocket(l->listeningSocket);
+        stateListenersBySocket.erase(l->listeningSocket);
+    }
+    if (l->connectedSocket != -1)
+    {
+        unwatchSocket(l->connectedSocket);
+        stateListenersBySocket.erase(l->connectedSocket);
+        shutdown(l->connectedSocket, SHUT_RDWR);
+    }
+}
+
+void ComunicationsManagerFileSockets::removeStateListener(statelistener *l)
+{
+    if (!l->dropped)
+    {
+        dropStateListener(l, "removed");
+    }
+    stateListeners.erase(l->petition);
+    delete l;
+}
+
+bool ComunicationsManagerFileSockets::supportsStateListener(CmdPetition *inf)
+{
+    // state listeners require a connection of their own
+    return !((CmdPetitionPosixSockets *)inf)->session;
+}
+
+bool ComunicationsManagerFileSockets::supportsStreamingOutput(CmdPetition *inf)
+{
+    // v1 sends the outcode ahead of the output: the whole of it needs to be known
+    return ((CmdPetitionPosixSockets *)inf)->protocolVersion == 2;
+}
+
+bool ComunicationsManagerFileSockets::sendPartialOutput(CmdPetition *inf, OUTSTRINGSTREAM *s)
+{
+    CmdSessionPosixSockets *session = ((CmdPetitionPosixSockets *)inf)->session;
+    bool sent;
+    if (session)
+    {
+        session->mtx.lock();
+        sent = sendSessionFrame(session, ((CmdPetitionPosixSockets *)inf)->requestId, MCMD_FRAME_OUTPUT, MCMD_OK, s->str());
+        session->mtx.unlock();
+    }
+    else
+    {
+        sent = sendFrame(((CmdPetitionPosixSockets *)inf)->acceptedOutSocket, MCMD_FRAME_OUTPUT, MCMD_OK, s->str());
+    }
+
+    if (!sent)
+    {
+        LOG_err << "ERROR writing output frame: " << errno;
+    }
+    return sent;
+}
+
+int ComunicationsManagerFileSockets::informStateListener(CmdPetition *inf, string &s)
+{
+    LOG_verbose << "Inform State Listener: Output to write in socket " << ((CmdPetitionPosixSockets *)inf)->outSocket << ": <<" << s << ">>";
+
+    mtxListeners.lock();
+    statelistener *l = getStateListener(inf);
+    if (!l->dropped)
     {
-        if (errno == 32) //socket closed
+        if (l->pending.size() + s.size() > MAXSTATELISTENERPENDINGBYTES)
         {
-            LOG_debug << "Unregistering no longer listening client. Original petition: " << *inf;
-            close(connectedsocket);
-            connectedsockets.erase(((CmdPetitionPosixSockets *)inf)->outSocket);
-            return -1;
+            // never block the broadcaster because of a listener not reading
+            LOG_warn << "State listener not keeping up: " << l->pending.size() << " bytes pending";
+            dropStateListener(l, "too slow");
         }
         else
         {
-            LOG_err << "ERROR writing to socket: " << errno;
+            l->pending.append(s);
+            if (!flushStateListener(l))
+            {
+                dropStateListener(l, "connection closed");
+            }
         }
     }
 
+    if (l->dropped)
+    {
+        LOG_debug << "Unregistering no longer listening client. Original petition: " << *inf;
+        removeStateListener(l);
+        mtxListeners.unlock();
+        return -1; // the petition will be deleted
+    }
+    mtxListeners.unlock();
     return 0;
 }
 
@@ -400,14 +833,28 @@ int ComunicationsManagerFileSockets::informStateListener(CmdPetition *inf, strin
  */
 CmdPetition * ComunicationsManagerFileSockets::getPetition()
 {
-    CmdPetitionPosixSockets *inf = new CmdPetitionPosixSockets();
-
-    clilen = sizeof( cli_addr );
+    if (readyPetitions.empty())
+    {
+        return NULL;
+    }
+    CmdPetition *inf = readyPetitions.front();
+    readyPetitions.pop_front();
+    return inf;
+}
 
-    newsockfd = accept(sockfd, (struct sockaddr*)&cli_addr, &clilen);
+bool ComunicationsManagerFileSockets::acceptConnection()
+{
+    sockaddr_in cliAddr;
+    socklen_t cliLength = sizeof( cliAddr );
+    int newsockfd = accept(sockfd, (struct sockaddr*)&cliAddr, &cliLength);
 
     if (newsockfd < 0)
     {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            return false;
+        }
+
         if (errno == EMFILE)
         {
             LOG_fatal << "ERROR on accept at getPetition: TOO many open files.";
@@ -421,67 +868,277 @@ CmdPetition * ComunicationsManagerFileSockets::getPetition()
         }
 
         sleep(1);
+        CmdPetitionPosixSockets *inf = new CmdPetitionPosixSockets();
         inf->line = strdup("ERROR");
-        return inf;
+        readyPetitions.push_back(inf);
+        return true;
     }
 
-    string wholepetition;
+    // its petition will be gathered as it arrives, without ever waiting for a client
+    incomingConnections[newsockfd] = string();
+    watchSocket(newsockfd, false, false);
+    return false;
+}
 
-    int n = read(newsockfd, buffer, 1023);
-    while(n == 1023)
+void ComunicationsManagerFileSockets::discardIncomingConnection(int socket)
+{
+    unwatchSocket(socket);
+    incomingConnections.erase(socket);
+    close(socket);
+}
+
+bool ComunicationsManagerFileSockets::processIncomingConnection(int socket)
+{
+    string &received = incomingConnections[socket];
+    bool open = recvAvailable(socket, &received);
+
+    if (received.size() && received[0] != '\0')
     {
-        unsigned long int total_available_bytes;
-        if (-1 == ioctl(newsockfd, FIONREAD, &total_available_bytes))
+        // protocol v1: the petition is whatever the client has written
+        if (received.size() > MCMD_MAX_PETITION_SIZE)
         {
-            LOG_err << "Failed to PeekNamedPipe. errno: " << errno;
-            break;
+            LOG_err << "Petition too long at getPetition: " << received.size() << " bytes. Discarding it";
+            discardIncomingConnection(socket);
+            return false;
         }
-        if (total_available_bytes == 0)
+        CmdPetitionPosixSockets *inf = new CmdPetitionPosixSockets();
+        inf->line = strdup(received.c_str());
+        unwatchSocket(socket);
+        incomingConnections.erase(socket);
+
+        int socket_id = 0;
+        inf->outSocket = create_new_socket(&socket_id);
+        if (!inf->outSocket || !socket_id)
         {
-            break;
+            LOG_fatal << "ERROR creating output socket at getPetition: " << errno;
+            free(inf->line);
+            inf->line = strdup("ERROR");
         }
-        buffer[n]=0;
-        wholepetition.append(buffer);
-        n = read(newsockfd, buffer, 1023);
+        else if (write(socket, &socket_id, sizeof( socket_id )) < 0)
+        {
+            LOG_fatal << "ERROR writing to socket at getPetition: " << errno;
+            free(inf->line);
+            inf->line = strdup("ERROR");
+        }
+        close(socket);
+        readyPetitions.push_back(inf);
+        return true;
     }
-    if (n >=0 )
+
+    if (received.size() >= MCMD_PROTOCOL_V2_MAGIC_SIZE && !memcmp(received.data(), MCMD_PROTOCOL_SESSION_MAGIC, MCMD_PROTOCOL_V2_MAGIC_SIZE))
     {
-        buffer[n]=0;
-        wholepetition.append(buffer);
+        string firstFrames = received.substr(MCMD_PROTOCOL_V2_MAGIC_SIZE);
+        unwatchSocket(socket);
+        incomingConnections.erase(socket);
+
+        CmdSessionPosixSockets *session = new CmdSessionPosixSockets(socket);
+        if (!sendSessionFrame(session, 0, MCMD_FRAME_SESSION, MCMD_OK, string()))
+        {
+            LOG_err << "ERROR accepting session: " << errno;
+            session->release();
+            return false;
+        }
+        sessions.push_back(session);
+        watchSocket(socket, false, false);
+        LOG_debug << "Session opened in socket " << socket << ". Open sessions: " << sessions.size();
+
+        // the first requests may have arrived along with the magic
+        session->received = firstFrames;
+        return processSessionInput(session);
     }
-    if (n < 0)
+
+    if (received.size() >= MCMD_PROTOCOL_V2_MAGIC_SIZE && !memcmp(received.data(), MCMD_PROTOCOL_V2_MAGIC, MCMD_PROTOCOL_V2_MAGIC_SIZE))
     {
-        LOG_fatal << "ERROR reading from socket at getPetition: " << errno;
-        inf->line = strdup("ERROR");
-        return inf;
+        const size_t headersize = MCMD_PROTOCOL_V2_MAGIC_SIZE + sizeof( uint32_t );
+        if (received.size() >= headersize)
+        {
+            uint32_t length;
+            memcpy(&length, received.data() + MCMD_PROTOCOL_V2_MAGIC_SIZE, sizeof( length ));
+            if (length > MCMD_MAX_PETITION_SIZE)
+            {
+                LOG_err << "Petition too long at getPetition: " << length << " bytes. Discarding it";
+                discardIncomingConnection(socket);
+                return false;
+            }
+
+            if (received.size() >= headersize + length)
+            {
+                // protocol v2: the output will be written in this same connection
+                CmdPetitionPosixSockets *inf = new CmdPetitionPosixSockets();
+                inf->protocolVersion = 2;
+                inf->acceptedOutSocket = socket;
+                inf->line = strdup(received.substr(headersize, length).c_str());
+                unwatchSocket(socket);
+                incomingConnections.erase(socket);
+                readyPetitions.push_back(inf);
+                return true;
+            }
+        }
+    }
+    else if (received.size() >= MCMD_PROTOCOL_V2_MAGIC_SIZE)
+    {
+        LOG_err << "Unknown protocol at getPetition. Discarding connection";
+        discardIncomingConnection(socket);
+        return false;
     }
 
-    int socket_id = 0;
-    inf->outSocket = create_new_socket(&socket_id);
-    if (!inf->outSocket || !socket_id)
+    if (!open)
     {
-        LOG_fatal << "ERROR creating output socket at getPetition: " << errno;
-        inf->line = strdup("ERROR");
-        return inf;
+        LOG_err << "Connection closed before its petition was complete";
+        discardIncomingConnection(socket);
     }
+    return false;
+}
 
-    n = write(newsockfd, &socket_id, sizeof( socket_id ));
-    if (n < 0)
+bool ComunicationsManagerFileSockets::processSessionInput(CmdSessionPosixSockets *session)
+{
+    bool open = recvAvailable(session->socket, &session->received);
+    bool ready = false;
+
+    // only complete frames are processed: the rest is kept for the next time
+    size_t offset = 0;
+    while (session->received.size() - offset >= sizeof( mcmdsessionframeheader ))
     {
-        LOG_fatal << "ERROR writing to socket at getPetition: " << errno;
-        inf->line = strdup("ERROR");
-        return inf;
+        mcmdsessionframeheader header;
+        memcpy(&header, session->received.data() + offset, sizeof( header ));
+        if (header.length > MCMD_MAX_PETITION_SIZE)
+        {
+            LOG_err << "Session frame too long: " << header.length << " bytes. Closing session";
+            closeSession(session);
+            return ready;
+        }
+        if (session->received.size() - offset - sizeof( header ) < header.length)
+        {
+            break;
+        }
+
+        string payload = session->received.substr(offset + sizeof( header ), header.length);
+        offset += sizeof( header ) + header.length;
+        ready |= processSessionFrame(session, header, payload);
     }
-    close(newsockfd);
+    session->received.erase(0, offset);
 
+    if (!open)
+    {
+        closeSession(session);
+    }
+    return ready;
+}
 
-    inf->line = strdup(wholepetition.c_str());
+bool ComunicationsManagerFileSockets::processSessionFrame(CmdSessionPosixSockets *session, const mcmdsessionframeheader &header, const string &payload)
+{
+    if (header.type == MCMD_FRAME_CONFIRMATION_RESPONSE)
+    {
+        session->mtxConfirmations.lock();
+        map<uint32_t, MegaSemaphore *>::iterator it = session->confirmationWaiters.find(header.requestId);
+        if (it != session->confirmationWaiters.end())
+        {
+            session->confirmationResponses[header.requestId] = header.outcode;
+            it->second->release();
+        }
+        else
+        {
+            LOG_warn << "Unexpected confirmation response for request " << header.requestId;
+        }
+        session->mtxConfirmations.unlock();
+        return false;
+    }
 
-    return inf;
+    if (header.type != MCMD_FRAME_REQUEST)
+    {
+        LOG_err << "Unexpected frame type in session: " << header.type;
+        return false;
+    }
+
+    CmdPetitionPosixSockets *inf = new CmdPetitionPosixSockets();
+    inf->protocolVersion = 2;
+    inf->session = session;
+    inf->requestId = header.requestId;
+    session->retain();
+    inf->line = strdup(payload.c_str());
+    readyPetitions.push_back(inf);
+    return true;
+}
+
+void ComunicationsManagerFileSockets::closeSession(CmdSessionPosixSockets *session)
+{
+    LOG_debug << "Session closed in socket " << session->socket;
+
+    sessions.erase(std::remove(sessions.begin(), sessions.end(), session), sessions.end());
+    unwatchSocket(session->socket);
+
+    // writers blocked in the connection (holding the session lock) fail right away
+    shutdown(session->socket, SHUT_RDWR);
+
+    // wake up petitions waiting for a confirmation that will never come
+    session->mtxConfirmations.lock();
+    session->closed = true;
+    for (map<uint32_t, MegaSemaphore *>::iterator it = session->confirmationWaiters.begin(); it != session->confirmationWaiters.end(); ++it)
+    {
+        session->confirmationResponses[it->first] = MCMDCONFIRM_NO;
+        it->second->release();
+    }
+    session->mtxConfirmations.unlock();
+
+    session->release();
 }
 
 int ComunicationsManagerFileSockets::getConfirmation(CmdPetition *inf, string message)
 {
+    CmdSessionPosixSockets *session = ((CmdPetitionPosixSockets *)inf)->session;
+    if (session)
+    {
+        uint32_t requestId = ((CmdPetitionPosixSockets *)inf)->requestId;
+        MegaSemaphore responded;
+
+        // registered before asking, since the response may arrive as soon as the question is sent
+        session->mtxConfirmations.lock();
+        if (session->closed)
+        {
+            session->mtxConfirmations.unlock();
+            return MCMDCONFIRM_NO;
+        }
+        session->confirmationWaiters[requestId] = &responded;
+        session->mtxConfirmations.unlock();
+
+        session->mtx.lock();
+        bool sent = sendSessionFrame(session, requestId, MCMD_FRAME_CONFIRMATION, MCMD_REQCONFIRM, message);
+        session->mtx.unlock();
+        if (sent)
+        {
+            responded.wait();
+        }
+        else
+        {
+            LOG_err << "ERROR writing confirmation frame to session: " << errno;
+        }
+
+        session->mtxConfirmations.lock();
+        int response = sent ? session->confirmationResponses[requestId] : MCMDCONFIRM_NO;
+        session->confirmationResponses.erase(requestId);
+        session->confirmationWaiters.erase(requestId);
+        session->mtxConfirmations.unlock();
+        return response;
+    }
+
+    if (((CmdPetitionPosixSockets *)inf)->protocolVersion == 2)
+    {
+        int connectedsocket = ((CmdPetitionPosixSockets *)inf)->acceptedOutSocket;
+        if (!sendFrame(connectedsocket, MCMD_FRAME_CONFIRMATION, MCMD_REQCONFIRM, message))
+        {
+            LOG_err << "ERROR writing confirmation frame to socket: " << errno;
+            return MCMDCONFIRM_NO;
+        }
+
+        int response = MCMDCONFIRM_NO;
+        if (!recvAll(connectedsocket, (char *)&response, sizeof( response )))
+        {
+            LOG_err << "ERROR reading confirmation response from socket: " << errno;
+            return MCMDCONFIRM_NO;
+        }
+        return response;
+    }
+
     sockaddr_in cliAddr;
     socklen_t cliLength = sizeof( cliAddr );
     int connectedsocket = ((CmdPetitionPosixSockets *)inf)->acceptedOutSocket;
@@ -516,12 +1173,59 @@ int ComunicationsManagerFileSockets::getConfirmation(CmdPetition *inf, string me
 string ComunicationsManagerFileSockets::get_petition_details(CmdPetition *inf)
 {
     ostringstream os;
-    os << "socket output: " << ((CmdPetitionPosixSockets *)inf)->outSocket;
+    if (((CmdPetitionPosixSockets *)inf)->session)
+    {
+        os << "session: " << ((CmdPetitionPosixSockets *)inf)->session->socket << " request: " << ((CmdPetitionPosixSockets *)inf)->requestId;
+    }
+    else if (((CmdPetitionPosixSockets *)inf)->protocolVersion == 2)
+    {
+        os << "socket connection (v2): " << ((CmdPetitionPosixSockets *)inf)->acceptedOutSocket;
+    }
+    else
+    {
+        os << "socket output: " << ((CmdPetitionPosixSockets *)inf)->outSocket;
+    }
     return os.str();
 }
 
 
 ComunicationsManagerFileSockets::~ComunicationsManagerFileSockets()
 {
+    while (incomingConnections.size())
+    {
+        discardIncomingConnection(incomingConnections.begin()->first);
+    }
+    while (readyPetitions.size())
+    {
+        delete readyPetitions.front();
+        readyPetitions.pop_front();
+    }
+
+    while (sessions.size())
+    {
+        closeSession(sessions.back());
+    }
+
+    mtxListeners.lock();
+    for (map<CmdPetition *, statelistener *>::iterator it = stateListeners.begin(); it != stateListeners.end(); it++)
+    {
+        delete it->second; // petitions are deleted by ComunicationsManager
+    }
+    stateListeners.clear();
+    stateListenersBySocket.clear();
+    mtxListeners.unlock();
+
+#ifdef __linux__
+    if (epollfd != -1)
+    {
+        close(epollfd);
+    }
+#else
+    if (wakeupPipe[0] != -1)
+    {
+        close(wakeupPipe[0]);
+        close(wakeupPipe[1]);
+    }
+#endif
     delete mtx;
 }
@@ -23,23 +23,89 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 
+#include <set>
+#include <deque>
+
+/**
+ * @brief Long lived connection through which a client sends several petitions
+ * It is shared by the petitions received through it, and deleted with its last reference
+ */
+class CmdSessionPosixSockets
+{
+private:
+    int refs;
+
+public:
+    int socket;
+    mega::MegaMutex mtx; //to serialize writes and guard refs
+
+    // the thread waiting for petitions never takes mtx: a writer may hold it while blocked in the connection
+    mega::MegaMutex mtxConfirmations; //guards closed & confirmations
+    bool closed;
+    std::map<uint32_t, mega::MegaSemaphore *> confirmationWaiters;
+    std::map<uint32_t, int> confirmationResponses;
+    std::string received; // incomplete frames (only accessed by the thread waiting for petitions)
+
+    CmdSessionPosixSockets(int socket)
+    {
+        this->socket = socket;
+        refs = 1;
+        closed = false;
+        mtx.init(false);
+        mtxConfirmations.init(false);
+    }
+
+    void retain()
+    {
+        mtx.lock();
+        refs++;
+        mtx.unlock();
+    }
+
+    void release()
+    {
+        mtx.lock();
+        bool last = !--refs;
+        mtx.unlock();
+        if (last)
+        {
+            close(socket);
+            delete this;
+        }
+    }
+};
+
 class CmdPetitionPosixSockets: public CmdPetition
 {
 public:
     int outSocket;
     int acceptedOutSocket;
+    int protocolVersion;
+    CmdSessionPosixSockets *session;
+    uint32_t requestId;
 
     CmdPetitionPosixSockets(){
+        outSocket = -1;
         acceptedOutSocket = -1;
+        protocolVersion = 1;
+        session = NULL;
+        requestId = 0;
     }
 
     virtual ~CmdPetitionPosixSockets()
     {
-        close(outSocket);
+        if (outSocket != -1)
+        {
+            close(outSocket);
+        }
         if (acceptedOutSocket != -1)
         {
             close(acceptedOutSocket);
         }
+        if (session)
+        {
+            session->release();
+        }
     }
 };
 
@@ -48,18 +114,48 @@ OUTSTREAMTYPE &operator<<(OUTSTREAMTYPE &os, CmdPetitionPosixSockets &p);
 class ComunicationsManagerFileSockets : public ComunicationsManager
 {
 private:
-    fd_set fds;
+    /**
+     * @brief Connection of a registered state listener
+     * Messages are queued in pending and written without blocking whenever the socket admits them.
+     * The sockets belong to the petition: they are closed when it is deleted
+     */
+    typedef struct statelistener_struct
+    {
+        CmdPetitionPosixSockets *petition;
+        int listeningSocket; // -1 once the listener has connected
+        int connectedSocket;
+        std::string pending;
+        bool watchingWrites;
+        bool dropped;
+    } statelistener;
+
+    std::map<CmdPetition *, statelistener *> stateListeners;
+    std::map<int, statelistener *> stateListenersBySocket;
+    mega::MegaMutex mtxListeners;
+
+#ifdef __linux__
+    int epollfd;
+#else
+    int wakeupPipe[2]; // to have poll reconsider the sockets watched
+#endif
+
+    // petitions received and not yet processed
+    std::deque<CmdPetition *> readyPetitions;
+
+    // connections accepted whose petition has not been entirely received yet, with what has been received
+    std::map<int, std::string> incomingConnections;
 
     // sockets and asociated variables
-    int sockfd, newsockfd;
-    socklen_t clilen;
-    char buffer[1024];
-    struct sockaddr_in serv_addr, cli_addr;
+    int sockfd;
+    struct sockaddr_in serv_addr;
 
     // to get next socket id
     int count;
     mega::MegaMutex *mtx;
 
+    // open sessions (only accessed by the thread waiting for petitions)
+    std::vector<CmdSessionPosixSockets *> sessions;
+
     /**
      * @brief create_new_socket
      * The caller is responsible for deleting the newly created socket
@@ -67,6 +163,62 @@ private:
      */
     int create_new_socket(int *sockId);
 
+    /**
+     * @brief Accepts a new connection, to be watched until its petition is complete
+     * @return true if a petition is ready to be processed (i.e. an error to be dismissed)
+     */
+    bool acceptConnection();
+
+    /**
+     * @brief Reads what has arrived through an incoming connection and queues its petition once it is complete
+     * Never waits for more data: petitions (or the start of sessions) are gathered across waits
+     * @return true if a petition is ready to be processed
+     */
+    bool processIncomingConnection(int socket);
+    void discardIncomingConnection(int socket);
+
+    /**
+     * @brief Sends a protocol v2 frame
+     * @return false if it could not be sent entirely
+     */
+    bool sendFrame(int socket, int type, int outCode, const std::string &payload);
+
+    /**
+     * @brief Sends a session frame. The caller must hold the session lock
+     * @return false if it could not be sent entirely
+     */
+    bool sendSessionFrame(CmdSessionPosixSockets *session, uint32_t requestId, int type, int outCode, const std::string &payload);
+
+    /**
+     * @brief Reads what a session has available and processes the frames completed.
+     * Never waits for more data: the rest of an incomplete frame is kept for the next time.
+     * The session is closed when its connection is.
+     * @return true if petitions are ready to be processed
+     */
+    bool processSessionInput(CmdSessionPosixSockets *session);
+    bool processSessionFrame(CmdSessionPosixSockets *session, const mcmdsessionframeheader &header, const std::string &payload);
+
+    void closeSession(CmdSessionPosixSockets *session);
+
+    /**
+     * @brief Adds a socket to the ones watched by waitForPetition or updates its events
+     * @param writable whether we are interested in writing to it (read events are always watched)
+     */
+    void watchSocket(int socket, bool writable, bool alreadyWatched);
+    void unwatchSocket(int socket);
+
+    /**
+     * @brief Handles the events of a socket. Returns true if a petition is ready to be processed
+     */
+    bool processSocketEvent(int socket, bool readable, bool writable, bool error);
+
+    // the following require mtxListeners to be locked
+    statelistener *getStateListener(CmdPetition *inf);
+    void processStateListenerEvent(statelistener *l, int socket, bool readable, bool writable, bool error);
+    bool flushStateListener(statelistener *l);
+    void dropStateListener(statelistener *l, const char *reason);
+    void removeStateListener(statelistener *l);
+
 public:
     ComunicationsManagerFileSockets();
 
@@ -88,12 +240,19 @@ public:
      */
     void returnAndClosePetition(CmdPetition *inf, OUTSTRINGSTREAM *s, int);
 
+    bool supportsStateListener(CmdPetition *inf);
+
+    bool supportsStreamingOutput(CmdPetition *inf);
+
+    bool sendPartialOutput(CmdPetition *inf, OUTSTRINGSTREAM *s);
+
     int informStateListener(CmdPetition *inf, std::string &s);
 
 
     /**
      * @brief getPetition
      * @return pointer to new CmdPetitionPosix. Petition returned must be properly deleted (this can be calling returnAndClosePetition)
+     * It might return NULL when what has been received requires no processing (e.g. a new session)
      */
     CmdPetition *getPetition();
 
@@ -19,6 +19,7 @@
 #include "configurationmanager.h"
 #include "megacmdversion.h"
 #include "megacmdutils.h"
+#include "megacmdrecordstore.h"
 #include <fstream>
 
 #ifdef _WIN32
@@ -50,6 +51,20 @@ std::set<std::string> ConfigurationManager::excludedNames;
 
 map<std::string, backup_struct *> ConfigurationManager::configuredBackups;
 
+vector<ConfigurationManager::configline> ConfigurationManager::configLines;
+map<string, string> ConfigurationManager::properties;
+bool ConfigurationManager::propertiesLoaded = false;
+int ConfigurationManager::openBatches = 0;
+bool ConfigurationManager::propertiesPending = false;
+bool ConfigurationManager::excludedNamesPending = false;
+vector<ConfigurationListener *> ConfigurationManager::listeners;
+MegaMutex ConfigurationManager::mtxProperties; // defined before mtxPropertiesInitialized: constructed before it is initialized
+bool ConfigurationManager::mtxPropertiesInitialized = ConfigurationManager::initPropertiesMutex();
+MegaCmdRecordStore *ConfigurationManager::syncsStore = NULL;
+MegaCmdRecordStore *ConfigurationManager::backupsStore = NULL;
+map<string, string> ConfigurationManager::savedSyncRecords;
+map<string, string> ConfigurationManager::savedBackupRecords;
+
 std::string ConfigurationManager::getConfigFolder()
 {
     return configFolder;
@@ -140,166 +155,296 @@ void ConfigurationManager::saveSession(const char*session)
     }
 }
 
-void ConfigurationManager::saveProperty(const char *property, const char *value)
+bool ConfigurationManager::initPropertiesMutex()
+{
+    // during static initialization, before any thread can race to lock it
+    mtxProperties.init(true);
+    return true;
+}
+
+void ConfigurationManager::lockProperties()
+{
+    mtxProperties.lock();
+
+    if (!propertiesLoaded)
+    {
+        loadProperties();
+    }
+}
+
+void ConfigurationManager::loadProperties()
 {
     if (!configFolder.size())
     {
         loadConfigDir();
     }
-    if (configFolder.size())
+    if (!configFolder.size())
     {
-        bool found = false;
-        stringstream configFile;
-        configFile << configFolder << "/" << "megacmd.cfg";
+        return;
+    }
+
+    configLines.clear();
+    properties.clear();
 
-        stringstream formerlines;
-        ifstream infile(configFile.str().c_str());
-        string line;
-        while (getline(infile, line))
+    stringstream configFile;
+    configFile << configFolder << "/" << "megacmd.cfg";
+    ifstream infile(configFile.str().c_str());
+    string line;
+    while (getline(infile, line))
+    {
+        configline cl;
+        cl.line = line;
+        if (line.length() > 0 && line[0] != '#')
         {
-            if (line.length() > 0 && line[0] != '#')
+            size_t pos = line.find("=");
+            if (pos != string::npos && ((pos + 1) < line.size()))
             {
-                string key;
-                size_t pos = line.find("=");
-                if (pos != string::npos && ((pos + 1) < line.size()))
+                string key = line.substr(0, pos);
+                rtrimProperty(key, ' ');
+                if (properties.find(key) != properties.end())
                 {
-                    key = line.substr(0, pos);
-                    rtrimProperty(key, ' ');
-
-                    if (!strcmp(key.c_str(), property))
-                    {
-                        if (!found)
-                        {
-                            formerlines << property << "=" << value << endl;
-                        }
-                        found = true;
-                    }
-                    else
-                    {
-                        formerlines << line << endl;
-                    }
-                }
-                else
-                {
-                    formerlines << line << endl;
+                    continue; // the first one prevails
                 }
+
+                string value = line.substr(pos + 1);
+                properties[key] = trimProperty(value);
+                cl.key = key;
             }
         }
-        ofstream fo(configFile.str().c_str());
+        configLines.push_back(cl);
+    }
+    propertiesLoaded = true;
+}
 
-        if (fo.is_open())
+void ConfigurationManager::writeProperties()
+{
+    stringstream configFile;
+    configFile << configFolder << "/" << "megacmd.cfg";
+
+    stringstream contents;
+    for (vector<configline>::iterator it = configLines.begin(); it != configLines.end(); ++it)
+    {
+        contents << it->line << endl;
+    }
+
+    if (!writeFileAtomically(configFile.str(), contents.str(), false))
+    {
+        LOG_err << "Unable to write configuration file: " << configFile.str();
+    }
+    propertiesPending = false;
+}
+
+void ConfigurationManager::notifyPropertyChanged(const string &property, const string &value)
+{
+    lockProperties();
+    vector<ConfigurationListener *> toNotify = listeners;
+    mtxProperties.unlock();
+
+    for (unsigned int i = 0; i < toNotify.size(); i++)
+    {
+        toNotify[i]->onPropertyChanged(property, value);
+    }
+}
+
+void ConfigurationManager::saveProperty(const char *property, const char *value)
+{
+    lockProperties();
+    if (!configFolder.size())
+    {
+        mtxProperties.unlock();
+        LOG_err << "Couldnt access configuration folder ";
+        return;
+    }
+
+    string line = string(property) + "=" + value;
+    string newValue(value);
+    trimProperty(newValue);
+
+    bool changed = true;
+    vector<configline>::iterator it = configLines.begin();
+    while (it != configLines.end() && it->key != property)
+    {
+        ++it;
+    }
+    if (it != configLines.end())
+    {
+        changed = it->line != line;
+        it->line = line;
+    }
+    else
+    {
+        configline cl;
+        cl.key = property;
+        cl.line = line;
+        configLines.push_back(cl);
+    }
+    properties[property] = newValue;
+
+    if (changed)
+    {
+        if (openBatches)
         {
-            fo << formerlines.str();
-            if (!found)
-            {
-                fo << property << "=" << value << endl;
-            }
-            fo.close();
+            propertiesPending = true;
         }
+        else
+        {
+            writeProperties();
+        }
+    }
+    mtxProperties.unlock();
 
+    if (changed)
+    {
+        notifyPropertyChanged(property, newValue);
+    }
+}
 
+void ConfigurationManager::beginPropertiesBatch()
+{
+    lockProperties();
+    openBatches++;
+    mtxProperties.unlock();
+}
+
+void ConfigurationManager::endPropertiesBatch()
+{
+    lockProperties();
+    if (openBatches > 0)
+    {
+        openBatches--;
+    }
+    if (!openBatches && configFolder.size())
+    {
+        if (propertiesPending)
+        {
+            writeProperties();
+        }
+        if (excludedNamesPending)
+        {
+            writeExcludedNames();
+        }
     }
+    mtxProperties.unlock();
 }
 
-void ConfigurationManager::saveSyncs(map<string, sync_struct *> *syncsmap)
+void ConfigurationManager::addConfigurationListener(ConfigurationListener *listener)
 {
-    stringstream syncsfile;
-    if (!configFolder.size())
+    lockProperties();
+    listeners.push_back(listener);
+    mtxProperties.unlock();
+}
+
+void ConfigurationManager::removeConfigurationListener(ConfigurationListener *listener)
+{
+    lockProperties();
+    for (vector<ConfigurationListener *>::iterator it = listeners.begin(); it != listeners.end(); ++it)
     {
-        loadConfigDir();
+        if (*it == listener)
+        {
+            listeners.erase(it);
+            break;
+        }
     }
-    if (configFolder.size())
+    mtxProperties.unlock();
+}
+
+MegaCmdRecordStore *ConfigurationManager::getSyncsStore()
+{
+    if (!syncsStore && configFolder.size())
     {
+        stringstream syncsfile;
         syncsfile << configFolder << "/" << "syncs";
         LOG_debug << "Syncs file: " << syncsfile.str();
+        syncsStore = new MegaCmdRecordStore(syncsfile.str(), SYNCSRECORDS);
+    }
+    return syncsStore;
+}
 
-        ofstream fo(syncsfile.str().c_str(), ios::out | ios::binary);
+MegaCmdRecordStore *ConfigurationManager::getBackupsStore()
+{
+    if (!backupsStore && configFolder.size())
+    {
+        stringstream backupsfile;
+        backupsfile << configFolder << "/" << "backups";
+        LOG_debug << "Backups file: " << backupsfile.str();
+        backupsStore = new MegaCmdRecordStore(backupsfile.str(), BACKUPSRECORDS);
+    }
+    return backupsStore;
+}
 
-        if (fo.is_open())
+/*
+ * Records of syncs: key: local path
+ *                   value: uint64 handle, int64 fingerprint, uint32 version of MEGAcmd
+ * Records of backups: key: local path
+ *                     value: uint64 handle, int64 period, int32 number of backups, uint32 version of MEGAcmd,
+ *                            period description (the rest)
+ */
+void ConfigurationManager::saveSyncs(map<string, sync_struct *> *syncsmap)
+{
+    lockProperties();
+    MegaCmdRecordStore *store = getSyncsStore();
+    if (store)
+    {
+        map<string, string> records;
+        if (syncsmap)
         {
-            map<string, sync_struct *>::iterator itr;
-            int i = 0;
-            if (syncsmap)
+            for (map<string, sync_struct *>::iterator itr = syncsmap->begin(); itr != syncsmap->end(); ++itr)
             {
-                for (itr = syncsmap->begin(); itr != syncsmap->end(); ++itr, i++)
-                {
-                    sync_struct *thesync = ((sync_struct*)( *itr ).second );
-
-                    long long controlvalue = CONFIGURATIONSTOREDBYVERSION;
-                    fo.write((char*)&controlvalue, sizeof( long long ));
-                    int versionmcmd = MEGACMD_CODE_VERSION;
-                    fo.write((char*)&versionmcmd, sizeof( int ));
-
-                    fo.write((char*)&thesync->fingerprint, sizeof( long long ));
-                    fo.write((char*)&thesync->handle, sizeof( MegaHandle ));
-                    const char * localPath = thesync->localpath.c_str();
-                    size_t lengthLocalPath = thesync->localpath.size();
-                    fo.write((char*)&lengthLocalPath, sizeof( size_t ));
-                    fo.write((char*)localPath, sizeof( char ) * lengthLocalPath);
-                }
+                sync_struct *thesync = itr->second;
+                string value;
+                MegaCmdRecordStore::appendInteger(&value, thesync->handle, 8);
+                MegaCmdRecordStore::appendInteger(&value, (unsigned long long)thesync->fingerprint, 8);
+                MegaCmdRecordStore::appendInteger(&value, MEGACMD_CODE_VERSION, 4);
+                records[thesync->localpath] = value;
             }
-
-            fo.close();
+        }
+        set<string> changed;
+        MegaCmdRecordStore::diff(savedSyncRecords, records, &changed);
+        if (store->save(records, changed))
+        {
+            savedSyncRecords.swap(records);
         }
     }
     else
     {
         LOG_err << "Couldnt access configuration folder ";
     }
+    mtxProperties.unlock();
 }
 
 void ConfigurationManager::saveBackups(map<string, backup_struct *> *backupsmap)
 {
-    stringstream backupsfile;
-    if (!configFolder.size())
-    {
-        loadConfigDir();
-    }
-    if (configFolder.size())
+    lockProperties();
+    MegaCmdRecordStore *store = getBackupsStore();
+    if (store)
     {
-        backupsfile << configFolder << "/" << "backups";
-        LOG_debug << "Backups file: " << backupsfile.str();
-
-        ofstream fo(backupsfile.str().c_str(), ios::out | ios::binary);
-
-        if (fo.is_open())
+        map<string, string> records;
+        if (backupsmap)
         {
-            map<string, backup_struct *>::iterator itr;
-            int i = 0;
-            if (backupsmap)
+            for (map<string, backup_struct *>::iterator itr = backupsmap->begin(); itr != backupsmap->end(); ++itr)
             {
-                for (itr = backupsmap->begin(); itr != backupsmap->end(); ++itr, i++)
-                {
-                    backup_struct *thebackup = ((backup_struct*)( *itr ).second );
-
-                    int versionmcmd = MEGACMD_CODE_VERSION;
-                    fo.write((char*)&versionmcmd, sizeof( int ));
-
-                    fo.write((char*)&thebackup->handle, sizeof( MegaHandle ));
-                    const char * localPath = thebackup->localpath.c_str();
-                    size_t lengthLocalPath = thebackup->localpath.size();
-                    fo.write((char*)&lengthLocalPath, sizeof( size_t ));
-                    fo.write((char*)localPath, sizeof( char ) * lengthLocalPath);
-
-                    fo.write((char*)&thebackup->numBackups, sizeof( int ));
-                    fo.write((char*)&thebackup->period, sizeof( int64_t ));
-
-                    const char * speriod = thebackup->speriod.c_str();
-                    size_t lengthLocalPeriod = thebackup->speriod.size();
-                    fo.write((char*)&lengthLocalPeriod, sizeof( size_t ));
-                    fo.write((char*)speriod, sizeof( char ) * lengthLocalPeriod);
-
-
-                }
+                backup_struct *thebackup = itr->second;
+                string value;
+                MegaCmdRecordStore::appendInteger(&value, thebackup->handle, 8);
+                MegaCmdRecordStore::appendInteger(&value, (unsigned long long)thebackup->period, 8);
+                MegaCmdRecordStore::appendInteger(&value, (unsigned int)thebackup->numBackups, 4);
+                MegaCmdRecordStore::appendInteger(&value, MEGACMD_CODE_VERSION, 4);
+                value.append(thebackup->speriod);
+                records[thebackup->localpath] = value;
             }
-
-            fo.close();
+        }
+        set<string> changed;
+        MegaCmdRecordStore::diff(savedBackupRecords, records, &changed);
+        if (store->save(records, changed))
+        {
+            savedBackupRecords.swap(records);
         }
     }
     else
     {
         LOG_err << "Couldnt access configuration folder ";
     }
+    mtxProperties.unlock();
 }
 
 void ConfigurationManager::addExcludedName(string excludedName)
@@ -317,6 +462,20 @@ void ConfigurationManager::removeExcludedName(string excludedName)
 }
 
 void ConfigurationManager::saveExcludedNames()
+{
+    lockProperties();
+    if (openBatches)
+    {
+        excludedNamesPending = true;
+    }
+    else
+    {
+        writeExcludedNames();
+    }
+    mtxProperties.unlock();
+}
+
+void ConfigurationManager::writeExcludedNames()
 {
     stringstream excludedNamesFile;
     if (!configFolder.size())
@@ -328,21 +487,22 @@ void ConfigurationManager::saveExcludedNames()
         excludedNamesFile << configFolder << "/" << "excluded";
         LOG_debug << "Exclusion file: " << excludedNamesFile.str();
 
-        ofstream fo(excludedNamesFile.str().c_str(), ios::out | ios::binary);
+        stringstream contents;
+        for (set<string>::iterator it=ConfigurationManager::excludedNames.begin(); it!=ConfigurationManager::excludedNames.end(); ++it)
+        {
+            contents << *it << endl;
+        }
 
-        if (fo.is_open())
+        if (!writeFileAtomically(excludedNamesFile.str(), contents.str(), true))
         {
-            for (set<string>::iterator it=ConfigurationManager::excludedNames.begin(); it!=ConfigurationManager::excludedNames.end(); ++it)
-            {
-                fo << *it << endl;
-            }
-            fo.close();
+            LOG_err << "Unable to write exclusion file: " << excludedNamesFile.str();
         }
     }
     else
     {
         LOG_err << "Couldnt access configuration folder ";
     }
+    excludedNamesPending = false;
 }
 
 void ConfigurationManager::loadExcludedNames()
@@ -408,154 +568,237 @@ void ConfigurationManager::unloadConfiguration()
     }
     ConfigurationManager::session = string();
     ConfigurationManager::excludedNames.clear();
+
+    if (mtxPropertiesInitialized)
+    {
+        mtxProperties.lock();
+        configLines.clear();
+        properties.clear();
+        propertiesLoaded = false;
+        delete syncsStore;
+        syncsStore = NULL;
+        delete backupsStore;
+        backupsStore = NULL;
+        savedSyncRecords.clear();
+        savedBackupRecords.clear();
+        mtxProperties.unlock();
+    }
 }
 
 void ConfigurationManager::loadsyncs()
 {
-    stringstream syncsfile;
     if (!configFolder.size())
     {
         loadConfigDir();
     }
-    if (configFolder.size())
-    {
-        syncsfile << configFolder << "/" << "syncs";
-        LOG_debug << "Syncs file: " << syncsfile.str();
 
-        ifstream fi(syncsfile.str().c_str(), ios::in | ios::binary);
+    lockProperties();
+    MegaCmdRecordStore *store = getSyncsStore();
+    if (store)
+    {
+        map<string, string> records;
+        int result = store->load(&records);
+        if (result == MegaCmdRecordStore::STORE_UNKNOWN_FORMAT)
+        {
+            LOG_info << "Migrating syncs file to the current format";
+            store->backupFile(); // kept until the migrated file is loaded
+            loadLegacySyncs(store->getPath());
+            saveSyncs(&configuredSyncs);
+        }
+        else
+        {
+            savedSyncRecords = records;
+        }
 
-        if (fi.is_open())
+        for (map<string, string>::iterator it = records.begin(); it != records.end(); ++it)
         {
-            if (fi.fail())
+            if (it->second.size() < 20)
             {
-                LOG_err << "fail with sync file";
+                LOG_err << "Failed to restore sync info of " << it->first;
+                continue;
             }
+            const char *value = it->second.data();
+            sync_struct *thesync = new sync_struct;
+            thesync->localpath = it->first;
+            thesync->handle = (MegaHandle)MegaCmdRecordStore::readInteger(value, 8);
+            thesync->fingerprint = (long long)MegaCmdRecordStore::readInteger(value + 8, 8);
 
-            bool updateSavedFormatRequired = false;
-            while (!( fi.peek() == EOF ))
+            if (configuredSyncs.find(thesync->localpath) != configuredSyncs.end())
             {
-                int versioncodeStoredValues;
-
-                sync_struct *thesync = new sync_struct;
-                //Load syncs
-                fi.read((char*)&thesync->fingerprint, sizeof( long long ));
-                if (thesync->fingerprint == CONFIGURATIONSTOREDBYVERSION)
-                {
-                    fi.read((char*)&versioncodeStoredValues, sizeof(int));
-                }
-                else
-                {
-                    versioncodeStoredValues = 90500;
-                }
-
-                if (versioncodeStoredValues > 90500)
-                {
-                    fi.read((char*)&thesync->fingerprint, sizeof( long long ));
-                }
+                delete configuredSyncs[thesync->localpath];
+            }
+            configuredSyncs[thesync->localpath] = thesync;
+        }
+    }
+    mtxProperties.unlock();
+}
 
-                fi.read((char*)&thesync->handle, sizeof( MegaHandle ));
-                size_t lengthLocalPath;
-                fi.read((char*)&lengthLocalPath, sizeof( size_t ));
-                thesync->localpath.resize(lengthLocalPath);
-                fi.read((char*)thesync->localpath.c_str(), sizeof( char ) * lengthLocalPath);
+void ConfigurationManager::loadbackups()
+{
+    if (!configFolder.size())
+    {
+        loadConfigDir();
+    }
 
-                if (configuredSyncs.find(thesync->localpath) != configuredSyncs.end())
-                {
-                    delete configuredSyncs[thesync->localpath];
-                }
-                configuredSyncs[thesync->localpath] = thesync;
+    lockProperties();
+    MegaCmdRecordStore *store = getBackupsStore();
+    if (store)
+    {
+        map<string, string> records;
+        int result = store->load(&records);
+        if (result == MegaCmdRecordStore::STORE_UNKNOWN_FORMAT)
+        {
+            LOG_info << "Migrating backups file to the current format";
+            store->backupFile(); // kept until the migrated file is loaded
+            loadLegacyBackups(store->getPath());
+            saveBackups(&configuredBackups);
+        }
+        else
+        {
+            savedBackupRecords = records;
+        }
 
-                if (versioncodeStoredValues != MEGACMD_CODE_VERSION)
-                {
-                    updateSavedFormatRequired = true;
-                }
-            }
-            if (updateSavedFormatRequired)
+        for (map<string, string>::iterator it = records.begin(); it != records.end(); ++it)
+        {
+            if (it->second.size() < 24)
             {
-                ConfigurationManager::saveSyncs(&ConfigurationManager::configuredSyncs);
+                LOG_err << "Failed to restore backup info of " << it->first;
+                continue;
             }
-
-            if (fi.bad())
+            const char *value = it->second.data();
+            backup_struct *thebackup = new backup_struct;
+            thebackup->localpath = it->first;
+            thebackup->handle = (MegaHandle)MegaCmdRecordStore::readInteger(value, 8);
+            thebackup->period = (int64_t)MegaCmdRecordStore::readInteger(value + 8, 8);
+            thebackup->numBackups = (int)MegaCmdRecordStore::readInteger(value + 16, 4);
+            thebackup->speriod = it->second.substr(24);
+
+            if (configuredBackups.find(thebackup->localpath) != configuredBackups.end())
             {
-                LOG_err << "fail with sync file  at the end";
+                delete configuredBackups[thebackup->localpath];
             }
 
-            fi.close();
+            thebackup->id = -1; //id will be set upon resumption
+            thebackup->tag = -1; //tag will be set upon resumption
+
+            configuredBackups[thebackup->localpath] = thebackup;
         }
     }
+    mtxProperties.unlock();
 }
 
-
-void ConfigurationManager::loadbackups()
+void ConfigurationManager::loadLegacySyncs(string syncsFile)
 {
-    stringstream backupsfile;
-    if (!configFolder.size())
-    {
-        loadConfigDir();
-    }
-    if (configFolder.size())
-    {
-        backupsfile << configFolder << "/" << "backups";
-        LOG_debug << "Backups file: " << backupsfile.str();
+    ifstream fi(syncsFile.c_str(), ios::in | ios::binary);
 
-        ifstream fi(backupsfile.str().c_str(), ios::in | ios::binary);
+    if (fi.is_open())
+    {
+        if (fi.fail())
+        {
+            LOG_err << "fail with sync file";
+        }
 
-        if (fi.is_open())
+        while (!( fi.peek() == EOF ))
         {
-            if (fi.fail())
+            int versioncodeStoredValues;
+
+            sync_struct *thesync = new sync_struct;
+            //Load syncs
+            fi.read((char*)&thesync->fingerprint, sizeof( long long ));
+            if (thesync->fingerprint == CONFIGURATIONSTOREDBYVERSION)
+            {
+                fi.read((char*)&versioncodeStoredValues, sizeof(int));
+            }
+            else
             {
-                LOG_err << "fail with backup file";
+                versioncodeStoredValues = 90500;
             }
 
-            while (!( fi.peek() == EOF ))
+            if (versioncodeStoredValues > 90500)
             {
-                backup_struct *thebackup = new backup_struct;
-                //Load backups
-                int versionmcmd;
-                fi.read((char*)&versionmcmd, sizeof( int ));
-
-                fi.read((char*)&thebackup->handle, sizeof( MegaHandle ));
-                size_t lengthLocalPath;
-                fi.read((char*)&lengthLocalPath, sizeof( size_t ));
-                if (lengthLocalPath && lengthLocalPath <= PATH_MAX_LOCAL_BACKUP)
-                {
-                    thebackup->localpath.resize(lengthLocalPath);
-                    fi.read((char*)thebackup->localpath.c_str(), sizeof( char ) * lengthLocalPath);
+                fi.read((char*)&thesync->fingerprint, sizeof( long long ));
+            }
+
+            fi.read((char*)&thesync->handle, sizeof( MegaHandle ));
+            size_t lengthLocalPath;
+            fi.read((char*)&lengthLocalPath, sizeof( size_t ));
+            thesync->localpath.resize(lengthLocalPath);
+            fi.read((char*)thesync->localpath.c_str(), sizeof( char ) * lengthLocalPath);
+
+            if (configuredSyncs.find(thesync->localpath) != configuredSyncs.end())
+            {
+                delete configuredSyncs[thesync->localpath];
+            }
+            configuredSyncs[thesync->localpath] = thesync;
+        }
+        if (fi.bad())
+        {
+            LOG_err << "fail with sync file  at the end";
+        }
+
+        fi.close();
+    }
+}
 
-                    fi.read((char*)&thebackup->numBackups, sizeof( int ));
-                    fi.read((char*)&thebackup->period, sizeof( int64_t ));
+void ConfigurationManager::loadLegacyBackups(string backupsFile)
+{
+    ifstream fi(backupsFile.c_str(), ios::in | ios::binary);
+
+    if (fi.is_open())
+    {
+        if (fi.fail())
+        {
+            LOG_err << "fail with backup file";
+        }
 
-                    size_t lengthLocalPeriod;
-                    fi.read((char*)&lengthLocalPeriod, sizeof( size_t ));
-                    if (lengthLocalPeriod && lengthLocalPeriod <= PATH_MAX_LOCAL_BACKUP)
-                    {
-                        thebackup->speriod.resize(lengthLocalPeriod);
-                        fi.read((char*)thebackup->speriod.c_str(), sizeof( char ) * lengthLocalPeriod);
+        while (!( fi.peek() == EOF ))
+        {
+            backup_struct *thebackup = new backup_struct;
+            //Load backups
+            int versionmcmd;
+            fi.read((char*)&versionmcmd, sizeof( int ));
+
+            fi.read((char*)&thebackup->handle, sizeof( MegaHandle ));
+            size_t lengthLocalPath;
+            fi.read((char*)&lengthLocalPath, sizeof( size_t ));
+            if (lengthLocalPath && lengthLocalPath <= PATH_MAX_LOCAL_BACKUP)
+            {
+                thebackup->localpath.resize(lengthLocalPath);
+                fi.read((char*)thebackup->localpath.c_str(), sizeof( char ) * lengthLocalPath);
 
-                    }
-                    if (configuredBackups.find(thebackup->localpath) != configuredBackups.end())
-                    {
-                        delete configuredBackups[thebackup->localpath];
-                    }
+                fi.read((char*)&thebackup->numBackups, sizeof( int ));
+                fi.read((char*)&thebackup->period, sizeof( int64_t ));
 
-                    thebackup->id = -1; //id will be set upon resumption
-                    thebackup->tag = -1; //tag will be set upon resumption
+                size_t lengthLocalPeriod;
+                fi.read((char*)&lengthLocalPeriod, sizeof( size_t ));
+                if (lengthLocalPeriod && lengthLocalPeriod <= PATH_MAX_LOCAL_BACKUP)
+                {
+                    thebackup->speriod.resize(lengthLocalPeriod);
+                    fi.read((char*)thebackup->speriod.c_str(), sizeof( char ) * lengthLocalPeriod);
 
-                    configuredBackups[thebackup->localpath] = thebackup;
                 }
-                else
+                if (configuredBackups.find(thebackup->localpath) != configuredBackups.end())
                 {
-                    LOG_err << " Failed to restore backup info";
+                    delete configuredBackups[thebackup->localpath];
                 }
-            }
 
-            if (fi.bad())
+                thebackup->id = -1; //id will be set upon resumption
+                thebackup->tag = -1; //tag will be set upon resumption
+
+                configuredBackups[thebackup->localpath] = thebackup;
+            }
+            else
             {
-                LOG_err << "fail with backup file  at the end";
+                LOG_err << " Failed to restore backup info";
             }
+        }
 
-            fi.close();
+        if (fi.bad())
+        {
+            LOG_err << "fail with backup file  at the end";
         }
+
+        fi.close();
     }
 }
 
@@ -596,36 +839,43 @@ void ConfigurationManager::loadConfiguration(bool debug)
 
 string ConfigurationManager::getConfigurationSValue(string propertyName)
 {
-    if (!configFolder.size())
-    {
-        loadConfigDir();
-    }
-    if (configFolder.size())
+    lockProperties();
+    string value;
+    map<string, string>::iterator it = properties.find(propertyName);
+    if (it != properties.end())
     {
-        stringstream configFile;
-        configFile << configFolder << "/" << "megacmd.cfg";
-        return getPropertyFromFile(configFile.str().c_str(),propertyName.c_str());
+        value = it->second;
     }
-    return string();
+    mtxProperties.unlock();
+    return value;
 }
 
 void ConfigurationManager::clearConfigurationFile()
 {
-    if (!configFolder.size())
+    lockProperties();
+    vector<string> removed;
+    for (map<string, string>::iterator it = properties.begin(); it != properties.end(); ++it)
     {
-        loadConfigDir();
+        removed.push_back(it->first);
     }
+    configLines.clear();
+    properties.clear();
+
     if (configFolder.size())
     {
-        stringstream configFile;
-        configFile << configFolder << "/" << "megacmd.cfg";
-        ofstream fo(configFile.str().c_str());
-
-        if (fo.is_open())
+        if (openBatches)
         {
-            fo << "";
-            fo.close();
+            propertiesPending = true;
+        }
+        else
+        {
+            writeProperties();
         }
     }
+    mtxProperties.unlock();
 
+    for (unsigned int i = 0; i < removed.size(); i++)
+    {
+        notifyPropertyChanged(removed[i], string());
+    }
 }
@@ -22,15 +22,75 @@
 #include "megacmd.h"
 #include <map>
 #include <set>
+#include <vector>
 
 #define CONFIGURATIONSTOREDBYVERSION -2
+
+// types of records of the stores (see MegaCmdRecordStore)
+#define SYNCSRECORDS 1
+#define BACKUPSRECORDS 2
+#define FINGERPRINTRECORDS 3 // see MegaCmdFingerprintCache
+
+class MegaCmdRecordStore;
+
+/**
+ * @brief Notified when a property of the configuration (megacmd.cfg) changes
+ */
+class ConfigurationListener
+{
+public:
+    /**
+     * @brief Called after the change, from the thread that saved it (without holding any lock)
+     * @param value new value, empty if the property was removed
+     */
+    virtual void onPropertyChanged(const std::string &property, const std::string &value) = 0;
+    virtual ~ConfigurationListener() {}
+};
 class ConfigurationManager
 {
 private:
     static std::string configFolder;
 
+    typedef struct configline_struct
+    {
+        std::string key; // empty for lines that are not properties (e.g. comments)
+        std::string line;
+    } configline;
+
+    // megacmd.cfg is read once and kept in memory: properties are read from here
+    static std::vector<configline> configLines; // as in the file
+    static std::map<std::string, std::string> properties;
+    static bool propertiesLoaded;
+    static int openBatches;
+    static bool propertiesPending; // changes not written because of a batch
+    static bool excludedNamesPending;
+    static std::vector<ConfigurationListener *> listeners;
+    static mega::MegaMutex mtxProperties;
+    static bool mtxPropertiesInitialized; // set before main, by initPropertiesMutex
+
+    // syncs and backups are saved appending their changes (they are protected by mtxProperties too)
+    static MegaCmdRecordStore *syncsStore;
+    static MegaCmdRecordStore *backupsStore;
+    static std::map<std::string, std::string> savedSyncRecords; // as last loaded or saved, to tell the stores what changed
+    static std::map<std::string, std::string> savedBackupRecords;
+
     static void loadConfigDir();
 
+    // the following require mtxProperties to be locked
+    static void loadProperties();
+    static void writeProperties();
+    static void writeExcludedNames();
+    static MegaCmdRecordStore *getSyncsStore();
+    static MegaCmdRecordStore *getBackupsStore();
+
+    // formats used before MegaCmdRecordStore, to migrate from them
+    static void loadLegacySyncs(std::string syncsFile);
+    static void loadLegacyBackups(std::string backupsFile);
+
+    static bool initPropertiesMutex();
+    static void lockProperties();
+    static void notifyPropertyChanged(const std::string &property, const std::string &value);
+
 
 public:
     static std::map<std::string, sync_struct *> configuredSyncs;
@@ -61,6 +121,17 @@ public:
 
     static void saveProperty(const char* property, const char* value);
 
+    /**
+     * @brief Defers writing the properties (and the excluded names) saved until the matching
+     * endPropertiesBatch, so that those saved together are written to disk at once.
+     * Meanwhile they can be read as usual.
+     */
+    static void beginPropertiesBatch();
+    static void endPropertiesBatch();
+
+    static void addConfigurationListener(ConfigurationListener *listener);
+    static void removeConfigurationListener(ConfigurationListener *listener);
+
     template<typename T>
     static void savePropertyValue(const char* property, T value)
     {
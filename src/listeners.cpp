@@ -62,14 +62,31 @@ void MegaCmdGlobalListener::onUsersUpdate(MegaApi *api, MegaUserList *users)
     }
 }
 
-MegaCmdGlobalListener::MegaCmdGlobalListener(MegaCMDLogger *logger, MegaCmdSandbox *sandboxCMD)
+MegaCmdGlobalListener::MegaCmdGlobalListener(MegaCMDLogger *logger, MegaCmdSandbox *sandboxCMD, MegaCmdPathIndex *pathIndex, MegaCmdSizeCache *sizeCache,
+                                             MegaCmdSyncStatusTable *syncStatus)
 {
     this->loggerCMD = logger;
     this->sandboxCMD = sandboxCMD;
+    this->pathIndex = pathIndex;
+    this->sizeCache = sizeCache;
+    this->syncStatus = syncStatus;
 }
 
 void MegaCmdGlobalListener::onNodesUpdate(MegaApi *api, MegaNodeList *nodes)
 {
+    if (pathIndex)
+    {
+        pathIndex->onNodesUpdate(nodes);
+    }
+    if (sizeCache)
+    {
+        sizeCache->onNodesUpdate(nodes);
+    }
+    if (syncStatus)
+    {
+        syncStatus->onNodesUpdate(nodes);
+    }
+
     long long nfolders = 0;
     long long nfiles = 0;
     long long rfolders = 0;
@@ -166,6 +183,11 @@ void MegaCmdGlobalListener::onAccountUpdate(MegaApi *api)
 
 void MegaCmdMegaListener::onRequestFinish(MegaApi *api, MegaRequest *request, MegaError *e)
 {
+    if (pathIndex)
+    {
+        pathIndex->onRequestFinish(request, e);
+    }
+
     if (e && ( e->getErrorCode() == MegaError::API_ESID ))
     {
         LOG_err << "Session is no longer valid (it might have been invalidated from elsewhere) ";
@@ -173,10 +195,21 @@ void MegaCmdMegaListener::onRequestFinish(MegaApi *api, MegaRequest *request, Me
     }
 }
 
-MegaCmdMegaListener::MegaCmdMegaListener(MegaApi *megaApi, MegaListener *parent)
+void MegaCmdMegaListener::onTransferFinish(MegaApi *api, MegaTransfer *transfer, MegaError *e)
+{
+    if (pathIndex)
+    {
+        pathIndex->onTransferFinish(transfer, e);
+    }
+}
+
+MegaCmdMegaListener::MegaCmdMegaListener(MegaApi *megaApi, MegaListener *parent, MegaCmdSyncStatusTable *syncStatus,
+                                         MegaCmdPathIndex *pathIndex)
 {
     this->megaApi = megaApi;
     this->listener = parent;
+    this->syncStatus = syncStatus;
+    this->pathIndex = pathIndex;
 }
 
 MegaCmdMegaListener::~MegaCmdMegaListener()
@@ -188,6 +221,24 @@ MegaCmdMegaListener::~MegaCmdMegaListener()
     }
 }
 
+#ifdef ENABLE_SYNC
+void MegaCmdMegaListener::onSyncStateChanged(MegaApi *api, MegaSync *sync)
+{
+    if (syncStatus)
+    {
+        syncStatus->onSyncStateChanged(sync);
+    }
+}
+
+void MegaCmdMegaListener::onSyncFileStateChanged(MegaApi *api, MegaSync *sync, string *localPath, int newState)
+{
+    if (syncStatus)
+    {
+        syncStatus->onSyncFileStateChanged(sync, localPath, newState);
+    }
+}
+#endif
+
 #ifdef ENABLE_CHAT
 void MegaCmdMegaListener::onChatsUpdate(MegaApi *api, MegaTextChatList *chats)
 {}
@@ -249,42 +300,7 @@ void MegaCmdListener::doOnRequestFinish(MegaApi* api, MegaRequest *request, Mega
     {
         case MegaRequest::TYPE_FETCH_NODES:
         {
-            map<string, sync_struct *>::iterator itr;
-            int i = 0;
-#ifdef ENABLE_SYNC
-
-            for (itr = ConfigurationManager::configuredSyncs.begin(); itr != ConfigurationManager::configuredSyncs.end(); ++itr, i++)
-            {
-                sync_struct *oldsync = ((sync_struct*)( *itr ).second );
-
-                MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-                MegaNode * node = api->getNodeByHandle(oldsync->handle);
-                api->resumeSync(oldsync->localpath.c_str(), node, oldsync->fingerprint, megaCmdListener);
-                megaCmdListener->wait();
-                if ( megaCmdListener->getError()->getErrorCode() == MegaError::API_OK )
-                {
-                    oldsync->fingerprint = megaCmdListener->getRequest()->getNumber();
-                    oldsync->active = true;
-                    oldsync->loadedok = true;
-
-                    char *nodepath = api->getNodePath(node);
-                    LOG_info << "Loaded sync: " << oldsync->localpath << " to " << nodepath;
-                    delete []nodepath;
-                }
-                else
-                {
-                    oldsync->loadedok = false;
-                    oldsync->active = false;
-
-                    char *nodepath = api->getNodePath(node);
-                    LOG_err << "Failed to resume sync: " << oldsync->localpath << " to " << nodepath;
-                    delete []nodepath;
-                }
-
-                delete megaCmdListener;
-                delete node;
-            }
-#endif
+            // configured syncs are resumed afterwards (see MegaCmdSyncRestarter), not blocking this thread
             informProgressUpdate(PROGRESS_COMPLETE, request->getTotalBytes(), this->clientID, "Fetching nodes");
 
             break;
@@ -309,21 +325,6 @@ void MegaCmdListener::onRequestUpdate(MegaApi* api, MegaRequest *request)
     {
         case MegaRequest::TYPE_FETCH_NODES:
         {
-            unsigned int cols = getNumberOfCols(80);
-            string outputString;
-            outputString.resize(cols+1);
-            for (unsigned int i = 0; i < cols; i++)
-            {
-                outputString[i] = '.';
-            }
-
-            outputString[cols] = '\0';
-            char *ptr = (char *)outputString.c_str();
-            sprintf(ptr, "%s", "Fetching nodes ||");
-            ptr += strlen("Fetching nodes ||");
-            *ptr = '.'; //replace \0 char
-
-
             float oldpercent = percentFetchnodes;
             if (request->getTotalBytes() == 0)
             {
@@ -342,7 +343,6 @@ void MegaCmdListener::onRequestUpdate(MegaApi* api, MegaRequest *request)
                 percentFetchnodes = 0;
             }
 
-            char aux[40];
             if (request->getTotalBytes() < 0)
             {
                 return;                         // after a 100% this happens
@@ -351,22 +351,13 @@ void MegaCmdListener::onRequestUpdate(MegaApi* api, MegaRequest *request)
             {
                 return;                                                            // after a 100% this happens
             }
-            sprintf(aux,"||(%lld/%lld MB: %.2f %%) ", request->getTransferredBytes() / 1024 / 1024, request->getTotalBytes() / 1024 / 1024, percentFetchnodes);
-            sprintf((char *)outputString.c_str() + cols - strlen(aux), "%s",                         aux);
-            for (int i = 0; i <= ( cols - strlen("Fetching nodes ||") - strlen(aux)) * 1.0 * percentFetchnodes / 100.0; i++)
-            {
-                *ptr++ = '#';
-            }
 
-            if (percentFetchnodes == 100 && !alreadyFinished)
+            bool final = percentFetchnodes == 100 && !alreadyFinished;
+            if (final)
             {
                 alreadyFinished = true;
-		std::cout << outputString << std::endl;
-            }
-            else
-            {
-		    std::cout << outputString << '\r' << std::flush;
             }
+            informProgressBar("Fetching nodes", request->getTransferredBytes(), request->getTotalBytes(), final);
 
             informProgressUpdate(request->getTransferredBytes(), request->getTotalBytes(), this->clientID, "Fetching nodes");
 
@@ -449,22 +440,6 @@ void MegaCmdTransferListener::onTransferUpdate(MegaApi* api, MegaTransfer *trans
         return;
     }
 
-    unsigned int cols = getNumberOfCols(80);
-
-    string outputString;
-    outputString.resize(cols + 1);
-    for (unsigned int i = 0; i < cols; i++)
-    {
-        outputString[i] = '.';
-    }
-
-    outputString[cols] = '\0';
-    char *ptr = (char *)outputString.c_str();
-    sprintf(ptr, "%s", "TRANSFERRING ||");
-    ptr += strlen("TRANSFERRING ||");
-    *ptr = '.'; //replace \0 char
-
-
     float oldpercent = percentDownloaded;
     if (transfer->getTotalBytes() == 0)
     {
@@ -483,7 +458,6 @@ void MegaCmdTransferListener::onTransferUpdate(MegaApi* api, MegaTransfer *trans
         percentDownloaded = 0;
     }
 
-    char aux[40];
     if (transfer->getTotalBytes() < 0)
     {
         return; // after a 100% this happens
@@ -492,22 +466,13 @@ void MegaCmdTransferListener::onTransferUpdate(MegaApi* api, MegaTransfer *trans
     {
         return; // after a 100% this happens
     }
-    sprintf(aux,"||(%lld/%lld MB: %.2f %%) ", (long long)(transfer->getTransferredBytes() / 1024 / 1024), (long long)(transfer->getTotalBytes() / 1024 / 1024), (float)percentDownloaded);
-    sprintf((char *)outputString.c_str() + cols - strlen(aux), "%s",                         aux);
-    for (int i = 0; i <= ( cols - strlen("TRANSFERRING ||") - strlen(aux)) * 1.0 * percentDownloaded / 100.0; i++)
-    {
-        *ptr++ = '#';
-    }
 
-    if (percentDownloaded == 100 && !alreadyFinished)
+    bool final = percentDownloaded == 100 && !alreadyFinished;
+    if (final)
     {
         alreadyFinished = true;
-	std::cout << outputString << std::endl;
-    }
-    else
-    {
-	    std::cout << outputString << '\r' << std::flush;
     }
+    informProgressBar("TRANSFERRING", transfer->getTransferredBytes(), transfer->getTotalBytes(), final);
 
     LOG_verbose << "onTransferUpdate transfer->getType(): " << transfer->getType() << " clientID=" << this->clientID;
 
@@ -557,14 +522,16 @@ void MegaCmdMultiTransferListener::onTransferStart(MegaApi* api, MegaTransfer *t
         return;
     }
     alreadyFinished = false;
+    mtxBytes.lock();
     if (totalbytes == 0)
     {
         percentDownloaded = 0;
     }
     else
     {
-        percentDownloaded = float((transferredbytes + getOngoingTransferredBytes()) * 1.0 / totalbytes * 1.0);
+        percentDownloaded = float((transferredbytes + ongoingTransferred) * 1.0 / totalbytes * 1.0);
     }
+    mtxBytes.unlock();
 
     onTransferUpdate(api,transfer);
 
@@ -573,9 +540,20 @@ void MegaCmdMultiTransferListener::onTransferStart(MegaApi* api, MegaTransfer *t
 
 void MegaCmdMultiTransferListener::doOnTransferFinish(MegaApi* api, MegaTransfer *transfer, MegaError* e)
 {
-    finished++;
     finalerror = (finalerror!=API_OK)?finalerror:e->getErrorCode();
 
+    // counted along with the bytes, so that no snapshot sees the transfer finished but its bytes still ongoing
+    mtxBytes.lock();
+    finished++;
+    finishTime = getMonotonicMicroSeconds();
+    if (transfer)
+    {
+        removeOngoing(transfer->getTag());
+        transferredbytes+=transfer->getTransferredBytes();
+        totalbytes+=transfer->getTotalBytes();
+    }
+    mtxBytes.unlock();
+
     if (!transfer)
     {
         LOG_err << " onTransferFinish for undefined transfer ";
@@ -583,25 +561,11 @@ void MegaCmdMultiTransferListener::doOnTransferFinish(MegaApi* api, MegaTransfer
     }
 
     LOG_verbose << "doOnTransferFinish MegaCmdMultiTransferListener Transfer->getType(): " << transfer->getType() << " transferring " << transfer->getFileName();
-    map<int, long long>::iterator itr = ongoingtransferredbytes.find(transfer->getTag());
-    if ( itr!= ongoingtransferredbytes.end())
-    {
-        ongoingtransferredbytes.erase(itr);
-    }
-
-    itr = ongoingtotalbytes.find(transfer->getTag());
-    if ( itr!= ongoingtotalbytes.end())
-    {
-        ongoingtotalbytes.erase(itr);
-    }
-
-    transferredbytes+=transfer->getTransferredBytes();
-    totalbytes+=transfer->getTotalBytes();
 }
 
 void MegaCmdMultiTransferListener::waitMultiEnd()
 {
-    for (int i=0; i < started; i++)
+    for (; waited < started; waited++)
     {
         wait();
     }
@@ -615,33 +579,23 @@ void MegaCmdMultiTransferListener::onTransferUpdate(MegaApi* api, MegaTransfer *
         LOG_err << " onTransferUpdate for undefined Transfer ";
         return;
     }
-    ongoingtransferredbytes[transfer->getTag()] = transfer->getTransferredBytes();
-    ongoingtotalbytes[transfer->getTag()] = transfer->getTotalBytes();
-
-    unsigned int cols = getNumberOfCols(80);
-
-    string outputString;
-    outputString.resize(cols + 1);
-    for (unsigned int i = 0; i < cols; i++)
-    {
-        outputString[i] = '.';
-    }
-
-    outputString[cols] = '\0';
-    char *ptr = (char *)outputString.c_str();
-    sprintf(ptr, "%s", "TRANSFERRING ||");
-    ptr += strlen("TRANSFERRING ||");
-    *ptr = '.'; //replace \0 char
-
+    mtxBytes.lock();
+    ongoingtransfer *ot = getOngoing(transfer->getTag());
+    ongoingTransferred += transfer->getTransferredBytes() - ot->transferred;
+    ongoingTotal += transfer->getTotalBytes() - ot->total;
+    ot->transferred = transfer->getTransferredBytes();
+    ot->total = transfer->getTotalBytes();
+    transfersnapshot snapshot = takeSnapshot();
+    mtxBytes.unlock();
 
     float oldpercent = percentDownloaded;
-    if ((totalbytes + getOngoingTotalBytes() ) == 0)
+    if (snapshot.totalBytes == 0)
     {
         percentDownloaded = 0;
     }
     else
     {
-        percentDownloaded = float((transferredbytes + getOngoingTransferredBytes()) * 1.0 / (totalbytes + getOngoingTotalBytes() ) * 100.0);
+        percentDownloaded = float(snapshot.transferredBytes * 1.0 / snapshot.totalBytes * 100.0);
     }
     if (alreadyFinished || ( (percentDownloaded == oldpercent ) && ( oldpercent != 0 ) ) )
     {
@@ -653,7 +607,6 @@ void MegaCmdMultiTransferListener::onTransferUpdate(MegaApi* api, MegaTransfer *
     }
     assert(percentDownloaded <=100);
 
-    char aux[40];
     if (transfer->getTotalBytes() < 0)
     {
         return; // after a 100% this happens
@@ -662,26 +615,17 @@ void MegaCmdMultiTransferListener::onTransferUpdate(MegaApi* api, MegaTransfer *
     {
         return; // after a 100% this happens
     }
-    sprintf(aux,"||(%lld/%lld MB: %.2f %%) ", (transferredbytes + getOngoingTransferredBytes()) / 1024 / 1024, (totalbytes + getOngoingTotalBytes() ) / 1024 / 1024, percentDownloaded);
-    sprintf((char *)outputString.c_str() + cols - strlen(aux), "%s",                         aux);
-    for (int i = 0; i <= ( cols - strlen("TRANSFERRING ||") - strlen(aux)) * 1.0 * std::min (100.0f, percentDownloaded) / 100.0; i++)
-    {
-        *ptr++ = '#';
-    }
 
-    if (percentDownloaded == 100 && !alreadyFinished)
+    bool final = percentDownloaded == 100 && !alreadyFinished;
+    if (final)
     {
         alreadyFinished = true;
-	std::cout << outputString << std::endl;
-    }
-    else
-    {
-	    std::cout << outputString << '\r' << std::flush;
     }
+    informProgressBar("TRANSFERRING", snapshot.transferredBytes, snapshot.totalBytes, final);
 
     LOG_verbose << "onTransferUpdate transfer->getType(): " << transfer->getType() << " clientID=" << this->clientID;
 
-    informProgressUpdate((transferredbytes + getOngoingTransferredBytes()),(totalbytes + getOngoingTotalBytes() ), clientID);
+    informProgressUpdate(snapshot, clientID);
 
 
 }
@@ -706,24 +650,116 @@ long long MegaCmdMultiTransferListener::getTotalbytes() const
     return totalbytes;
 }
 
-long long MegaCmdMultiTransferListener::getOngoingTransferredBytes()
+int MegaCmdMultiTransferListener::getFinished()
 {
-    long long total = 0;
-    for (map<int, long long>::iterator itr = ongoingtransferredbytes.begin(); itr!= ongoingtransferredbytes.end(); itr++)
+    mtxBytes.lock();
+    int toret = finished;
+    mtxBytes.unlock();
+    return toret;
+}
+
+long long MegaCmdMultiTransferListener::elapsedMicroSeconds()
+{
+    if (!started)
     {
-        total += itr->second;
+        return 0;
     }
-    return total;
+    long long end = (finished >= started) ? finishTime : getMonotonicMicroSeconds();
+    return std::max(end - startTime, 1LL);
 }
 
-long long MegaCmdMultiTransferListener::getOngoingTotalBytes()
+long long MegaCmdMultiTransferListener::getElapsedMicroSeconds()
 {
-    long long total = 0;
-    for (map<int, long long>::iterator itr = ongoingtotalbytes.begin(); itr!= ongoingtotalbytes.end(); itr++)
+    mtxBytes.lock();
+    long long toret = elapsedMicroSeconds();
+    mtxBytes.unlock();
+    return toret;
+}
+
+long long MegaCmdMultiTransferListener::getThroughput()
+{
+    mtxBytes.lock();
+    long long elapsed = elapsedMicroSeconds();
+    long long transferred = transferredbytes;
+    mtxBytes.unlock();
+    return elapsed ? (long long)(transferred * 1000000.0 / elapsed) : 0;
+}
+
+transfersnapshot MegaCmdMultiTransferListener::takeSnapshot()
+{
+    transfersnapshot snapshot;
+    snapshot.transferredBytes = transferredbytes + ongoingTransferred;
+    snapshot.totalBytes = std::max(totalbytes + ongoingTotal, expectedBytes);
+    snapshot.filesDone = finished;
+    snapshot.filesTotal = std::max(started, expectedTransfers);
+
+    long long elapsed = elapsedMicroSeconds();
+    snapshot.bytesPerSecond = elapsed ? (long long)(snapshot.transferredBytes * 1000000.0 / elapsed) : 0;
+    snapshot.eta = -1;
+    if (snapshot.bytesPerSecond > 0 && snapshot.totalBytes >= snapshot.transferredBytes)
     {
-        total += itr->second;
+        snapshot.eta = (snapshot.totalBytes - snapshot.transferredBytes) / snapshot.bytesPerSecond;
+    }
+    return snapshot;
+}
+
+transfersnapshot MegaCmdMultiTransferListener::getSnapshot()
+{
+    mtxBytes.lock();
+    transfersnapshot snapshot = takeSnapshot();
+    mtxBytes.unlock();
+    return snapshot;
+}
+
+MegaCmdMultiTransferListener::ongoingtransfer *MegaCmdMultiTransferListener::getOngoing(int tag)
+{
+    ongoingtransfer empty;
+    empty.transferred = 0;
+    empty.total = 0;
+    empty.active = false;
+
+    if (ongoing.empty())
+    {
+        ongoingBaseTag = tag;
+    }
+    // tags are given in increasing order: the table only grows at its ends
+    while (tag < ongoingBaseTag)
+    {
+        ongoing.push_front(empty);
+        ongoingBaseTag--;
+    }
+    while (tag - ongoingBaseTag >= int(ongoing.size()))
+    {
+        ongoing.push_back(empty);
+    }
+
+    ongoingtransfer *ot = &ongoing[tag - ongoingBaseTag];
+    ot->active = true;
+    return ot;
+}
+
+void MegaCmdMultiTransferListener::removeOngoing(int tag)
+{
+    if (tag < ongoingBaseTag || tag - ongoingBaseTag >= int(ongoing.size()))
+    {
+        return;
+    }
+    ongoingtransfer &ot = ongoing[tag - ongoingBaseTag];
+    ongoingTransferred -= ot.transferred;
+    ongoingTotal -= ot.total;
+    ot.transferred = 0;
+    ot.total = 0;
+    ot.active = false;
+
+    while (ongoing.size() && !ongoing.front().active)
+    {
+        ongoing.pop_front();
+        ongoingBaseTag++;
+    }
+    while (ongoing.size() && !ongoing.back().active)
+    {
+        ongoing.pop_back();
     }
-    return total;
 }
 
 MegaCmdMultiTransferListener::MegaCmdMultiTransferListener(MegaApi *megaApi, MegaCmdSandbox *sandboxCMD, MegaTransferListener *listener, int clientID)
@@ -737,8 +773,17 @@ MegaCmdMultiTransferListener::MegaCmdMultiTransferListener(MegaApi *megaApi, Meg
 
     started = 0;
     finished = 0;
+    waited = 0;
+    startTime = 0;
+    finishTime = 0;
     totalbytes = 0;
     transferredbytes = 0;
+    ongoingBaseTag = 0;
+    ongoingTransferred = 0;
+    ongoingTotal = 0;
+    expectedTransfers = 0;
+    expectedBytes = 0;
+    mtxBytes.init(false);
 
     finalerror = MegaError::API_OK;
 
@@ -751,45 +796,46 @@ bool MegaCmdMultiTransferListener::onTransferData(MegaApi *api, MegaTransfer *tr
 
 void MegaCmdMultiTransferListener::onNewTransfer()
 {
+    mtxBytes.lock();
+    if (!started)
+    {
+        startTime = getMonotonicMicroSeconds();
+    }
     started ++;
+    mtxBytes.unlock();
+}
+
+void MegaCmdMultiTransferListener::expectTransfers(int count, long long bytes)
+{
+    mtxBytes.lock();
+    expectedTransfers += count;
+    expectedBytes += bytes;
+    mtxBytes.unlock();
+}
+
+void MegaCmdMultiTransferListener::waitForSlot(int window)
+{
+    for (; started - waited >= window; waited++)
+    {
+        wait();
+    }
 }
 
 ////////////////////////////////////////
 ///  MegaCmdGlobalTransferListener   ///
 ////////////////////////////////////////
-const int MegaCmdGlobalTransferListener::MAXCOMPLETEDTRANSFERSBUFFER = 10000;
-
-MegaCmdGlobalTransferListener::MegaCmdGlobalTransferListener(MegaApi *megaApi, MegaCmdSandbox *sandboxCMD, MegaTransferListener *parent)
+MegaCmdGlobalTransferListener::MegaCmdGlobalTransferListener(MegaApi *megaApi, MegaCmdSandbox *sandboxCMD, MegaTransferListener *parent, size_t maxCompletedTransfers)
+    : completedTransfers(maxCompletedTransfers)
 {
     this->megaApi = megaApi;
     this->sandboxCMD = sandboxCMD;
     this->listener = parent;
-    completedTransfersMutex.init(false);
 };
 
 void MegaCmdGlobalTransferListener::onTransferFinish(MegaApi* api, MegaTransfer *transfer, MegaError* error)
 {
-    completedTransfersMutex.lock();
-    completedTransfers.push_front(transfer->copy());
-
-    // source
-    MegaNode * node = api->getNodeByHandle(transfer->getNodeHandle());
-    if (node)
-    {
-        char * nodepath = api->getNodePath(node);
-        completedPathsByHandle[transfer->getNodeHandle()]=nodepath;
-        delete []nodepath;
-        delete node;
-    }
-
-    if (completedTransfers.size()>MAXCOMPLETEDTRANSFERSBUFFER)
-    {
-        MegaTransfer * todelete = completedTransfers.back();
-        completedPathsByHandle.erase(todelete->getNodeHandle()); //TODO: this can be potentially eliminate a handle that has been added twice
-        delete todelete;
-        completedTransfers.pop_back();
-    }
-    completedTransfersMutex.unlock();
+    // no paths resolved here: that would lock the SDK for every transfer. They are when listed
+    completedTransfers.add(transfer);
 }
 
 void MegaCmdGlobalTransferListener::onTransferStart(MegaApi* api, MegaTransfer *transfer) {};
@@ -817,11 +863,4 @@ bool MegaCmdGlobalTransferListener::onTransferData(MegaApi *api, MegaTransfer *t
 
 MegaCmdGlobalTransferListener::~MegaCmdGlobalTransferListener()
 {
-    completedTransfersMutex.lock();
-    while (completedTransfers.size())
-    {
-        delete completedTransfers.front();
-        completedTransfers.pop_front();
-    }
-    completedTransfersMutex.unlock();
 }
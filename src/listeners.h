@@ -21,6 +21,10 @@
 
 #include "megacmdlogger.h"
 #include "megacmdsandbox.h"
+#include "megacmdpathindex.h"
+#include "megacmdsizecache.h"
+#include "megacmdtransferhistory.h"
+#include "megacmdsyncstatus.h"
 
 class MegaCmdListener : public mega::SynchronousRequestListener
 {
@@ -78,14 +82,34 @@ private:
     int clientID;
     int started;
     int finished;
+    int waited; // finished transfers already waited for
+    long long startTime; // when the first transfer was started
+    long long finishTime; // when the last one finished
     long long transferredbytes;
-    std::map<int, long long> ongoingtransferredbytes;
-    std::map<int, long long> ongoingtotalbytes;
     long long totalbytes;
     int finalerror;
 
-    long long getOngoingTransferredBytes();
-    long long getOngoingTotalBytes();
+    typedef struct ongoingtransfer_struct
+    {
+        long long transferred;
+        long long total;
+        bool active;
+    } ongoingtransfer;
+
+    // the transfers ongoing, by their tag (from ongoingBaseTag), with the sums of their bytes kept up to date
+    std::deque<ongoingtransfer> ongoing;
+    int ongoingBaseTag;
+    long long ongoingTransferred;
+    long long ongoingTotal;
+    int expectedTransfers; // to be started, as planned
+    long long expectedBytes;
+    mega::MegaMutex mtxBytes; // protects the counts of bytes and transfers, for the snapshots taken from other threads
+
+    // the following require mtxBytes to be locked
+    ongoingtransfer *getOngoing(int tag);
+    void removeOngoing(int tag);
+    long long elapsedMicroSeconds();
+    transfersnapshot takeSnapshot();
 
 public:
     MegaCmdMultiTransferListener(mega::MegaApi *megaApi, MegaCmdSandbox * sandboxCMD, mega::MegaTransferListener *listener = NULL, int clientID=-1);
@@ -100,12 +124,37 @@ public:
 
     void onNewTransfer();
 
+    /**
+     * @brief Accounts for transfers that are going to be started (negative to discount the ones that will not)
+     */
+    void expectTransfers(int count, long long bytes);
+
+    /**
+     * @brief Bytes transferred (of the finished and the ongoing transfers), speed, ETA and files done
+     */
+    transfersnapshot getSnapshot();
+
+    /**
+     * @brief Waits until less than "window" of the transfers started are ongoing
+     */
+    void waitForSlot(int window);
+
     void waitMultiEnd();
 
     int getFinalerror() const;
 
     long long getTotalbytes() const;
 
+    int getFinished();
+
+    /**
+     * @brief Bytes per second transferred from the start of the first transfer to the end of the last one
+     * (or to now, if they have not finished)
+     */
+    long long getThroughput();
+
+    long long getElapsedMicroSeconds();
+
 protected:
     mega::MegaTransferListener *listener;
 };
@@ -115,9 +164,13 @@ class MegaCmdGlobalListener : public mega::MegaGlobalListener
 private:
     MegaCMDLogger *loggerCMD;
     MegaCmdSandbox *sandboxCMD;
+    MegaCmdPathIndex *pathIndex;
+    MegaCmdSizeCache *sizeCache;
+    MegaCmdSyncStatusTable *syncStatus;
 
 public:
-    MegaCmdGlobalListener(MegaCMDLogger *logger, MegaCmdSandbox *sandboxCMD);
+    MegaCmdGlobalListener(MegaCMDLogger *logger, MegaCmdSandbox *sandboxCMD, MegaCmdPathIndex *pathIndex = NULL, MegaCmdSizeCache *sizeCache = NULL,
+                          MegaCmdSyncStatusTable *syncStatus = NULL);
     void onNodesUpdate(mega::MegaApi* api, mega::MegaNodeList *nodes);
     void onUsersUpdate(mega::MegaApi* api, mega::MegaUserList *users);
     void onAccountUpdate(mega::MegaApi *api);
@@ -131,10 +184,17 @@ class MegaCmdMegaListener : public mega::MegaListener
 {
 
 public:
-    MegaCmdMegaListener(mega::MegaApi *megaApi, mega::MegaListener *parent=NULL);
+    MegaCmdMegaListener(mega::MegaApi *megaApi, mega::MegaListener *parent=NULL, MegaCmdSyncStatusTable *syncStatus = NULL,
+                        MegaCmdPathIndex *pathIndex = NULL);
     virtual ~MegaCmdMegaListener();
 
     virtual void onRequestFinish(mega::MegaApi* api, mega::MegaRequest *request, mega::MegaError* e);
+    virtual void onTransferFinish(mega::MegaApi* api, mega::MegaTransfer *transfer, mega::MegaError* e);
+
+#ifdef ENABLE_SYNC
+    virtual void onSyncStateChanged(mega::MegaApi *api, mega::MegaSync *sync);
+    virtual void onSyncFileStateChanged(mega::MegaApi *api, mega::MegaSync *sync, std::string *localPath, int newState);
+#endif
 
 #ifdef ENABLE_CHAT
     void onChatsUpdate(mega::MegaApi *api, mega::MegaTextChatList *chats);
@@ -151,20 +211,20 @@ public:
 protected:
     mega::MegaApi *megaApi;
     mega::MegaListener *listener;
+    MegaCmdSyncStatusTable *syncStatus;
+    MegaCmdPathIndex *pathIndex;
 };
 
 class MegaCmdGlobalTransferListener : public mega::MegaTransferListener
 {
 private:
     MegaCmdSandbox *sandboxCMD;
-    static const int MAXCOMPLETEDTRANSFERSBUFFER;
 
 public:
-    mega::MegaMutex completedTransfersMutex;
-    std::deque<mega::MegaTransfer *> completedTransfers;
-    std::map<mega::MegaHandle,std::string> completedPathsByHandle;
+    MegaCmdTransferHistory completedTransfers;
 public:
-    MegaCmdGlobalTransferListener(mega::MegaApi *megaApi, MegaCmdSandbox *sandboxCMD, mega::MegaTransferListener *parent = NULL);
+    MegaCmdGlobalTransferListener(mega::MegaApi *megaApi, MegaCmdSandbox *sandboxCMD, mega::MegaTransferListener *parent = NULL,
+                                  size_t maxCompletedTransfers = DEFAULTCOMPLETEDTRANSFERS);
     virtual ~MegaCmdGlobalTransferListener();
 
     //Transfer callbacks
@@ -25,6 +25,8 @@
 #include "megacmdlogger.h"
 #include "comunicationsmanager.h"
 #include "listeners.h"
+#include "megacmdworkerpool.h"
+#include "megacmdprogress.h"
 
 #include "megacmdplatform.h"
 #include "megacmdversion.h"
@@ -144,6 +146,8 @@ using namespace mega;
 MegaCmdExecuter *cmdexecuter;
 MegaCmdSandbox *sandboxCMD;
 
+#define MAXPARALLELPETITIONS 100
+#define OUTPUTCHUNKSIZE 65536
 MegaSemaphore semaphoreClients; //to limit max parallel petitions
 
 MegaApi *api;
@@ -156,14 +160,16 @@ MegaMutex mutexapiFolders;
 
 MegaCMDLogger *loggerCMD;
 
-MegaMutex mutexEndedPetitionThreads;
-std::vector<MegaThread *> petitionThreads;
-std::vector<MegaThread *> endedPetitionThreads;
+//persistent threads to process petitions
+MegaCmdWorkerPool *petitionsPool;
 MegaThread *threadRetryConnections;
 
 //Comunications Manager
 ComunicationsManager * cm;
 
+// progress of transfers and requests informed to the clients and drawn in the console
+MegaCmdProgressAggregator *progressAggregator = NULL;
+
 // global listener
 MegaCmdGlobalListener* megaCmdGlobalListener;
 
@@ -336,22 +342,82 @@ void informTransferUpdate(MegaTransfer *transfer, int clientID)
     informProgressUpdate(transfer->getTransferredBytes(),transfer->getTotalBytes(), clientID);
 }
 
-void informProgressUpdate(long long transferred, long long total, int clientID, string title)
+/*
+ * progress:TRANSFERRED:TOTAL[:TITLE[:FILESDONE:FILESTOTAL:BYTESPERSECOND:ETA]]
+ * (clients not knowing about the fields after the title ignore them)
+ */
+void sendProgressUpdate(long long transferred, long long total, int clientID, string title, const transfersnapshot *snapshot)
 {
     string s = "progress:";
     s+=SSTR(transferred);
     s+=":";
     s+=SSTR(total);
 
-    if (title.size())
+    if (title.size() || snapshot)
     {
         s+=":";
         s+=title;
     }
 
+    if (snapshot)
+    {
+        s+=":";
+        s+=SSTR(snapshot->filesDone);
+        s+=":";
+        s+=SSTR(snapshot->filesTotal);
+        s+=":";
+        s+=SSTR(snapshot->bytesPerSecond);
+        s+=":";
+        s+=SSTR(snapshot->eta);
+    }
+
     cm->informStateListenerByClientId(s, clientID);
 }
 
+void informProgressUpdate(long long transferred, long long total, int clientID, string title)
+{
+    if (progressAggregator)
+    {
+        progressAggregator->update(clientID, transferred, total, title);
+    }
+    else
+    {
+        sendProgressUpdate(transferred, total, clientID, title, NULL);
+    }
+}
+
+void informProgressUpdate(const transfersnapshot &snapshot, int clientID)
+{
+    if (progressAggregator)
+    {
+        progressAggregator->update(clientID, snapshot);
+    }
+    else
+    {
+        sendProgressUpdate(snapshot.transferredBytes, snapshot.totalBytes, clientID, "", &snapshot);
+    }
+}
+
+void informProgressBar(string title, long long transferred, long long total, bool final)
+{
+    if (progressAggregator)
+    {
+        progressAggregator->updateBar(title, transferred, total, final);
+    }
+    else
+    {
+        string line = MegaCmdProgressAggregator::formatBar(title, transferred, total, getNumberOfCols(80));
+        if (final)
+        {
+            std::cout << line << std::endl;
+        }
+        else
+        {
+            std::cout << line << '\r' << std::flush;
+        }
+    }
+}
+
 void insertValidParamsPerCommand(set<string> *validParams, string thecommand, set<string> *validOptValues = NULL)
 {
     if (!validOptValues)
@@ -405,6 +471,12 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
     {
 #ifdef USE_PCRE
         validParams->insert("use-pcre");
+#endif
+    }
+    else if ("cp" == thecommand)
+    {
+#ifdef USE_PCRE
+        validParams->insert("use-pcre");
 #endif
     }
     else if ("speedlimit" == thecommand)
@@ -471,6 +543,8 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
         validParams->insert("d");
         validParams->insert("s");
         validParams->insert("r");
+        validParams->insert("restart-status");
+        validParams->insert("refresh");
         validOptValues->insert("path-display-size");
     }
     else if ("export" == thecommand)
@@ -568,6 +642,7 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
         validParams->insert("c");
         validParams->insert("q");
         validParams->insert("ignore-quota-warn");
+        validParams->insert("skip-unchanged");
         validOptValues->insert("clientID");
     }
     else if ("get" == thecommand)
@@ -1317,7 +1392,7 @@ const char * getUsageStr(const char *command)
     }
     if (!strcmp(command, "put"))
     {
-        return "put  [-c] [-q] [--ignore-quota-warn] localfile [localfile2 localfile3 ...] [dstremotepath]";
+        return "put  [-c] [-q] [--ignore-quota-warn] [--skip-unchanged] localfile [localfile2 localfile3 ...] [dstremotepath]";
     }
     if (!strcmp(command, "putq"))
     {
@@ -1369,7 +1444,11 @@ const char * getUsageStr(const char *command)
     }
     if (!strcmp(command, "cp"))
     {
-        return "cp srcremotepath dstremotepath|dstemail:";
+#ifdef USE_PCRE
+        return "cp [--use-pcre] srcremotepath [srcremotepath2 srcremotepath3 ..] dstremotepath|dstemail:";
+#else
+        return "cp srcremotepath [srcremotepath2 srcremotepath3 ..] dstremotepath|dstemail:";
+#endif
     }
     if (!strcmp(command, "deleteversions"))
     {
@@ -1392,7 +1471,7 @@ const char * getUsageStr(const char *command)
 #endif
     if (!strcmp(command, "sync"))
     {
-        return "sync [localpath dstremotepath| [-dsr] [ID|localpath]";
+        return "sync [localpath dstremotepath| [-dsr] [ID|localpath] | --restart-status] [--refresh]";
     }
     if (!strcmp(command, "backup"))
     {
@@ -1754,6 +1833,8 @@ string getHelpStr(const char *command)
         os << " -q" << "\t" << "queue upload: execute in the background. Don't wait for it to end' " << std::endl;
         os << " --ignore-quota-warn" << "\t" << "ignore quota surpassing warning. " << std::endl;
         os << "                    " << "\t" << "  The upload will be attempted anyway." << std::endl;
+        os << " --skip-unchanged" << "\t" << "Skips the files already uploaded: those whose remote file (with the same name) has their fingerprint." << std::endl;
+        os << "                 " << "\t" << "  Fingerprints of local files are cached, to read again only the ones modified." << std::endl;
 
         os << std::endl;
         os << "Notice that the dstremotepath can only be omitted when only one local path is provided. " << std::endl;
@@ -1809,6 +1890,9 @@ string getHelpStr(const char *command)
     {
         os << "Deletes a remote file/folder" << std::endl;
         os << std::endl;
+        os << "The matches of patterns are deleted together: confirmation is asked once for all of them" << std::endl;
+        os << " (if there are folders among them), and their removals are requested \"remove_concurrency\" at a time" << std::endl;
+        os << std::endl;
         os << "Options:" << std::endl;
         os << " -r" << "\t" << "Delete recursively (for folders)" << std::endl;
         os << " -f" << "\t" << "Force (no asking)" << std::endl;
@@ -1822,6 +1906,10 @@ string getHelpStr(const char *command)
         os << std::endl;
         os << "If the location exists and is a folder, the source will be moved there" << std::endl;
         os << "If the location doesn't exist, the source will be renamed to the destination name given" << std::endl;
+        os << std::endl;
+        os << "Several sources (or the matches of patterns) are moved together into the destination folder," << std::endl;
+        os << " \"copy_concurrency\" at a time. Files replace the files of their names there," << std::endl;
+        os << " the rest of the ones whose name is taken there are skipped" << std::endl;
 #ifdef USE_PCRE
         os << "Options:" << std::endl;
         os << " --use-pcre" << "\t" << "use PCRE expressions" << std::endl;
@@ -1837,6 +1925,15 @@ string getHelpStr(const char *command)
         os << "If \"dstemail:\" provided, the file/folder will be sent to that user's inbox (//in)" << std::endl;
         os << " e.g: cp /path/to/file user@doma.in:" << std::endl;
         os << " Remember the trailing \":\", otherwise a file with the name of that user (\"user@doma.in\") will be created" << std::endl;
+        os << std::endl;
+        os << "Several sources (or the matches of patterns) are copied together into the destination folder," << std::endl;
+        os << " \"copy_concurrency\" at a time. Files replace the files of their names there," << std::endl;
+        os << " the rest of the ones whose name is taken there are skipped" << std::endl;
+#ifdef USE_PCRE
+        os << std::endl;
+        os << "Options:" << std::endl;
+        os << " --use-pcre" << "\t" << "use PCRE expressions" << std::endl;
+#endif
     }
 #ifndef _WIN32
     else if (!strcmp(command, "permissions"))
@@ -1944,6 +2041,11 @@ string getHelpStr(const char *command)
         os << "-d" << " " << "ID|localpath" << "\t" << "deletes a synchronization" << std::endl;
         os << "-s" << " " << "ID|localpath" << "\t" << "stops(pauses) a synchronization" << std::endl;
         os << "-r" << " " << "ID|localpath" << "\t" << "resumes a synchronization" << std::endl;
+        os << " --restart-status" << "\t" << "Shows the progress of the last restart of the synchronizations" << std::endl;
+        os << "                 " << "\t" << " (when logging in, reloading or excluding names with --restart-syncs)." << std::endl;
+        os << "                 " << "\t" << " Synchronizations are restarted in background, \"sync_restart_concurrency\" at a time" << std::endl;
+        os << " --refresh" << "\t" << "Counts the files and folders and queries the state of the synchronizations listed again." << std::endl;
+        os << "          " << "\t" << " Otherwise, they are kept up to date with the changes notified since they were listed" << std::endl;
         os << " --path-display-size=N" << "\t" << "Use a fixed size of N characters for paths" << std::endl;
     }
     else if (!strcmp(command, "backup"))
@@ -2674,23 +2776,36 @@ void * doProcessLine(void *pointer)
 {
     CmdPetition *inf = (CmdPetition*)pointer;
 
+    semaphoreClients.wait();
+
     OUTSTRINGSTREAM s;
-    setCurrentThreadOutStream(&s);
-    setCurrentThreadLogLevel(MegaApi::LOG_LEVEL_ERROR);
-    setCurrentOutCode(MCMD_OK);
-    setCurrentPetition(inf);
+    MegaCmdThreadContext context;
+    CmdOutputStreamBuf *streamingBuffer = NULL;
+    OUTSTREAMTYPE *streamingOut = NULL;
+    if (cm->supportsStreamingOutput(inf))
+    {
+        // output is sent as it is produced, instead of holding it all until the command finishes
+        streamingBuffer = new CmdOutputStreamBuf(cm, inf, OUTPUTCHUNKSIZE);
+        streamingOut = new OUTSTREAMTYPE(streamingBuffer);
+        context.out = streamingOut;
+    }
+    else
+    {
+        // e.g. v1 petitions: their outcode goes ahead of the output, which needs to be complete
+        context.out = &s;
+    }
+    context.logLevel = MegaApi::LOG_LEVEL_ERROR;
+    context.outCode = MCMD_OK;
+    context.petition = inf;
 
     if (inf->getLine() && *(inf->getLine())=='X')
     {
-        setCurrentThreadIsCmdShell(true);
+        context.isCmdShell = true;
         char * aux = inf->line;
         inf->line=strdup(inf->line+1);
         free(aux);
     }
-    else
-    {
-        setCurrentThreadIsCmdShell(false);
-    }
+    setCurrentThreadContext(&context);
 
     LOG_verbose << " Processing " << *inf << " in thread: " << MegaThread::currentThreadId() << " " << cm->get_petition_details(inf);
 
@@ -2703,8 +2818,17 @@ void * doProcessLine(void *pointer)
 
     LOG_verbose << " Procesed " << *inf << " in thread: " << MegaThread::currentThreadId() << " " << cm->get_petition_details(inf);
 
-    MegaThread * petitionThread = inf->getPetitionThread();
-    cm->returnAndClosePetition(inf, &s, getCurrentOutCode());
+    if (streamingBuffer)
+    {
+        // what has not been sent yet goes in the trailer, along with the outcode
+        streamingBuffer->getRemaining(&s);
+        context.out = &s;
+        delete streamingOut;
+        delete streamingBuffer;
+    }
+
+    cm->returnAndClosePetition(inf, &s, context.outCode);
+    context.petition = NULL;
 
     semaphoreClients.release();
 
@@ -2713,10 +2837,17 @@ void * doProcessLine(void *pointer)
         cm->stopWaiting();
     }
 
-    mutexEndedPetitionThreads.lock();
-    endedPetitionThreads.push_back(petitionThread);
-    mutexEndedPetitionThreads.unlock();
+    setCurrentThreadContext(NULL);
+    return NULL;
+}
+
+void * refuseStateListener(void *pointer)
+{
+    CmdPetition *inf = (CmdPetition*)pointer;
 
+    OUTSTRINGSTREAM s;
+    s << "State listeners cannot be registered within a session" << endl;
+    cm->returnAndClosePetition(inf, &s, MCMD_NOTPERMITTED);
     return NULL;
 }
 
@@ -2726,6 +2857,12 @@ int askforConfirmation(string message)
     CmdPetition *inf = getCurrentPetition();
     if (inf)
     {
+        // the question should come after the output produced so far
+        CmdOutputStreamBuf *streamingBuffer = dynamic_cast<CmdOutputStreamBuf *>(OUTSTREAM.rdbuf());
+        if (streamingBuffer)
+        {
+            streamingBuffer->flushOutput();
+        }
         return cm->getConfirmation(inf,message);
     }
     else
@@ -2737,33 +2874,6 @@ int askforConfirmation(string message)
 }
 
 
-void delete_finished_threads()
-{
-    mutexEndedPetitionThreads.lock();
-    for (std::vector<MegaThread *>::iterator it = endedPetitionThreads.begin(); it != endedPetitionThreads.end(); )
-    {
-        MegaThread *mt = (MegaThread*)*it;
-        for (std::vector<MegaThread *>::iterator it2 = petitionThreads.begin(); it2 != petitionThreads.end(); )
-        {
-            if (mt == (MegaThread*)*it2)
-            {
-                it2 = petitionThreads.erase(it2);
-            }
-            else
-            {
-                ++it2;
-            }
-        }
-
-        mt->join();
-        delete mt;
-        it = endedPetitionThreads.erase(it);
-    }
-    mutexEndedPetitionThreads.unlock();
-}
-
-
-
 void finalize()
 {
     static bool alreadyfinalized = false;
@@ -2771,7 +2881,11 @@ void finalize()
         return;
     alreadyfinalized = true;
     LOG_info << "closing application ...";
-    delete_finished_threads();
+    delete petitionsPool;
+    if (progressAggregator)
+    {
+        progressAggregator->stop(); // what comes afterwards is discarded
+    }
     delete cm;
     if (!consoleFailed)
     {
@@ -2781,6 +2895,10 @@ void finalize()
     delete megaCmdMegaListener;
     threadRetryConnections->join();
     delete threadRetryConnections;
+    if (cmdexecuter)
+    {
+        cmdexecuter->getSyncRestarter()->stop(); // no more requests to the api deleted below
+    }
     delete api;
 
     while (!apiFolders.empty())
@@ -2798,6 +2916,8 @@ void finalize()
 
     delete megaCmdGlobalListener;
     delete cmdexecuter;
+    delete progressAggregator;
+    progressAggregator = NULL;
 
     LOG_debug << "resources have been cleaned ...";
     delete loggerCMD;
@@ -2806,6 +2926,7 @@ void finalize()
 }
 
 int currentclientID = 1;
+unsigned long long lastPetitionId = 0;
 
 void * retryConnections(void *pointer)
 {
@@ -2850,16 +2971,27 @@ void megacmd()
             LOG_verbose << "Client connected ";
 
             CmdPetition *inf = cm->getPetition();
+            if (!inf)
+            {
+                continue; // nothing to process (e.g. a session has been opened)
+            }
 
+            inf->id = ++lastPetitionId;
             LOG_verbose << "petition registered: " << *inf;
 
-            delete_finished_threads();
-
-            if (!inf || !strcmp(inf->getLine(),"ERROR"))
+            if (!strcmp(inf->getLine(),"ERROR"))
             {
                 LOG_warn << "Petition couldn't be registered. Dismissing it.";
                 delete inf;
             }
+            // state register petition that cannot be turned into a listener (e.g. sent within a session):
+            // a worker refuses it, since writing to its client could block this thread
+            else  if ((!strncmp(inf->getLine(),"registerstatelistener",strlen("registerstatelistener")) ||
+                       !strncmp(inf->getLine(),"Xregisterstatelistener",strlen("Xregisterstatelistener")))
+                      && !cm->supportsStateListener(inf))
+            {
+                petitionsPool->submit(refuseStateListener, (void*)inf);
+            }
             // if state register petition
             else  if (!strncmp(inf->getLine(),"registerstatelistener",strlen("registerstatelistener")) ||
                       !strncmp(inf->getLine(),"Xregisterstatelistener",strlen("Xregisterstatelistener")))
@@ -2973,16 +3105,12 @@ void megacmd()
             else
             { // normal petition
 
-                semaphoreClients.wait();
-
-                //append new one
-                MegaThread * petitionThread = new MegaThread();
-                petitionThreads.push_back(petitionThread);
-                inf->setPetitionThread(petitionThread);
-
+                // never waits here for a free slot: this thread has to keep reading the frames (e.g. the
+                // confirmation responses) the ongoing petitions of sessions may be waiting for.
+                // Petitions beyond the free workers are queued in the pool
                 LOG_verbose << "starting processing: <" << *inf << ">";
 
-                petitionThread->start(doProcessLine, (void*)inf);
+                petitionsPool->submit(doProcessLine, (void*)inf);
             }
         }
     }
@@ -3234,10 +3362,46 @@ int main(int argc, char* argv[])
 
     mutexHistory.init(false);
 
-    mutexEndedPetitionThreads.init(false);
-
     ConfigurationManager::loadConfiguration(( argc > 1 ) && !( strcmp(argv[1], "--debug")));
 
+    if (ConfigurationManager::getConfigurationValue("async_logging", false))
+    {
+        int asyncLogRecords = ConfigurationManager::getConfigurationValue("async_logging_buffer", DEFAULTASYNCLOGRECORDS);
+        loggerCMD->startAsyncMode(std::max(asyncLogRecords, 2));
+    }
+
+    string logFile = ConfigurationManager::getConfigurationSValue("log_file");
+    if (logFile.size())
+    {
+        if (!isAbsolutePath(logFile))
+        {
+            logFile = ConfigurationManager::getConfigFolder() + "/" + logFile;
+        }
+        string logFileFormat = ConfigurationManager::getConfigurationSValue("log_file_format");
+        int format = logFileFormat.size() ? MegaCmdLogFileSink::getFormat(logFileFormat) : MegaCmdLogFileSink::FORMAT_JSON;
+        if (format < 0)
+        {
+            format = MegaCmdLogFileSink::FORMAT_JSON;
+            LOG_err << "Unknown log_file_format: " << logFileFormat << ". Using json";
+        }
+        long long maxSize = ConfigurationManager::getConfigurationValue("log_file_max_size", (long long)DEFAULTLOGFILEMAXSIZE);
+        int maxAge = ConfigurationManager::getConfigurationValue("log_file_max_age", 0);
+        int rotations = ConfigurationManager::getConfigurationValue("log_file_rotations", DEFAULTLOGFILEROTATIONS);
+        int records = ConfigurationManager::getConfigurationValue("log_file_buffer", DEFAULTASYNCLOGRECORDS);
+
+        MegaCmdLogFileSink *sink = new MegaCmdLogFileSink(logFile, format, std::max(maxSize, 1LL), std::max(maxAge, 0),
+                                                          std::max(rotations, 0), std::max(records, 2));
+        if (sink->start())
+        {
+            loggerCMD->setFileSink(sink);
+        }
+        else
+        {
+            LOG_err << "Unable to open log file " << logFile;
+            delete sink;
+        }
+    }
+
     char userAgent[30];
     sprintf(userAgent, "MEGAcmd/%d.%d.%d.0", MEGACMD_MAJOR_VERSION,MEGACMD_MINOR_VERSION,MEGACMD_MICRO_VERSION);
 
@@ -3279,7 +3443,13 @@ int main(int argc, char* argv[])
         semaphoreapiFolders.release();
     }
 
-    for (int i = 0; i < 100; i++)
+    // petitions may block for long (e.g. transfers or confirmations): by default there is a worker for
+    // each of the petitions that can be processed in parallel, and never more petitions than workers
+    int numberOfWorkers = ConfigurationManager::getConfigurationValue("petition_workers", MAXPARALLELPETITIONS);
+    numberOfWorkers = std::max(1, std::min(numberOfWorkers, MAXPARALLELPETITIONS));
+    petitionsPool = new MegaCmdWorkerPool(numberOfWorkers);
+
+    for (int i = 0; i < numberOfWorkers; i++)
     {
         semaphoreClients.release();
     }
@@ -3291,8 +3461,9 @@ int main(int argc, char* argv[])
     sandboxCMD = new MegaCmdSandbox();
     cmdexecuter = new MegaCmdExecuter(api, loggerCMD, sandboxCMD);
 
-    megaCmdGlobalListener = new MegaCmdGlobalListener(loggerCMD, sandboxCMD);
-    megaCmdMegaListener = new MegaCmdMegaListener(api, NULL);
+    megaCmdGlobalListener = new MegaCmdGlobalListener(loggerCMD, sandboxCMD, cmdexecuter->getPathIndex(), cmdexecuter->getSizeCache(),
+                                                      cmdexecuter->getSyncStatusTable());
+    megaCmdMegaListener = new MegaCmdMegaListener(api, NULL, cmdexecuter->getSyncStatusTable(), cmdexecuter->getPathIndex());
     api->addGlobalListener(megaCmdGlobalListener);
     api->addListener(megaCmdMegaListener);
 
@@ -3313,6 +3484,10 @@ int main(int argc, char* argv[])
 #endif
     cm = new COMUNICATIONMANAGER();
 
+    int progressFrequency = ConfigurationManager::getConfigurationValue("progress_frequency", DEFAULTPROGRESSFREQUENCY);
+    progressAggregator = new MegaCmdProgressAggregator(sendProgressUpdate, progressFrequency);
+    progressAggregator->start();
+
 #if _WIN32
     if( SetConsoleCtrlHandler( (PHANDLER_ROUTINE) CtrlHandler, TRUE ) )
      {
@@ -46,6 +46,19 @@ void localwtostring(const std::wstring* wide, std::string *multibyte);
 
 #define PROGRESS_COMPLETE -2
 
+/**
+ * @brief The state of a set of transfers (e.g. the ones of a get or a put)
+ */
+typedef struct transfersnapshot_struct
+{
+    long long transferredBytes;
+    long long totalBytes;
+    long long bytesPerSecond; // since the first transfer started
+    long long eta; // seconds, -1 if unknown
+    int filesDone;
+    int filesTotal;
+} transfersnapshot;
+
 typedef struct sync_struct
 {
     mega::MegaHandle handle;
@@ -128,6 +141,16 @@ void informTransferUpdate(mega::MegaTransfer *transfer, int clientID);
 
 void informProgressUpdate(long long transferred, long long total, int clientID, std::string title = "");
 
+/**
+ * @brief Informs the progress of a set of transfers, with the files done, the speed and the ETA
+ */
+void informProgressUpdate(const transfersnapshot &snapshot, int clientID);
+
+/**
+ * @brief Draws a progress bar in the console (at most a number of times per second, but the final one)
+ */
+void informProgressBar(std::string title, long long transferred, long long total, bool final);
+
 
 
 #endif
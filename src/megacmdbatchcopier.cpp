@@ -0,0 +1,258 @@
+/**
+ * @file src/megacmdbatchcopier.cpp
+ * @brief MEGAcmd: Copies and moves of many nodes into a folder
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdbatchcopier.h"
+#include "megacmdlogger.h"
+
+#include <sstream>
+
+using namespace std;
+using namespace mega;
+
+MegaCmdBatchCopier::MegaCmdBatchCopier(MegaApi *api, int mode, MegaNode *destination)
+{
+    this->api = api;
+    this->mode = mode;
+    this->destination = destination->copy();
+    skipped = 0;
+    succeeded = 0;
+    failed = 0;
+    lastError = MegaError::API_OK;
+    mtx.init(false);
+
+    MegaNodeList *children = api->getChildren(destination);
+    if (children)
+    {
+        for (int i = 0; i < children->size(); i++)
+        {
+            MegaNode *child = children->get(i);
+            if (!child->getName())
+            {
+                continue;
+            }
+            if (child->getType() == MegaNode::TYPE_FILE && names.find(child->getName()) == names.end()
+                    && files.find(child->getName()) == files.end())
+            {
+                files[child->getName()] = child->getHandle();
+            }
+            else
+            {
+                // several with the same name: which one to replace is ambiguous
+                files.erase(child->getName());
+                names.insert(child->getName());
+            }
+        }
+        delete children;
+    }
+
+    for (MegaNode *ancestor = destination->copy(); ancestor; )
+    {
+        destinationAncestors.insert(ancestor->getHandle());
+        MegaNode *parent = api->getParentNode(ancestor);
+        delete ancestor;
+        ancestor = parent;
+    }
+}
+
+MegaCmdBatchCopier::~MegaCmdBatchCopier()
+{
+    for (unsigned int i = 0; i < nodes.size(); i++)
+    {
+        delete nodes[i];
+    }
+    for (unsigned int i = 0; i < listeners.size(); i++)
+    {
+        delete listeners[i];
+    }
+    delete destination;
+}
+
+bool MegaCmdBatchCopier::add(MegaNode *node)
+{
+    const char *reason = NULL;
+    if (node->getHandle() == destination->getHandle())
+    {
+        reason = "it is the destination";
+    }
+    else if (destinationAncestors.find(node->getHandle()) != destinationAncestors.end())
+    {
+        reason = "the destination is within it";
+    }
+    else if (mode == MODE_MOVE && node->getParentHandle() == destination->getHandle())
+    {
+        reason = "it is already there";
+    }
+    else if (!node->getName() || names.find(node->getName()) != names.end())
+    {
+        reason = "its name is already taken in the destination";
+    }
+
+    MegaHandle toReplace = UNDEF;
+    map<string, MegaHandle>::iterator file = reason ? files.end() : files.find(node->getName());
+    if (file != files.end())
+    {
+        if (node->getType() != MegaNode::TYPE_FILE)
+        {
+            reason = "a folder cannot replace a file";
+        }
+        else
+        {
+            toReplace = file->second;
+            files.erase(file);
+        }
+    }
+
+    if (reason)
+    {
+        char *nodePath = api->getNodePath(node);
+        LOG_warn << "Skipping " << (nodePath ? nodePath : node->getName()) << ": " << reason;
+        delete []nodePath;
+        delete node;
+        skipped++;
+        return false;
+    }
+
+    names.insert(node->getName());
+    nodes.push_back(node);
+    replaced.push_back(toReplace);
+    return true;
+}
+
+size_t MegaCmdBatchCopier::run(int window)
+{
+    window = max(1, window);
+    paths.resize(nodes.size());
+
+    size_t waits = 0;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        if (int(i) >= window)
+        {
+            slots.wait();
+            waits++;
+        }
+
+        char *nodePath = api->getNodePath(nodes[i]);
+        paths[i] = nodePath ? nodePath : nodes[i]->getName();
+        delete []nodePath;
+        LOG_verbose << (mode == MODE_MOVE ? "Moving: " : "Copying: ") << paths[i];
+
+        CopyListener *listener = new CopyListener();
+        listener->copier = this;
+        listener->index = i;
+        listener->removing = false;
+        listeners.push_back(listener);
+        if (mode == MODE_MOVE)
+        {
+            api->moveNode(nodes[i], destination, listener);
+        }
+        else
+        {
+            api->copyNode(nodes[i], destination, listener);
+        }
+    }
+
+    for (; waits < nodes.size(); waits++)
+    {
+        slots.wait();
+    }
+
+    return getNumberFailed();
+}
+
+void MegaCmdBatchCopier::CopyListener::onRequestFinish(MegaApi *api, MegaRequest *request, MegaError *e)
+{
+    copier->onFinish(this, e);
+}
+
+void MegaCmdBatchCopier::onFinish(CopyListener *listener, MegaError *e)
+{
+    size_t index = listener->index;
+    int errorCode = e ? e->getErrorCode() : int(MegaError::API_EINTERNAL);
+    if (!listener->removing && errorCode == MegaError::API_OK && replaced[index] != UNDEF)
+    {
+        // the slot is kept until the file replaced is removed too
+        MegaNode *former = api->getNodeByHandle(replaced[index]);
+        if (former)
+        {
+            listener->removing = true;
+            api->remove(former, listener);
+            delete former;
+            return;
+        }
+    }
+
+    mtx.lock();
+    if (errorCode == MegaError::API_OK)
+    {
+        succeeded++;
+    }
+    else
+    {
+        LOG_err << "Failed to " << (listener->removing ? "remove the file replaced by " : (mode == MODE_MOVE ? "move " : "copy "))
+                << paths[index] << ": " << MegaError::getErrorString(errorCode);
+        lastError = errorCode;
+        failed++;
+    }
+    // still within the lock: run() returns only after taking it (see getNumberFailed), so the copier
+    // cannot be deleted while this callback is still using it
+    slots.release();
+    mtx.unlock();
+}
+
+string MegaCmdBatchCopier::getSummary()
+{
+    ostringstream os;
+    os << (mode == MODE_MOVE ? "Moved: " : "Copied: ") << getNumberSucceeded()
+       << ". Skipped: " << skipped << ". Failed: " << getNumberFailed();
+    return os.str();
+}
+
+size_t MegaCmdBatchCopier::getNumberOfNodes() const
+{
+    return nodes.size();
+}
+
+size_t MegaCmdBatchCopier::getNumberSkipped() const
+{
+    return skipped;
+}
+
+size_t MegaCmdBatchCopier::getNumberSucceeded()
+{
+    mtx.lock();
+    size_t toret = succeeded;
+    mtx.unlock();
+    return toret;
+}
+
+size_t MegaCmdBatchCopier::getNumberFailed()
+{
+    mtx.lock();
+    size_t toret = failed;
+    mtx.unlock();
+    return toret;
+}
+
+int MegaCmdBatchCopier::getLastError()
+{
+    mtx.lock();
+    int toret = lastError;
+    mtx.unlock();
+    return toret;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file src/megacmdbatchcopier.h
+ * @brief MEGAcmd: Copies and moves of many nodes into a folder
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDBATCHCOPIER_H
+#define MEGACMDBATCHCOPIER_H
+
+#include "megacmd.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+#define DEFAULTCOPYCONCURRENCY 32
+
+/**
+ * @brief The copies (or moves) of a set of nodes (e.g. the ones matched by the sources given to
+ * cp or mv) into a destination folder
+ *
+ * Conflicts are checked locally as nodes are added, against an index of the names of the
+ * children of the destination (built once, and updated with the ones added). As with a single
+ * target, a file replaces the file of its name in the destination: the former one is removed once
+ * the new one is there. The rest of the nodes that would conflict, or that cannot go there, are
+ * skipped. The requests of the others are then submitted keeping a bounded number of them ongoing.
+ */
+class MegaCmdBatchCopier
+{
+public:
+    enum
+    {
+        MODE_COPY = 0,
+        MODE_MOVE
+    };
+
+private:
+    // the request of a copy ends up with the handle of the new node: every request gets its listener
+    // (and so does the removal of the file replaced, if any, which follows it)
+    class CopyListener : public mega::MegaRequestListener
+    {
+    public:
+        MegaCmdBatchCopier *copier;
+        size_t index;
+        bool removing; // the file replaced
+        void onRequestFinish(mega::MegaApi *api, mega::MegaRequest *request, mega::MegaError *e);
+    };
+
+    mega::MegaApi *api;
+    int mode;
+    mega::MegaNode *destination;
+    std::set<std::string> names; // of the children of the destination and the nodes added (but the files below)
+    std::map<std::string, mega::MegaHandle> files; // children of the destination that can be replaced
+    std::set<mega::MegaHandle> destinationAncestors; // including itself: none can go into the destination
+    std::vector<mega::MegaNode *> nodes; // to copy or move, in the order they were added
+    std::vector<mega::MegaHandle> replaced; // file each node replaces (UNDEF if none)
+    std::vector<std::string> paths; // of the nodes, once submitted
+    std::vector<CopyListener *> listeners;
+    size_t skipped;
+
+    mega::MegaMutex mtx; // protects the following
+    size_t succeeded;
+    size_t failed;
+    int lastError;
+
+    mega::MegaSemaphore slots; // released as requests finish
+
+    void onFinish(CopyListener *listener, mega::MegaError *e);
+
+public:
+    /**
+     * @param destination folder to copy or move the nodes into (it is copied)
+     */
+    MegaCmdBatchCopier(mega::MegaApi *api, int mode, mega::MegaNode *destination);
+    ~MegaCmdBatchCopier();
+
+    /**
+     * @brief Adds a node to copy or move (its ownership is taken), unless it conflicts (other than
+     * a file with a file, which it will replace)
+     * @return false if it was skipped (and deleted)
+     */
+    bool add(mega::MegaNode *node);
+
+    /**
+     * @brief Submits the requests (once), keeping at most "window" of them ongoing, and waits for all of them
+     * @return the number of them that failed
+     */
+    size_t run(int window);
+
+    /**
+     * @return e.g. "Copied: 10. Skipped: 2. Failed: 0"
+     */
+    std::string getSummary();
+
+    size_t getNumberOfNodes() const;
+    size_t getNumberSkipped() const;
+    size_t getNumberSucceeded();
+    size_t getNumberFailed();
+    int getLastError();
+};
+
+#endif // MEGACMDBATCHCOPIER_H
@@ -0,0 +1,270 @@
+/**
+ * @file src/megacmdbulkremover.cpp
+ * @brief MEGAcmd: Removal of many nodes at once
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdbulkremover.h"
+#include "megacmdlogger.h"
+#include "megacmdutils.h"
+
+#include <sstream>
+
+using namespace std;
+using namespace mega;
+
+MegaCmdBulkRemover::MegaCmdBulkRemover(MegaApi *api, MegaCmdSizeCache *sizeCache)
+{
+    this->api = api;
+    this->sizeCache = sizeCache;
+    prepared = false;
+    pruned = 0;
+    totalBytes = 0;
+    finished = 0;
+    failed = 0;
+    bytesRemoved = 0;
+    lastError = MegaError::API_OK;
+    mtx.init(false);
+}
+
+MegaCmdBulkRemover::~MegaCmdBulkRemover()
+{
+    for (unsigned int i = 0; i < removals.size(); i++)
+    {
+        delete removals[i].node;
+    }
+}
+
+bool MegaCmdBulkRemover::add(MegaNode *node)
+{
+    if (!added.insert(node->getHandle()).second)
+    {
+        delete node;
+        return false;
+    }
+
+    removal r;
+    r.node = node;
+    r.folder = node->getType() != MegaNode::TYPE_FILE;
+    r.version = false;
+    r.bytes = 0;
+    r.files = 0;
+    removals.push_back(r);
+    prepared = false;
+    return true;
+}
+
+void MegaCmdBulkRemover::prepare()
+{
+    if (prepared)
+    {
+        return;
+    }
+
+    set<string> folderPaths;
+    for (unsigned int i = 0; i < removals.size(); i++)
+    {
+        removal &r = removals[i];
+        char *nodePath = api->getNodePath(r.node);
+        r.path = nodePath ? nodePath : (r.node->getName() ? r.node->getName() : "");
+        delete []nodePath;
+
+        MegaNode *parent = api->getParentNode(r.node);
+        r.version = parent && parent->getType() == MegaNode::TYPE_FILE;
+        delete parent;
+
+        if (r.folder && !r.version)
+        {
+            folderPaths.insert(r.path);
+        }
+    }
+
+    // the ones within a folder added are removed along with it
+    vector<removal> kept;
+    totalBytes = 0;
+    for (unsigned int i = 0; i < removals.size(); i++)
+    {
+        removal &r = removals[i];
+        bool within = false;
+        for (size_t possep = r.path.find('/', 1); !within && possep != string::npos; possep = r.path.find('/', possep + 1))
+        {
+            within = folderPaths.find(r.path.substr(0, possep)) != folderPaths.end();
+        }
+        if (within)
+        {
+            LOG_verbose << "Not removing " << r.path << " on its own: its folder is removed";
+            delete r.node;
+            pruned++;
+            continue;
+        }
+
+        if (r.folder)
+        {
+            treesizes sizes;
+            sizeCache->getSizes(r.node, &sizes);
+            r.bytes = sizes.bytes;
+            r.files = sizes.files;
+        }
+        else
+        {
+            r.bytes = r.node->getSize();
+            r.files = 1;
+        }
+        totalBytes += r.bytes;
+        kept.push_back(r);
+    }
+    removals.swap(kept);
+    prepared = true;
+}
+
+size_t MegaCmdBulkRemover::remove(int window, int clientID)
+{
+    prepare();
+    window = max(1, window);
+
+    size_t waits = 0;
+    for (size_t i = 0; i < removals.size(); i++)
+    {
+        if (int(i) >= window)
+        {
+            slots.wait();
+            waits++;
+
+            mtx.lock();
+            long long removed = bytesRemoved;
+            mtx.unlock();
+            informProgressBar("REMOVING", removed, totalBytes, false);
+            informProgressUpdate(removed, totalBytes, clientID, "Removing");
+        }
+
+        removal &r = removals[i];
+        LOG_verbose << "Deleting: " << r.path;
+        mtx.lock();
+        ongoing[r.node->getHandle()] = i;
+        mtx.unlock();
+        if (r.version)
+        {
+            api->removeVersion(r.node, this);
+        }
+        else
+        {
+            api->remove(r.node, this);
+        }
+    }
+
+    for (; waits < removals.size(); waits++)
+    {
+        slots.wait();
+    }
+
+    informProgressBar("REMOVING", totalBytes, totalBytes, true);
+    informProgressUpdate(PROGRESS_COMPLETE, totalBytes, clientID, "Removing");
+
+    mtx.lock();
+    size_t toret = failed;
+    mtx.unlock();
+    return toret;
+}
+
+void MegaCmdBulkRemover::onRequestFinish(MegaApi *api, MegaRequest *request, MegaError *e)
+{
+    mtx.lock();
+    map<MegaHandle, size_t>::iterator it = ongoing.find(request->getNodeHandle());
+    if (it != ongoing.end())
+    {
+        const removal &r = removals[it->second];
+        if (e && e->getErrorCode() == MegaError::API_OK)
+        {
+            bytesRemoved += r.bytes;
+        }
+        else
+        {
+            int errorCode = e ? e->getErrorCode() : int(MegaError::API_EINTERNAL);
+            LOG_err << "Failed to delete node " << r.path << ": " << MegaError::getErrorString(errorCode);
+            lastError = errorCode;
+            failed++;
+        }
+        ongoing.erase(it);
+        finished++;
+    }
+    else
+    {
+        LOG_warn << "Unexpected removal finished: " << request->getNodeHandle();
+    }
+    // released while holding the lock: remove() locks it once done waiting, so this object is not
+    // deleted (right after it returns) before this callback stops using it
+    slots.release();
+    mtx.unlock();
+}
+
+string MegaCmdBulkRemover::getSummary()
+{
+    prepare();
+    size_t folders = getNumberOfFolders();
+    long long filesWithin = 0;
+    for (unsigned int i = 0; i < removals.size(); i++)
+    {
+        if (removals[i].folder)
+        {
+            filesWithin += removals[i].files;
+        }
+    }
+
+    ostringstream os;
+    os << (removals.size() - folders) << " file" << (removals.size() - folders == 1 ? "" : "s")
+       << " and " << folders << " folder" << (folders == 1 ? "" : "s");
+    if (folders)
+    {
+        os << " (containing " << filesWithin << " file" << (filesWithin == 1 ? "" : "s") << ")";
+    }
+    os << ", " << sizeToText(totalBytes, false);
+    return os.str();
+}
+
+size_t MegaCmdBulkRemover::getNumberOfNodes() const
+{
+    return removals.size();
+}
+
+size_t MegaCmdBulkRemover::getNumberOfFolders() const
+{
+    size_t folders = 0;
+    for (unsigned int i = 0; i < removals.size(); i++)
+    {
+        if (removals[i].folder)
+        {
+            folders++;
+        }
+    }
+    return folders;
+}
+
+size_t MegaCmdBulkRemover::getNumberOfPruned() const
+{
+    return pruned;
+}
+
+long long MegaCmdBulkRemover::getTotalBytes() const
+{
+    return totalBytes;
+}
+
+int MegaCmdBulkRemover::getLastError()
+{
+    mtx.lock();
+    int toret = lastError;
+    mtx.unlock();
+    return toret;
+}
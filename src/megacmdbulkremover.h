@@ -0,0 +1,105 @@
+/**
+ * @file src/megacmdbulkremover.h
+ * @brief MEGAcmd: Removal of many nodes at once
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDBULKREMOVER_H
+#define MEGACMDBULKREMOVER_H
+
+#include "megacmd.h"
+#include "megacmdsizecache.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+#define DEFAULTREMOVECONCURRENCY 32
+
+/**
+ * @brief The removal of a set of nodes (e.g. the ones matched by the patterns given to rm)
+ *
+ * Nodes within folders that are also removed are pruned (their removal comes with the one of
+ * the folder), the rest are measured to ask for confirmation once for all of them, and their
+ * removals are then requested keeping a bounded number of them ongoing.
+ */
+class MegaCmdBulkRemover : public mega::MegaRequestListener
+{
+private:
+    typedef struct removal_struct
+    {
+        mega::MegaNode *node;
+        std::string path;
+        bool folder;
+        bool version; // a previous version of a file
+        long long bytes; // of all of its contents for folders
+        long long files; // within it for folders
+    } removal;
+
+    mega::MegaApi *api;
+    MegaCmdSizeCache *sizeCache;
+    std::vector<removal> removals; // in the order they were added, once pruned
+    std::set<mega::MegaHandle> added;
+    bool prepared;
+    size_t pruned;
+    long long totalBytes;
+
+    mega::MegaMutex mtx; // protects the following
+    std::map<mega::MegaHandle, size_t> ongoing; // removals requested and not finished, by handle
+    size_t finished;
+    size_t failed;
+    long long bytesRemoved;
+    int lastError;
+
+    mega::MegaSemaphore slots; // released as removals finish
+
+public:
+    MegaCmdBulkRemover(mega::MegaApi *api, MegaCmdSizeCache *sizeCache);
+    ~MegaCmdBulkRemover();
+
+    /**
+     * @brief Adds a node to be removed (its ownership is taken)
+     * @return false if it was already added (and is deleted)
+     */
+    bool add(mega::MegaNode *node);
+
+    /**
+     * @brief Prunes the nodes within other folders added and measures the rest.
+     * Not to be called from the thread of the MegaApi callbacks
+     */
+    void prepare();
+
+    /**
+     * @brief Requests the removals, keeping at most "window" of them ongoing, and waits for all of them.
+     * The bytes removed are informed as the progress of the client (and drawn in the progress bar)
+     * @return the number of removals that failed
+     */
+    size_t remove(int window, int clientID);
+
+    /**
+     * @return a description of what is to be removed, e.g. "12 files and 3 folders (1.20 GB)"
+     */
+    std::string getSummary();
+
+    size_t getNumberOfNodes() const;
+    size_t getNumberOfFolders() const;
+    size_t getNumberOfPruned() const;
+    long long getTotalBytes() const;
+    int getLastError();
+
+    void onRequestFinish(mega::MegaApi *api, mega::MegaRequest *request, mega::MegaError *e);
+};
+
+#endif // MEGACMDBULKREMOVER_H
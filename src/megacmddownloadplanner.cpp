@@ -0,0 +1,269 @@
+/**
+ * @file src/megacmddownloadplanner.cpp
+ * @brief MEGAcmd: Planning of downloads of several nodes at once
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmddownloadplanner.h"
+#include "megacmdutils.h"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+using namespace std;
+using namespace mega;
+
+#ifdef _WIN32
+#define LOCALSEPARATOR "\\"
+#else
+#define LOCALSEPARATOR "/"
+#endif
+
+static bool endsWithSeparator(const string &path)
+{
+    return path.size() && (path[path.size() - 1] == '/' || path[path.size() - 1] == '\\');
+}
+
+/**
+ * @brief A name for a node named "name" not in taken: "name (1)", "name (2)"... keeping the extension of files
+ */
+static string getDistinctName(const string &name, bool isFile, const set<string> &taken)
+{
+    size_t dot = isFile ? name.find_last_of('.') : string::npos;
+    if (dot == 0)
+    {
+        dot = string::npos; // hidden files have no extension
+    }
+    string base = name.substr(0, dot);
+    string extension = (dot != string::npos) ? name.substr(dot) : "";
+    for (int i = 1; ; i++)
+    {
+        ostringstream candidate;
+        candidate << base << " (" << i << ")" << extension;
+        if (taken.find(candidate.str()) == taken.end())
+        {
+            return candidate.str();
+        }
+    }
+}
+
+MegaCmdDownloadPlanner::MegaCmdDownloadPlanner(MegaApi *api)
+{
+    this->api = api;
+    totalBytes = 0;
+}
+
+MegaCmdDownloadPlanner::~MegaCmdDownloadPlanner()
+{
+    clear();
+}
+
+void MegaCmdDownloadPlanner::add(MegaNode *node, string path)
+{
+#ifdef _WIN32
+    replaceAll(path, "/", "\\");
+#endif
+    if (node->getType() == MegaNode::TYPE_FILE)
+    {
+        addDownload(node, path);
+        targets.push_back(endsWithSeparator(path) ? path + node->getName() : path);
+        return;
+    }
+
+    if (endsWithSeparator(path))
+    {
+        path += node->getName();
+    }
+    addFolder(node, path);
+    targets.push_back(path);
+}
+
+void MegaCmdDownloadPlanner::addFolder(MegaNode *folder, string localFolder)
+{
+    MegaNodeList *children = NULL;
+    bool ownChildren = false;
+    if (folder->isForeign())
+    {
+        // nodes authorized from a folder link carry their children: the ones in the MegaApi are not theirs
+        children = folder->getChildren();
+    }
+    else
+    {
+        children = api->getChildren(folder);
+        ownChildren = true;
+    }
+
+    if (!children)
+    {
+        LOG_debug << "Children of " << folder->getName() << " unavailable. Downloading the folder as a whole";
+        addDownload(folder, localFolder);
+        return;
+    }
+
+    folders.push_back(localFolder);
+    localFolder += LOCALSEPARATOR;
+
+    set<string> taken; // names in the folder: the local names given to duplicates must not collide with any
+    for (int i = 0; i < children->size(); i++)
+    {
+        taken.insert(children->get(i)->getName());
+    }
+
+    set<string> used;
+    for (int i = 0; i < children->size(); i++)
+    {
+        MegaNode *child = children->get(i);
+        bool isFile = child->getType() == MegaNode::TYPE_FILE;
+        string name = child->getName();
+        if (!used.insert(name).second)
+        {
+            string distinctName = getDistinctName(name, isFile, taken);
+            taken.insert(distinctName);
+            LOG_warn << "Several nodes named " << name << " in " << folder->getName() << ". Downloading one of them as " << distinctName;
+            name = distinctName;
+        }
+
+        if (isFile)
+        {
+            addDownload(child, localFolder + name);
+        }
+        else
+        {
+            addFolder(child, localFolder + name);
+        }
+    }
+
+    if (ownChildren)
+    {
+        delete children;
+    }
+}
+
+void MegaCmdDownloadPlanner::addDownload(MegaNode *node, string path)
+{
+    planneddownload pd;
+    pd.node = node->copy();
+    pd.path = path;
+    pd.position = downloads.size();
+    downloads.push_back(pd);
+    if (node->getType() == MegaNode::TYPE_FILE)
+    {
+        totalBytes += node->getSize();
+    }
+    else
+    {
+        totalBytes += api->getSize(node);
+    }
+}
+
+bool MegaCmdDownloadPlanner::smallerFirst(const planneddownload &a, const planneddownload &b)
+{
+    long long sa = a.node->getSize();
+    long long sb = b.node->getSize();
+    return sa < sb || (sa == sb && a.position < b.position);
+}
+
+bool MegaCmdDownloadPlanner::largerFirst(const planneddownload &a, const planneddownload &b)
+{
+    long long sa = a.node->getSize();
+    long long sb = b.node->getSize();
+    return sa > sb || (sa == sb && a.position < b.position);
+}
+
+void MegaCmdDownloadPlanner::sort(int order)
+{
+    if (order == ORDER_SMALLEST_FIRST)
+    {
+        std::sort(downloads.begin(), downloads.end(), smallerFirst);
+    }
+    else if (order == ORDER_LARGEST_FIRST)
+    {
+        std::sort(downloads.begin(), downloads.end(), largerFirst);
+    }
+}
+
+void MegaCmdDownloadPlanner::start(MegaCmdMultiTransferListener *listener, int window)
+{
+    if (listener)
+    {
+        listener->expectTransfers(int(downloads.size()), totalBytes);
+    }
+
+    for (size_t i = 0; i < downloads.size(); i++)
+    {
+        LOG_debug << "Starting download: " << downloads[i].node->getName() << " to : " << downloads[i].path;
+        if (listener)
+        {
+            listener->waitForSlot(std::max(window, 1));
+            listener->onNewTransfer();
+        }
+        api->startDownload(downloads[i].node, downloads[i].path.c_str(), listener);
+    }
+}
+
+void MegaCmdDownloadPlanner::clear()
+{
+    for (size_t i = 0; i < downloads.size(); i++)
+    {
+        delete downloads[i].node;
+    }
+    downloads.clear();
+    folders.clear();
+    targets.clear();
+    totalBytes = 0;
+}
+
+MegaApi *MegaCmdDownloadPlanner::getApi() const
+{
+    return api;
+}
+
+const vector<string> &MegaCmdDownloadPlanner::getFolders() const
+{
+    return folders;
+}
+
+const vector<string> &MegaCmdDownloadPlanner::getTargets() const
+{
+    return targets;
+}
+
+size_t MegaCmdDownloadPlanner::getNumberOfDownloads() const
+{
+    return downloads.size();
+}
+
+long long MegaCmdDownloadPlanner::getTotalBytes() const
+{
+    return totalBytes;
+}
+
+int MegaCmdDownloadPlanner::getOrder(string name)
+{
+    if (name == "tree")
+    {
+        return ORDER_TREE;
+    }
+    if (name == "smallest")
+    {
+        return ORDER_SMALLEST_FIRST;
+    }
+    if (name == "largest")
+    {
+        return ORDER_LARGEST_FIRST;
+    }
+    return -1;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file src/megacmddownloadplanner.h
+ * @brief MEGAcmd: Planning of downloads of several nodes at once
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDDOWNLOADPLANNER_H
+#define MEGACMDDOWNLOADPLANNER_H
+
+#include "megacmd.h"
+#include "listeners.h"
+
+#include <vector>
+
+#define DEFAULTDOWNLOADCONCURRENCY 32
+
+/**
+ * @brief The downloads of a set of nodes (e.g. the ones matched by get), planned before any is started
+ *
+ * Folders are expanded into the local folders to create and the files to download into them, so
+ * that the whole set can be checked against the transfer quota once, its local tree created
+ * at once and its files submitted together, instead of one node at a time.
+ */
+class MegaCmdDownloadPlanner
+{
+public:
+    enum
+    {
+        ORDER_TREE = 0, // as the nodes were added and their children listed
+        ORDER_SMALLEST_FIRST,
+        ORDER_LARGEST_FIRST
+    };
+
+private:
+    typedef struct planneddownload_struct
+    {
+        mega::MegaNode *node;
+        std::string path;
+        size_t position; // to keep the order of the tree among nodes of the same size
+    } planneddownload;
+
+    mega::MegaApi *api;
+    std::vector<planneddownload> downloads;
+    std::vector<std::string> folders; // local folders to create, parents first
+    std::vector<std::string> targets; // local paths of the nodes added
+    long long totalBytes;
+
+    void addFolder(mega::MegaNode *folder, std::string localFolder);
+    void addDownload(mega::MegaNode *node, std::string path);
+
+    static bool smallerFirst(const planneddownload &a, const planneddownload &b);
+    static bool largerFirst(const planneddownload &a, const planneddownload &b);
+
+public:
+    MegaCmdDownloadPlanner(mega::MegaApi *api);
+    ~MegaCmdDownloadPlanner();
+
+    /**
+     * @brief Plans the download of a node as downloadNode would do it: into path when it ends
+     * with a separator, as path otherwise. Folders are expanded into their files. Children with
+     * the same name as a previous sibling are given a distinct local name
+     */
+    void add(mega::MegaNode *node, std::string path);
+
+    /**
+     * @brief Sorts the downloads planned
+     * @param order one of ORDER_TREE, ORDER_SMALLEST_FIRST, ORDER_LARGEST_FIRST
+     */
+    void sort(int order);
+
+    /**
+     * @brief Starts the downloads planned, keeping at most "window" of them ongoing.
+     * Returns once all of them have been started. Without a listener (in background) all of them are
+     * handed to the SDK at once, so that they are listed, cancelled and resumed as any other transfer
+     */
+    void start(MegaCmdMultiTransferListener *listener, int window);
+
+    void clear();
+
+    mega::MegaApi *getApi() const;
+    const std::vector<std::string> &getFolders() const;
+    const std::vector<std::string> &getTargets() const;
+    size_t getNumberOfDownloads() const;
+    long long getTotalBytes() const;
+
+    /**
+     * @brief Parses an order name ("tree", "smallest" or "largest")
+     * @return the order or -1 if unknown
+     */
+    static int getOrder(std::string name);
+};
+
+#endif // MEGACMDDOWNLOADPLANNER_H
@@ -102,11 +102,31 @@ MegaCmdExecuter::MegaCmdExecuter(MegaApi *api, MegaCMDLogger *loggerCMD, MegaCmd
     this->api = api;
     this->loggerCMD = loggerCMD;
     this->sandboxCMD = sandboxCMD;
-    this->globalTransferListener = new MegaCmdGlobalTransferListener(api, sandboxCMD);
+    int maxCompletedTransfers = ConfigurationManager::getConfigurationValue("completed_transfers_history", DEFAULTCOMPLETEDTRANSFERS);
+    this->globalTransferListener = new MegaCmdGlobalTransferListener(api, sandboxCMD, NULL, size_t(std::max(1, maxCompletedTransfers)));
     api->addTransferListener(globalTransferListener);
+    pathIndex = new MegaCmdPathIndex(api);
+    int traversalThreads = ConfigurationManager::getConfigurationValue("traversal_threads", int(getNumberOfCores()));
+    treeWalker = new MegaCmdTreeWalker(api, std::max(1, std::min(traversalThreads, MAXTRAVERSALTHREADS)));
+    sizeCache = new MegaCmdSizeCache(api, treeWalker);
+    localScanPool = NULL;
+    localScanThreads = std::min(ConfigurationManager::getConfigurationValue("upload_scan_threads", int(getNumberOfCores())), MAXTRAVERSALTHREADS);
+    mtxLocalScanPool.init(false);
+    fingerprintCache = NULL;
+    if (ConfigurationManager::getConfigFolder().size())
+    {
+        long long fingerprintCacheEntries = ConfigurationManager::getConfigurationValue("fingerprint_cache_entries", (long long)DEFAULTFINGERPRINTCACHEENTRIES);
+        fingerprintCache = new MegaCmdFingerprintCache(ConfigurationManager::getConfigFolder() + "/fingerprints",
+                                                       size_t(std::max(1LL, fingerprintCacheEntries)));
+    }
+    bulkRemovalToConfirm = NULL;
+    bulkRemovalClientID = -1;
     cwd = UNDEF;
     fsAccessCMD = new MegaFileSystemAccess();
+    mtxLocalFolders.init(false);
     mtxSyncMap.init(false);
+    syncStatus = new MegaCmdSyncStatusTable(api, fsAccessCMD);
+    syncRestarter = new MegaCmdSyncRestarter(api, &mtxSyncMap, ConfigurationManager::getConfigurationValue("sync_restart_concurrency", DEFAULTSYNCRESTARTCONCURRENCY));
     mtxWebDavLocations.init(false);
 #ifdef ENABLE_BACKUPS
     mtxBackupsMap.init(true);
@@ -123,7 +143,56 @@ MegaCmdExecuter::~MegaCmdExecuter()
         delete *it;
     }
     nodesToConfirmDelete.clear();
+    delete bulkRemovalToConfirm;
     delete globalTransferListener;
+    delete pathIndex;
+    delete sizeCache;
+    delete treeWalker;
+    if (localScanPool)
+    {
+        localScanPool->stop();
+        delete localScanPool;
+    }
+    delete fingerprintCache;
+    delete syncRestarter;
+    delete syncStatus;
+}
+
+MegaCmdPathIndex *MegaCmdExecuter::getPathIndex()
+{
+    return pathIndex;
+}
+
+MegaCmdWorkerPool *MegaCmdExecuter::getLocalScanPool()
+{
+    if (localScanThreads <= 1)
+    {
+        return NULL;
+    }
+
+    mtxLocalScanPool.lock();
+    if (!localScanPool)
+    {
+        localScanPool = new MegaCmdWorkerPool(localScanThreads, true);
+    }
+    MegaCmdWorkerPool *pool = localScanPool;
+    mtxLocalScanPool.unlock();
+    return pool;
+}
+
+MegaCmdSizeCache *MegaCmdExecuter::getSizeCache()
+{
+    return sizeCache;
+}
+
+MegaCmdSyncRestarter *MegaCmdExecuter::getSyncRestarter()
+{
+    return syncRestarter;
+}
+
+MegaCmdSyncStatusTable *MegaCmdExecuter::getSyncStatusTable()
+{
+    return syncStatus;
 }
 
 // list available top-level nodes and contacts/incoming shares
@@ -209,15 +278,13 @@ bool MegaCmdExecuter::includeIfIsSharedOrPendingOutShare(MegaApi *api, MegaNode
 
 struct patternNodeVector
 {
-    string pattern;
-    bool usepcre;
+    PatternMatcher *matcher;
     vector<MegaNode*> *nodesMatching;
 };
 
 struct criteriaNodeVector
 {
-    string pattern;
-    bool usepcre;
+    PatternMatcher *matcher;
     time_t minTime;
     time_t maxTime;
 
@@ -230,7 +297,7 @@ struct criteriaNodeVector
 bool MegaCmdExecuter::includeIfMatchesPattern(MegaApi *api, MegaNode * n, void *arg)
 {
     struct patternNodeVector *pnv = (struct patternNodeVector*)arg;
-    if (patternMatches(n->getName(), pnv->pattern.c_str(), pnv->usepcre))
+    if (pnv->matcher->matches(n->getName()))
     {
         pnv->nodesMatching->push_back(n->copy());
         return true;
@@ -262,7 +329,7 @@ bool MegaCmdExecuter::includeIfMatchesCriteria(MegaApi *api, MegaNode * n, void
         return false;
     }
 
-    if (!patternMatches(n->getName(), pnv->pattern.c_str(), pnv->usepcre))
+    if (!pnv->matcher->matches(n->getName()))
     {
         return false;
     }
@@ -294,6 +361,175 @@ bool MegaCmdExecuter::processTree(MegaNode *n, bool processor(MegaApi *, MegaNod
     return toret && currentret;
 }
 
+/**
+ * @brief Output of (part of) a listing, to be printed in order
+ */
+class TreeOutputResult : public MegaCmdTreeResult
+{
+public:
+    OUTSTRINGSTREAM output;
+};
+
+class TreeOutputVisitor : public MegaCmdTreeVisitor
+{
+public:
+    MegaCmdTreeResult *newResult()
+    {
+        return new TreeOutputResult();
+    }
+
+    void reduce(MegaCmdTreeResult *into, MegaCmdTreeResult *from)
+    {
+        ((TreeOutputResult *)into)->output << ((TreeOutputResult *)from)->output.str();
+    }
+
+    bool streams()
+    {
+        return true;
+    }
+
+    void consume(MegaCmdTreeResult *result)
+    {
+        OUTSTREAM << ((TreeOutputResult *)result)->output.str();
+    }
+};
+
+/**
+ * @brief Lists every node below the first one (as recursive dumptree)
+ */
+class DumpTreeVisitor : public TreeOutputVisitor
+{
+private:
+    MegaCmdExecuter *executer;
+    int extended_info;
+    bool showversions;
+    int firstDepth;
+
+public:
+    DumpTreeVisitor(MegaCmdExecuter *executer, int extended_info, bool showversions, int firstDepth)
+    {
+        this->executer = executer;
+        this->extended_info = extended_info;
+        this->showversions = showversions;
+        this->firstDepth = firstDepth;
+    }
+
+    bool visit(MegaNode *n, int depth, MegaCmdTreeResult *result)
+    {
+        if (depth > firstDepth)
+        {
+            executer->dumpNode(n, extended_info, showversions, depth, NULL, &((TreeOutputResult *)result)->output);
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Summarizes the contents of every folder (as recursive dumpTreeSummary)
+ */
+class TreeSummaryVisitor : public TreeOutputVisitor
+{
+private:
+    MegaCmdExecuter *executer;
+    MegaApi *api;
+    bool show_versions;
+    bool humanreadable;
+    int firstDepth;
+    string firstPathToShow;
+
+public:
+    TreeSummaryVisitor(MegaCmdExecuter *executer, MegaApi *api, bool show_versions, bool humanreadable, int firstDepth, string firstPathToShow)
+    {
+        this->executer = executer;
+        this->api = api;
+        this->show_versions = show_versions;
+        this->humanreadable = humanreadable;
+        this->firstDepth = firstDepth;
+        this->firstPathToShow = firstPathToShow;
+    }
+
+    bool visit(MegaNode *n, int depth, MegaCmdTreeResult *result)
+    {
+        return n->getType() != MegaNode::TYPE_FILE;
+    }
+
+    void visitChildren(MegaNode *n, int depth, MegaNodeList *children, MegaCmdTreeResult *result)
+    {
+        string pathToShow = firstPathToShow;
+        if (depth != firstDepth)
+        {
+            char *nodepath = api->getNodePath(n);
+            if (nodepath)
+            {
+                pathToShow = nodepath;
+                delete []nodepath;
+            }
+            else
+            {
+                pathToShow = n->getName() ? n->getName() : "CRYPTO_ERROR";
+            }
+        }
+        executer->dumpFolderSummary(children, pathToShow, true, show_versions, depth, humanreadable, &((TreeOutputResult *)result)->output);
+    }
+};
+
+class FoundNodesResult : public MegaCmdTreeResult
+{
+public:
+    vector<MegaNode *> nodes;
+
+    ~FoundNodesResult()
+    {
+        for (unsigned int i = 0; i < nodes.size(); i++)
+        {
+            delete nodes[i];
+        }
+    }
+};
+
+/**
+ * @brief Gathers the nodes that match some criteria (as processTree with includeIfMatchesCriteria)
+ */
+class FindCriteriaVisitor : public MegaCmdTreeVisitor
+{
+private:
+    MegaApi *api;
+    struct criteriaNodeVector *criteria;
+
+public:
+    FindCriteriaVisitor(MegaApi *api, struct criteriaNodeVector *criteria)
+    {
+        this->api = api;
+        this->criteria = criteria;
+    }
+
+    MegaCmdTreeResult *newResult()
+    {
+        return new FoundNodesResult();
+    }
+
+    bool visit(MegaNode *n, int depth, MegaCmdTreeResult *result)
+    {
+        struct criteriaNodeVector pnv = *criteria;
+        pnv.nodesMatching = &((FoundNodesResult *)result)->nodes;
+        MegaCmdExecuter::includeIfMatchesCriteria(api, n, &pnv);
+        return true;
+    }
+
+    void reduce(MegaCmdTreeResult *into, MegaCmdTreeResult *from)
+    {
+        vector<MegaNode *> &fromNodes = ((FoundNodesResult *)from)->nodes;
+        vector<MegaNode *> &intoNodes = ((FoundNodesResult *)into)->nodes;
+        intoNodes.insert(intoNodes.end(), fromNodes.begin(), fromNodes.end());
+        fromNodes.clear();
+    }
+
+    bool postOrder()
+    {
+        return true;
+    }
+};
+
 
 // returns node pointer determined by path relative to cwd
 // path naming conventions:
@@ -504,7 +740,7 @@ MegaNode* MegaCmdExecuter::nodebypath(const char* ptr, string* user, string* nam
                     bool isversion = nodeNameIsVersion(c[l]);
                     if (isversion)
                     {
-                        MegaNode *baseNode = api->getChildNode(n, c[l].substr(0,c[l].size()-11).c_str());
+                        MegaNode *baseNode = pathIndex->getChildNode(n, c[l].substr(0,c[l].size()-11));
                         if (baseNode)
                         {
                             MegaNodeList *versionNodes = api->getVersions(baseNode);
@@ -526,7 +762,7 @@ MegaNode* MegaCmdExecuter::nodebypath(const char* ptr, string* user, string* nam
                     }
                     else
                     {
-                        nn = api->getChildNode(n, c[l].c_str());
+                        nn = pathIndex->getChildNode(n, c[l]);
                     }
 
                     if (!nn) //NOT FOUND
@@ -557,6 +793,35 @@ MegaNode* MegaCmdExecuter::nodebypath(const char* ptr, string* user, string* nam
     return n;
 }
 
+/**
+ * @brief MegaCmdExecuter::getChildrenMatchingFromIndex Gets the names and handles of the children of parentNode matching a name pattern.
+ * Names are escaped (see escapeNodeName), so that the paths built with them can be resolved again
+ */
+void MegaCmdExecuter::getChildrenMatchingFromIndex(MegaNode *parentNode, const string &namePattern, bool usepcre, indexedchildren_t *children)
+{
+    children->clear();
+    PatternMatcher matcher(namePattern, usepcre);
+    if (matcher.isLiteral())
+    {
+        vector<MegaHandle> handles = pathIndex->getChildrenByName(parentNode, namePattern);
+        for (unsigned int i = 0; i < handles.size(); i++)
+        {
+            children->push_back(make_pair(escapeNodeName(namePattern), handles[i]));
+        }
+        return;
+    }
+
+    indexedchildren_t allchildren;
+    pathIndex->getChildren(parentNode, &allchildren);
+    for (unsigned int i = 0; i < allchildren.size(); i++)
+    {
+        if (matcher.matches(allchildren[i].first.c_str()))
+        {
+            children->push_back(allchildren[i]);
+        }
+    }
+}
+
 /**
  * @brief MegaCmdExecuter::getPathsMatching Gets paths of nodes matching a pattern given its path parts and a parent node
  *
@@ -605,75 +870,57 @@ void MegaCmdExecuter::getPathsMatching(MegaNode *parentNode, deque<string> pathP
         }
     }
 
-    MegaNodeList* children = api->getChildren(parentNode);
-    if (children)
+    bool isversion = nodeNameIsVersion(currentPart);
+    string namePattern = isversion ? currentPart.substr(0, currentPart.size() - 11) : currentPart;
+
+    indexedchildren_t children;
+    getChildrenMatchingFromIndex(parentNode, namePattern, usepcre, &children);
+
+    for (unsigned int i = 0; i < children.size(); i++)
     {
-        bool isversion = nodeNameIsVersion(currentPart);
+        const string &childname = children[i].first;
+        if (!isversion && !pathParts.size()) //last leave: no need to get the node
+        {
+            pathsMatching->push_back(pathPrefix+childname);
+            continue;
+        }
 
-        for (int i = 0; i < children->size(); i++)
+        MegaNode *childNode = api->getNodeByHandle(children[i].second);
+        if (!childNode)
         {
-            MegaNode *childNode = children->get(i);
-            // get childname from its path: alternative: childNode->getName()
-            char *childNodePath = api->getNodePath(childNode);
-            char *aux;
-            aux = childNodePath+strlen(childNodePath);
-            while (aux>childNodePath){
-                if (*aux=='/' && *(aux-1) != '\\')  break;
-                aux--;
-            }
-            if (*aux=='/') aux++;
-            string childname(aux);
-            delete []childNodePath;
+            continue;
+        }
 
-            if (isversion)
+        if (isversion)
+        {
+            MegaNodeList *versionNodes = api->getVersions(childNode);
+            if (versionNodes)
             {
-
-                if (childNode && patternMatches(childname.c_str(), currentPart.substr(0,currentPart.size()-11).c_str(), usepcre))
+                for (int i = 0; i < versionNodes->size(); i++)
                 {
-                    MegaNodeList *versionNodes = api->getVersions(childNode);
-                    if (versionNodes)
+                    MegaNode *versionNode = versionNodes->get(i);
+                    if ( currentPart.substr(currentPart.size()-10) == SSTR(versionNode->getModificationTime()) )
                     {
-                        for (int i = 0; i < versionNodes->size(); i++)
+                        if (pathParts.size() == 0) //last leave
                         {
-                            MegaNode *versionNode = versionNodes->get(i);
-                            if ( currentPart.substr(currentPart.size()-10) == SSTR(versionNode->getModificationTime()) )
-                            {
-                                if (pathParts.size() == 0) //last leave
-                                {
-                                    pathsMatching->push_back(pathPrefix+childname+"#"+SSTR(versionNode->getModificationTime())); //TODO: def version separator elswhere
-                                }
-                                else
-                                {
-                                    getPathsMatching(versionNode, pathParts, pathsMatching, usepcre,pathPrefix+childname+"#"+SSTR(versionNode->getModificationTime())+"/");
-                                }
-
-                                break;
-                            }
+                            pathsMatching->push_back(pathPrefix+childname+"#"+SSTR(versionNode->getModificationTime())); //TODO: def version separator elswhere
                         }
-                        delete versionNodes;
-                    }
-                }
-            }
-            else
-            {
-                if (patternMatches(childname.c_str(), currentPart.c_str(), usepcre))
-                {
-                    if (pathParts.size() == 0) //last leave
-                    {
-                        pathsMatching->push_back(pathPrefix+childname);
-                    }
-                    else
-                    {
-                        getPathsMatching(childNode, pathParts, pathsMatching, usepcre,pathPrefix+childname+"/");
+                        else
+                        {
+                            getPathsMatching(versionNode, pathParts, pathsMatching, usepcre,pathPrefix+childname+"#"+SSTR(versionNode->getModificationTime())+"/");
+                        }
+
+                        break;
                     }
                 }
-
-
+                delete versionNodes;
             }
-
         }
-
-        delete children;
+        else
+        {
+            getPathsMatching(childNode, pathParts, pathsMatching, usepcre,pathPrefix+childname+"/");
+        }
+        delete childNode;
     }
 }
 
@@ -976,62 +1223,55 @@ void MegaCmdExecuter::getNodesMatching(MegaNode *parentNode, queue<string> pathP
 
     }
 
-    MegaNodeList* children = api->getChildren(parentNode);
-    if (children)
+    bool isversion = nodeNameIsVersion(currentPart);
+    string namePattern = isversion ? currentPart.substr(0, currentPart.size() - 11) : currentPart;
+
+    indexedchildren_t children;
+    getChildrenMatchingFromIndex(parentNode, namePattern, usepcre, &children);
+
+    for (unsigned int i = 0; i < children.size(); i++)
     {
-        bool isversion = nodeNameIsVersion(currentPart);
+        MegaNode *childNode = api->getNodeByHandle(children[i].second);
+        if (!childNode)
+        {
+            continue;
+        }
 
-        for (int i = 0; i < children->size(); i++)
+        if (isversion)
         {
-            MegaNode *childNode = children->get(i);
-            if (isversion)
+            MegaNodeList *versionNodes = api->getVersions(childNode);
+            if (versionNodes)
             {
-
-                if (childNode && patternMatches(childNode->getName(), currentPart.substr(0,currentPart.size()-11).c_str(), usepcre))
+                for (int i = 0; i < versionNodes->size(); i++)
                 {
-                    MegaNodeList *versionNodes = api->getVersions(childNode);
-                    if (versionNodes)
+                    MegaNode *versionNode = versionNodes->get(i);
+                    if ( currentPart.substr(currentPart.size()-10) == SSTR(versionNode->getModificationTime()) )
                     {
-                        for (int i = 0; i < versionNodes->size(); i++)
+                        if (pathParts.size() == 0) //last leave
                         {
-                            MegaNode *versionNode = versionNodes->get(i);
-                            if ( currentPart.substr(currentPart.size()-10) == SSTR(versionNode->getModificationTime()) )
-                            {
-                                if (pathParts.size() == 0) //last leave
-                                {
-                                    nodesMatching->push_back(versionNode->copy());
-                                }
-                                else
-                                {
-                                    getNodesMatching(versionNode, pathParts, nodesMatching, usepcre);
-                                }
-
-                                break;
-                            }
+                            nodesMatching->push_back(versionNode->copy());
+                        }
+                        else
+                        {
+                            getNodesMatching(versionNode, pathParts, nodesMatching, usepcre);
                         }
-                        delete versionNodes;
-                    }
-                }
-            }
-            else
-            {
 
-                if (patternMatches(childNode->getName(), currentPart.c_str(), usepcre))
-                {
-                    if (pathParts.size() == 0) //last leave
-                    {
-                        nodesMatching->push_back(childNode->copy());
-                    }
-                    else
-                    {
-                        getNodesMatching(childNode, pathParts, nodesMatching, usepcre);
+                        break;
                     }
-
                 }
+                delete versionNodes;
             }
+            delete childNode;
+        }
+        else if (pathParts.size() == 0) //last leave
+        {
+            nodesMatching->push_back(childNode);
+        }
+        else
+        {
+            getNodesMatching(childNode, pathParts, nodesMatching, usepcre);
+            delete childNode;
         }
-
-        delete children;
     }
 }
 
@@ -1402,8 +1642,10 @@ vector <MegaNode*> * MegaCmdExecuter::nodesbypath(const char* ptr, bool usepcre,
     return nodesMatching;
 }
 
-void MegaCmdExecuter::dumpNode(MegaNode* n, int extended_info, bool showversions, int depth, const char* title)
+void MegaCmdExecuter::dumpNode(MegaNode* n, int extended_info, bool showversions, int depth, const char* title, OUTSTREAMTYPE *out)
 {
+    OUTSTREAMTYPE &os = out ? *out : OUTSTREAM;
+
     if (!title && !( title = n->getName()))
     {
         title = "CRYPTO_ERROR";
@@ -1413,54 +1655,54 @@ void MegaCmdExecuter::dumpNode(MegaNode* n, int extended_info, bool showversions
     {
         for (int i = depth - 1; i--; )
         {
-            OUTSTREAM << "\t";
+            os << "\t";
         }
     }
 
-    OUTSTREAM << title;
+    os << title;
     if (extended_info)
     {
-        //OUTSTREAM << "<" << api->handleToBase64(n->getHandle()) << ">";
-        OUTSTREAM << " (";
+        //os << "<" << api->handleToBase64(n->getHandle()) << ">";
+        os << " (";
         switch (n->getType())
         {
             case MegaNode::TYPE_FILE:
-                OUTSTREAM << sizeToText(n->getSize(), false);
+                os << sizeToText(n->getSize(), false);
 
                 const char* p;
                 if (( p = strchr(n->getAttrString()->c_str(), ':')))
                 {
-                    OUTSTREAM << ", has attributes " << p + 1;
+                    os << ", has attributes " << p + 1;
                 }
 
                 if (INVALID_HANDLE != n->getPublicHandle())
 //            if (n->isExported())
                 {
-                    OUTSTREAM << ", shared as exported";
+                    os << ", shared as exported";
                     if (n->getExpirationTime())
                     {
-                        OUTSTREAM << " temporal";
+                        os << " temporal";
                     }
                     else
                     {
-                        OUTSTREAM << " permanent";
+                        os << " permanent";
                     }
-                    OUTSTREAM << " file link";
+                    os << " file link";
                     if (extended_info > 1)
                     {
                         char * publicLink = n->getPublicLink();
-                        OUTSTREAM << ": " << publicLink;
+                        os << ": " << publicLink;
                         if (n->getExpirationTime())
                         {
                             if (n->isExpired())
                             {
-                                OUTSTREAM << " expired at ";
+                                os << " expired at ";
                             }
                             else
                             {
-                                OUTSTREAM << " expires at ";
+                                os << " expires at ";
                             }
-                            OUTSTREAM << " at " << getReadableTime(n->getExpirationTime());
+                            os << " at " << getReadableTime(n->getExpirationTime());
                         }
                         delete []publicLink;
                     }
@@ -1469,7 +1711,7 @@ void MegaCmdExecuter::dumpNode(MegaNode* n, int extended_info, bool showversions
 
             case MegaNode::TYPE_FOLDER:
             {
-                OUTSTREAM << "folder";
+                os << "folder";
                 MegaShareList* outShares = api->getOutShares(n);
                 if (outShares)
                 {
@@ -1477,7 +1719,7 @@ void MegaCmdExecuter::dumpNode(MegaNode* n, int extended_info, bool showversions
                     {
                         if (outShares->get(i)->getNodeHandle() == n->getHandle())
                         {
-                            OUTSTREAM << ", shared with " << outShares->get(i)->getUser() << ", access "
+                            os << ", shared with " << outShares->get(i)->getUser() << ", access "
                                       << getAccessLevelStr(outShares->get(i)->getAccess());
                         }
                     }
@@ -1489,12 +1731,12 @@ void MegaCmdExecuter::dumpNode(MegaNode* n, int extended_info, bool showversions
                         {
                             if (pendingoutShares->get(i)->getNodeHandle() == n->getHandle())
                             {
-                                OUTSTREAM << ", shared (still pending)";
+                                os << ", shared (still pending)";
                                 if (pendingoutShares->get(i)->getUser())
                                 {
-                                    OUTSTREAM << " with " << pendingoutShares->get(i)->getUser();
+                                    os << " with " << pendingoutShares->get(i)->getUser();
                                 }
-                                OUTSTREAM << " access " << getAccessLevelStr(pendingoutShares->get(i)->getAccess());
+                                os << " access " << getAccessLevelStr(pendingoutShares->get(i)->getAccess());
                             }
                         }
 
@@ -1503,20 +1745,20 @@ void MegaCmdExecuter::dumpNode(MegaNode* n, int extended_info, bool showversions
 
                     if (UNDEF != n->getPublicHandle())
                     {
-                        OUTSTREAM << ", shared as exported";
+                        os << ", shared as exported";
                         if (n->getExpirationTime())
                         {
-                            OUTSTREAM << " temporal";
+                            os << " temporal";
                         }
                         else
                         {
-                            OUTSTREAM << " permanent";
+                            os << " permanent";
                         }
-                        OUTSTREAM << " folder link";
+                        os << " folder link";
                         if (extended_info > 1)
                         {
                             char * publicLink = n->getPublicLink();
-                            OUTSTREAM << ": " << publicLink;
+                            os << ": " << publicLink;
                             delete []publicLink;
                         }
                     }
@@ -1525,32 +1767,32 @@ void MegaCmdExecuter::dumpNode(MegaNode* n, int extended_info, bool showversions
 
                 if (n->isInShare())
                 {
-                    OUTSTREAM << ", inbound " << api->getAccess(n) << " share";
+                    os << ", inbound " << api->getAccess(n) << " share";
                 }
                 break;
             }
             case MegaNode::TYPE_ROOT:
             {
-                OUTSTREAM << "root node";
+                os << "root node";
                 break;
             }
             case MegaNode::TYPE_INCOMING:
             {
-                OUTSTREAM << "inbox";
+                os << "inbox";
                 break;
             }
             case MegaNode::TYPE_RUBBISH:
             {
-                OUTSTREAM << "rubbish";
+                os << "rubbish";
                 break;
             }
             default:
-                OUTSTREAM << "unsupported type: " <<  n->getType() <<" , please upgrade";
+                os << "unsupported type: " <<  n->getType() <<" , please upgrade";
         }
-        OUTSTREAM << ")" << ( n->isRemoved() ? " (DELETED)" : "" );
+        os << ")" << ( n->isRemoved() ? " (DELETED)" : "" );
     }
 
-    OUTSTREAM << std::endl;
+    os << std::endl;
 
     if (showversions && n->getType() == MegaNode::TYPE_FILE)
     {
@@ -1566,17 +1808,17 @@ void MegaCmdExecuter::dumpNode(MegaNode* n, int extended_info, bool showversions
                     string fullname(n->getName()?n->getName():"NO_NAME");
                     fullname += "#";
                     fullname += SSTR(versionNode->getModificationTime());
-                    OUTSTREAM << "  " << fullname;
+                    os << "  " << fullname;
                     if (versionNode->getName() && !strcmp(versionNode->getName(),n->getName()) )
                     {
-                        OUTSTREAM << "[" << (versionNode->getName()?versionNode->getName():"NO_NAME") << "]";
+                        os << "[" << (versionNode->getName()?versionNode->getName():"NO_NAME") << "]";
                     }
-                    OUTSTREAM << " (" << getReadableTime(versionNode->getModificationTime()) << ")";
+                    os << " (" << getReadableTime(versionNode->getModificationTime()) << ")";
                     if (extended_info)
                     {
-                        OUTSTREAM << " (" << sizeToText(versionNode->getSize(), false) << ")";
+                        os << " (" << sizeToText(versionNode->getSize(), false) << ")";
                     }
-                    OUTSTREAM << std::endl;
+                    os << std::endl;
                 }
             }
         }
@@ -1597,8 +1839,10 @@ void MegaCmdExecuter::dumpNodeSummaryHeader()
     OUTSTREAM << std::endl;
 }
 
-void MegaCmdExecuter::dumpNodeSummary(MegaNode *n, bool humanreadable, const char *title)
+void MegaCmdExecuter::dumpNodeSummary(MegaNode *n, bool humanreadable, const char *title, OUTSTREAMTYPE *out)
 {
+    OUTSTREAMTYPE &os = out ? *out : OUTSTREAM;
+
     if (!title && !( title = n->getName()))
     {
         title = "CRYPTO_ERROR";
@@ -1607,56 +1851,56 @@ void MegaCmdExecuter::dumpNodeSummary(MegaNode *n, bool humanreadable, const cha
     switch (n->getType())
     {
     case MegaNode::TYPE_FILE:
-        OUTSTREAM << "-";
+        os << "-";
         break;
     case MegaNode::TYPE_FOLDER:
-        OUTSTREAM << "d";
+        os << "d";
         break;
     case MegaNode::TYPE_ROOT:
-        OUTSTREAM << "r";
+        os << "r";
         break;
     case MegaNode::TYPE_INCOMING:
-        OUTSTREAM << "i";
+        os << "i";
         break;
     case MegaNode::TYPE_RUBBISH:
-        OUTSTREAM << "b";
+        os << "b";
         break;
     default:
-        OUTSTREAM << "x";
+        os << "x";
         break;
     }
 
     if (UNDEF != n->getPublicHandle())
     {
-        OUTSTREAM << "e";
+        os << "e";
         if (n->getExpirationTime())
         {
-            OUTSTREAM << "t";
+            os << "t";
         }
         else
         {
-            OUTSTREAM << "p";
+            os << "p";
         }
     }
     else
     {
-        OUTSTREAM << "--";
+        os << "--";
     }
 
     if (n->isShared())
     {
-        OUTSTREAM << "s";
+        os << "s";
     }
     else if (n->isInShare())
     {
-        OUTSTREAM << "i";
+        os << "i";
     }
     else
     {
-        OUTSTREAM << "-";
+        os << "-";
     }
 
-    OUTSTREAM << " ";
+    os << " ";
 
     if (n->isFile())
     {
@@ -1664,50 +1908,50 @@ void MegaCmdExecuter::dumpNodeSummary(MegaNode *n, bool humanreadable, const cha
         int nversions = versionNodes ? versionNodes->size() : 0;
         if (nversions > 999)
         {
-            OUTSTREAM << getFixLengthString(">999", 4, ' ', true);
+            os << getFixLengthString(">999", 4, ' ', true);
         }
         else
         {
-            OUTSTREAM << getFixLengthString(SSTR(nversions), 4, ' ', true);
+            os << getFixLengthString(SSTR(nversions), 4, ' ', true);
         }
 
         delete versionNodes;
     }
     else
     {
-        OUTSTREAM << getFixLengthString("-", 4, ' ', true);
+        os << getFixLengthString("-", 4, ' ', true);
     }
 
-    OUTSTREAM << " ";
+    os << " ";
 
     if (n->isFile())
     {
         if (humanreadable)
         {
-            OUTSTREAM << getFixLengthString(sizeToText(n->getSize()), 10, ' ', true);
+            os << getFixLengthString(sizeToText(n->getSize()), 10, ' ', true);
         }
         else
         {
-            OUTSTREAM << getFixLengthString(SSTR(n->getSize()), 10, ' ', true);
+            os << getFixLengthString(SSTR(n->getSize()), 10, ' ', true);
         }
     }
     else
     {
-        OUTSTREAM << getFixLengthString("-", 10, ' ', true);
+        os << getFixLengthString("-", 10, ' ', true);
     }
 
     if (n->isFile())
     {
-        OUTSTREAM << " " << getReadableShortTime(n->getModificationTime());
+        os << " " << getReadableShortTime(n->getModificationTime());
     }
     else
     {
-        OUTSTREAM << " " << getReadableShortTime(n->getCreationTime());
+        os << " " << getReadableShortTime(n->getCreationTime());
     }
 
 
-    OUTSTREAM << " " << title;
-    OUTSTREAM << std::endl;
+    os << " " << title;
+    os << std::endl;
 }
 
 
@@ -1830,6 +2074,14 @@ void MegaCmdExecuter::createOrModifyBackup(string local, string remote, string s
 
 void MegaCmdExecuter::dumptree(MegaNode* n, int recurse, int extended_info, bool showversions, int depth, string pathRelativeTo)
 {
+    if (recurse && !depth && n->getType() != MegaNode::TYPE_FILE)
+    {
+        // subtrees are listed in parallel and printed in order
+        DumpTreeVisitor visitor(this, extended_info, showversions, depth);
+        treeWalker->walk(n, &visitor, depth);
+        return;
+    }
+
     if (depth || ( n->getType() == MegaNode::TYPE_FILE ))
     {
         if (pathRelativeTo != "NULL")
@@ -1892,6 +2144,46 @@ void MegaCmdExecuter::dumptree(MegaNode* n, int recurse, int extended_info, bool
     }
 }
 
+void MegaCmdExecuter::dumpFolderSummary(MegaNodeList *children, string pathToShow, int recurse, bool show_versions, int depth, bool humanreadable, OUTSTREAMTYPE *out)
+{
+    OUTSTREAMTYPE &os = out ? *out : OUTSTREAM;
+
+    if (depth)
+    {
+        os << std::endl;
+    }
+
+    if (recurse)
+    {
+        os << pathToShow << ":" << std::endl;
+    }
+
+    for (int i = 0; i < children->size(); i++)
+    {
+        dumpNodeSummary(children->get(i), humanreadable, NULL, &os);
+    }
+
+    if (show_versions)
+    {
+        for (int i = 0; i < children->size(); i++)
+        {
+            MegaNode *c = children->get(i);
+
+            MegaNodeList *vers = api->getVersions(c);
+            if (vers &&  vers->size() > 1)
+            {
+                os << std::endl << "Versions of " << pathToShow << "/" << c->getName() << ":" << std::endl;
+
+                for (int i = 0; i < vers->size(); i++)
+                {
+                    dumpNodeSummary(vers->get(i), humanreadable, NULL, &os);
+                }
+            }
+            delete vers;
+        }
+    }
+}
+
 void MegaCmdExecuter::dumpTreeSummary(MegaNode *n, int recurse, bool show_versions, int depth, bool humanreadable, string pathRelativeTo)
 {
     char * nodepath = api->getNodePath(n);
@@ -1924,53 +2216,20 @@ void MegaCmdExecuter::dumpTreeSummary(MegaNode *n, int recurse, bool show_versio
 
     if (n->getType() != MegaNode::TYPE_FILE)
     {
-        MegaNodeList* children = api->getChildren(n);
-        if (children)
+        if (recurse)
         {
-            if (depth)
-            {
-                OUTSTREAM << std::endl;
-            }
-
-            if (recurse)
-            {
-                OUTSTREAM << pathToShow << ":" << std::endl;
-            }
-
-            for (int i = 0; i < children->size(); i++)
-            {
-                dumpNodeSummary(children->get(i), humanreadable);
-            }
-
-            if (show_versions)
-            {
-                for (int i = 0; i < children->size(); i++)
-                {
-                    MegaNode *c = children->get(i);
-
-                    MegaNodeList *vers = api->getVersions(c);
-                    if (vers &&  vers->size() > 1)
-                    {
-                        OUTSTREAM << std::endl << "Versions of " << pathToShow << "/" << c->getName() << ":" << std::endl;
-
-                        for (int i = 0; i < vers->size(); i++)
-                        {
-                            dumpNodeSummary(vers->get(i), humanreadable);
-                        }
-                    }
-                    delete vers;
-                }
-            }
-
-            if (recurse)
+            // subfolders are summarized in parallel and printed in order
+            TreeSummaryVisitor visitor(this, api, show_versions, humanreadable, depth, pathToShow);
+            treeWalker->walk(n, &visitor, depth);
+        }
+        else
+        {
+            MegaNodeList* children = api->getChildren(n);
+            if (children)
             {
-                for (int i = 0; i < children->size(); i++)
-                {
-                    MegaNode *c = children->get(i);
-                    dumpTreeSummary(c, recurse, show_versions, depth + 1, humanreadable);
-                }
+                dumpFolderSummary(children, pathToShow, false, show_versions, depth, humanreadable);
+                delete children;
             }
-            delete children;
         }
     }
     else // file
@@ -2505,6 +2764,10 @@ bool MegaCmdExecuter::actUponFetchNodes(MegaApi *api, SynchronousRequestListener
     {
         LOG_verbose << "actUponFetchNodes ok";
         api->enableTransferResumption();
+#ifdef ENABLE_SYNC
+        // not waited for: petitions not involving syncs can be served meanwhile
+        syncRestarter->schedule(MegaCmdSyncRestarter::MODE_RESUME);
+#endif
 
         MegaNode *cwdNode = ( cwd == UNDEF ) ? NULL : api->getNodeByHandle(cwd);
         if (( cwd == UNDEF ) || !cwdNode)
@@ -2743,6 +3006,11 @@ void MegaCmdExecuter::actUponLogout(SynchronousRequestListener *srl, bool keptSe
         cwd = UNDEF;
         delete []session;
         session = NULL;
+        pathIndex->clear();
+        sizeCache->clear();
+        syncStatus->clear();
+        syncRestarter->cancel();
+        syncRestarter->waitUntilDone();
         mtxSyncMap.lock();
         ConfigurationManager::unloadConfiguration();
         if (!keptSession)
@@ -2781,20 +3049,19 @@ int MegaCmdExecuter::actUponCreateFolder(SynchronousRequestListener *srl, int ti
     return 2;
 }
 
-void MegaCmdExecuter::confirmDelete()
+void MegaCmdExecuter::setDeletePrompt()
 {
     if (nodesToConfirmDelete.size())
     {
-        MegaNode * nodeToConfirmDelete = nodesToConfirmDelete.front();
-        nodesToConfirmDelete.erase(nodesToConfirmDelete.begin());
-        doDeleteNode(nodeToConfirmDelete,api);
+        string newprompt("Are you sure to delete ");
+        newprompt+=nodesToConfirmDelete.front()->getName();
+        newprompt+=" ? (Yes/No/All/None): ";
+        setprompt(AREYOUSURETODELETE,newprompt);
     }
-
-
-    if (nodesToConfirmDelete.size())
+    else if (bulkRemovalToConfirm)
     {
         string newprompt("Are you sure to delete ");
-        newprompt+=nodesToConfirmDelete.front()->getName();
+        newprompt+=bulkRemovalToConfirm->getSummary();
         newprompt+=" ? (Yes/No/All/None): ";
         setprompt(AREYOUSURETODELETE,newprompt);
     }
@@ -2802,7 +3069,24 @@ void MegaCmdExecuter::confirmDelete()
     {
         setprompt(COMMAND);
     }
+}
 
+void MegaCmdExecuter::confirmDelete()
+{
+    if (nodesToConfirmDelete.size())
+    {
+        MegaNode * nodeToConfirmDelete = nodesToConfirmDelete.front();
+        nodesToConfirmDelete.erase(nodesToConfirmDelete.begin());
+        doDeleteNode(nodeToConfirmDelete,api);
+    }
+    else if (bulkRemovalToConfirm)
+    {
+        MegaCmdBulkRemover *remover = bulkRemovalToConfirm;
+        bulkRemovalToConfirm = NULL;
+        doDeleteNodes(remover, bulkRemovalClientID);
+    }
+
+    setDeletePrompt();
 }
 
 void MegaCmdExecuter::discardDelete()
@@ -2811,17 +3095,12 @@ void MegaCmdExecuter::discardDelete()
         delete nodesToConfirmDelete.front();
         nodesToConfirmDelete.erase(nodesToConfirmDelete.begin());
     }
-    if (nodesToConfirmDelete.size())
-    {
-        string newprompt("Are you sure to delete ");
-        newprompt+=nodesToConfirmDelete.front()->getName();
-        newprompt+=" ? (Yes/No/All/None): ";
-        setprompt(AREYOUSURETODELETE,newprompt);
-    }
     else
     {
-        setprompt(COMMAND);
+        delete bulkRemovalToConfirm;
+        bulkRemovalToConfirm = NULL;
     }
+    setDeletePrompt();
 }
 
 
@@ -2834,6 +3113,12 @@ void MegaCmdExecuter::confirmDeleteAll()
         nodesToConfirmDelete.erase(nodesToConfirmDelete.begin());
         doDeleteNode(nodeToConfirmDelete,api);
     }
+    if (bulkRemovalToConfirm)
+    {
+        MegaCmdBulkRemover *remover = bulkRemovalToConfirm;
+        bulkRemovalToConfirm = NULL;
+        doDeleteNodes(remover, bulkRemovalClientID);
+    }
 
     setprompt(COMMAND);
 }
@@ -2844,9 +3129,70 @@ void MegaCmdExecuter::discardDeleteAll()
         delete nodesToConfirmDelete.front();
         nodesToConfirmDelete.erase(nodesToConfirmDelete.begin());
     }
+    delete bulkRemovalToConfirm;
+    bulkRemovalToConfirm = NULL;
     setprompt(COMMAND);
 }
 
+void MegaCmdExecuter::doDeleteNodes(MegaCmdBulkRemover *remover, int clientID)
+{
+    long long startTime = getMonotonicMicroSeconds();
+    int window = ConfigurationManager::getConfigurationValue("remove_concurrency", DEFAULTREMOVECONCURRENCY);
+    size_t failed = remover->remove(window, clientID);
+    if (failed)
+    {
+        setCurrentOutCode(remover->getLastError());
+        LOG_err << "Failed to delete " << failed << " of " << remover->getNumberOfNodes() << " nodes";
+    }
+    LOG_debug << "Removed " << remover->getNumberOfNodes() - failed << " nodes (" << remover->getNumberOfPruned()
+              << " pruned within removed folders) in " << (getMonotonicMicroSeconds() - startTime) / 1000 << " ms";
+    delete remover;
+}
+
+int MegaCmdExecuter::deleteNodes(MegaCmdBulkRemover *remover, int force, int clientID)
+{
+    remover->prepare();
+    if (!remover->getNumberOfNodes())
+    {
+        delete remover;
+        return MCMDCONFIRM_NO;
+    }
+
+    if (force || !remover->getNumberOfFolders())
+    {
+        doDeleteNodes(remover, clientID);
+        return MCMDCONFIRM_YES;
+    }
+
+    if (!getCurrentThreadIsCmdShell() && interactiveThread())
+    {
+        delete bulkRemovalToConfirm;
+        bulkRemovalToConfirm = remover;
+        bulkRemovalClientID = clientID;
+        if (getprompt() != AREYOUSURETODELETE)
+        {
+            setDeletePrompt();
+        }
+        return MCMDCONFIRM_NO; //default return
+    }
+
+    string confirmationQuery("Are you sure to delete ");
+    confirmationQuery += remover->getSummary();
+    confirmationQuery += " ? (Yes/No/All/None): ";
+
+    int confirmationResponse = askforConfirmation(confirmationQuery);
+    if (confirmationResponse == MCMDCONFIRM_YES || confirmationResponse == MCMDCONFIRM_ALL)
+    {
+        LOG_debug << "confirmation received";
+        doDeleteNodes(remover, clientID);
+    }
+    else
+    {
+        LOG_debug << "confirmation denied";
+        delete remover;
+    }
+    return confirmationResponse;
+}
 
 void MegaCmdExecuter::doDeleteNode(MegaNode *nodeToDelete,MegaApi* api)
 {
@@ -3039,7 +3385,7 @@ int MegaCmdExecuter::deleteNode(MegaNode *nodeToDelete, MegaApi* api, int recurs
     return MCMDCONFIRM_NO; //default return
 }
 
-void MegaCmdExecuter::downloadNode(string path, MegaApi* api, MegaNode *node, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener)
+bool MegaCmdExecuter::checkDownloadQuota(MegaApi *api, long long size, bool ignorequotawarn)
 {
     if (sandboxCMD->isOverquota() && !ignorequotawarn)
     {
@@ -3084,13 +3430,13 @@ void MegaCmdExecuter::downloadNode(string path, MegaApi* api, MegaNode *node, bo
                      "Alternatively, you can try again in " << secondsToText(sandboxCMD->secondsOverQuota-(ts-sandboxCMD->timeOfOverquota)) <<
                      "." << std::endl << "See \"help --upgrade\" for further details" << std::endl;
         OUTSTREAM << "Use --ignore-quota-warn to initiate nevertheless" << std::endl;
-        return;
+        return false;
     }
 
-    if (!ignorequotawarn)
+    if (!ignorequotawarn && size > 0)
     {
         MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-        api->queryTransferQuota(node->getSize(),megaCmdListener);
+        api->queryTransferQuota(size, megaCmdListener);
         megaCmdListener->wait();
         if (checkNoErrors(megaCmdListener->getError(), "query transfer quota"))
         {
@@ -3098,54 +3444,127 @@ void MegaCmdExecuter::downloadNode(string path, MegaApi* api, MegaNode *node, bo
             {
                 OUTSTREAM << "Transfer not started: proceding will exceed transfer quota. "
                              "Use --ignore-quota-warn to initiate nevertheless" << std::endl;
-                return;
+                delete megaCmdListener;
+                return false;
             }
         }
         delete megaCmdListener;
     }
+    return true;
+}
 
-    MegaCmdTransferListener *megaCmdTransferListener = NULL;
-    if (!background)
+void MegaCmdExecuter::createLocalFolders(const vector<string> &folders)
+{
+    for (size_t i = 0; i < folders.size(); i++)
     {
-        if (!multiTransferListener)
+        string path = folders[i];
+        string localpath;
+        fsAccessCMD->path2local(&path, &localpath);
+        mtxLocalFolders.lock();
+        bool failed = !fsAccessCMD->mkdirlocal(&localpath, false) && !fsAccessCMD->target_exists;
+        mtxLocalFolders.unlock();
+        if (failed)
         {
-            megaCmdTransferListener = new MegaCmdTransferListener(api, sandboxCMD, multiTransferListener, clientID);
+            LOG_err << "Unable to create folder " << path;
         }
-        multiTransferListener->onNewTransfer();
     }
-#ifdef _WIN32
-    replaceAll(path,"/","\\");
-#endif
-    LOG_debug << "Starting download: " << node->getName() << " to : " << path;
+}
+
+void MegaCmdExecuter::downloadNode(string path, MegaApi* api, MegaNode *node, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener)
+{
+    MegaCmdDownloadPlanner planner(api);
+    planner.add(node, path);
+    downloadNodes(&planner, background, ignorequotawarn, clientID, multiTransferListener);
+}
 
-    if (multiTransferListener && !background)
+void MegaCmdExecuter::downloadNodes(MegaCmdDownloadPlanner *planner, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener)
+{
+    if (!planner->getNumberOfDownloads() && !planner->getFolders().size())
     {
-        api->startDownload(node, path.c_str(), multiTransferListener);
+        return;
     }
-    else
+
+    // a single query for the whole set, instead of one per node
+    if (!checkDownloadQuota(planner->getApi(), planner->getTotalBytes(), ignorequotawarn))
     {
-        api->startDownload(node, path.c_str(), megaCmdTransferListener);
+        planner->clear();
+        return;
     }
-    if (megaCmdTransferListener)
+
+    createLocalFolders(planner->getFolders());
+
+    string order = ConfigurationManager::getConfigurationSValue("download_order");
+    if (order.size() && MegaCmdDownloadPlanner::getOrder(order) < 0)
     {
-        megaCmdTransferListener->wait();
+        LOG_warn << "Unknown download order: " << order << ". Using the order of the tree";
+    }
+    planner->sort(MegaCmdDownloadPlanner::getOrder(order));
+    int window = ConfigurationManager::getConfigurationValue("download_concurrency", DEFAULTDOWNLOADCONCURRENCY);
+
+    LOG_debug << "Starting " << planner->getNumberOfDownloads() << " downloads (" << planner->getTotalBytes() << " bytes), "
+              << planner->getFolders().size() << " folders created";
+
+    if (background)
+    {
+        planner->start(NULL, window);
+    }
+    else if (multiTransferListener)
+    {
+        planner->start(multiTransferListener, window);
+    }
+    else
+    {
+        MegaCmdMultiTransferListener *megaCmdMultiTransferListener = new MegaCmdMultiTransferListener(planner->getApi(), sandboxCMD, NULL, clientID);
+        planner->start(megaCmdMultiTransferListener, window);
+        megaCmdMultiTransferListener->waitMultiEnd();
 #ifdef _WIN32
-            Sleep(100); //give a while to print end of transfer
+        Sleep(100); //give a while to print end of transfer
 #endif
-        if (checkNoErrors(megaCmdTransferListener->getError(), "download node"))
+        if (megaCmdMultiTransferListener->getFinalerror() != MegaError::API_OK)
         {
-            LOG_info << "Download complete: " << megaCmdTransferListener->getTransfer()->getPath();
+            setCurrentOutCode(megaCmdMultiTransferListener->getFinalerror());
+            LOG_err << "Download failed. error code:" << MegaError::getErrorString(megaCmdMultiTransferListener->getFinalerror());
         }
-        delete megaCmdTransferListener;
+        else
+        {
+            for (size_t i = 0; i < planner->getTargets().size(); i++)
+            {
+                LOG_info << "Download complete: " << planner->getTargets()[i];
+            }
+        }
+        delete megaCmdMultiTransferListener;
     }
+    planner->clear();
 }
 
 void MegaCmdExecuter::uploadNode(string path, MegaApi* api, MegaNode *node, string newname, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener)
 {
+    unescapeifRequired(path);
+
+    MegaCmdUploadPlanner planner(api, fsAccessCMD, getLocalScanPool());
+    if (!planner.add(path, node, newname))
+    {
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << "Could not find local path: " << path;
+        return;
+    }
+    uploadNodes(&planner, background, ignorequotawarn, clientID, multiTransferListener);
+}
+
+void MegaCmdExecuter::uploadNodes(MegaCmdUploadPlanner *planner, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener)
+{
+    string order = ConfigurationManager::getConfigurationSValue("upload_order");
+    int uploadOrder = order.size() ? MegaCmdUploadPlanner::getOrder(order) : MegaCmdUploadPlanner::ORDER_SIZE_BUCKETS;
+    if (uploadOrder < 0)
+    {
+        LOG_warn << "Unknown upload order: " << order << ". Using the order of the tree";
+    }
+    planner->scan(uploadOrder);
+
     if (!ignorequotawarn)
     { //TODO: reenable this if ever queryBandwidthQuota applies to uploads as well
 //        MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-//        api->queryBandwidthQuota(node->getSize(),megaCmdListener);
+//        api->queryBandwidthQuota(planner->getTotalBytes(),megaCmdListener);
 //        megaCmdListener->wait();
 //        if (checkNoErrors(megaCmdListener->getError(), "query bandwidth quota"))
 //        {
@@ -3157,61 +3576,61 @@ void MegaCmdExecuter::uploadNode(string path, MegaApi* api, MegaNode *node, stri
 //            }
 //        }
     }
-    MegaCmdTransferListener *megaCmdTransferListener = NULL;
-    if (!background)
+
+    int failedFolders = planner->createRemoteFolders();
+    if (failedFolders)
     {
-        if (!multiTransferListener)
-        {
-            megaCmdTransferListener = new MegaCmdTransferListener(api, sandboxCMD, multiTransferListener, clientID);
-        }
-        multiTransferListener->onNewTransfer();
+        setCurrentOutCode(MCMD_INVALIDSTATE);
+        LOG_err << failedFolders << " remote folders could not be created: their contents will not be uploaded";
     }
-    unescapeifRequired(path);
 
-#ifdef _WIN32
-    replaceAll(path,"/","\\");
-#endif
-
-    LOG_debug << "Starting upload: " << path << " to : " << node->getName() << (newname.size()?"/":"") << newname;
+    int window = ConfigurationManager::getConfigurationValue("upload_concurrency", DEFAULTUPLOADCONCURRENCY);
 
+    LOG_debug << "Starting " << planner->getNumberOfUploads() << " uploads (" << planner->getTotalBytes() << " bytes) into "
+              << planner->getNumberOfFolders() << " folders";
 
-    MegaTransferListener *thelistener;
-    if (multiTransferListener && !background)
+    if (background)
     {
-       thelistener = multiTransferListener;
+        planner->start(NULL, window);
     }
-    else
-    {
-        thelistener = megaCmdTransferListener;
-    }
-
-    if (newname.size())
+    else if (multiTransferListener)
     {
-        api->startUpload(path.c_str(), node, newname.c_str(), thelistener);
+        planner->start(multiTransferListener, window);
     }
     else
     {
-        api->startUpload(path.c_str(), node, thelistener);
-    }
-    if (megaCmdTransferListener)
-    {
-        megaCmdTransferListener->wait();
+        MegaCmdMultiTransferListener *megaCmdMultiTransferListener = new MegaCmdMultiTransferListener(api, sandboxCMD, NULL, clientID);
+        planner->start(megaCmdMultiTransferListener, window);
+        megaCmdMultiTransferListener->waitMultiEnd();
 #ifdef _WIN32
-            Sleep(100); //give a while to print end of transfer
+        Sleep(100); //give a while to print end of transfer
 #endif
-        if (megaCmdTransferListener->getError()->getErrorCode() == API_EREAD)
+        if (megaCmdMultiTransferListener->getFinalerror() != MegaError::API_OK)
         {
-            setCurrentOutCode(MCMD_NOTFOUND);
-            LOG_err << "Could not find local path: " << path;
+            setCurrentOutCode(megaCmdMultiTransferListener->getFinalerror());
+            LOG_err << "Upload failed. error code:" << MegaError::getErrorString(megaCmdMultiTransferListener->getFinalerror());
         }
-        else if (checkNoErrors(megaCmdTransferListener->getError(), "Upload node"))
-        {
-            char * destinyPath = api->getNodePath(node);
-            LOG_info << "Upload complete: " << path << " to " << destinyPath << newname;
-            delete []destinyPath;
-        }
-        delete megaCmdTransferListener;
+        delete megaCmdMultiTransferListener;
+        planner->recordUploads();
+    }
+
+    if (planner->getNumberOfSkipped())
+    {
+        LOG_info << planner->getNumberOfSkipped() << " unchanged files skipped";
+    }
+}
+
+void MegaCmdExecuter::reportTransferRate(string action, MegaCmdMultiTransferListener *multiTransferListener)
+{
+    long long elapsed = multiTransferListener->getElapsedMicroSeconds();
+    if (!multiTransferListener->getFinished() || !elapsed)
+    {
+        return;
     }
+    LOG_info << action << " " << multiTransferListener->getFinished() << " files ("
+             << sizeToText(multiTransferListener->getTotalbytes(), false) << ") in " << elapsed / 1000 << " ms: "
+             << std::fixed << std::setprecision(1) << multiTransferListener->getFinished() * 1000000.0 / elapsed << " files/s, "
+             << sizeToText(multiTransferListener->getThroughput(), false) << "/s";
 }
 
 
@@ -3345,7 +3764,7 @@ void MegaCmdExecuter::disableShare(MegaNode *n, string with)
     shareNode(n, with, MegaShare::ACCESS_UNKNOWN);
 }
 
-int MegaCmdExecuter::makedir(string remotepath, bool recursive, MegaNode *parentnode)
+int MegaCmdExecuter::makedir(string remotepath, bool recursive, MegaNode *parentnode, MegaCmdFolderCreator *creator)
 {
     MegaNode *currentnode;
     if (parentnode)
@@ -3356,88 +3775,94 @@ int MegaCmdExecuter::makedir(string remotepath, bool recursive, MegaNode *parent
     {
         currentnode = api->getNodeByHandle(cwd);
     }
-    if (currentnode)
+    if (!currentnode)
+    {
+        return MCMD_EARGS;
+    }
+
+    // normalized first, so that ".." after an existing folder does not reach the creator (e.g. a/../b)
+    string rest = remotepath;
+    if (!MegaCmdFolderCreator::normalize(&rest))
+    {
+        LOG_err << "Folder navigation failed: " << remotepath;
+        if (currentnode != parentnode)
+            delete currentnode;
+        return MCMD_INVALIDSTATE;
+    }
+
+    // existing folders are traversed here, the missing ones are left to the creator
+    while (rest.length())
     {
-        string rest = remotepath;
-        while (rest.length())
+        bool lastleave = false;
+        size_t possep = rest.find_first_of("/");
+        if (possep == string::npos)
         {
-            bool lastleave = false;
-            size_t possep = rest.find_first_of("/");
-            if (possep == string::npos)
-            {
-                possep = rest.length();
-                lastleave = true;
-            }
+            possep = rest.length();
+            lastleave = true;
+        }
 
-            string newfoldername = rest.substr(0, possep);
-            if (!rest.length())
-            {
-                break;
-            }
-            if (newfoldername.length())
+        string newfoldername = rest.substr(0, possep);
+        if (newfoldername.length())
+        {
+            MegaNode *existing_node = api->getChildNode(currentnode, newfoldername.c_str());
+            if (!existing_node)
             {
-                MegaNode *existing_node = api->getChildNode(currentnode, newfoldername.c_str());
-                if (!existing_node)
-                {
-                    if (!recursive && !lastleave)
-                    {
-                        LOG_err << "Use -p to create folders recursively";
-                        if (currentnode != parentnode)
-                            delete currentnode;
-                        return MCMD_EARGS;
-                    }
-                    LOG_verbose << "Creating (sub)folder: " << newfoldername;
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->createFolder(newfoldername.c_str(), currentnode, megaCmdListener);
-                    actUponCreateFolder(megaCmdListener);
-                    delete megaCmdListener;
-                    MegaNode *prevcurrentNode = currentnode;
-                    currentnode = api->getChildNode(currentnode, newfoldername.c_str());
-                    if (prevcurrentNode != parentnode)
-                        delete prevcurrentNode;
-                    if (!currentnode)
-                    {
-                        LOG_err << "Couldn't get node for created subfolder: " << newfoldername;
-                        if (currentnode != parentnode)
-                            delete currentnode;
-                        return MCMD_INVALIDSTATE;
-                    }
-                }
-                else
-                {
-                    if (currentnode != parentnode)
-                        delete currentnode;
-                    currentnode = existing_node;
-                }
-
-                if (lastleave && existing_node)
+                if (!recursive && !lastleave)
                 {
-                    LOG_err << ((existing_node->getType() == MegaNode::TYPE_FILE)?"File":"Folder") << " already exists: " << remotepath;
+                    LOG_err << "Use -p to create folders recursively";
                     if (currentnode != parentnode)
                         delete currentnode;
-                    return MCMD_INVALIDSTATE;
+                    return MCMD_EARGS;
                 }
+                break;
             }
 
-            //string rest = rest.substr(possep+1,rest.length()-possep-1);
-            if (!lastleave)
+            if (lastleave || existing_node->getType() == MegaNode::TYPE_FILE)
             {
-                rest = rest.substr(possep + 1, rest.length());
-            }
-            else
-            {
-                break;
+                LOG_err << ((existing_node->getType() == MegaNode::TYPE_FILE)?"File":"Folder") << " already exists: " << remotepath;
+                delete existing_node;
+                if (currentnode != parentnode)
+                    delete currentnode;
+                return MCMD_INVALIDSTATE;
             }
+
+            if (currentnode != parentnode)
+                delete currentnode;
+            currentnode = existing_node;
         }
-        if (currentnode != parentnode)
-            delete currentnode;
+
+        rest = lastleave ? string() : rest.substr(possep + 1);
     }
-    else
+
+    int toret = MCMD_OK;
+    if (rest.length())
     {
-        return MCMD_EARGS;
+        MegaCmdFolderCreator *ownCreator = creator ? NULL : new MegaCmdFolderCreator(api);
+        int added = (creator ? creator : ownCreator)->add(currentnode->getHandle(), rest);
+        if (added == MegaError::API_EEXIST)
+        {
+            // to be created by a previous path
+            LOG_err << "Folder already exists: " << remotepath;
+            toret = MCMD_INVALIDSTATE;
+        }
+        else if (added != MegaError::API_OK)
+        {
+            LOG_err << "Folder navigation failed: " << remotepath;
+            toret = MCMD_INVALIDSTATE;
+        }
+        if (ownCreator)
+        {
+            if (ownCreator->create())
+            {
+                toret = MCMD_INVALIDSTATE;
+            }
+            delete ownCreator;
+        }
     }
-    return MCMD_OK;
 
+    if (currentnode != parentnode)
+        delete currentnode;
+    return toret;
 }
 
 
@@ -3456,30 +3881,10 @@ string MegaCmdExecuter::getCurrentPath()
 }
 
 long long MegaCmdExecuter::getVersionsSize(MegaNode *n)
-{
-    long long toret = 0;
-
-    MegaNodeList *versionNodes = api->getVersions(n);
-    if (versionNodes)
-    {
-        for (int i = 0; i < versionNodes->size(); i++)
-        {
-            MegaNode *versionNode = versionNodes->get(i);
-            toret += api->getSize(versionNode);
-        }
-    }
-
-    MegaNodeList *children = api->getChildren(n);
-    if (children)
-    {
-        for (int i = 0; i < children->size(); i++)
-        {
-            MegaNode *child = children->get(i);
-            toret += getVersionsSize(child);
-        }
-        delete children;
-    }
-    return toret;
+{
+    treesizes sizes;
+    sizeCache->getSizes(n, &sizes);
+    return sizes.bytes + sizes.versionsBytes;
 }
 
 vector<string> MegaCmdExecuter::listpaths(bool usepcre, string askedPath, bool discardFiles)
@@ -3688,18 +4093,20 @@ void MegaCmdExecuter::printTransfersHeader(const unsigned int PATHSIZE, bool pri
     OUTSTREAM << std::endl;
 }
 
-void MegaCmdExecuter::printTransfer(MegaTransfer *transfer, const unsigned int PATHSIZE, bool printstate)
+void MegaCmdExecuter::printTransfer(int type, bool sync, int tag, string source, string destination,
+                                    long long transferredBytes, long long totalBytes, int state,
+                                    const unsigned int PATHSIZE, bool printstate)
 {
     //Direction
 #ifdef _WIN32
-    OUTSTREAM << " " << ((transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?"D":"U") << " ";
+    OUTSTREAM << " " << ((type == MegaTransfer::TYPE_DOWNLOAD)?"D":"U") << " ";
 #else
-    OUTSTREAM << " " << ((transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?"\u21d3":"\u21d1") << " ";
+    OUTSTREAM << " " << ((type == MegaTransfer::TYPE_DOWNLOAD)?"\u21d3":"\u21d1") << " ";
 #endif
     //TODO: handle TYPE_LOCAL_HTTP_DOWNLOAD
 
     //type (transfer/normal)
-    if (transfer->isSyncTransfer())
+    if (sync)
     {
 #ifdef _WIN32
         OUTSTREAM << "S";
@@ -3715,84 +4122,83 @@ void MegaCmdExecuter::printTransfer(MegaTransfer *transfer, const unsigned int P
     OUTSTREAM << " " ;
 
     //tag
-    OUTSTREAM << getRightAlignedString(SSTR(transfer->getTag()),7) << " ";
-
-    if (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
-    {
-        // source
-        MegaNode * node = api->getNodeByHandle(transfer->getNodeHandle());
-        if (node)
-        {
-            char * nodepath = api->getNodePath(node);
-            OUTSTREAM << getFixLengthString(nodepath,PATHSIZE);
-            delete []nodepath;
-
-            delete node;
-        }
-        else
-        {
-            globalTransferListener->completedTransfersMutex.lock();
-            OUTSTREAM << getFixLengthString(globalTransferListener->completedPathsByHandle[transfer->getNodeHandle()],PATHSIZE);
-            globalTransferListener->completedTransfersMutex.unlock();
-        }
-
-        OUTSTREAM << " ";
-
-        //destination
-        string dest = transfer->getParentPath();
-        dest.append(transfer->getFileName());
-        OUTSTREAM << getFixLengthString(dest,PATHSIZE);
-    }
-    else
-    {
-
-        //source
-        string source(transfer->getParentPath()?transfer->getParentPath():"");
-        source.append(transfer->getFileName());
+    OUTSTREAM << getRightAlignedString(SSTR(tag),7) << " ";
 
-        OUTSTREAM << getFixLengthString(source, PATHSIZE);
-        OUTSTREAM << " ";
-
-        //destination
-        MegaNode * parentNode = api->getNodeByHandle(transfer->getParentHandle());
-        if (parentNode)
-        {
-            char * parentnodepath = api->getNodePath(parentNode);
-            OUTSTREAM << getFixLengthString(parentnodepath ,PATHSIZE);
-            delete []parentnodepath;
-
-            delete parentNode;
-        }
-        else
-        {
-            OUTSTREAM << getFixLengthString("",PATHSIZE,'-');
-            LOG_warn << "Could not find destination (parent handle "<< ((transfer->getParentHandle()==INVALID_HANDLE)?" invalid":" valid")
-                     <<" ) for upload transfer. Source=" << transfer->getParentPath() << transfer->getFileName();
-        }
-    }
+    // an empty path is an unknown (remote) one
+    OUTSTREAM << getFixLengthString(source, PATHSIZE, source.size() ? ' ' : '-');
+    OUTSTREAM << " ";
+    OUTSTREAM << getFixLengthString(destination, PATHSIZE, destination.size() ? ' ' : '-');
 
     //progress
     float percent;
-    if (transfer->getTotalBytes() == 0)
+    if (totalBytes == 0)
     {
         percent = 0;
     }
     else
     {
-        percent = float(transfer->getTransferredBytes()*1.0/transfer->getTotalBytes());
+        percent = float(transferredBytes*1.0/totalBytes);
     }
     OUTSTREAM << "  " << getFixLengthString(percentageToText(percent),7,' ',true)
-              << " of " << getFixLengthString(sizeToText(transfer->getTotalBytes()),10,' ',true);
+              << " of " << getFixLengthString(sizeToText(totalBytes),10,' ',true);
 
     //state
     if (printstate)
     {
-        OUTSTREAM << "  " << getTransferStateStr(transfer->getState());
+        OUTSTREAM << "  " << getTransferStateStr(state);
     }
 
     OUTSTREAM << std::endl;
 }
 
+void MegaCmdExecuter::printTransfer(MegaTransfer *transfer, const unsigned int PATHSIZE, bool printstate)
+{
+    string localpath(transfer->getParentPath()?transfer->getParentPath():"");
+    localpath.append(transfer->getFileName()?transfer->getFileName():"");
+
+    string remotepath;
+    MegaNode * node = api->getNodeByHandle((transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
+                                           ? transfer->getNodeHandle() : transfer->getParentHandle());
+    if (node)
+    {
+        char * nodepath = api->getNodePath(node);
+        remotepath = nodepath ? nodepath : "";
+        delete []nodepath;
+
+        delete node;
+    }
+    else if (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
+    {
+        // removed since: it may have been resolved for a completed transfer of it
+        completedtransfer completed;
+        if (globalTransferListener->completedTransfers.getByHandle(transfer->getNodeHandle(), &completed))
+        {
+            remotepath = globalTransferListener->completedTransfers.getRemotePath(api, completed);
+        }
+    }
+    else
+    {
+        LOG_warn << "Could not find destination (parent handle "<< ((transfer->getParentHandle()==INVALID_HANDLE)?" invalid":" valid")
+                 <<" ) for upload transfer. Source=" << localpath;
+    }
+
+    bool download = transfer->getType() == MegaTransfer::TYPE_DOWNLOAD;
+    printTransfer(transfer->getType(), transfer->isSyncTransfer(), transfer->getTag(),
+                  download ? remotepath : localpath, download ? localpath : remotepath,
+                  transfer->getTransferredBytes(), transfer->getTotalBytes(), transfer->getState(), PATHSIZE, printstate);
+}
+
+void MegaCmdExecuter::printTransfer(const completedtransfer &transfer, const unsigned int PATHSIZE, bool printstate)
+{
+    MegaCmdTransferHistory *history = &globalTransferListener->completedTransfers;
+    string localpath = history->getLocalPath(transfer);
+    string remotepath = history->getRemotePath(api, transfer);
+    bool download = transfer.type == MegaTransfer::TYPE_DOWNLOAD;
+    printTransfer(transfer.type, transfer.sync, transfer.tag,
+                  download ? remotepath : localpath, download ? localpath : remotepath,
+                  transfer.transferredBytes, transfer.totalBytes, transfer.state, PATHSIZE, printstate);
+}
+
 void MegaCmdExecuter::printSyncHeader(const unsigned int PATHSIZE)
 {
     OUTSTREAM << "ID ";
@@ -3808,6 +4214,69 @@ void MegaCmdExecuter::printSyncHeader(const unsigned int PATHSIZE)
 
 }
 
+void MegaCmdExecuter::printSyncRestartStatus(const unsigned int PATHSIZE)
+{
+    vector<MegaCmdSyncRestarter::syncrestart> status = syncRestarter->getStatus();
+    if (!status.size())
+    {
+        OUTSTREAM << "No syncs restarted" << std::endl;
+        return;
+    }
+
+    long long now = getMonotonicMicroSeconds();
+    int counts[MegaCmdSyncRestarter::STATE_CANCELLED + 1] = { 0 };
+    long long totalLatency = 0;
+    long long maxLatency = 0;
+    int finished = 0;
+
+    OUTSTREAM << "ID " << getFixLengthString("LOCALPATH ", PATHSIZE) << " " << getFixLengthString("STATE", 10) << " "
+              << getRightAlignedString("WAITED", 10) << " " << getRightAlignedString("LATENCY", 10) << " " << "ERROR" << std::endl;
+    for (unsigned int i = 0; i < status.size(); i++)
+    {
+        MegaCmdSyncRestarter::syncrestart &r = status[i];
+        counts[r.state]++;
+
+        string waited = "-";
+        string latency = "-";
+        if (r.startTime)
+        {
+            waited = SSTR((r.startTime - r.queuedTime) / 1000) + " ms";
+            long long elapsed = (r.endTime ? r.endTime : now) - r.startTime;
+            latency = SSTR(elapsed / 1000) + " ms";
+            if (r.endTime)
+            {
+                totalLatency += elapsed;
+                maxLatency = std::max(maxLatency, elapsed);
+                finished++;
+            }
+        }
+        else if (r.state == MegaCmdSyncRestarter::STATE_PENDING)
+        {
+            waited = SSTR((now - r.queuedTime) / 1000) + " ms";
+        }
+
+        OUTSTREAM << getFixLengthString(SSTR(i), 3) << getFixLengthString(r.localpath, PATHSIZE) << " "
+                  << getFixLengthString(MegaCmdSyncRestarter::getStateStr(r.state), 10) << " "
+                  << getRightAlignedString(waited, 10) << " " << getRightAlignedString(latency, 10) << " "
+                  << ((r.errorCode != MegaError::API_OK) ? MegaError::getErrorString(r.errorCode) : "") << std::endl;
+    }
+
+    OUTSTREAM << std::endl << status.size() << " syncs " << (syncRestarter->isRunning() ? "being restarted" : "restarted") << ": "
+              << counts[MegaCmdSyncRestarter::STATE_DONE] << " done, "
+              << counts[MegaCmdSyncRestarter::STATE_FAILED] << " failed, "
+              << counts[MegaCmdSyncRestarter::STATE_DISABLING] + counts[MegaCmdSyncRestarter::STATE_RESUMING] << " in progress, "
+              << counts[MegaCmdSyncRestarter::STATE_PENDING] << " pending";
+    if (counts[MegaCmdSyncRestarter::STATE_CANCELLED])
+    {
+        OUTSTREAM << ", " << counts[MegaCmdSyncRestarter::STATE_CANCELLED] << " cancelled";
+    }
+    OUTSTREAM << std::endl;
+    if (finished)
+    {
+        OUTSTREAM << "Latency: average " << totalLatency / finished / 1000 << " ms, max " << maxLatency / 1000 << " ms" << std::endl;
+    }
+}
+
 #ifdef ENABLE_BACKUPS
 
 void MegaCmdExecuter::printBackupHeader(const unsigned int PATHSIZE)
@@ -4006,29 +4475,19 @@ void MegaCmdExecuter::printBackup(backup_struct *backupstruct, const unsigned in
 }
 #endif
 
-void MegaCmdExecuter::printSync(int i, string key, const char *nodepath, sync_struct * thesync, MegaNode *n, long long nfiles, long long nfolders, const unsigned int PATHSIZE)
+void MegaCmdExecuter::printSync(int i, string key, sync_struct * thesync, const syncstatus &status, const treesizes &sizes, const unsigned int PATHSIZE)
 {
     //tag
     OUTSTREAM << getRightAlignedString(SSTR(i),2) << " ";
 
     OUTSTREAM << getFixLengthString(key,PATHSIZE) << " ";
 
-    OUTSTREAM << getFixLengthString(nodepath,PATHSIZE) << " ";
-
-    string sstate(key);
-    sstate = rtrim(sstate, '/');
-#ifdef _WIN32
-    sstate = rtrim(sstate, '\\');
-#endif
-    string psstate;
-    fsAccessCMD->path2local(&sstate,&psstate);
-    int statepath = api->syncPathState(&psstate);
+    OUTSTREAM << getFixLengthString(status.remotePath,PATHSIZE) << " ";
 
-    MegaSync *msync = api->getSyncByNode(n);
     string syncstate = "REMOVED";
-    if (msync)
+    if (status.hasSync)
     {
-        syncstate = getSyncStateStr(msync->getState());
+        syncstate = getSyncStateStr(status.syncState);
     }
 
     string statetoprint;
@@ -4038,7 +4497,7 @@ void MegaCmdExecuter::printSync(int i, string key, const char *nodepath, sync_st
     }
     else
     {
-        if (msync)
+        if (status.hasSync)
         {
             statetoprint = "Disabling:";
             statetoprint+=syncstate;
@@ -4048,15 +4507,14 @@ void MegaCmdExecuter::printSync(int i, string key, const char *nodepath, sync_st
             statetoprint = "Disabled";
         }
     }
-    delete msync;
 
     OUTSTREAM << getFixLengthString(statetoprint,10) << " ";
-    OUTSTREAM << getFixLengthString(getSyncPathStateStr(statepath),9) << " ";
+    OUTSTREAM << getFixLengthString(getSyncPathStateStr(status.pathState),9) << " ";
 
-    OUTSTREAM << getRightAlignedString(sizeToText(api->getSize(n), false),8) << " ";
+    OUTSTREAM << getRightAlignedString(sizeToText(sizes.bytes, false),8) << " ";
 
-    OUTSTREAM << getRightAlignedString(SSTR(nfiles),6) << " ";
-    OUTSTREAM << getRightAlignedString(SSTR(nfolders),6) << " ";
+    OUTSTREAM << getRightAlignedString(SSTR(sizes.files),6) << " ";
+    OUTSTREAM << getRightAlignedString(SSTR(sizes.folders + 1),6) << " "; //add the sync root itself
 
     OUTSTREAM << std::endl;
 
@@ -4065,11 +4523,11 @@ void MegaCmdExecuter::printSync(int i, string key, const char *nodepath, sync_st
 void MegaCmdExecuter::doFind(MegaNode* nodeBase, string word, int printfileinfo, string pattern, bool usepcre, time_t minTime, time_t maxTime, int64_t minSize, int64_t maxSize)
 {
     struct criteriaNodeVector pnv;
-    pnv.pattern = pattern;
+    PatternMatcher matcher(pattern, usepcre); // compiled once for the whole tree
+    pnv.matcher = &matcher;
 
     vector<MegaNode *> listOfMatches;
     pnv.nodesMatching = &listOfMatches;
-    pnv.usepcre = usepcre;
 
     pnv.minTime = minTime;
     pnv.maxTime = maxTime;
@@ -4077,7 +4535,14 @@ void MegaCmdExecuter::doFind(MegaNode* nodeBase, string word, int printfileinfo,
     pnv.maxSize = maxSize;
 
 
-    processTree(nodeBase, includeIfMatchesCriteria, (void*)&pnv);
+    // subtrees are searched in parallel. Matches keep the order processTree would give them
+    FindCriteriaVisitor visitor(api, &pnv);
+    FoundNodesResult *found = (FoundNodesResult *)treeWalker->walk(nodeBase, &visitor);
+    if (found)
+    {
+        listOfMatches.swap(found->nodes);
+        delete found;
+    }
 
 
     for (std::vector< MegaNode * >::iterator it = listOfMatches.begin(); it != listOfMatches.end(); ++it)
@@ -4261,6 +4726,23 @@ void MegaCmdExecuter::move(MegaNode * n, string destiny)
 }
 
 
+void MegaCmdExecuter::runBatchCopy(MegaCmdBatchCopier *copier)
+{
+    long long startTime = getMonotonicMicroSeconds();
+    int window = ConfigurationManager::getConfigurationValue("copy_concurrency", DEFAULTCOPYCONCURRENCY);
+    if (copier->getNumberOfNodes())
+    {
+        copier->run(window);
+    }
+    if (copier->getNumberFailed())
+    {
+        setCurrentOutCode(copier->getLastError());
+    }
+    LOG_debug << "Batch of " << copier->getNumberOfNodes() << " nodes done in " << (getMonotonicMicroSeconds() - startTime) / 1000 << " ms";
+    OUTSTREAM << copier->getSummary() << std::endl;
+    delete copier;
+}
+
 bool MegaCmdExecuter::isValidFolder(string destiny)
 {
     bool isdestinyavalidfolder = true;
@@ -4282,62 +4764,10 @@ bool MegaCmdExecuter::isValidFolder(string destiny)
 
 void MegaCmdExecuter::restartsyncs()
 {
-    map<string, sync_struct *>::iterator itr;
-    for (itr = ConfigurationManager::configuredSyncs.begin(); itr != ConfigurationManager::configuredSyncs.end(); ++itr)
+    int scheduled = syncRestarter->schedule(MegaCmdSyncRestarter::MODE_RESTART);
+    if (scheduled)
     {
-        string key = ( *itr ).first;
-        sync_struct *thesync = ((sync_struct*)( *itr ).second );
-        if (thesync->active)
-        {
-            MegaNode * n = api->getNodeByHandle(thesync->handle);
-            if (n)
-            {
-                char * nodepath = api->getNodePath(n);
-                LOG_info << "Restarting sync "<< key << ": " << nodepath;
-                delete []nodepath;
-                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                api->disableSync(n, megaCmdListener);
-                megaCmdListener->wait();
-
-                if (checkNoErrors(megaCmdListener->getError(), "stop sync"))
-                {
-                    thesync->active = false;
-
-                    MegaSync *msync = api->getSyncByNode(n);
-                    if (!msync)
-                    {
-                        MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL);
-                        api->syncFolder(thesync->localpath.c_str(), n, megaCmdListener2);
-                        megaCmdListener2->wait();
-
-                        if (checkNoErrors(megaCmdListener2->getError(), "resume sync"))
-                        {
-                            thesync->active = true;
-                            thesync->loadedok = true;
-
-                            if (megaCmdListener2->getRequest()->getNumber())
-                            {
-                                thesync->fingerprint = megaCmdListener2->getRequest()->getNumber();
-                            }
-                        }
-                        else
-                        {
-                            thesync->active = false;
-                            thesync->loadedok = false;
-                        }
-                        delete megaCmdListener2;
-                        delete msync;
-                    }
-                    else
-                    {
-                        setCurrentOutCode(MCMD_INVALIDSTATE);
-                        LOG_err << "Failed to restart sync: " << key << ". You will need to manually reenable or restart MEGAcmd";
-                    }
-                }
-                delete megaCmdListener;
-                delete n;
-            }
-        }
+        OUTSTREAM << "Restarting " << scheduled << " syncs. See \"sync --restart-status\"" << std::endl;
     }
 }
 
@@ -4724,10 +5154,16 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     delete *it;
                 }
                 nodesToConfirmDelete.clear();
+                delete bulkRemovalToConfirm;
+                bulkRemovalToConfirm = NULL;
             }
 
             bool force = getFlag(clflags, "f");
             bool none = false;
+            int clientID = getintOption(cloptions, "clientID", -1);
+
+            // the matches of all the patterns are removed together, after a single confirmation
+            MegaCmdBulkRemover *remover = new MegaCmdBulkRemover(api, sizeCache);
 
             for (unsigned int i = 1; i < words.size(); i++)
             {
@@ -4737,21 +5173,24 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     vector<MegaNode *> *nodesToDelete = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
                     if (nodesToDelete->size())
                     {
-                        for (std::vector< MegaNode * >::iterator it = nodesToDelete->begin(); !none && it != nodesToDelete->end(); ++it)
+                        for (std::vector< MegaNode * >::iterator it = nodesToDelete->begin(); it != nodesToDelete->end(); ++it)
                         {
                             MegaNode * nodeToDelete = *it;
-                            if (nodeToDelete)
+                            if (!nodeToDelete)
                             {
-                                int confirmationCode = deleteNode(nodeToDelete, api, getFlag(clflags, "r"), force);
-                                if (confirmationCode == MCMDCONFIRM_ALL)
-                                {
-                                    force = true;
-                                }
-                                else if (confirmationCode == MCMDCONFIRM_NONE)
-                                {
-                                    none = true;
-                                }
-
+                                continue;
+                            }
+                            if (nodeToDelete->getType() != MegaNode::TYPE_FILE && !getFlag(clflags, "r"))
+                            {
+                                char *nodePath = api->getNodePath(nodeToDelete);
+                                setCurrentOutCode(MCMD_INVALIDTYPE);
+                                LOG_err << "Unable to delete folder: " << nodePath << ". Use -r to delete a folder recursively";
+                                delete []nodePath;
+                                delete nodeToDelete;
+                            }
+                            else
+                            {
+                                remover->add(nodeToDelete);
                             }
                         }
                         nodesToDelete->clear();
@@ -4785,6 +5224,15 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     }
                 }
             }
+
+            if (none)
+            {
+                delete remover;
+            }
+            else
+            {
+                deleteNodes(remover, force, clientID);
+            }
         }
         else
         {
@@ -4813,6 +5261,20 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                 return;
             }
 
+            // several sources (or patterns) into a folder are moved together
+            MegaCmdBatchCopier *copier = NULL;
+            bool several = words.size() > 3;
+            for (unsigned int i=1;!several && i<(words.size()-1);i++)
+            {
+                several = isRegExp(words[i]);
+            }
+            if (several && isValidFolder(destiny))
+            {
+                MegaNode *destinyNode = nodebypath(destiny.c_str());
+                copier = new MegaCmdBatchCopier(api, MegaCmdBatchCopier::MODE_MOVE, destinyNode);
+                delete destinyNode;
+            }
+
             for (unsigned int i=1;i<(words.size()-1);i++)
             {
                 string source = words[i];
@@ -4841,7 +5303,11 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                             for (std::vector< MegaNode * >::iterator it = nodesToList->begin(); it != nodesToList->end(); ++it)
                             {
                                 MegaNode * n = *it;
-                                if (n)
+                                if (n && copier)
+                                {
+                                    copier->add(n);
+                                }
+                                else if (n)
                                 {
                                     move(n, destiny);
                                     delete n;
@@ -4857,8 +5323,15 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                 {
                     if (( n = nodebypath(source.c_str())) )
                     {
-                        move(n, destiny);
-                        delete n;
+                        if (copier)
+                        {
+                            copier->add(n);
+                        }
+                        else
+                        {
+                            move(n, destiny);
+                            delete n;
+                        }
                     }
                     else
                     {
@@ -4868,6 +5341,10 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                 }
             }
 
+            if (copier)
+            {
+                runBatchCopy(copier);
+            }
         }
         else
         {
@@ -4889,7 +5366,53 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
         string targetuser;
         string newname;
 
-        if (words.size() > 2)
+        if (words.size() > 3 || (words.size() > 2 && isRegExp(words[1])))
+        {
+            // several sources (or patterns): copied together into a folder
+            string destiny = words[words.size()-1];
+            if (!isValidFolder(destiny))
+            {
+                setCurrentOutCode(MCMD_INVALIDTYPE);
+                LOG_err << destiny << " must be a valid folder";
+                return;
+            }
+            tn = nodebypath(destiny.c_str());
+            MegaCmdBatchCopier *copier = new MegaCmdBatchCopier(api, MegaCmdBatchCopier::MODE_COPY, tn);
+            delete tn;
+
+            for (unsigned int i = 1; i < (words.size() - 1); i++)
+            {
+                if (isRegExp(words[i]))
+                {
+                    vector<MegaNode *> *nodesToCopy = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+                    if (!nodesToCopy->size())
+                    {
+                        setCurrentOutCode(MCMD_NOTFOUND);
+                        LOG_err << words[i] << ": No such file or directory";
+                    }
+                    for (std::vector< MegaNode * >::iterator it = nodesToCopy->begin(); it != nodesToCopy->end(); ++it)
+                    {
+                        if (*it)
+                        {
+                            copier->add(*it);
+                        }
+                    }
+                    delete nodesToCopy;
+                }
+                else if (( n = nodebypath(words[i].c_str())))
+                {
+                    copier->add(n);
+                }
+                else
+                {
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << words[i] << ": No such file or directory";
+                }
+            }
+
+            runBatchCopy(copier);
+        }
+        else if (words.size() > 2)
         {
             if (( n = nodebypath(words[1].c_str())))
             {
@@ -5061,14 +5584,16 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                                 OUTSTREAM << std::endl;
                                 firstone = false;
                             }
-                            currentSize = api->getSize(n);
+                            treesizes sizes;
+                            sizeCache->getSizes(n, &sizes);
+                            currentSize = sizes.bytes;
                             totalSize += currentSize;
 
                             dpath = getDisplayPath(words[i], n);
                             OUTSTREAM << getFixLengthString(dpath+":",40) << getFixLengthString(sizeToText(currentSize, true, humanreadable), 12, ' ', true);
                             if (show_versions_size)
                             {
-                                long long sizeWithVersions = getVersionsSize(n);
+                                long long sizeWithVersions = sizes.bytes + sizes.versionsBytes;
                                 OUTSTREAM << getFixLengthString(sizeToText(sizeWithVersions, true, humanreadable), 12, ' ', true);
                                 totalVersionsSize += sizeWithVersions;
                             }
@@ -5091,7 +5616,9 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     return;
                 }
 
-                currentSize = api->getSize(n);
+                treesizes sizes;
+                sizeCache->getSizes(n, &sizes);
+                currentSize = sizes.bytes;
                 totalSize += currentSize;
                 dpath = getDisplayPath(words[i], n);
                 if (dpath.size())
@@ -5110,7 +5637,7 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     OUTSTREAM << getFixLengthString(dpath+":",40) << getFixLengthString(sizeToText(currentSize, true, humanreadable), 12, ' ', true);
                     if (show_versions_size)
                     {
-                        long long sizeWithVersions = getVersionsSize(n);
+                        long long sizeWithVersions = sizes.bytes + sizes.versionsBytes;
                         OUTSTREAM << getFixLengthString(sizeToText(sizeWithVersions, true, humanreadable), 12, ' ', true);
                         totalVersionsSize += sizeWithVersions;
                     }
@@ -5394,15 +5921,17 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                                 path=path.substr(0,path.size()-1);
                             }
                         }
+                        MegaCmdDownloadPlanner planner(api);
                         for (std::vector< MegaNode * >::iterator it = nodesToGet->begin(); it != nodesToGet->end(); ++it)
                         {
                             MegaNode * n = *it;
                             if (n)
                             {
-                                downloadNode(path, api, n, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
+                                planner.add(n, path);
                                 delete n;
                             }
                         }
+                        downloadNodes(&planner, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
                         if (!nodesToGet->size())
                         {
                             setCurrentOutCode(MCMD_NOTFOUND);
@@ -5507,6 +6036,8 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                 LOG_err << "Download failed. error code:" << MegaError::getErrorString(megaCmdMultiTransferListener->getFinalerror());
             }
 
+            reportTransferRate("Downloaded", megaCmdMultiTransferListener);
+
             informProgressUpdate(PROGRESS_COMPLETE, megaCmdMultiTransferListener->getTotalbytes(), clientID);
             delete megaCmdMultiTransferListener;
         }
@@ -5677,6 +6208,20 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
 
         bool ignorequotawarn = getFlag(clflags,"ignore-quota-warn");
 
+        MegaCmdUploadPlanner planner(api, fsAccessCMD, getLocalScanPool());
+        bool skipUnchanged = getFlag(clflags, "skip-unchanged");
+        if (skipUnchanged)
+        {
+            if (fingerprintCache)
+            {
+                planner.setSkipUnchanged(fingerprintCache);
+            }
+            else
+            {
+                LOG_warn << "No fingerprints cache available: ignoring --skip-unchanged";
+            }
+        }
+
         if (words.size() > 1)
         {
             string targetuser;
@@ -5694,10 +6239,21 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                 {
                     string destinationfolder(destination,0,destination.find_last_of("/"));
                     newname=string(destination,destination.find_last_of("/")+1,destination.size());
-                    MegaNode *cwdNode = api->getNodeByHandle(cwd);
-                    makedir(destinationfolder,true,cwdNode);
-                    n = nodebypath(destinationfolder.c_str());
-                    delete cwdNode;
+                    MegaNode *baseNode = (destination.size() && destination[0] == '/') ? api->getRootNode() : api->getNodeByHandle(cwd);
+                    if (baseNode)
+                    {
+                        MegaCmdFolderCreator creator(api);
+                        if (makedir(destinationfolder, true, baseNode, &creator) == MCMD_OK && !creator.create())
+                        {
+                            // the handle of the folder comes with its creation: no need to look it up by path
+                            n = api->getNodeByHandle(creator.getHandle(baseNode->getHandle(), destinationfolder));
+                        }
+                        if (!n)
+                        {
+                            n = nodebypath(destinationfolder.c_str());
+                        }
+                        delete baseNode;
+                    }
                 }
             }
             else
@@ -5715,8 +6271,14 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                         {
                             words[i] = getLPWD();
                         }
-                        uploadNode(words[i], api, n, newname, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
+                        unescapeifRequired(words[i]);
+                        if (!planner.add(words[i], n, newname))
+                        {
+                            setCurrentOutCode(MCMD_NOTFOUND);
+                            LOG_err << "Could not find local path: " << words[i];
+                        }
                     }
+                    uploadNodes(&planner, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
                 }
                 else
                 {
@@ -5732,6 +6294,16 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     setCurrentOutCode(megaCmdMultiTransferListener->getFinalerror());
                     LOG_err << "Upload failed. error code:" << MegaError::getErrorString(megaCmdMultiTransferListener->getFinalerror());
                 }
+                reportTransferRate("Uploaded", megaCmdMultiTransferListener);
+
+                if (skipUnchanged && fingerprintCache)
+                {
+                    if (!background)
+                    {
+                        planner.recordUploads(); // the ones in background are cached once found unchanged the next time
+                    }
+                    fingerprintCache->save();
+                }
 
                 informProgressUpdate(PROGRESS_COMPLETE, megaCmdMultiTransferListener->getTotalbytes(), clientID);
                 delete megaCmdMultiTransferListener;
@@ -5758,6 +6330,16 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
             {
                 OUTSTREAM << "CMD log level = " << getLogLevelStr(loggerCMD->getCmdLoggerLevel()) << std::endl;
                 OUTSTREAM << "SDK log level = " << getLogLevelStr(loggerCMD->getApiLoggerLevel()) << std::endl;
+                if (loggerCMD->isAsync())
+                {
+                    OUTSTREAM << "Async logging: buffer of " << loggerCMD->getAsyncCapacity() << " lines, "
+                              << loggerCMD->getDroppedLines() << " lines dropped" << std::endl;
+                }
+                if (loggerCMD->getFileSink())
+                {
+                    OUTSTREAM << "Log file: " << loggerCMD->getFileSink()->getPath() << ", "
+                              << loggerCMD->getFileSink()->getDropped() << " lines dropped" << std::endl;
+                }
             }
             else if (getFlag(clflags, "s"))
             {
@@ -6165,6 +6747,7 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
     //            api->httpServerEnableOfflineAttribute(true); //TODO: we might want to offer this as parameter
                 if (api->httpServerStart(localonly, port, tls, pathtocert.c_str(), pathtokey.c_str()))
                 {
+                    ConfigurationManager::beginPropertiesBatch();
                     ConfigurationManager::savePropertyValue("webdav_port", port);
                     ConfigurationManager::savePropertyValue("webdav_localonly", localonly);
                     ConfigurationManager::savePropertyValue("webdav_tls", tls);
@@ -6176,6 +6759,7 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     {
                         ConfigurationManager::savePropertyValue("webdav_key", pathtokey);
                     }
+                    ConfigurationManager::endPropertiesBatch();
                 }
                 else
                 {
@@ -6203,12 +6787,14 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     size_t sizeprior = servedpaths.size();
                     servedpaths.remove(pathToServe);
                     size_t sizeafter = servedpaths.size();
+                    ConfigurationManager::beginPropertiesBatch();
                     if (!sizeafter)
                     {
                         api->httpServerStop();
                         ConfigurationManager::savePropertyValue("webdav_port", -1); //so as not to load server on startup
                     }
                     ConfigurationManager::savePropertyValueList("webdav_served_locations", servedpaths);
+                    ConfigurationManager::endPropertiesBatch();
                     mtxWebDavLocations.unlock();
 
                     if (sizeprior != sizeafter)
@@ -6267,10 +6853,12 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
 
         if (getFlag(clflags, "a"))
         {
+            ConfigurationManager::beginPropertiesBatch();
             for (unsigned int i=1;i<words.size(); i++)
             {
                 ConfigurationManager::addExcludedName(words[i]);
             }
+            ConfigurationManager::endPropertiesBatch();
             if (words.size()>1)
             {
                 std::vector<string> vexcludednames(ConfigurationManager::excludedNames.begin(), ConfigurationManager::excludedNames.end());
@@ -6289,10 +6877,12 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
         }
         else if (getFlag(clflags, "d"))
         {
+            ConfigurationManager::beginPropertiesBatch();
             for (unsigned int i=1;i<words.size(); i++)
             {
                 ConfigurationManager::removeExcludedName(words[i]);
             }
+            ConfigurationManager::endPropertiesBatch();
             if (words.size()>1)
             {
                 std::vector<string> vexcludednames(ConfigurationManager::excludedNames.begin(), ConfigurationManager::excludedNames.end());
@@ -6347,6 +6937,20 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
             PATHSIZE = std::min(60,int((width-46)/2));
         }
 
+        if (getFlag(clflags, "restart-status"))
+        {
+            printSyncRestartStatus(PATHSIZE);
+            return;
+        }
+
+        if (words.size() > 1)
+        {
+            // syncs being restarted are not to be changed meanwhile
+            syncRestarter->waitUntilDone();
+        }
+
+        bool refresh = getFlag(clflags, "refresh"); // the syncs listed are counted and queried again
+
         bool headershown = false;
         bool modifiedsyncs = false;
         mtxSyncMap.lock();
@@ -6427,10 +7031,6 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     if (( id == i ) || (( id == -1 ) && ( words[1] == thesync->localpath )))
                     {
                         foundsync = true;
-                        long long nfiles = 0;
-                        long long nfolders = 0;
-                        nfolders++; //add the share itself
-                        getNumFolderFiles(n, api, &nfiles, &nfolders);
 
                         if (getFlag(clflags, "s") || getFlag(clflags, "r"))
                         {
@@ -6497,13 +7097,25 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                             delete megaCmdListener;
                         }
 
-                        if (!headershown)
+                        syncStatus->invalidate(key); // it might have been changed above
+                        if (!erased)
                         {
-                            headershown = true;
-                            printSyncHeader(PATHSIZE);
-                        }
+                            if (!headershown)
+                            {
+                                headershown = true;
+                                printSyncHeader(PATHSIZE);
+                            }
 
-                        printSync(i, key, nodepath, thesync, n, nfiles, nfolders, PATHSIZE);
+                            if (refresh)
+                            {
+                                sizeCache->forget(thesync->handle);
+                            }
+                            treesizes sizes;
+                            sizeCache->getSizes(n, &sizes);
+                            syncstatus status;
+                            syncStatus->getStatus(key, thesync->handle, &status);
+                            printSync(i, key, thesync, status, sizes, PATHSIZE);
+                        }
 
                     }
                     delete n;
@@ -6541,16 +7153,19 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                         headershown = true;
                         printSyncHeader(PATHSIZE);
                     }
-                    long long nfiles = 0;
-                    long long nfolders = 0;
-                    nfolders++; //add the share itself
-                    getNumFolderFiles(n, api, &nfiles, &nfolders);
-
-                    char * nodepath = api->getNodePath(n);
-                    printSync(i++, ( *itr ).first, nodepath, thesync, n, nfiles, nfolders, PATHSIZE);
+                    // kept up to date from callbacks: no tree walks nor sync queries
+                    if (refresh)
+                    {
+                        sizeCache->forget(thesync->handle);
+                        syncStatus->invalidate(( *itr ).first);
+                    }
+                    treesizes sizes;
+                    sizeCache->getSizes(n, &sizes);
+                    syncstatus status;
+                    syncStatus->getStatus(( *itr ).first, thesync->handle, &status);
+                    printSync(i++, ( *itr ).first, thesync, status, sizes, PATHSIZE);
 
                     delete n;
-                    delete []nodepath;
                 }
                 else
                 {
@@ -6558,6 +7173,10 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                     LOG_err << "Node not found for sync " << ( *itr ).first << " into handle: " << thesync->handle;
                 }
             }
+            if (syncRestarter->isRunning())
+            {
+                OUTSTREAM << "Syncs are being restarted. See \"sync --restart-status\"" << std::endl;
+            }
         }
         else
         {
@@ -7000,6 +7619,8 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
             globalstatus = MCMD_EARGS;
         }
         bool printusage = false;
+        // the folders of all the paths are created together, a level at a time
+        MegaCmdFolderCreator creator(api);
         for (unsigned int i = 1; i < words.size(); i++)
         {
             unescapeifRequired(words[i]);
@@ -7079,7 +7700,7 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
             }
             if (baseNode)
             {
-                int status = makedir(rest,getFlag(clflags, "p"),baseNode);
+                int status = makedir(rest,getFlag(clflags, "p"),baseNode,&creator);
                 if (status != MCMD_OK)
                 {
                     globalstatus = status;
@@ -7092,6 +7713,7 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
             }
             else
             {
+                creator.create(); // the ones of the previous paths
                 setCurrentOutCode(MCMD_INVALIDSTATE);
                 LOG_err << "Folder navigation failed";
                 return;
@@ -7099,6 +7721,12 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
 
         }
 
+        if (creator.create())
+        {
+            globalstatus = MCMD_INVALIDSTATE;
+        }
+        LOG_verbose << "Folders created: " << creator.getNumberCreated();
+
         setCurrentOutCode(globalstatus);
         if (printusage)
         {
@@ -7426,8 +8054,10 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
             {
                 api->setMaxDownloadSpeed(maxspeed);
                 api->setMaxUploadSpeed(maxspeed);
+                ConfigurationManager::beginPropertiesBatch();
                 ConfigurationManager::savePropertyValue("maxspeedupload", maxspeed);
                 ConfigurationManager::savePropertyValue("maxspeeddownload", maxspeed);
+                ConfigurationManager::endPropertiesBatch();
             }
             else if (getFlag(clflags, "u"))
             {
@@ -8362,32 +8992,16 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
 
         vector<MegaTransfer *> transfersDLToShow;
         vector<MegaTransfer *> transfersUPToShow;
-        vector<MegaTransfer *> transfersCompletedToShow;
+        vector<completedtransfer> transfersCompletedToShow;
 
         if (showcompleted)
         {
-            globalTransferListener->completedTransfersMutex.lock();
-            size_t totalcompleted = globalTransferListener->completedTransfers.size();
-            for (size_t i = 0;(i < totalcompleted)
-                 && (shownCompleted < totalcompleted)
-                 && (shownCompleted < (size_t)(limit+1)); //Note limit+1 to seek for one more to show if there are more to show!
-                 i++)
-            {
-                MegaTransfer *transfer = globalTransferListener->completedTransfers.at(i);
-                if (
-                    (
-                            (transfer->getType() == MegaTransfer::TYPE_UPLOAD && (onlyuploads || (!onlyuploads && !onlydownloads) ))
-                        ||  (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD && (onlydownloads || (!onlyuploads && !onlydownloads) ) )
-                    )
-                    &&  !(!showsyncs && transfer->isSyncTransfer())
-                    )
-                {
-
-                    transfersCompletedToShow.push_back(transfer);
-                    shownCompleted++;
-                }
-            }
-            globalTransferListener->completedTransfersMutex.unlock();
+            //Note limit+1 to seek for one more to show if there are more to show!
+            transfersCompletedToShow = globalTransferListener->completedTransfers.getLast(limit + 1,
+                                                                                          onlyuploads || !onlydownloads,
+                                                                                          onlydownloads || !onlyuploads,
+                                                                                          showsyncs);
+            shownCompleted = (unsigned int)transfersCompletedToShow.size();
         }
 
         shown += shownCompleted;
@@ -8452,29 +9066,28 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
 
         delete transferdata;
 
-        vector<MegaTransfer *>::iterator itCompleted = transfersCompletedToShow.begin();
+        vector<completedtransfer>::iterator itCompleted = transfersCompletedToShow.begin();
         vector<MegaTransfer *>::iterator itDLs = transfersDLToShow.begin();
         vector<MegaTransfer *>::iterator itUPs = transfersUPToShow.begin();
 
         for (unsigned int i=0;i<showndl+shownup+shownCompleted; i++)
         {
             MegaTransfer *transfer = NULL;
-            bool deleteTransfer = true;
-            if (itDLs == transfersDLToShow.end() && itCompleted == transfersCompletedToShow.end())
+            completedtransfer *completed = NULL;
+            if (itCompleted != transfersCompletedToShow.end())
             {
-                transfer = (MegaTransfer *) *itUPs;
-                itUPs++;
+                completed = &(*itCompleted);
+                itCompleted++;
             }
-            else if (itCompleted == transfersCompletedToShow.end())
+            else if (itDLs != transfersDLToShow.end())
             {
                 transfer = (MegaTransfer *) *itDLs;
                 itDLs++;
             }
             else
             {
-                transfer = (MegaTransfer *) *itCompleted;
-                itCompleted++;
-                deleteTransfer=false;
+                transfer = (MegaTransfer *) *itUPs;
+                itUPs++;
             }
             if (i == 0) //first
             {
@@ -8488,20 +9101,30 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
             if (i==(unsigned int)limit) //we are in the extra one (not to be shown)
             {
                 OUTSTREAM << " ...  Showing first " << limit << " transfers ..." << std::endl;
-                if (deleteTransfer)
-                {
-                    delete transfer;
-                }
+                delete transfer;
                 break;
             }
 
-            printTransfer(transfer, PATHSIZE);
-
-            if (deleteTransfer)
+            if (completed)
             {
+                printTransfer(*completed, PATHSIZE);
+            }
+            else
+            {
+                printTransfer(transfer, PATHSIZE);
                 delete transfer;
             }
         }
+
+        // the ones not shown
+        for (; itDLs != transfersDLToShow.end(); itDLs++)
+        {
+            delete *itDLs;
+        }
+        for (; itUPs != transfersUPToShow.end(); itUPs++)
+        {
+            delete *itUPs;
+        }
     }
     else if (words[0] == "locallogout")
     {
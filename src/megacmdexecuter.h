@@ -22,6 +22,16 @@
 #include "megacmdlogger.h"
 #include "megacmdsandbox.h"
 #include "listeners.h"
+#include "megacmdpathindex.h"
+#include "megacmdtreewalker.h"
+#include "megacmdsizecache.h"
+#include "megacmddownloadplanner.h"
+#include "megacmduploadplanner.h"
+#include "megacmdsyncrestarter.h"
+#include "megacmdsyncstatus.h"
+#include "megacmdfoldercreator.h"
+#include "megacmdbulkremover.h"
+#include "megacmdbatchcopier.h"
 
 class MegaCmdExecuter
 {
@@ -30,9 +40,19 @@ private:
     mega::handle cwd;
     char *session;
     mega::MegaFileSystemAccess *fsAccessCMD;
+    mega::MegaMutex mtxLocalFolders; // for mkdirlocal and the target_exists it leaves in fsAccessCMD
     MegaCMDLogger *loggerCMD;
     MegaCmdSandbox *sandboxCMD;
     MegaCmdGlobalTransferListener *globalTransferListener;
+    MegaCmdPathIndex *pathIndex;
+    MegaCmdTreeWalker *treeWalker; // for find, du and recursive ls
+    MegaCmdSizeCache *sizeCache;
+    MegaCmdWorkerPool *localScanPool; // for the local folders uploaded, created by the first upload (see getLocalScanPool)
+    int localScanThreads;
+    mega::MegaMutex mtxLocalScanPool;
+    MegaCmdFingerprintCache *fingerprintCache; // of the files uploaded with put --skip-unchanged, NULL if there is no config folder
+    MegaCmdSyncRestarter *syncRestarter;
+    MegaCmdSyncStatusTable *syncStatus;
     mega::MegaMutex mtxSyncMap;
     mega::MegaMutex mtxWebDavLocations;
 
@@ -51,6 +71,10 @@ private:
 
     //delete confirmation
     std::vector<mega::MegaNode *> nodesToConfirmDelete;
+    MegaCmdBulkRemover *bulkRemovalToConfirm; // of the matches of rm patterns (asked after nodesToConfirmDelete)
+    int bulkRemovalClientID;
+
+    void setDeletePrompt();
 
 
     void updateprompt(mega::MegaApi *api, mega::MegaHandle handle);
@@ -62,6 +86,17 @@ public:
     MegaCmdExecuter(mega::MegaApi *api, MegaCMDLogger *loggerCMD, MegaCmdSandbox *sandboxCMD);
     ~MegaCmdExecuter();
 
+    MegaCmdPathIndex *getPathIndex();
+
+    /**
+     * @brief The pool to scan the local folders uploaded with, created on first use
+     * @return NULL to scan them in the petition thread
+     */
+    MegaCmdWorkerPool *getLocalScanPool();
+    MegaCmdSizeCache *getSizeCache();
+    MegaCmdSyncRestarter *getSyncRestarter();
+    MegaCmdSyncStatusTable *getSyncStatusTable();
+
     // nodes browsing
     void listtrees();
     static bool includeIfIsExported(mega::MegaApi* api, mega::MegaNode * n, void *arg);
@@ -82,10 +117,19 @@ public:
     std::vector <std::string> * nodesPathsbypath(const char* ptr, bool usepcre, std::string* user = NULL, std::string* namepart = NULL);
     void getPathsMatching(mega::MegaNode *parentNode, std::deque<std::string> pathParts, std::vector<std::string> *pathsMatching, bool usepcre, std::string pathPrefix = "");
 
-    void dumpNode(mega::MegaNode* n, int extended_info, bool showversions = false, int depth = 0, const char* title = NULL);
+    /**
+     * @brief Gets the names and handles of the children of parentNode whose name matches namePattern
+     */
+    void getChildrenMatchingFromIndex(mega::MegaNode *parentNode, const std::string &namePattern, bool usepcre, indexedchildren_t *children);
+
+    /**
+     * @param out where to print (by default, OUTSTREAM)
+     */
+    void dumpNode(mega::MegaNode* n, int extended_info, bool showversions = false, int depth = 0, const char* title = NULL, OUTSTREAMTYPE *out = NULL);
     void dumptree(mega::MegaNode* n, int recurse, int extended_info, bool showversions = false, int depth = 0, std::string pathRelativeTo = "NULL");
     void dumpNodeSummaryHeader();
-    void dumpNodeSummary(mega::MegaNode* n, bool humanreadable = false, const char* title = NULL);
+    void dumpNodeSummary(mega::MegaNode* n, bool humanreadable = false, const char* title = NULL, OUTSTREAMTYPE *out = NULL);
+    void dumpFolderSummary(mega::MegaNodeList *children, std::string pathToShow, int recurse, bool show_versions, int depth, bool humanreadable, OUTSTREAMTYPE *out = NULL);
     void dumpTreeSummary(mega::MegaNode* n, int recurse, bool show_versions, int depth = 0, bool humanreadable = false, std::string pathRelativeTo = "NULL");
     mega::MegaContactRequest * getPcrByContact(std::string contactEmail);
     bool TestCanWriteOnContainingFolder(std::string *path);
@@ -108,7 +152,25 @@ public:
     int deleteNode(mega::MegaNode *nodeToDelete, mega::MegaApi* api, int recursive, int force = 0);
     int deleteNodeVersions(mega::MegaNode *nodeToDelete, mega::MegaApi* api, int force = 0);
     void downloadNode(std::string localPath, mega::MegaApi* api, mega::MegaNode *node, bool background, bool ignorequotawar, int clientID, MegaCmdMultiTransferListener *listener = NULL);
+    /**
+     * @brief Starts the downloads planned: checks the transfer quota for all of them at once, creates the local
+     * folders and starts the transfers, at most "download_concurrency" of them at once (all of them in background)
+     * and in the "download_order"
+     */
+    void downloadNodes(MegaCmdDownloadPlanner *planner, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *listener = NULL);
+    /**
+     * @brief Checks whether downloading size bytes would exceed the transfer quota, telling the user if so
+     * @return whether the download can proceed
+     */
+    bool checkDownloadQuota(mega::MegaApi *api, long long size, bool ignorequotawarn);
+    void createLocalFolders(const std::vector<std::string> &folders);
     void uploadNode(std::string localPath, mega::MegaApi* api, mega::MegaNode *node, std::string newname, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener = NULL);
+    /**
+     * @brief Starts the uploads planned: scans the local folders, creates the remote ones and starts the
+     * transfers, at most "upload_concurrency" of them at once and in the "upload_order"
+     */
+    void uploadNodes(MegaCmdUploadPlanner *planner, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener = NULL);
+    void reportTransferRate(std::string action, MegaCmdMultiTransferListener *multiTransferListener);
     void exportNode(mega::MegaNode *n, int64_t expireTime, bool force = false);
     void disableExport(mega::MegaNode *n);
     void shareNode(mega::MegaNode *n, std::string with, int level = mega::MegaShare::ACCESS_READ);
@@ -136,18 +198,35 @@ public:
     void confirm(std::string passwd, std::string email, std::string link);
     void confirmWithPassword(std::string passwd);
 
-    int makedir(std::string remotepath, bool recursive, mega::MegaNode *parentnode = NULL);
+    /**
+     * @brief Creates a remote folder (and its missing ancestors if recursive)
+     * @param creator to leave the folders to create in, for them to be created along with others
+     * (by its create). If NULL, they are created before returning
+     */
+    int makedir(std::string remotepath, bool recursive, mega::MegaNode *parentnode = NULL, MegaCmdFolderCreator *creator = NULL);
     bool IsFolder(std::string path);
     void doDeleteNode(mega::MegaNode *nodeToDelete, mega::MegaApi* api);
 
+    /**
+     * @brief Removes the nodes of a bulk removal (asking for confirmation once for all of them
+     * if there are folders among them, unless forced). Takes its ownership
+     * @return confirmation code
+     */
+    int deleteNodes(MegaCmdBulkRemover *remover, int force, int clientID);
+    void doDeleteNodes(MegaCmdBulkRemover *remover, int clientID);
+
     void confirmDelete();
     void discardDelete();
     void confirmDeleteAll();
     void discardDeleteAll();
 
     void printTransfersHeader(const unsigned int PATHSIZE, bool printstate=true);
+    void printTransfer(int type, bool sync, int tag, std::string source, std::string destination,
+                       long long transferredBytes, long long totalBytes, int state, const unsigned int PATHSIZE, bool printstate);
     void printTransfer(mega::MegaTransfer *transfer, const unsigned int PATHSIZE, bool printstate=true);
+    void printTransfer(const completedtransfer &transfer, const unsigned int PATHSIZE, bool printstate=true);
     void printSyncHeader(const unsigned int PATHSIZE);
+    void printSyncRestartStatus(const unsigned int PATHSIZE);
 
 #ifdef ENABLE_BACKUPS
 
@@ -158,11 +237,17 @@ public:
     void printBackup(int tag, mega::MegaBackup *backup, const unsigned int PATHSIZE, bool extendedinfo = false, bool showhistory = false, mega::MegaNode *parentnode = NULL);
     void printBackup(backup_struct *backupstruct, const unsigned int PATHSIZE, bool extendedinfo = false, bool showhistory = false);
 #endif
-    void printSync(int i, std::string key, const char *nodepath, sync_struct * thesync, mega::MegaNode *n, long long nfiles, long long nfolders, const unsigned int PATHSIZE);
+    void printSync(int i, std::string key, sync_struct * thesync, const syncstatus &status, const treesizes &sizes, const unsigned int PATHSIZE);
 
     void doFind(mega::MegaNode* nodeBase, std::string word, int printfileinfo, std::string pattern, bool usepcre, time_t minTime, time_t maxTime, int64_t minSize, int64_t maxSize);
 
     void move(mega::MegaNode *n, std::string destiny);
+
+    /**
+     * @brief Runs the copies (or moves) of a batch, "copy_concurrency" at a time, and prints its summary.
+     * Takes its ownership
+     */
+    void runBatchCopy(MegaCmdBatchCopier *copier);
     std::string getLPWD();
     bool isValidFolder(std::string destiny);
     bool establishBackup(std::string local, mega::MegaNode *n, int64_t period, std::string periodstring, int numBackups);
@@ -0,0 +1,215 @@
+/**
+ * @file src/megacmdfingerprintcache.cpp
+ * @brief MEGAcmd: Cache of the fingerprints of the local files uploaded
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdfingerprintcache.h"
+#include "configurationmanager.h"
+#include "megacmdlogger.h"
+
+#define FINGERPRINTVALUEHEADER 32 // bytes before the fingerprint
+
+using namespace std;
+using namespace mega;
+
+MegaCmdFingerprintCache::MegaCmdFingerprintCache(string path, size_t maxEntries)
+    : store(path, FINGERPRINTRECORDS)
+{
+    this->maxEntries = std::max(maxEntries, (size_t)1);
+    loaded = false;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    mtx.init(false);
+}
+
+void MegaCmdFingerprintCache::load()
+{
+    if (loaded)
+    {
+        return;
+    }
+    loaded = true;
+
+    int result = store.load(&records);
+    if (result != MegaCmdRecordStore::STORE_OK && result != MegaCmdRecordStore::STORE_MISSING)
+    {
+        LOG_warn << "Fingerprints cache could not be (entirely) read: " << store.getPath();
+    }
+    for (map<string, string>::iterator it = records.begin(); it != records.end(); ++it)
+    {
+        lruPositions[&it->first] = lru.insert(lru.end(), &it->first);
+    }
+    LOG_debug << "Fingerprints cache loaded with " << records.size() << " entries";
+    evict(); // in case the limit was lowered
+}
+
+void MegaCmdFingerprintCache::touch(map<string, string>::iterator it)
+{
+    map<const string *, list<const string *>::iterator>::iterator position = lruPositions.find(&it->first);
+    if (position == lruPositions.end())
+    {
+        lruPositions[&it->first] = lru.insert(lru.end(), &it->first);
+    }
+    else
+    {
+        lru.splice(lru.end(), lru, position->second);
+    }
+}
+
+void MegaCmdFingerprintCache::erase(map<string, string>::iterator it)
+{
+    map<const string *, list<const string *>::iterator>::iterator position = lruPositions.find(&it->first);
+    if (position != lruPositions.end())
+    {
+        lru.erase(position->second);
+        lruPositions.erase(position);
+    }
+    changed.insert(it->first);
+    records.erase(it);
+}
+
+void MegaCmdFingerprintCache::evict()
+{
+    size_t evicted = 0;
+    while (records.size() > maxEntries && !lru.empty())
+    {
+        erase(records.find(*lru.front()));
+        evicted++;
+    }
+    if (evicted)
+    {
+        evictions += evicted;
+        LOG_verbose << "Evicted " << evicted << " entries from the fingerprints cache";
+    }
+}
+
+bool MegaCmdFingerprintCache::get(const string &localPath, long long size, long long mtime, unsigned long long inode,
+                                  string *fingerprint, MegaHandle *handle)
+{
+    mtx.lock();
+    load();
+
+    map<string, string>::iterator it = records.find(localPath);
+    if (it == records.end() || it->second.size() <= FINGERPRINTVALUEHEADER)
+    {
+        misses++;
+        mtx.unlock();
+        return false;
+    }
+
+    const char *value = it->second.data();
+    if ((long long)MegaCmdRecordStore::readInteger(value, 8) != size
+            || (long long)MegaCmdRecordStore::readInteger(value + 8, 8) != mtime
+            || MegaCmdRecordStore::readInteger(value + 16, 8) != inode)
+    {
+        misses++;
+        mtx.unlock();
+        return false;
+    }
+
+    if (handle)
+    {
+        *handle = (MegaHandle)MegaCmdRecordStore::readInteger(value + 24, 8);
+    }
+    fingerprint->assign(value + FINGERPRINTVALUEHEADER, it->second.size() - FINGERPRINTVALUEHEADER);
+    touch(it);
+    hits++;
+    mtx.unlock();
+    return true;
+}
+
+void MegaCmdFingerprintCache::put(const string &localPath, long long size, long long mtime, unsigned long long inode,
+                                  const string &fingerprint, MegaHandle handle)
+{
+    string value;
+    MegaCmdRecordStore::appendInteger(&value, (unsigned long long)size, 8);
+    MegaCmdRecordStore::appendInteger(&value, (unsigned long long)mtime, 8);
+    MegaCmdRecordStore::appendInteger(&value, inode, 8);
+    MegaCmdRecordStore::appendInteger(&value, handle, 8);
+    value.append(fingerprint);
+
+    mtx.lock();
+    load();
+    map<string, string>::iterator it = records.insert(make_pair(localPath, string())).first;
+    if (it->second != value)
+    {
+        it->second.swap(value);
+        changed.insert(localPath);
+    }
+    touch(it);
+    evict();
+    mtx.unlock();
+}
+
+void MegaCmdFingerprintCache::remove(const string &localPath)
+{
+    mtx.lock();
+    load();
+    map<string, string>::iterator it = records.find(localPath);
+    if (it != records.end())
+    {
+        erase(it);
+    }
+    mtx.unlock();
+}
+
+bool MegaCmdFingerprintCache::save()
+{
+    mtx.lock();
+    bool saved = true;
+    if (!changed.empty())
+    {
+        saved = store.save(records, changed);
+        if (saved)
+        {
+            changed.clear();
+        }
+        else
+        {
+            LOG_err << "Unable to save fingerprints cache: " << store.getPath();
+        }
+    }
+    LOG_debug << "Fingerprints cache: " << records.size() << " entries. Hits: " << hits << " Misses: " << misses
+              << " Evictions: " << evictions;
+    mtx.unlock();
+    return saved;
+}
+
+size_t MegaCmdFingerprintCache::size()
+{
+    mtx.lock();
+    load();
+    size_t toret = records.size();
+    mtx.unlock();
+    return toret;
+}
+
+long long MegaCmdFingerprintCache::getHits()
+{
+    mtx.lock();
+    long long toret = hits;
+    mtx.unlock();
+    return toret;
+}
+
+long long MegaCmdFingerprintCache::getMisses()
+{
+    mtx.lock();
+    long long toret = misses;
+    mtx.unlock();
+    return toret;
+}
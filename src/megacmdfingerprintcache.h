@@ -0,0 +1,92 @@
+/**
+ * @file src/megacmdfingerprintcache.h
+ * @brief MEGAcmd: Cache of the fingerprints of the local files uploaded
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDFINGERPRINTCACHE_H
+#define MEGACMDFINGERPRINTCACHE_H
+
+#include "megacmd.h"
+#include "megacmdrecordstore.h"
+
+#include <list>
+#include <map>
+#include <set>
+
+#define DEFAULTFINGERPRINTCACHEENTRIES 1000000
+
+/**
+ * @brief Fingerprints of local files, persisted in the configuration folder
+ *
+ * Entries are identified by the local path and are valid while the size, modification time and
+ * inode of the file are the ones it had when its fingerprint was computed: a file unchanged since
+ * then needs not be read to know its fingerprint.
+ * Along with the fingerprint, the handle of the node it was last uploaded to is kept.
+ * Once there are more than maxEntries, the least recently used ones are evicted (the order of use is
+ * not persisted: entries loaded are considered used in the order of their paths).
+ *
+ * Records: key: local path
+ *          value: int64 size, int64 modification time, uint64 inode, uint64 handle, fingerprint (the rest)
+ */
+class MegaCmdFingerprintCache
+{
+private:
+    MegaCmdRecordStore store;
+    std::map<std::string, std::string> records;
+    std::list<const std::string *> lru; // keys of records, the least recently used first
+    std::map<const std::string *, std::list<const std::string *>::iterator> lruPositions;
+    std::set<std::string> changed; // keys put or removed since the last save
+    size_t maxEntries;
+    bool loaded;
+    mega::MegaMutex mtx;
+
+    long long hits;
+    long long misses;
+    long long evictions;
+
+    // the following require mtx to be locked
+    void load();
+    void touch(std::map<std::string, std::string>::iterator it);
+    void erase(std::map<std::string, std::string>::iterator it);
+    void evict();
+
+public:
+    MegaCmdFingerprintCache(std::string path, size_t maxEntries = DEFAULTFINGERPRINTCACHEENTRIES);
+
+    /**
+     * @brief Gets the fingerprint of a local file, if it was cached with the same size, modification time and inode
+     * @param handle if not NULL, receives the handle of the node it was last uploaded to (or UNDEF)
+     * @return whether it was found
+     */
+    bool get(const std::string &localPath, long long size, long long mtime, unsigned long long inode,
+             std::string *fingerprint, mega::MegaHandle *handle);
+
+    void put(const std::string &localPath, long long size, long long mtime, unsigned long long inode,
+             const std::string &fingerprint, mega::MegaHandle handle);
+
+    void remove(const std::string &localPath);
+
+    /**
+     * @brief Persists the changes made since the last save
+     */
+    bool save();
+
+    size_t size();
+    long long getHits();
+    long long getMisses();
+};
+
+#endif // MEGACMDFINGERPRINTCACHE_H
@@ -0,0 +1,260 @@
+/**
+ * @file src/megacmdfoldercreator.cpp
+ * @brief MEGAcmd: Creation of remote folders in batches
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdfoldercreator.h"
+#include "megacmdlogger.h"
+#include "listeners.h"
+
+using namespace std;
+using namespace mega;
+
+MegaCmdFolderCreator::MegaCmdFolderCreator(MegaApi *api)
+{
+    this->api = api;
+    created = 0;
+}
+
+bool MegaCmdFolderCreator::normalize(string *path, int *components)
+{
+    vector<string> parts;
+    size_t start = 0;
+    while (start <= path->size())
+    {
+        size_t possep = path->find('/', start);
+        if (possep == string::npos)
+        {
+            possep = path->size();
+        }
+        string part = path->substr(start, possep - start);
+        if (part == "..")
+        {
+            if (!parts.size())
+            {
+                return false;
+            }
+            parts.pop_back();
+        }
+        else if (part.size() && part != ".")
+        {
+            parts.push_back(part);
+        }
+        start = possep + 1;
+    }
+
+    path->clear();
+    for (unsigned int i = 0; i < parts.size(); i++)
+    {
+        if (i)
+        {
+            path->append("/");
+        }
+        path->append(parts[i]);
+    }
+    if (components)
+    {
+        *components = int(parts.size());
+    }
+    return true;
+}
+
+int MegaCmdFolderCreator::add(MegaHandle base, string path)
+{
+    int depth;
+    if (!normalize(&path, &depth))
+    {
+        return MegaError::API_EARGS;
+    }
+
+    int toret = MegaError::API_OK;
+    for (bool leaf = true; depth > 0; leaf = false)
+    {
+        if (int(levels.size()) < depth)
+        {
+            levels.resize(depth);
+        }
+        if (!levels[depth - 1].insert(folderkey(base, path)).second)
+        {
+            if (leaf)
+            {
+                toret = MegaError::API_EEXIST;
+            }
+            break; // so were its ancestors
+        }
+        size_t possep = path.find_last_of('/');
+        path = (possep == string::npos) ? string() : path.substr(0, possep);
+        depth--;
+    }
+    return toret;
+}
+
+int MegaCmdFolderCreator::createBatch(vector<folderkey> &batch)
+{
+    int failed = 0;
+    vector<MegaCmdListener *> listeners(batch.size(), (MegaCmdListener *)NULL);
+    map<MegaHandle, MegaNode *> parents;
+
+    // all the creations are requested before waiting for any of them
+    for (unsigned int i = 0; i < batch.size(); i++)
+    {
+        const folderkey &key = batch[i];
+        size_t possep = key.second.find_last_of('/');
+        string name = (possep == string::npos) ? key.second : key.second.substr(possep + 1);
+        MegaHandle parent = key.first;
+        if (possep != string::npos)
+        {
+            folderkey parentKey(key.first, key.second.substr(0, possep));
+            map<folderkey, MegaHandle>::iterator it = handles.find(parentKey);
+            if (it == handles.end())
+            {
+                map<folderkey, int>::iterator ite = errors.find(parentKey);
+                errors[key] = (ite != errors.end()) ? ite->second : int(MegaError::API_ENOENT);
+                failed++;
+                continue;
+            }
+            parent = it->second;
+        }
+
+        map<MegaHandle, MegaNode *>::iterator itp = parents.find(parent);
+        if (itp == parents.end())
+        {
+            itp = parents.insert(pair<MegaHandle, MegaNode *>(parent, api->getNodeByHandle(parent))).first;
+        }
+        MegaNode *parentNode = itp->second;
+        if (!parentNode)
+        {
+            errors[key] = MegaError::API_ENOENT;
+            failed++;
+            continue;
+        }
+
+        MegaNode *existing = api->getChildNode(parentNode, name.c_str());
+        if (existing && existing->getType() != MegaNode::TYPE_FILE)
+        {
+            handles[key] = existing->getHandle();
+        }
+        else if (existing)
+        {
+            LOG_err << "Unable to create remote folder " << key.second << ": a file with that name exists";
+            errors[key] = MegaError::API_EEXIST;
+            failed++;
+        }
+        else
+        {
+            LOG_verbose << "Creating (sub)folder: " << key.second;
+            listeners[i] = new MegaCmdListener(api, NULL);
+            api->createFolder(name.c_str(), parentNode, listeners[i]);
+        }
+        delete existing;
+    }
+
+    for (map<MegaHandle, MegaNode *>::iterator it = parents.begin(); it != parents.end(); it++)
+    {
+        delete it->second;
+    }
+
+    for (unsigned int i = 0; i < batch.size(); i++)
+    {
+        if (!listeners[i])
+        {
+            continue;
+        }
+        listeners[i]->wait();
+        int errorCode = listeners[i]->getError() ? listeners[i]->getError()->getErrorCode() : int(MegaError::API_EINTERNAL);
+        if (errorCode == MegaError::API_OK)
+        {
+            handles[batch[i]] = listeners[i]->getRequest()->getNodeHandle();
+            created++;
+        }
+        else
+        {
+            LOG_err << "Unable to create remote folder " << batch[i].second << ": " << MegaError::getErrorString(errorCode);
+            errors[batch[i]] = errorCode;
+            failed++;
+        }
+        delete listeners[i];
+    }
+    return failed;
+}
+
+int MegaCmdFolderCreator::create()
+{
+    int failed = 0;
+    // a level must be created before the next one: its handles are the parents of the next
+    for (unsigned int depth = 0; depth < levels.size(); depth++)
+    {
+        vector<folderkey> batch;
+        for (set<folderkey>::iterator it = levels[depth].begin(); it != levels[depth].end(); it++)
+        {
+            if (handles.find(*it) != handles.end() || errors.find(*it) != errors.end())
+            {
+                continue; // from a previous call
+            }
+            batch.push_back(*it);
+            if (batch.size() >= MAXFOLDERCREATIONBATCH)
+            {
+                failed += createBatch(batch);
+                batch.clear();
+            }
+        }
+        if (batch.size())
+        {
+            failed += createBatch(batch);
+        }
+    }
+    return failed;
+}
+
+MegaHandle MegaCmdFolderCreator::getHandle(MegaHandle base, string path)
+{
+    if (!normalize(&path))
+    {
+        return UNDEF;
+    }
+    if (!path.size())
+    {
+        return base;
+    }
+    map<folderkey, MegaHandle>::iterator it = handles.find(folderkey(base, path));
+    return (it != handles.end()) ? it->second : UNDEF;
+}
+
+int MegaCmdFolderCreator::getError(MegaHandle base, string path)
+{
+    if (!normalize(&path))
+    {
+        return MegaError::API_EARGS;
+    }
+    map<folderkey, int>::iterator it = errors.find(folderkey(base, path));
+    return (it != errors.end()) ? it->second : int(MegaError::API_OK);
+}
+
+map<string, MegaHandle> MegaCmdFolderCreator::getHandles(MegaHandle base)
+{
+    map<string, MegaHandle> toret;
+    for (map<folderkey, MegaHandle>::iterator it = handles.lower_bound(folderkey(base, string()));
+         it != handles.end() && it->first.first == base; it++)
+    {
+        toret[it->first.second] = it->second;
+    }
+    return toret;
+}
+
+size_t MegaCmdFolderCreator::getNumberCreated() const
+{
+    return created;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file src/megacmdfoldercreator.h
+ * @brief MEGAcmd: Creation of remote folders in batches
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDFOLDERCREATOR_H
+#define MEGACMDFOLDERCREATOR_H
+
+#include "megacmd.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+#define MAXFOLDERCREATIONBATCH 500
+
+/**
+ * @brief Creates the remote folders of a set of paths (e.g. the ones given to mkdir -p, or the
+ * tree of a local folder to upload), relative to base folders.
+ *
+ * The folders that already exist are found, and the missing ones are created a level of the
+ * trees at a time, requesting the creation of all the folders of a level at once (in batches of
+ * MAXFOLDERCREATIONBATCH) before waiting for them. The handles of the folders come with the
+ * results of their requests: they are not looked up again.
+ */
+class MegaCmdFolderCreator
+{
+private:
+    typedef std::pair<mega::MegaHandle, std::string> folderkey; // base folder and path relative to it
+
+    mega::MegaApi *api;
+    std::vector<std::set<folderkey> > levels; // the paths added (and their ancestors) by depth
+    std::map<folderkey, mega::MegaHandle> handles; // of the folders found or created
+    std::map<folderkey, int> errors; // of the ones that could not be created
+    size_t created;
+
+    int createBatch(std::vector<folderkey> &batch);
+
+public:
+    MegaCmdFolderCreator(mega::MegaApi *api);
+
+    /**
+     * @brief Normalizes a relative path: separators are collapsed, "." is skipped and ".." goes up
+     * @param components will receive the number of components of the path (if not NULL)
+     * @return false (leaving path untouched) if ".." goes above the base folder
+     */
+    static bool normalize(std::string *path, int *components = NULL);
+
+    /**
+     * @brief Adds a path (relative to the folder base) to be created along with all its ancestors
+     * @return API_OK, API_EEXIST if the path was already added (by itself or as an ancestor of
+     * another one) or API_EARGS if it goes above the base folder
+     */
+    int add(mega::MegaHandle base, std::string path);
+
+    /**
+     * @brief Finds the folders of the paths added and creates the ones missing
+     * @return the number of folders that could not be created (including the ones within them)
+     */
+    int create();
+
+    /**
+     * @return the handle of the folder of a path added (or of an ancestor), UNDEF if it could not be created
+     */
+    mega::MegaHandle getHandle(mega::MegaHandle base, std::string path);
+
+    /**
+     * @return the error code of the creation of a path added (API_OK if it was created or found)
+     */
+    int getError(mega::MegaHandle base, std::string path);
+
+    /**
+     * @return the handles of all the folders found or created within base, by their (normalized) path
+     */
+    std::map<std::string, mega::MegaHandle> getHandles(mega::MegaHandle base);
+
+    size_t getNumberCreated() const;
+};
+
+#endif // MEGACMDFOLDERCREATOR_H
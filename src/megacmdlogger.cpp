@@ -18,140 +18,294 @@
 
 #include "megacmdlogger.h"
 
-#include <map>
-
 #include <sys/types.h>
+#include <sstream>
+#include <stdio.h>
 using namespace std;
 using namespace mega;
 
-// different outstreams for every thread. to gather all the output data
-map<uint64_t, OUTSTREAMTYPE *> outstreams;
-map<uint64_t, int> threadLogLevel;
-map<uint64_t, int> threadoutCode;
-map<uint64_t, CmdPetition *> threadpetition;
-map<uint64_t, bool> threadIsCmdShell;
+// context of the command being run by the current thread
+static THREADLOCAL MegaCmdThreadContext *currentContext = NULL;
+// for threads that change the context without having installed one (e.g. the interactive one)
+static THREADLOCAL MegaCmdThreadContext *defaultContext = NULL;
 
-OUTSTREAMTYPE &getCurrentOut()
+static const MegaCmdThreadContext noContext;
+
+MegaCmdThreadContext::MegaCmdThreadContext()
 {
-    uint64_t currentThread = MegaThread::currentThreadId();
-    if (outstreams.find(currentThread) == outstreams.end())
-    {
-        return COUT;
-    }
-    else
-    {
-        return *outstreams[currentThread];
-    }
+    out = NULL;
+    logLevel = -1;
+    outCode = 0; //default OK
+    petition = NULL;
+    isCmdShell = false;
 }
 
-bool interactiveThread()
+static inline const MegaCmdThreadContext *readContext()
 {
-    if (getCurrentThreadIsCmdShell())
-    {
-        return true;
-    }
+    return currentContext ? currentContext : &noContext;
+}
 
-    unsigned long long currentThread = MegaThread::currentThreadId();
-    if (outstreams.find(currentThread) == outstreams.end())
-    {
-        return true;
-    }
-    else
+static MegaCmdThreadContext *writeContext()
+{
+    if (!currentContext)
     {
-        return false;
+        if (!defaultContext)
+        {
+            defaultContext = new MegaCmdThreadContext();
+        }
+        currentContext = defaultContext;
     }
+    return currentContext;
 }
 
-int getCurrentOutCode()
+MegaCmdThreadContext *getCurrentThreadContext()
 {
-    unsigned long long currentThread = MegaThread::currentThreadId();
-    if (threadoutCode.find(currentThread) == threadoutCode.end())
-    {
-        return 0; //default OK
-    }
-    else
-    {
-        return threadoutCode[currentThread];
-    }
+    return currentContext;
 }
 
+void setCurrentThreadContext(MegaCmdThreadContext *context)
+{
+    currentContext = context ? context : defaultContext;
+}
+
+OUTSTREAMTYPE &getCurrentOut()
+{
+    OUTSTREAMTYPE *out = readContext()->out;
+    return out ? *out : COUT;
+}
+
+bool interactiveThread()
+{
+    const MegaCmdThreadContext *context = readContext();
+    return context->isCmdShell || !context->out;
+}
+
+int getCurrentOutCode()
+{
+    return readContext()->outCode;
+}
 
 CmdPetition * getCurrentPetition()
 {
-    unsigned long long currentThread = MegaThread::currentThreadId();
-    if (threadpetition.find(currentThread) == threadpetition.end())
-    {
-        return NULL;
-    }
-    else
-    {
-        return threadpetition[currentThread];
-    }
+    return readContext()->petition;
 }
 
 int getCurrentThreadLogLevel()
 {
-    unsigned long long currentThread = MegaThread::currentThreadId();
-    if (threadLogLevel.find(currentThread) == threadLogLevel.end())
+    return readContext()->logLevel;
+}
+
+bool getCurrentThreadIsCmdShell()
+{
+    return readContext()->isCmdShell;
+}
+
+void setCurrentThreadLogLevel(int level)
+{
+    writeContext()->logLevel = level;
+}
+
+void setCurrentThreadOutStream(OUTSTREAMTYPE *s)
+{
+    writeContext()->out = s;
+}
+
+void setCurrentThreadIsCmdShell(bool isit)
+{
+    writeContext()->isCmdShell = isit;
+}
+
+void setCurrentOutCode(int outCode)
+{
+    writeContext()->outCode = outCode;
+}
+
+void setCurrentPetition(CmdPetition *petition)
+{
+    writeContext()->petition = petition;
+}
+
+// classification of the sources of the log lines (MEGAcmd or SDK): sources are "file:line",
+// so each call site is classified once per thread and remembered by the hash of its source.
+// Entries keep the hash with its lowest bits replaced by: used (2) | MEGAcmd source (1)
+#define SOURCECLASSES 256 // power of 2
+static THREADLOCAL unsigned long long sourceClasses[SOURCECLASSES];
+
+static bool isMegaCmdSource(const char *source)
+{
+    unsigned long long hash = 14695981039346656037ULL; // FNV-1a
+    for (const char *c = source; *c; c++)
     {
-        return -1;
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ULL;
     }
-    else
+
+    unsigned long long key = (hash & ~3ULL) | 2;
+    unsigned long long *entry = &sourceClasses[(hash >> 2) & (SOURCECLASSES - 1)];
+    if ((*entry & ~1ULL) == key)
     {
-        return threadLogLevel[currentThread];
+        return *entry & 1;
     }
+
+    bool megacmd = (strstr(source, "src/megacmd") != NULL)
+            || (strstr(source, "src/listeners.cpp") != NULL)
+            || (strstr(source, "src/configurationmanager.cpp") != NULL)
+            || (strstr(source, "src/comunicationsmanager") != NULL);
+    *entry = key | (megacmd ? 1 : 0);
+    return megacmd;
 }
 
-bool getCurrentThreadIsCmdShell()
+MegaCMDLogger::MegaCMDLogger(OUTSTREAMTYPE *outstr)
 {
-    unsigned long long currentThread = MegaThread::currentThreadId();
-    if (threadIsCmdShell.find(currentThread) == threadIsCmdShell.end())
+    this->output = outstr;
+    this->apiLoggerLevel = MegaApi::LOG_LEVEL_ERROR;
+    this->cmdLoggerLevel = MegaApi::LOG_LEVEL_INFO;
+    this->asyncBuffer = NULL;
+    this->asyncStopping = false;
+    this->fileSink = NULL;
+    asyncMutex.init(false);
+}
+
+MegaCMDLogger::~MegaCMDLogger()
+{
+    if (asyncBuffer)
     {
-        return false; //default not
+        asyncMutex.lock();
+        asyncStopping = true;
+        asyncMutex.unlock();
+        asyncWakeup.release();
+        asyncWriter.join(); // the records left are written before
+
+        MegaCmdLogRingBuffer *buffer = asyncBuffer;
+        asyncBuffer = NULL;
+        if (buffer->getDropped())
+        {
+            *output << "[warn: async logging] " << buffer->getDropped() << " log lines were dropped in total" << endl;
+        }
+        delete buffer;
     }
-    else
+
+    delete fileSink;
+}
+
+void MegaCMDLogger::startAsyncMode(unsigned int records)
+{
+    if (asyncBuffer)
     {
-        return threadIsCmdShell[currentThread];
+        return;
     }
+    asyncBuffer = new MegaCmdLogRingBuffer(records);
+    asyncWriter.start(asyncWriterEntry, this);
 }
 
+bool MegaCMDLogger::isAsync()
+{
+    return asyncBuffer != NULL;
+}
 
-void setCurrentThreadLogLevel(int level)
+unsigned long long MegaCMDLogger::getDroppedLines()
 {
-    threadLogLevel[MegaThread::currentThreadId()] = level;
+    return asyncBuffer ? asyncBuffer->getDropped() : 0;
 }
 
-void setCurrentThreadOutStream(OUTSTREAMTYPE *s)
+unsigned int MegaCMDLogger::getAsyncCapacity()
 {
-    outstreams[MegaThread::currentThreadId()] = s;
+    return asyncBuffer ? asyncBuffer->getCapacity() : 0;
 }
 
-void setCurrentThreadIsCmdShell(bool isit)
+void MegaCMDLogger::setFileSink(MegaCmdLogFileSink *sink)
 {
-    threadIsCmdShell[MegaThread::currentThreadId()] = isit;
+    fileSink = sink;
 }
 
-void setCurrentOutCode(int outCode)
+MegaCmdLogFileSink *MegaCMDLogger::getFileSink()
 {
-    threadoutCode[MegaThread::currentThreadId()] = outCode;
+    return fileSink;
 }
 
-void setCurrentPetition(CmdPetition *petition)
+void *MegaCMDLogger::asyncWriterEntry(void *param)
+{
+    ((MegaCMDLogger *)param)->writeAsyncRecords();
+    return NULL;
+}
+
+void MegaCMDLogger::writeAsyncRecords()
 {
-    threadpetition[MegaThread::currentThreadId()] = petition;
+    string batch;
+    batch.reserve(MAXASYNCLOGBATCH + MAXLOGRECORD);
+    unsigned long long reportedDropped = 0;
+
+    for (;; )
+    {
+        asyncMutex.lock();
+        bool stopping = asyncStopping;
+        asyncMutex.unlock();
+
+        batch.clear();
+        while (batch.size() < MAXASYNCLOGBATCH && asyncBuffer->pop(&batch))
+        {
+        }
+
+        unsigned long long dropped = asyncBuffer->getDropped();
+        if (dropped != reportedDropped)
+        {
+            ostringstream report;
+            report << "[warn: async logging] " << dropped - reportedDropped << " log lines dropped (buffer of "
+                   << asyncBuffer->getCapacity() << " lines full)\n";
+            batch.append(report.str());
+            reportedDropped = dropped;
+        }
+
+        if (batch.size())
+        {
+            *output << batch.c_str();
+            output->flush();
+            continue;
+        }
+
+        if (stopping)
+        {
+            break; // stopping is read before popping: nothing was left behind
+        }
+        asyncWakeup.timedwait(ASYNCLOGWRITEPERIOD);
+    }
+}
+
+void MegaCMDLogger::writeToOutput(const char *prefix, const char *time, int loglevel, const char *message)
+{
+    if (!asyncBuffer)
+    {
+        *output << prefix << SimpleLogger::toStr(LogLevel(loglevel)) << ": " << time << "] " << message << endl;
+        return;
+    }
+
+    char line[MAXLOGRECORD + 1];
+    int length = snprintf(line, sizeof(line), "%s%s: %s] %s\n", prefix, SimpleLogger::toStr(LogLevel(loglevel)), time, message);
+    if (length < 0)
+    {
+        return;
+    }
+    if (length >= (int)sizeof(line))
+    {
+        // truncated, as the ring would do
+        length = MAXLOGRECORD;
+        line[length - 1] = '\n';
+    }
+    asyncBuffer->push(line, length);
 }
 
 void MegaCMDLogger::log(const char *time, int loglevel, const char *source, const char *message)
 {
-    if ( (strstr(source, "src/megacmd") != NULL)
-         || (strstr(source, "src/listeners.cpp") != NULL)
-         || (strstr(source, "src/configurationmanager.cpp") != NULL)
-         || (strstr(source, "src/comunicationsmanager") != NULL)
-         )
+    if (isMegaCmdSource(source))
     {
         if (loglevel <= cmdLoggerLevel)
         {
-            *output << "[" << SimpleLogger::toStr(LogLevel(loglevel)) << ": " << time << "] " << message << endl;
+            writeToOutput("[", time, loglevel, message);
+            if (fileSink)
+            {
+                CmdPetition *petition = getCurrentPetition();
+                fileSink->log(time, loglevel, source, message, true, petition ? petition->id : 0);
+            }
         }
 
         int currentThreadLogLevel = getCurrentThreadLogLevel();
@@ -177,7 +331,12 @@ void MegaCMDLogger::log(const char *time, int loglevel, const char *source, cons
                 return;
             }
 
-            *output << "[API:" << SimpleLogger::toStr(LogLevel(loglevel)) << ": " << time << "] " << message << endl;
+            writeToOutput("[API:", time, loglevel, message);
+            if (fileSink)
+            {
+                CmdPetition *petition = getCurrentPetition();
+                fileSink->log(time, loglevel, source, message, false, petition ? petition->id : 0);
+            }
         }
 
         int currentThreadLogLevel = getCurrentThreadLogLevel();
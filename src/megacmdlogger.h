@@ -21,9 +21,42 @@
 
 #include "megacmd.h"
 #include "comunicationsmanager.h"
+#include "megacmdlogringbuffer.h"
+#include "megacmdlogsink.h"
 
 #define OUTSTREAM getCurrentOut()
 
+#ifdef _WIN32
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL __thread
+#endif
+
+/**
+ * @brief State of the command run by a thread: where its output goes, its outcode, ...
+ *
+ * The thread that executes a petition installs one for as long as it lasts (see setCurrentThreadContext).
+ * The functions below read and change the one of the current thread.
+ */
+class MegaCmdThreadContext
+{
+public:
+    OUTSTREAMTYPE *out; // NULL: not gathering output (COUT)
+    int logLevel; // <0: the one of the logger
+    int outCode;
+    CmdPetition *petition;
+    bool isCmdShell;
+
+    MegaCmdThreadContext();
+};
+
+MegaCmdThreadContext *getCurrentThreadContext();
+/**
+ * @param context context of the command the current thread is about to run (owned by the caller),
+ * NULL when done with it
+ */
+void setCurrentThreadContext(MegaCmdThreadContext *context);
+
 OUTSTREAMTYPE &getCurrentOut();
 bool interactiveThread();
 void setCurrentThreadOutStream(OUTSTREAMTYPE *);
@@ -40,21 +73,56 @@ void setCurrentThreadIsCmdShell(bool isit);
 bool getCurrentThreadIsCmdShell();
 
 
+#define DEFAULTASYNCLOGRECORDS 8192
+#define MAXASYNCLOGBATCH 65536 // bytes written at once
+#define ASYNCLOGWRITEPERIOD 20 // ms to wait for more records once the buffer is empty
+
 class MegaCMDLogger : public mega::MegaLogger
 {
 private:
     int apiLoggerLevel;
     int cmdLoggerLevel;
     OUTSTREAMTYPE * output;
+
+    // async mode: lines are queued here and written by asyncWriter
+    MegaCmdLogRingBuffer *asyncBuffer;
+    mega::MegaThread asyncWriter;
+    mega::MegaSemaphore asyncWakeup;
+    mega::MegaMutex asyncMutex;
+    bool asyncStopping;
+
+    MegaCmdLogFileSink *fileSink;
+
+    void writeToOutput(const char *prefix, const char *time, int loglevel, const char *message);
+    static void *asyncWriterEntry(void *param);
+    void writeAsyncRecords();
+
 public:
-    MegaCMDLogger(OUTSTREAMTYPE * outstr)
-    {
-        this->output = outstr;
-        this->apiLoggerLevel = mega::MegaApi::LOG_LEVEL_ERROR;
-    }
+    MegaCMDLogger(OUTSTREAMTYPE * outstr);
+    ~MegaCMDLogger();
 
     void log(const char *time, int loglevel, const char *source, const char *message);
 
+    /**
+     * @brief Makes log lines be queued and written to the output by a thread of their own,
+     * so that the threads logging do not wait for it. When the queue is full, lines are dropped
+     * (and their number is logged).
+     * To be called before other threads start logging
+     * @param records number of lines that can be queued
+     */
+    void startAsyncMode(unsigned int records = DEFAULTASYNCLOGRECORDS);
+    bool isAsync();
+    unsigned long long getDroppedLines();
+    unsigned int getAsyncCapacity();
+
+    /**
+     * @brief Makes the lines logged be written to sink too (with the same log levels).
+     * To be called before other threads start logging
+     * @param sink started sink, owned by the logger from then on
+     */
+    void setFileSink(MegaCmdLogFileSink *sink);
+    MegaCmdLogFileSink *getFileSink();
+
     void setApiLoggerLevel(int apiLoggerLevel)
     {
         this->apiLoggerLevel = apiLoggerLevel;
@@ -0,0 +1,165 @@
+/**
+ * @file src/megacmdlogringbuffer.cpp
+ * @brief MEGAcmd: Bounded queue of log records written by many threads
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdlogringbuffer.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+// Interlocked functions are full barriers, whatever the compiler does with volatile accesses
+static inline unsigned long long atomicLoad(unsigned long long *p)
+{
+    return (unsigned long long)InterlockedCompareExchange64((volatile LONG64 *)p, 0, 0);
+}
+
+static inline void atomicStore(unsigned long long *p, unsigned long long value)
+{
+    InterlockedExchange64((volatile LONG64 *)p, (LONG64)value);
+}
+
+static inline bool atomicCompareAndSwap(unsigned long long *p, unsigned long long expected, unsigned long long desired)
+{
+    return InterlockedCompareExchange64((volatile LONG64 *)p, (LONG64)desired, (LONG64)expected) == (LONG64)expected;
+}
+
+static inline void atomicIncrement(unsigned long long *p)
+{
+    InterlockedIncrement64((volatile LONG64 *)p);
+}
+#else
+static inline unsigned long long atomicLoad(unsigned long long *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomicStore(unsigned long long *p, unsigned long long value)
+{
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+static inline bool atomicCompareAndSwap(unsigned long long *p, unsigned long long expected, unsigned long long desired)
+{
+    return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomicIncrement(unsigned long long *p)
+{
+    __atomic_fetch_add(p, 1, __ATOMIC_RELAXED);
+}
+#endif
+
+MegaCmdLogRingBuffer::MegaCmdLogRingBuffer(unsigned int capacity)
+{
+    unsigned long long size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    records = new logrecord[size];
+    for (unsigned long long i = 0; i < size; i++)
+    {
+        records[i].sequence = i;
+        records[i].length = 0;
+    }
+    mask = size - 1;
+    writePosition = 0;
+    readPosition = 0;
+    dropped = 0;
+}
+
+MegaCmdLogRingBuffer::~MegaCmdLogRingBuffer()
+{
+    delete [] records;
+}
+
+bool MegaCmdLogRingBuffer::push(const char *text, size_t length)
+{
+    logrecord *record;
+    unsigned long long position = atomicLoad(&writePosition);
+    for (;;)
+    {
+        record = &records[position & mask];
+        unsigned long long sequence = atomicLoad(&record->sequence);
+        long long difference = (long long)(sequence - position);
+        if (!difference)
+        {
+            if (atomicCompareAndSwap(&writePosition, position, position + 1))
+            {
+                break;
+            }
+            position = atomicLoad(&writePosition);
+        }
+        else if (difference < 0)
+        {
+            // the consumer has not read this slot yet: the ring is full
+            atomicIncrement(&dropped);
+            return false;
+        }
+        else
+        {
+            // another producer claimed it
+            position = atomicLoad(&writePosition);
+        }
+    }
+
+    if (length <= MAXLOGRECORD)
+    {
+        memcpy(record->text, text, length);
+    }
+    else
+    {
+        memcpy(record->text, text, MAXLOGRECORD - 1);
+        record->text[MAXLOGRECORD - 1] = text[length - 1];
+        length = MAXLOGRECORD;
+    }
+    record->length = length;
+    atomicStore(&record->sequence, position + 1);
+    return true;
+}
+
+bool MegaCmdLogRingBuffer::pop(string *batch)
+{
+    logrecord *record = &records[readPosition & mask];
+    if (atomicLoad(&record->sequence) != readPosition + 1)
+    {
+        return false;
+    }
+
+    batch->append(record->text, record->length);
+
+    atomicStore(&record->sequence, readPosition + mask + 1);
+    readPosition++;
+    return true;
+}
+
+unsigned long long MegaCmdLogRingBuffer::getDropped()
+{
+    return atomicLoad(&dropped);
+}
+
+unsigned int MegaCmdLogRingBuffer::getCapacity()
+{
+    return (unsigned int)(mask + 1);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file src/megacmdlogringbuffer.h
+ * @brief MEGAcmd: Bounded queue of log records written by many threads
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDLOGRINGBUFFER_H
+#define MEGACMDLOGRINGBUFFER_H
+
+#include <string>
+#include <stddef.h>
+
+#define MAXLOGRECORD 512 // longer records are truncated
+
+/**
+ * @brief Fixed size ring of preformatted log records.
+ *
+ * Any number of threads may push records without locking (slots are claimed with a
+ * compare-and-swap on the position to write), while a single thread pops them.
+ * When the ring is full, records are dropped and counted instead of waiting.
+ * Records are copied into preallocated slots: pushing never allocates memory.
+ */
+class MegaCmdLogRingBuffer
+{
+private:
+    typedef struct logrecord_struct
+    {
+        unsigned long long sequence; // position the slot is ready for: to be written (==pos) or read (==pos+1)
+        size_t length;
+        char text[MAXLOGRECORD];
+    } logrecord;
+
+    logrecord *records;
+    unsigned long long mask;
+    unsigned long long writePosition; // shared by producers
+    unsigned long long readPosition; // only used by the consumer
+    unsigned long long dropped;
+
+public:
+    /**
+     * @param capacity number of records, rounded up to a power of 2
+     */
+    MegaCmdLogRingBuffer(unsigned int capacity);
+    ~MegaCmdLogRingBuffer();
+
+    /**
+     * @brief Queues a record. Can be called from any thread
+     *
+     * Records longer than MAXLOGRECORD are truncated, keeping their last character (e.g. a line break)
+     * @return false if the ring was full and the record was dropped
+     */
+    bool push(const char *text, size_t length);
+
+    /**
+     * @brief Appends the oldest record to batch. Only to be called from one thread at a time
+     * @return false if there were no records
+     */
+    bool pop(std::string *batch);
+
+    unsigned long long getDropped();
+    unsigned int getCapacity();
+};
+
+#endif // MEGACMDLOGRINGBUFFER_H
@@ -0,0 +1,344 @@
+/**
+ * @file src/megacmdlogsink.cpp
+ * @brief MEGAcmd: Structured log files with rotation
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdlogsink.h"
+#include "megacmdutils.h"
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <sys/time.h> // gettimeofday
+#endif
+
+using namespace std;
+using namespace mega;
+
+static long long getWallClockMicroSeconds()
+{
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    unsigned long long t = ((unsigned long long)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (long long)(t / 10) - 11644473600000000LL; // from 1601 to 1970
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+static void appendInteger(string *record, unsigned long long value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        record->append(1, (char)((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static void appendJsonString(string *record, const char *value)
+{
+    static const char *hex = "0123456789abcdef";
+    record->append(1, '"');
+    for (const char *c = value; *c; c++)
+    {
+        switch (*c)
+        {
+            case '"':
+                record->append("\\\"");
+                break;
+            case '\\':
+                record->append("\\\\");
+                break;
+            case '\n':
+                record->append("\\n");
+                break;
+            case '\r':
+                record->append("\\r");
+                break;
+            case '\t':
+                record->append("\\t");
+                break;
+            default:
+                if ((unsigned char)*c < 0x20)
+                {
+                    record->append("\\u00");
+                    record->append(1, hex[((unsigned char)*c) >> 4]);
+                    record->append(1, hex[((unsigned char)*c) & 0xF]);
+                }
+                else
+                {
+                    record->append(1, *c);
+                }
+        }
+    }
+    record->append(1, '"');
+}
+
+MegaCmdLogFileSink::MegaCmdLogFileSink(string path, int format, long long maxSize, int maxAge, int rotations, unsigned int records)
+    : buffer(records)
+{
+    this->path = path;
+    this->format = format;
+    this->maxSize = maxSize;
+    this->maxAge = (long long)maxAge * 1000000;
+    this->rotations = rotations;
+    stopping = false;
+    started = false;
+    fileSize = 0;
+    fileOpenedAt = 0;
+    reportedDropped = 0;
+    mtx.init(false);
+}
+
+MegaCmdLogFileSink::~MegaCmdLogFileSink()
+{
+    if (started)
+    {
+        mtx.lock();
+        stopping = true;
+        mtx.unlock();
+        wakeup.release();
+        writer.join(); // the records left are written before
+    }
+    if (file.is_open())
+    {
+        file.close();
+    }
+}
+
+bool MegaCmdLogFileSink::start()
+{
+    rotate();
+    if (!file.is_open())
+    {
+        return false;
+    }
+    writer.start(writerEntry, this);
+    started = true;
+    return true;
+}
+
+int MegaCmdLogFileSink::getFormat(string name)
+{
+    if (name == "json")
+    {
+        return FORMAT_JSON;
+    }
+    if (name == "binary")
+    {
+        return FORMAT_BINARY;
+    }
+    return -1;
+}
+
+string MegaCmdLogFileSink::getPath()
+{
+    return path;
+}
+
+unsigned long long MegaCmdLogFileSink::getDropped()
+{
+    return buffer.getDropped();
+}
+
+void MegaCmdLogFileSink::encode(string *record, long long monotonicTime, unsigned long long thread, unsigned long long petition,
+                                int loglevel, bool megacmd, const char *time, const char *source, const char *message)
+{
+    if (format == FORMAT_BINARY)
+    {
+        size_t sourceLength = min(strlen(source), (size_t)0xFFFF);
+        size_t messageLength = strlen(message);
+        record->reserve(4 + LOGRECORDFIXEDSIZE + sourceLength + messageLength);
+        appendInteger(record, LOGRECORDFIXEDSIZE + sourceLength + messageLength, 4);
+        appendInteger(record, (unsigned long long)monotonicTime, 8);
+        appendInteger(record, thread, 8);
+        appendInteger(record, petition, 8);
+        appendInteger(record, (unsigned long long)loglevel, 1);
+        appendInteger(record, megacmd ? 0 : 1, 1);
+        appendInteger(record, sourceLength, 2);
+        record->append(source, sourceLength);
+        record->append(message, messageLength);
+        return;
+    }
+
+    ostringstream fields;
+    fields << "{\"mono\":" << monotonicTime << ",\"thread\":" << thread << ",\"petition\":" << petition
+           << ",\"level\":\"" << SimpleLogger::toStr(LogLevel(loglevel)) << "\",\"origin\":\"" << (megacmd ? "megacmd" : "sdk")
+           << "\",\"time\":";
+    record->append(fields.str());
+    appendJsonString(record, time);
+    record->append(",\"source\":");
+    appendJsonString(record, source);
+    record->append(",\"message\":");
+    appendJsonString(record, message);
+    record->append("}\n");
+}
+
+void MegaCmdLogFileSink::log(const char *time, int loglevel, const char *source, const char *message, bool megacmd, unsigned long long petition)
+{
+    string record;
+    long long monotonicTime = getMonotonicMicroSeconds();
+    unsigned long long thread = MegaThread::currentThreadId();
+    encode(&record, monotonicTime, thread, petition, loglevel, megacmd, time, source, message);
+
+    if (record.size() > MAXLOGRECORD)
+    {
+        // the ring would cut the record: shorten the message instead, so that it remains well formed
+        string shortened(message);
+        while (record.size() > MAXLOGRECORD && shortened.size())
+        {
+            size_t end = shortened.size() - min(shortened.size(), record.size() - MAXLOGRECORD);
+            while (end && ( (unsigned char)shortened[end - 1] & 0xC0 ) == 0x80)
+            {
+                end--; // not to leave a partial UTF-8 character
+            }
+            if (end && (unsigned char)shortened[end - 1] >= 0xC0)
+            {
+                end--;
+            }
+            shortened.resize(end);
+
+            record.clear();
+            encode(&record, monotonicTime, thread, petition, loglevel, megacmd, time, source, shortened.c_str());
+        }
+    }
+    buffer.push(record.data(), record.size());
+}
+
+bool MegaCmdLogFileSink::openFile()
+{
+    file.open(path.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    fileSize = 0;
+    fileOpenedAt = getMonotonicMicroSeconds();
+    if (format == FORMAT_BINARY)
+    {
+        string header(LOGFILEMAGIC);
+        appendInteger(&header, LOGFILEVERSION, 1);
+        appendInteger(&header, (unsigned long long)getWallClockMicroSeconds(), 8);
+        appendInteger(&header, (unsigned long long)fileOpenedAt, 8);
+        file.write(header.data(), header.size());
+        fileSize = header.size();
+    }
+    return true;
+}
+
+void MegaCmdLogFileSink::rotate()
+{
+    if (file.is_open())
+    {
+        file.close();
+    }
+
+    for (int i = rotations; i >= 1; i--)
+    {
+        ostringstream from;
+        from << path;
+        if (i > 1)
+        {
+            from << "." << (i - 1);
+        }
+        ostringstream to;
+        to << path << "." << i;
+
+        remove(to.str().c_str()); // rename does not replace it everywhere
+        rename(from.str().c_str(), to.str().c_str());
+    }
+    if (rotations <= 0)
+    {
+        remove(path.c_str());
+    }
+
+    openFile();
+}
+
+void *MegaCmdLogFileSink::writerEntry(void *param)
+{
+    ((MegaCmdLogFileSink *)param)->writeRecords();
+    return NULL;
+}
+
+void MegaCmdLogFileSink::writeRecords()
+{
+    string batch;
+    string record;
+
+    for (;; )
+    {
+        mtx.lock();
+        bool finishing = stopping;
+        mtx.unlock();
+
+        unsigned long long dropped = buffer.getDropped();
+        if (dropped != reportedDropped)
+        {
+            ostringstream report;
+            report << dropped - reportedDropped << " log lines dropped (buffer of " << buffer.getCapacity() << " records full)";
+            encode(&batch, getMonotonicMicroSeconds(), MegaThread::currentThreadId(), 0, MegaApi::LOG_LEVEL_WARNING,
+                   true, "", __FILE__, report.str().c_str());
+            reportedDropped = dropped;
+        }
+
+        bool written = false;
+        for (;; )
+        {
+            record.clear();
+            bool popped = buffer.pop(&record);
+            if (popped && (batch.size() + record.size() <= LOGFILEBATCH))
+            {
+                batch.append(record);
+                continue;
+            }
+
+            if (batch.size() && file.is_open())
+            {
+                bool tooOld = maxAge && (getMonotonicMicroSeconds() - fileOpenedAt >= maxAge);
+                if (tooOld || (fileSize && fileSize + (long long)batch.size() > maxSize))
+                {
+                    rotate();
+                }
+                file.write(batch.data(), batch.size());
+                fileSize += batch.size();
+                written = true;
+            }
+            batch.clear();
+
+            if (!popped)
+            {
+                break;
+            }
+            batch.append(record);
+        }
+
+        if (written && file.is_open())
+        {
+            file.flush();
+            continue;
+        }
+
+        if (finishing)
+        {
+            break; // stopping is read before popping: nothing was left behind
+        }
+        wakeup.timedwait(LOGFILEWRITEPERIOD);
+    }
+}
@@ -0,0 +1,133 @@
+/**
+ * @file src/megacmdlogsink.h
+ * @brief MEGAcmd: Structured log files with rotation
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDLOGSINK_H
+#define MEGACMDLOGSINK_H
+
+#include "megacmd.h"
+#include "megacmdlogringbuffer.h"
+
+#include <fstream>
+
+#define DEFAULTLOGFILEMAXSIZE 10485760 // bytes
+#define DEFAULTLOGFILEROTATIONS 5
+#define LOGFILEWRITEPERIOD 100 // ms to wait for more records once the buffer is empty
+#define LOGFILEBATCH 65536 // bytes written at once (at most, unless a record is longer)
+
+/*
+ * Binary format (all integers little endian):
+ *  file header: "MCMDLOG" 1 (version, 1 byte)
+ *               int64 wall clock time when the file was opened (microseconds since the epoch)
+ *               int64 monotonic time when the file was opened (microseconds)
+ *  records:     uint32 length of the rest of the record
+ *               int64 monotonic time (microseconds)
+ *               uint64 thread id
+ *               uint64 petition id (0: none)
+ *               uint8 log level
+ *               uint8 origin (0: MEGAcmd, 1: SDK)
+ *               uint16 length of the source
+ *               source ("file:line")
+ *               message (the rest of the record)
+ *
+ * The wall clock time of a record is the one in the header plus its monotonic time minus the one in the header.
+ */
+#define LOGFILEMAGIC "MCMDLOG"
+#define LOGFILEVERSION 1
+#define LOGFILEHEADERSIZE 24
+#define LOGRECORDFIXEDSIZE 28 // without the length
+
+/**
+ * @brief Writes log lines to a file as JSON lines or binary records, with the level, source,
+ * thread, petition and monotonic time of each line.
+ *
+ * Records are encoded by the threads logging and queued: a thread of its own writes them and
+ * rotates the file when it reaches a size or an age (file -> file.1 -> file.2 ...), so that
+ * logging never waits for the disk. Records that do not fit in the queue are dropped (and their
+ * number written to the file).
+ */
+class MegaCmdLogFileSink
+{
+public:
+    enum
+    {
+        FORMAT_JSON = 0,
+        FORMAT_BINARY
+    };
+
+private:
+    std::string path;
+    int format;
+    long long maxSize;
+    long long maxAge; // microseconds, 0: no rotation by age
+    int rotations;
+
+    MegaCmdLogRingBuffer buffer;
+    mega::MegaThread writer;
+    mega::MegaSemaphore wakeup;
+    mega::MegaMutex mtx;
+    bool stopping;
+    bool started; // whether the writer thread was started (it may close the file on its own)
+
+    // only used by the writer thread (or before it starts)
+    std::ofstream file;
+    long long fileSize;
+    long long fileOpenedAt;
+    unsigned long long reportedDropped;
+
+    static void *writerEntry(void *param);
+    void writeRecords();
+    bool openFile();
+    void rotate();
+    void encode(std::string *record, long long monotonicTime, unsigned long long thread, unsigned long long petition,
+                int loglevel, bool megacmd, const char *time, const char *source, const char *message);
+
+public:
+    /**
+     * @param path file to write (rotated files get a suffix)
+     * @param format FORMAT_JSON or FORMAT_BINARY
+     * @param maxSize size in bytes after which the file is rotated
+     * @param maxAge seconds after which the file is rotated, 0 for none
+     * @param rotations number of rotated files to keep
+     * @param records number of records that can be queued
+     */
+    MegaCmdLogFileSink(std::string path, int format, long long maxSize, int maxAge, int rotations, unsigned int records);
+    ~MegaCmdLogFileSink();
+
+    /**
+     * @brief Starts writing to the file (a previous one is rotated first)
+     * @return false if the file cannot be opened
+     */
+    bool start();
+
+    /**
+     * @brief Queues a log line. Can be called from any thread
+     * @param megacmd whether it comes from MEGAcmd or the SDK
+     * @param petition id of the petition being processed by the thread logging, 0 if none
+     */
+    void log(const char *time, int loglevel, const char *source, const char *message, bool megacmd, unsigned long long petition);
+
+    unsigned long long getDropped();
+    std::string getPath();
+
+    /**
+     * @return the format named ("json" or "binary"), -1 if unknown
+     */
+    static int getFormat(std::string name);
+};
+
+#endif // MEGACMDLOGSINK_H
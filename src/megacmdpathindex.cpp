@@ -0,0 +1,298 @@
+/**
+ * @file src/megacmdpathindex.cpp
+ * @brief MEGAcmd: Index of the names of the children of remote folders
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdpathindex.h"
+#include "megacmdlogger.h"
+#include "megacmdutils.h"
+
+using namespace std;
+using namespace mega;
+
+MegaCmdPathIndex::MegaCmdPathIndex(MegaApi *api)
+{
+    this->api = api;
+    generation = 0;
+    hits = 0;
+    misses = 0;
+    mtx.init(false);
+}
+
+MegaCmdPathIndex::folderindex *MegaCmdPathIndex::getFolderIndex(MegaNode *folder, bool *temporary)
+{
+    *temporary = false;
+    MegaHandle h = folder->getHandle();
+    map<MegaHandle, folderindex *>::iterator it = folders.find(h);
+    if (it != folders.end())
+    {
+        hits++;
+        return it->second;
+    }
+    misses++;
+
+    unsigned long long startGeneration = generation;
+    mtx.unlock();
+
+    folderindex *fi = new folderindex;
+    MegaNodeList *children = api->getChildren(folder);
+    if (children)
+    {
+        fi->children.reserve(children->size());
+        for (int i = 0; i < children->size(); i++)
+        {
+            MegaNode *child = children->get(i);
+            string name = escapeNodeName(child->getName() ? child->getName() : "");
+            fi->positionsByName.insert(make_pair(name, fi->children.size()));
+            fi->children.push_back(make_pair(name, child->getHandle()));
+        }
+        delete children;
+    }
+
+    mtx.lock();
+
+    it = folders.find(h);
+    if (it != folders.end())
+    {
+        // indexed by someone else meanwhile
+        delete fi;
+        return it->second;
+    }
+
+    if (generation != startGeneration)
+    {
+        // nodes were updated while listing the children: this might be already outdated
+        *temporary = true;
+        return fi;
+    }
+
+    if (folders.size() >= MAXINDEXEDFOLDERS)
+    {
+        LOG_debug << "Path index reached " << folders.size() << " folders. Hits: " << hits << " misses: " << misses << ". Discarding it";
+        clearIndex();
+    }
+
+    folders[h] = fi;
+    for (unsigned int i = 0; i < fi->children.size(); i++)
+    {
+        parents[fi->children[i].second] = h;
+    }
+    return fi;
+}
+
+void MegaCmdPathIndex::forgetFolder(MegaHandle folder)
+{
+    map<MegaHandle, folderindex *>::iterator it = folders.find(folder);
+    if (it == folders.end())
+    {
+        return;
+    }
+
+    folderindex *fi = it->second;
+    for (unsigned int i = 0; i < fi->children.size(); i++)
+    {
+        map<MegaHandle, MegaHandle>::iterator itparent = parents.find(fi->children[i].second);
+        if (itparent != parents.end() && itparent->second == folder)
+        {
+            parents.erase(itparent);
+        }
+    }
+    delete fi;
+    folders.erase(it);
+}
+
+void MegaCmdPathIndex::clearIndex()
+{
+    for (map<MegaHandle, folderindex *>::iterator it = folders.begin(); it != folders.end(); it++)
+    {
+        delete it->second;
+    }
+    folders.clear();
+    parents.clear();
+}
+
+MegaNode *MegaCmdPathIndex::getChildNode(MegaNode *folder, const string &name)
+{
+    vector<MegaHandle> handles = getChildrenByName(folder, name);
+    for (unsigned int i = 0; i < handles.size(); i++)
+    {
+        MegaNode *child = api->getNodeByHandle(handles[i]);
+        if (child)
+        {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+vector<MegaHandle> MegaCmdPathIndex::getChildrenByName(MegaNode *folder, const string &name)
+{
+    vector<MegaHandle> toret;
+    if (!folder)
+    {
+        return toret;
+    }
+
+    string escapedName = escapeNodeName(name);
+    mtx.lock();
+    bool temporary;
+    folderindex *fi = getFolderIndex(folder, &temporary);
+
+    // positions, to keep the order of the children
+    set<size_t> positions;
+    pair<multimap<string, size_t>::iterator, multimap<string, size_t>::iterator> range = fi->positionsByName.equal_range(escapedName);
+    for (multimap<string, size_t>::iterator it = range.first; it != range.second; it++)
+    {
+        positions.insert(it->second);
+    }
+    for (set<size_t>::iterator it = positions.begin(); it != positions.end(); it++)
+    {
+        toret.push_back(fi->children[*it].second);
+    }
+
+    if (temporary)
+    {
+        delete fi;
+    }
+    mtx.unlock();
+    return toret;
+}
+
+void MegaCmdPathIndex::getChildren(MegaNode *folder, indexedchildren_t *children)
+{
+    children->clear();
+    if (!folder)
+    {
+        return;
+    }
+
+    mtx.lock();
+    bool temporary;
+    folderindex *fi = getFolderIndex(folder, &temporary);
+    *children = fi->children;
+    if (temporary)
+    {
+        delete fi;
+    }
+    mtx.unlock();
+}
+
+void MegaCmdPathIndex::onNodesUpdate(MegaNodeList *nodes)
+{
+    mtx.lock();
+    generation++;
+
+    if (!nodes)
+    {
+        clearIndex();
+        mtx.unlock();
+        return;
+    }
+
+    for (int i = 0; i < nodes->size(); i++)
+    {
+        MegaNode *n = nodes->get(i);
+
+        // the folder it was in (in case it has been moved) and the one it is in now
+        map<MegaHandle, MegaHandle>::iterator itparent = parents.find(n->getHandle());
+        if (itparent != parents.end())
+        {
+            forgetFolder(itparent->second);
+        }
+        forgetFolder(n->getParentHandle());
+
+        if (n->isRemoved())
+        {
+            forgetFolder(n->getHandle());
+        }
+    }
+    mtx.unlock();
+}
+
+void MegaCmdPathIndex::onRequestFinish(MegaRequest *request, MegaError *e)
+{
+    if (!request || !e || e->getErrorCode() != MegaError::API_OK)
+    {
+        return;
+    }
+
+    MegaHandle node = UNDEF;
+    MegaHandle newParent = UNDEF;
+    switch (request->getType())
+    {
+        case MegaRequest::TYPE_CREATE_FOLDER:
+        case MegaRequest::TYPE_COPY:
+        case MegaRequest::TYPE_IMPORT_LINK:
+            newParent = request->getParentHandle();
+            break;
+        case MegaRequest::TYPE_MOVE:
+            node = request->getNodeHandle();
+            newParent = request->getParentHandle();
+            break;
+        case MegaRequest::TYPE_RENAME:
+        case MegaRequest::TYPE_REMOVE:
+            node = request->getNodeHandle();
+            break;
+        default:
+            return;
+    }
+
+    mtx.lock();
+    generation++;
+    if (node != UNDEF)
+    {
+        map<MegaHandle, MegaHandle>::iterator itparent = parents.find(node);
+        if (itparent != parents.end())
+        {
+            forgetFolder(itparent->second);
+        }
+        if (request->getType() == MegaRequest::TYPE_REMOVE)
+        {
+            forgetFolder(node);
+        }
+    }
+    if (newParent != UNDEF)
+    {
+        forgetFolder(newParent);
+    }
+    mtx.unlock();
+}
+
+void MegaCmdPathIndex::onTransferFinish(MegaTransfer *transfer, MegaError *e)
+{
+    if (!transfer || transfer->getType() != MegaTransfer::TYPE_UPLOAD || !e || e->getErrorCode() != MegaError::API_OK)
+    {
+        return;
+    }
+
+    mtx.lock();
+    generation++;
+    forgetFolder(transfer->getParentHandle());
+    mtx.unlock();
+}
+
+void MegaCmdPathIndex::clear()
+{
+    mtx.lock();
+    generation++;
+    clearIndex();
+    mtx.unlock();
+}
+
+MegaCmdPathIndex::~MegaCmdPathIndex()
+{
+    clear();
+}
@@ -0,0 +1,114 @@
+/**
+ * @file src/megacmdpathindex.h
+ * @brief MEGAcmd: Index of the names of the children of remote folders
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDPATHINDEX_H
+#define MEGACMDPATHINDEX_H
+
+#include "megacmd.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define MAXINDEXEDFOLDERS 50000
+
+typedef std::vector<std::pair<std::string, mega::MegaHandle> > indexedchildren_t;
+
+/**
+ * @brief Name to handle index of the children of the folders walked when resolving paths
+ *
+ * Folders are indexed the first time they are looked into and forgotten whenever any of their
+ * children changes (see onNodesUpdate, onRequestFinish and onTransferFinish), to be indexed again on demand.
+ * Children keep the order of MegaApi::getChildren. Names may be repeated. They are kept escaped
+ * (see escapeNodeName), as they appear in the paths built from them, while the names looked up are not.
+ */
+class MegaCmdPathIndex
+{
+private:
+    typedef struct folderindex_struct
+    {
+        indexedchildren_t children;
+        std::multimap<std::string, size_t> positionsByName;
+    } folderindex;
+
+    mega::MegaApi *api;
+    std::map<mega::MegaHandle, folderindex *> folders;
+    std::map<mega::MegaHandle, mega::MegaHandle> parents; // of the indexed children
+    mega::MegaMutex mtx;
+    unsigned long long generation; // to discard indexes built while updates were received
+
+    long long hits;
+    long long misses;
+
+    /**
+     * @brief Returns the index of a folder, building it if required. mtx must be locked:
+     * it is unlocked while querying the api
+     * @param temporary will be set to true when the index could not be kept: the caller must delete it
+     */
+    folderindex *getFolderIndex(mega::MegaNode *folder, bool *temporary);
+
+    // the following require mtx to be locked
+    void forgetFolder(mega::MegaHandle folder);
+    void clearIndex();
+
+public:
+    MegaCmdPathIndex(mega::MegaApi *api);
+    ~MegaCmdPathIndex();
+
+    /**
+     * @brief Gets the first child of folder with that name
+     * @return the child (to be deleted by the caller) or NULL if there is none
+     */
+    mega::MegaNode *getChildNode(mega::MegaNode *folder, const std::string &name);
+
+    /**
+     * @brief Gets the handles of the children of folder with that name
+     */
+    std::vector<mega::MegaHandle> getChildrenByName(mega::MegaNode *folder, const std::string &name);
+
+    /**
+     * @brief Gets the (escaped) names and handles of all the children of folder
+     */
+    void getChildren(mega::MegaNode *folder, indexedchildren_t *children);
+
+    /**
+     * @brief Forgets the folders affected by the nodes updated
+     * @param nodes nodes updated or NULL when everything should be considered outdated
+     */
+    void onNodesUpdate(mega::MegaNodeList *nodes);
+
+    /**
+     * @brief Forgets the folders affected by a request that changed the tree
+     *
+     * Called when any request finishes, before its own listener is notified, so that the paths
+     * resolved right after createFolder, moveNode, renameNode, copyNode, importFileLink or remove
+     * are not stale even if the corresponding nodes update has not been received yet.
+     */
+    void onRequestFinish(mega::MegaRequest *request, mega::MegaError *e);
+
+    /**
+     * @brief Forgets the folder an upload has just put its node into, as onRequestFinish does for requests
+     */
+    void onTransferFinish(mega::MegaTransfer *transfer, mega::MegaError *e);
+
+    void clear();
+};
+
+#endif // MEGACMDPATHINDEX_H
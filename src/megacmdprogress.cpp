@@ -0,0 +1,265 @@
+/**
+ * @file src/megacmdprogress.cpp
+ * @brief MEGAcmd: Coalescing of the progress of transfers and requests
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdprogress.h"
+#include "megacmdlogger.h"
+#include "megacmdutils.h"
+
+#include <stdio.h>
+
+using namespace std;
+using namespace mega;
+
+MegaCmdProgressAggregator::MegaCmdProgressAggregator(progresssender_t sender, int frequency)
+{
+    this->sender = sender;
+    period = frequency > 0 ? std::max(1, 1000 / frequency) : 0;
+    barPending = false;
+    stopping = false;
+    running = false;
+    cols = 0;
+    colsTime = 0;
+    updates = 0;
+    sent = 0;
+    mtx.init(false);
+    mtxSend.init(false);
+}
+
+MegaCmdProgressAggregator::~MegaCmdProgressAggregator()
+{
+    stop();
+}
+
+void MegaCmdProgressAggregator::start()
+{
+    mtx.lock();
+    bool toStart = period && !running && !stopping;
+    running = running || toStart;
+    mtx.unlock();
+    if (toStart)
+    {
+        thread.start(threadEntry, this);
+    }
+}
+
+void MegaCmdProgressAggregator::stop()
+{
+    mtx.lock();
+    bool wasStopping = stopping;
+    stopping = true;
+    mtx.unlock();
+    if (wasStopping)
+    {
+        return;
+    }
+
+    mtx.lock();
+    bool wasRunning = running;
+    mtx.unlock();
+    if (wasRunning)
+    {
+        wakeup.release();
+        thread.join();
+    }
+    flush();
+
+    mtxSend.lock();
+    mtx.lock();
+    if (updates)
+    {
+        LOG_debug << "Progress updates: " << updates << " received, " << sent << " sent";
+    }
+    mtx.unlock();
+    mtxSend.unlock();
+}
+
+void *MegaCmdProgressAggregator::threadEntry(void *param)
+{
+    ((MegaCmdProgressAggregator *)param)->loop();
+    return NULL;
+}
+
+void MegaCmdProgressAggregator::loop()
+{
+    for (;; )
+    {
+        wakeup.timedwait(period);
+
+        mtx.lock();
+        bool finishing = stopping;
+        mtx.unlock();
+        if (finishing)
+        {
+            return; // what is left is flushed by stop
+        }
+        flush();
+    }
+}
+
+void MegaCmdProgressAggregator::flush()
+{
+    mtxSend.lock();
+    mtx.lock();
+    map<int, progressupdate> toSend;
+    toSend.swap(pending);
+    bool drawBar = barPending;
+    progressupdate toDraw;
+    if (drawBar)
+    {
+        toDraw = bar;
+        barPending = false;
+    }
+    mtx.unlock();
+
+    for (map<int, progressupdate>::iterator it = toSend.begin(); it != toSend.end(); it++)
+    {
+        send(it->first, it->second);
+    }
+    if (drawBar)
+    {
+        draw(toDraw, false);
+    }
+    mtxSend.unlock();
+}
+
+void MegaCmdProgressAggregator::send(int clientID, const progressupdate &update)
+{
+    sender(update.transferred, update.total, clientID, update.title, update.hasSnapshot ? &update.snapshot : NULL);
+    sent++;
+}
+
+void MegaCmdProgressAggregator::draw(const progressupdate &update, bool final)
+{
+    string line = formatBar(update.title, update.transferred, update.total, getCols());
+    if (final)
+    {
+        std::cout << line << std::endl;
+    }
+    else
+    {
+        std::cout << line << '\r' << std::flush;
+    }
+}
+
+unsigned int MegaCmdProgressAggregator::getCols()
+{
+    long long now = getMonotonicMicroSeconds();
+    if (!colsTime || now - colsTime >= PROGRESSCOLSREFRESH)
+    {
+        cols = getNumberOfCols(80);
+        colsTime = now;
+    }
+    return cols;
+}
+
+void MegaCmdProgressAggregator::update(int clientID, long long transferred, long long total, string title)
+{
+    progressupdate u;
+    u.transferred = transferred;
+    u.total = total;
+    u.title = title;
+    u.hasSnapshot = false;
+    update(clientID, u);
+}
+
+void MegaCmdProgressAggregator::update(int clientID, const transfersnapshot &snapshot)
+{
+    progressupdate u;
+    u.transferred = snapshot.transferredBytes;
+    u.total = snapshot.totalBytes;
+    u.hasSnapshot = true;
+    u.snapshot = snapshot;
+    update(clientID, u);
+}
+
+void MegaCmdProgressAggregator::update(int clientID, const progressupdate &u)
+{
+    mtx.lock();
+    updates++;
+    bool discard = stopping;
+    if (!discard && running && u.transferred != PROGRESS_COMPLETE)
+    {
+        pending[clientID] = u;
+        mtx.unlock();
+        return;
+    }
+    mtx.unlock();
+
+    if (discard)
+    {
+        return;
+    }
+
+    mtxSend.lock();
+    mtx.lock();
+    pending.erase(clientID); // former progress must not come after this
+    mtx.unlock();
+    send(clientID, u);
+    mtxSend.unlock();
+}
+
+void MegaCmdProgressAggregator::updateBar(string title, long long transferred, long long total, bool final)
+{
+    progressupdate u;
+    u.transferred = transferred;
+    u.total = total;
+    u.title = title;
+    u.hasSnapshot = false;
+
+    mtx.lock();
+    if (!final && running && !stopping)
+    {
+        bar = u;
+        barPending = true;
+        mtx.unlock();
+        return;
+    }
+    mtx.unlock();
+
+    mtxSend.lock();
+    mtx.lock();
+    barPending = false;
+    mtx.unlock();
+    draw(u, final);
+    mtxSend.unlock();
+}
+
+string MegaCmdProgressAggregator::formatBar(string title, long long transferred, long long total, unsigned int cols)
+{
+    float percent = 0;
+    if (total > 0)
+    {
+        percent = float(transferred * 1.0 / total * 100.0);
+    }
+    percent = std::max(0.0f, std::min(100.0f, percent));
+
+    string prefix = title + " ||";
+    char aux[60];
+    sprintf(aux, "||(%lld/%lld MB: %.2f %%) ", transferred / 1024 / 1024, total / 1024 / 1024, percent);
+    size_t auxLength = strlen(aux);
+    cols = std::max(cols, (unsigned int)(prefix.size() + auxLength + 1));
+
+    string outputString(cols, '.');
+    outputString.replace(0, prefix.size(), prefix);
+    outputString.replace(cols - auxLength, auxLength, aux);
+    for (unsigned int i = 0; i <= ( cols - prefix.size() - auxLength) * 1.0 * percent / 100.0 && prefix.size() + i < cols - auxLength; i++)
+    {
+        outputString[prefix.size() + i] = '#';
+    }
+    return outputString;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file src/megacmdprogress.h
+ * @brief MEGAcmd: Coalescing of the progress of transfers and requests
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDPROGRESS_H
+#define MEGACMDPROGRESS_H
+
+#include "megacmd.h"
+
+#include <map>
+
+#define DEFAULTPROGRESSFREQUENCY 10 // updates per second
+#define PROGRESSCOLSREFRESH 1000000 // microseconds the width of the terminal is kept
+
+typedef void (*progresssender_t)(long long transferred, long long total, int clientID, std::string title, const transfersnapshot *snapshot);
+
+/**
+ * @brief Coalesces the progress informed to the clients and drawn in the console
+ *
+ * SDK callbacks only keep the last progress of every client (and of the progress bar): a thread
+ * of its own sends them and draws the bar a number of times per second. Completions (and the
+ * last state of the bar) are not delayed: they are sent right away, after the pending updates
+ * of the client are discarded, so that no former progress can arrive after them.
+ */
+class MegaCmdProgressAggregator
+{
+private:
+    typedef struct progressupdate_struct
+    {
+        long long transferred;
+        long long total;
+        std::string title;
+        bool hasSnapshot;
+        transfersnapshot snapshot;
+    } progressupdate;
+
+    progresssender_t sender;
+    int period; // milliseconds between updates, 0 to send them right away
+
+    std::map<int, progressupdate> pending; // by client
+    progressupdate bar;
+    bool barPending;
+    bool running;
+    bool stopping;
+    long long updates;
+    mega::MegaMutex mtx; // protects the above
+    mega::MegaMutex mtxSend; // to send (and draw) in order
+
+    mega::MegaThread thread;
+    mega::MegaSemaphore wakeup;
+
+    // protected by mtxSend
+    unsigned int cols;
+    long long colsTime;
+    long long sent;
+
+    static void *threadEntry(void *param);
+    void loop();
+    void flush();
+    void update(int clientID, const progressupdate &u);
+
+    // the following require mtxSend to be locked
+    void send(int clientID, const progressupdate &update);
+    void draw(const progressupdate &update, bool final);
+    unsigned int getCols();
+
+public:
+    /**
+     * @param sender sends an update to a client
+     * @param frequency updates per second, 0 (or less) to send each of them right away
+     */
+    MegaCmdProgressAggregator(progresssender_t sender, int frequency);
+    ~MegaCmdProgressAggregator();
+
+    void start();
+
+    /**
+     * @brief Sends what is pending and discards what comes afterwards
+     */
+    void stop();
+
+    /**
+     * @brief Informs the progress of a client (PROGRESS_COMPLETE as transferred for the completion)
+     */
+    void update(int clientID, long long transferred, long long total, std::string title = "");
+
+    /**
+     * @brief Informs the progress of a set of transfers of a client
+     */
+    void update(int clientID, const transfersnapshot &snapshot);
+
+    /**
+     * @brief Updates the progress bar drawn in the console
+     * @param final whether this is the last state of the bar (drawn right away, ending the line)
+     */
+    void updateBar(std::string title, long long transferred, long long total, bool final);
+
+    /**
+     * @brief Formats a progress bar as "TITLE ||####......||(x/y MB: z %) "
+     */
+    static std::string formatBar(std::string title, long long transferred, long long total, unsigned int cols);
+};
+
+#endif // MEGACMDPROGRESS_H
@@ -0,0 +1,73 @@
+/**
+ * @file src/megacmdprotocol.h
+ * @brief MEGAcmd: Framing of the petitions exchanged between the clients and the server
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDPROTOCOL_H
+#define MEGACMDPROTOCOL_H
+
+#include <stdint.h>
+
+/**
+ * Protocol v2: a petition starts with MCMD_PROTOCOL_V2_MAGIC followed by the length of the command (uint32_t)
+ * and the command itself. Everything is answered through that same connection using frames:
+ * a mcmdframeheader followed by "length" bytes of payload.
+ * When a confirmation is required, a MCMD_FRAME_CONFIRMATION frame carries the question and the client
+ * answers with an int (confirmresponse).
+ * Output may be streamed as it is produced in MCMD_FRAME_OUTPUT frames. The last frame is always a
+ * MCMD_FRAME_RESPONSE (the trailer), with the rest of the output and the outcode of the command.
+ *
+ * Sessions: a connection that starts with MCMD_PROTOCOL_SESSION_MAGIC is kept open and accepted
+ * with a MCMD_FRAME_SESSION frame. From then on, both ends exchange mcmdsessionframeheader frames
+ * (followed by "length" bytes of payload). The client sends MCMD_FRAME_REQUEST frames with ids of
+ * its choice and may have several of them in flight. Responses and confirmations carry the id of
+ * the request they belong to, and are answered with MCMD_FRAME_CONFIRMATION_RESPONSE frames
+ * (the response goes in the outcode field).
+ *
+ * The server drops connections that announce petitions (or session frames) longer than
+ * MCMD_MAX_PETITION_SIZE.
+ */
+#define MCMD_PROTOCOL_V2_MAGIC "\0MC2"
+#define MCMD_PROTOCOL_SESSION_MAGIC "\0MCS"
+#define MCMD_PROTOCOL_V2_MAGIC_SIZE 4
+#define MCMD_MAX_PETITION_SIZE (1024 * 1024)
+
+enum
+{
+    MCMD_FRAME_RESPONSE = 1,     ///< Trailer: (rest of the) output of the command. Outcode is final
+    MCMD_FRAME_CONFIRMATION = 2, ///< Confirmation required. Payload contains the question
+    MCMD_FRAME_REQUEST = 3,      ///< (session) Command to execute
+    MCMD_FRAME_CONFIRMATION_RESPONSE = 4, ///< (session) Response to a confirmation
+    MCMD_FRAME_SESSION = 5,      ///< (session) Session accepted
+    MCMD_FRAME_OUTPUT = 6,       ///< Chunk of output. Outcode is meaningless
+};
+
+typedef struct mcmdframeheader_struct
+{
+    int32_t type;
+    int32_t outcode;
+    uint32_t length;
+} mcmdframeheader;
+
+typedef struct mcmdsessionframeheader_struct
+{
+    uint32_t requestId;
+    int32_t type;
+    int32_t outcode;
+    uint32_t length;
+} mcmdsessionframeheader;
+
+#endif // MEGACMDPROTOCOL_H
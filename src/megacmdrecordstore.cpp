@@ -0,0 +1,411 @@
+/**
+ * @file src/megacmdrecordstore.cpp
+ * @brief MEGAcmd: Journaled files of records (e.g. the configured syncs and backups)
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdrecordstore.h"
+#include "megacmdutils.h"
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace mega;
+
+/**
+ * @brief Maps a file into memory to read it
+ * @param exists set to whether the file exists
+ * @return the contents of the file, NULL if it is empty or could not be mapped
+ */
+static const char *mapFile(const string &path, size_t *size, bool *exists)
+{
+    *size = 0;
+    *exists = false;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+    *exists = true;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || !fileSize.QuadPart)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return NULL;
+    }
+    const char *data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data)
+    {
+        *size = (size_t)fileSize.QuadPart;
+    }
+    return data;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    *exists = true;
+
+    struct stat st;
+    if (fstat(fd, &st) || !st.st_size)
+    {
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *size = st.st_size;
+    return (const char *)data;
+#endif
+}
+
+static void unmapFile(const char *data, size_t size)
+{
+    if (!data)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+MegaCmdRecordStore::MegaCmdRecordStore(string path, unsigned int recordType)
+{
+    this->path = path;
+    this->recordType = recordType;
+    fileValid = false;
+    journalEntries = 0;
+}
+
+string MegaCmdRecordStore::getPath()
+{
+    return path;
+}
+
+unsigned int MegaCmdRecordStore::crc32(const char *data, size_t size, unsigned int crc)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= (unsigned char)data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+void MegaCmdRecordStore::appendInteger(string *data, unsigned long long value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        data->append(1, (char)((value >> (8 * i)) & 0xFF));
+    }
+}
+
+unsigned long long MegaCmdRecordStore::readInteger(const char *data, int bytes)
+{
+    unsigned long long value = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+    {
+        value = (value << 8) | (unsigned char)data[i];
+    }
+    return value;
+}
+
+unsigned int MegaCmdRecordStore::parse(const char *data, size_t size, unsigned int recordType,
+                                       map<string, string> *records, unsigned int *journalEntries)
+{
+    size_t magicLength = strlen(RECORDSTOREMAGIC);
+    if (size < RECORDSTOREHEADERSIZE || memcmp(data, RECORDSTOREMAGIC, magicLength))
+    {
+        return STORE_UNKNOWN_FORMAT;
+    }
+
+    if (readInteger(data + 28, 4) != crc32(data, 28))
+    {
+        LOG_err << "Corrupt header";
+        return STORE_CORRUPT;
+    }
+    unsigned int version = (unsigned int)readInteger(data + 8, 4);
+    unsigned int type = (unsigned int)readInteger(data + 12, 4);
+    unsigned int count = (unsigned int)readInteger(data + 16, 4);
+    size_t snapshotLength = (size_t)readInteger(data + 20, 4);
+    if (version != RECORDSTOREVERSION || type != recordType)
+    {
+        LOG_err << "Unexpected version " << version << " or type of records " << type;
+        return STORE_CORRUPT;
+    }
+    if (snapshotLength > size - RECORDSTOREHEADERSIZE
+            || readInteger(data + 24, 4) != crc32(data + RECORDSTOREHEADERSIZE, snapshotLength))
+    {
+        LOG_err << "Corrupt snapshot";
+        return STORE_CORRUPT;
+    }
+
+    const char *p = data + RECORDSTOREHEADERSIZE;
+    const char *snapshotEnd = p + snapshotLength;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (snapshotEnd - p < 8)
+        {
+            return STORE_CORRUPT;
+        }
+        size_t keyLength = (size_t)readInteger(p, 4);
+        size_t valueLength = (size_t)readInteger(p + 4, 4);
+        p += 8;
+        if ((size_t)(snapshotEnd - p) < keyLength + valueLength)
+        {
+            return STORE_CORRUPT;
+        }
+        (*records)[string(p, keyLength)] = string(p + keyLength, valueLength);
+        p += keyLength + valueLength;
+    }
+
+    // the journal: the last entry might have been cut by a crash
+    const char *end = data + size;
+    p = snapshotEnd;
+    while (p < end)
+    {
+        (*journalEntries)++;
+        if (end - p < 13)
+        {
+            break;
+        }
+        int operation = (int)readInteger(p, 1);
+        size_t keyLength = (size_t)readInteger(p + 1, 4);
+        size_t valueLength = (size_t)readInteger(p + 5, 4);
+        if ((size_t)(end - p) < 13 + keyLength + valueLength
+                || readInteger(p + 9 + keyLength + valueLength, 4) != crc32(p, 9 + keyLength + valueLength))
+        {
+            LOG_warn << "Discarding an incomplete change at the end of the journal";
+            break;
+        }
+
+        string key(p + 9, keyLength);
+        if (operation == RECORDSTOREPUT)
+        {
+            (*records)[key] = string(p + 9 + keyLength, valueLength);
+        }
+        else if (operation == RECORDSTOREREMOVE)
+        {
+            records->erase(key);
+        }
+        p += 13 + keyLength + valueLength;
+    }
+    return STORE_OK;
+}
+
+int MegaCmdRecordStore::load(map<string, string> *records)
+{
+    fileValid = false;
+    journalEntries = 0;
+
+    size_t size;
+    bool exists;
+    const char *data = mapFile(path, &size, &exists);
+    if (!exists)
+    {
+        return STORE_MISSING;
+    }
+
+    map<string, string> read;
+    unsigned int result = data ? parse(data, size, recordType, &read, &journalEntries) : STORE_UNKNOWN_FORMAT;
+    unmapFile(data, size);
+
+    if (result == STORE_UNKNOWN_FORMAT)
+    {
+        return result;
+    }
+
+    records->insert(read.begin(), read.end());
+    if (result == STORE_CORRUPT)
+    {
+        // keep it for inspection and start over with what could be read
+        string corruptPath = path + ".corrupt";
+        remove(corruptPath.c_str());
+        rename(path.c_str(), corruptPath.c_str());
+        LOG_err << "Unable to read " << path << " entirely. Kept as " << corruptPath;
+        compact(read);
+        return result;
+    }
+
+    fileValid = true;
+    if (journalEntries)
+    {
+        compact(read);
+    }
+    remove(( path + ".bak" ).c_str()); // no longer needed, if there was one
+    return STORE_OK;
+}
+
+void MegaCmdRecordStore::diff(const map<string, string> &former, const map<string, string> &current, set<string> *changed)
+{
+    map<string, string>::const_iterator it = current.begin();
+    map<string, string>::const_iterator old = former.begin();
+    while (it != current.end() || old != former.end())
+    {
+        if (old == former.end() || (it != current.end() && it->first < old->first))
+        {
+            changed->insert(it->first); // new
+            ++it;
+        }
+        else if (it == current.end() || old->first < it->first)
+        {
+            changed->insert(old->first); // removed
+            ++old;
+        }
+        else
+        {
+            if (it->second != old->second)
+            {
+                changed->insert(it->first);
+            }
+            ++it;
+            ++old;
+        }
+    }
+}
+
+bool MegaCmdRecordStore::save(const map<string, string> &records, const set<string> &changed)
+{
+    unsigned int changes = (unsigned int)changed.size();
+    if (!fileValid || journalEntries + changes > max((size_t)RECORDSTOREMINJOURNAL, records.size()))
+    {
+        return compact(records);
+    }
+    if (!changes)
+    {
+        return true;
+    }
+
+    string entries;
+    for (set<string>::const_iterator key = changed.begin(); key != changed.end(); ++key)
+    {
+        map<string, string>::const_iterator it = records.find(*key);
+        const string *value = it != records.end() ? &it->second : NULL;
+
+        string entry;
+        appendInteger(&entry, value ? RECORDSTOREPUT : RECORDSTOREREMOVE, 1);
+        appendInteger(&entry, key->size(), 4);
+        appendInteger(&entry, value ? value->size() : 0, 4);
+        entry.append(*key);
+        if (value)
+        {
+            entry.append(*value);
+        }
+        appendInteger(&entry, crc32(entry.data(), entry.size()), 4);
+        entries.append(entry);
+    }
+
+    FILE *fo = fopen(path.c_str(), "ab");
+    bool written = fo != NULL;
+    if (written)
+    {
+        written = fwrite(entries.data(), 1, entries.size(), fo) == entries.size() && flushFileToDisk(fo);
+        written = !fclose(fo) && written;
+    }
+    if (!written)
+    {
+        LOG_err << "Unable to append to " << path;
+        return compact(records);
+    }
+
+    journalEntries += changes;
+    return true;
+}
+
+bool MegaCmdRecordStore::compact(const map<string, string> &records)
+{
+    string snapshot;
+    for (map<string, string>::const_iterator it = records.begin(); it != records.end(); ++it)
+    {
+        appendInteger(&snapshot, it->first.size(), 4);
+        appendInteger(&snapshot, it->second.size(), 4);
+        snapshot.append(it->first);
+        snapshot.append(it->second);
+    }
+
+    string contents(RECORDSTOREMAGIC);
+    appendInteger(&contents, RECORDSTOREVERSION, 4);
+    appendInteger(&contents, recordType, 4);
+    appendInteger(&contents, records.size(), 4);
+    appendInteger(&contents, snapshot.size(), 4);
+    appendInteger(&contents, crc32(snapshot.data(), snapshot.size()), 4);
+    appendInteger(&contents, crc32(contents.data(), contents.size()), 4);
+    contents.append(snapshot);
+
+    if (!writeFileAtomically(path, contents, true))
+    {
+        LOG_err << "Unable to write " << path;
+        fileValid = false;
+        return false;
+    }
+
+    fileValid = true;
+    journalEntries = 0;
+    return true;
+}
+
+bool MegaCmdRecordStore::backupFile()
+{
+    size_t size;
+    bool exists;
+    const char *data = mapFile(path, &size, &exists);
+    if (!exists)
+    {
+        return false;
+    }
+    string contents;
+    if (data)
+    {
+        contents.assign(data, size);
+    }
+    unmapFile(data, size);
+
+    string backupPath = path + ".bak";
+    if (!writeFileAtomically(backupPath, contents, true))
+    {
+        LOG_err << "Unable to write " << backupPath;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file src/megacmdrecordstore.h
+ * @brief MEGAcmd: Journaled files of records (e.g. the configured syncs and backups)
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDRECORDSTORE_H
+#define MEGACMDRECORDSTORE_H
+
+#include <map>
+#include <set>
+#include <string>
+
+/*
+ * File format (all integers little endian):
+ *  header:   "MCMDSTOR"
+ *            uint32 format version
+ *            uint32 type of records (whose layout is up to the user of the store)
+ *            uint32 number of records in the snapshot
+ *            uint32 length of the snapshot
+ *            uint32 CRC-32 of the snapshot
+ *            uint32 CRC-32 of the header (the previous 28 bytes)
+ *  snapshot: records: uint32 length of the key, uint32 length of the value, key, value
+ *  journal:  changes made after the snapshot was written, each one:
+ *            uint8 operation (RECORDSTOREPUT or RECORDSTOREREMOVE)
+ *            uint32 length of the key, uint32 length of the value (0 to remove), key, value
+ *            uint32 CRC-32 of the previous fields
+ *
+ * Changes are appended to the journal (and flushed to disk), so that a crash can only lose
+ * the last one (which is detected by its CRC and ignored). Once the journal grows too long, the records are
+ * written to a new file with everything in its snapshot, which replaces the former one.
+ */
+#define RECORDSTOREMAGIC "MCMDSTOR"
+#define RECORDSTOREVERSION 1
+#define RECORDSTOREHEADERSIZE 32
+#define RECORDSTOREPUT 1
+#define RECORDSTOREREMOVE 2
+#define RECORDSTOREMINJOURNAL 64 // changes before compacting (or as many as records, if more)
+
+/**
+ * @brief File of records identified by a key, persisted by appending the changes made
+ */
+class MegaCmdRecordStore
+{
+public:
+    enum
+    {
+        STORE_OK = 0,
+        STORE_MISSING, // there is no file
+        STORE_UNKNOWN_FORMAT, // the file is not a store (e.g. it was written in a former format)
+        STORE_CORRUPT // the file is a store but it could not be read (entirely)
+    };
+
+private:
+    std::string path;
+    unsigned int recordType;
+
+    bool fileValid; // whether the file is a store with the records last loaded or saved, that can be appended to
+    unsigned int journalEntries;
+
+    static unsigned int parse(const char *data, size_t size, unsigned int recordType,
+                              std::map<std::string, std::string> *records, unsigned int *journalEntries);
+
+public:
+    MegaCmdRecordStore(std::string path, unsigned int recordType);
+
+    /**
+     * @brief Reads the records of the file (mapping it into memory).
+     * If its journal has changes, the file is compacted
+     * @param records receives the records read (even if the file is corrupt, those that could be read)
+     * @return STORE_OK or the reason the records could not be (all) read
+     */
+    int load(std::map<std::string, std::string> *records);
+
+    /**
+     * @brief Persists records: the changes since the last load or save are appended to the file,
+     * or the file is compacted if the journal is too long (or the file was not a valid store).
+     * The store keeps no copy of the records: the caller tells which ones changed
+     * @param changed keys put or removed since the last load or save (those not in records were removed)
+     */
+    bool save(const std::map<std::string, std::string> &records, const std::set<std::string> &changed);
+
+    /**
+     * @brief Writes a new file with records (all in the snapshot) and replaces the former one with it
+     */
+    bool compact(const std::map<std::string, std::string> &records);
+
+    /**
+     * @brief Copies the file as it is (e.g. in a former format, before migrating it) to path + ".bak".
+     * The copy is removed by the next load that succeeds
+     */
+    bool backupFile();
+
+    std::string getPath();
+
+    /**
+     * @brief Adds to changed the keys whose records differ between former and current
+     */
+    static void diff(const std::map<std::string, std::string> &former, const std::map<std::string, std::string> &current,
+                     std::set<std::string> *changed);
+
+    static unsigned int crc32(const char *data, size_t size, unsigned int crc = 0);
+
+    // to encode the values of the records with a fixed layout
+    static void appendInteger(std::string *data, unsigned long long value, int bytes);
+    static unsigned long long readInteger(const char *data, int bytes);
+};
+
+#endif // MEGACMDRECORDSTORE_H
@@ -332,23 +332,38 @@ void statechangehandle(string statestring)
             string total = rest.substr(0,nexdel);
 
             string title;
+            string transfersDetails;
             if ( (nexdel != string::npos) && (nexdel < rest.size() ) )
             {
                 rest = rest.substr(nexdel+1);
                 nexdel = rest.find(":");
                 title = rest.substr(0,nexdel);
+
+                // files done, files in total, bytes per second and ETA of a set of transfers
+                vector<long long> details;
+                while (nexdel != string::npos)
+                {
+                    rest = rest.substr(nexdel+1);
+                    nexdel = rest.find(":");
+                    details.push_back(charstoll(rest.substr(0,nexdel).c_str()));
+                }
+                if (details.size() >= 4)
+                {
+                    title = title.size() ? title : "TRANSFERING";
+                    transfersDetails = getTransfersDetails(details[0], details[1], details[2], details[3]);
+                }
             }
 
             if (title.size())
             {
                 if (received==SPROGRESS_COMPLETE)
                 {
-                    printprogress(PROGRESS_COMPLETE, charstoll(total.c_str()),title.c_str());
+                    printprogress(PROGRESS_COMPLETE, charstoll(total.c_str()),title.c_str(), transfersDetails.c_str());
 
                 }
                 else
                 {
-                    printprogress(charstoll(received.c_str()), charstoll(total.c_str()),title.c_str());
+                    printprogress(charstoll(received.c_str()), charstoll(total.c_str()),title.c_str(), transfersDetails.c_str());
                 }
             }
             else
@@ -405,10 +420,49 @@ void sigint_handler(int signum)
 }
 
 
-void printprogress(long long completed, long long total, const char *title)
+string getTransfersDetails(long long filesDone, long long filesTotal, long long bytesPerSecond, long long eta)
+{
+    ostringstream os;
+    os << " " << filesDone << "/" << filesTotal << " files";
+    if (bytesPerSecond > 0)
+    {
+        os << " " << fixed << setprecision(2) << bytesPerSecond / 1024.0 / 1024.0 << " MB/s";
+    }
+    if (eta >= 0)
+    {
+        os << " ETA " << setfill('0');
+        if (eta >= 3600)
+        {
+            os << eta / 3600 << ":" << setw(2);
+        }
+        os << ( eta % 3600 ) / 60 << ":" << setw(2) << eta % 60;
+    }
+    return os.str();
+}
+
+void printprogress(long long completed, long long total, const char *title, const char *details)
 {
     int cols = getNumberOfCols(80);
 
+    // what does not fit besides the bar and the figures (about 40 characters) is cut: the title first, then the details
+    int room = std::max(cols - 45, 0);
+    string fittingDetails(details);
+    if (int(fittingDetails.size()) > room)
+    {
+        fittingDetails.clear();
+    }
+    string fittingTitle(title);
+    if (int(fittingTitle.size() + fittingDetails.size()) > room)
+    {
+        fittingTitle.resize(room - fittingDetails.size());
+    }
+    if (fittingTitle.empty() && fittingDetails.size() && fittingDetails[0] == ' ')
+    {
+        fittingDetails.erase(0, 1);
+    }
+    fittingTitle += fittingDetails;
+    title = fittingTitle.c_str();
+
     string outputString;
     outputString.resize(cols + 1);
     for (int i = 0; i < cols; i++)
@@ -38,7 +38,15 @@ void sleepMicroSeconds(long microseconds);
 
 void restoreprompt();
 
-void printprogress(long long completed, long long total, const char *title = "TRANSFERING");
+/**
+ * @brief Prints a progress bar, preceded by title and details. If there is no room for all of them, the title is cut first
+ */
+void printprogress(long long completed, long long total, const char *title = "TRANSFERING", const char *details = "");
+
+/**
+ * @brief Describes the progress of a set of transfers, e.g. " 3/10 files 1.25 MB/s ETA 1:05"
+ */
+std::string getTransfersDetails(long long filesDone, long long filesTotal, long long bytesPerSecond, long long eta);
 
 void changeprompt(const char *newprompt, bool redisplay = false);
 
@@ -89,6 +89,9 @@ bool MegaCmdShellCommunications::confirmResponse;
 bool MegaCmdShellCommunications::stopListener;
 ::mega::Thread *MegaCmdShellCommunications::listenerThread;
 SOCKET MegaCmdShellCommunications::newsockfd = INVALID_SOCKET;
+#ifndef _WIN32
+bool MegaCmdShellCommunications::legacyServer = false;
+#endif
 
 #ifdef _WIN32
 // UNICODE SUPPORT FOR WINDOWS
@@ -564,6 +567,11 @@ MegaCmdShellCommunications::MegaCmdShellCommunications()
 
     stopListener = false;
     listenerThread = NULL;
+
+#ifndef _WIN32
+    sessionsock = INVALID_SOCKET;
+    nextRequestId = 1;
+#endif
 }
 
 
@@ -689,6 +697,24 @@ int MegaCmdShellCommunications::executeCommand(string command, int (*readconfirm
     int n = send(thesock,(char *)wcommand.data(),int(wcslen(wcommand.c_str())*sizeof(wchar_t)), MSG_NOSIGNAL);
 
 #else
+    if (!legacyServer)
+    {
+        int outcode = executeCommandV2(thesock, command, readconfirmationloop, output);
+        if (!legacyServer)
+        {
+            closeSocket(thesock);
+            return outcode;
+        }
+
+        // the server does not understand v2: try again with the former protocol
+        closeSocket(thesock);
+        thesock = createSocket(0, false);
+        if (!socketValid(thesock))
+        {
+            return -1;
+        }
+    }
+
     int n = send(thesock,command.data(),command.size(), MSG_NOSIGNAL);
 #endif
     if (n == SOCKET_ERROR)
@@ -795,6 +821,244 @@ int MegaCmdShellCommunications::executeCommand(string command, int (*readconfirm
 }
 
 
+#ifndef _WIN32
+bool MegaCmdShellCommunications::recvAll(SOCKET socket, char *data, size_t size)
+{
+    while (size)
+    {
+        ssize_t n = recv(socket, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool MegaCmdShellCommunications::sendAll(SOCKET socket, const char *data, size_t size)
+{
+    while (size)
+    {
+        ssize_t n = send(socket, data, size, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+int MegaCmdShellCommunications::executeCommandV2(SOCKET thesock, string command, int (*readconfirmationloop)(const char *), OUTSTREAMTYPE &output)
+{
+    string petition(MCMD_PROTOCOL_V2_MAGIC, MCMD_PROTOCOL_V2_MAGIC_SIZE);
+    uint32_t length = uint32_t(command.size());
+    petition.append((const char *)&length, sizeof( length ));
+    petition.append(command);
+
+    if (!sendAll(thesock, petition.data(), petition.size()))
+    {
+        if ( (!command.compare(0,5,"Xexit") || !command.compare(0,5,"Xquit") ) && (ERRNO == ENOTCONN) )
+        {
+             cerr << "Could not send exit command to server (probably already down)" << endl;
+        }
+        else
+        {
+            cerr << "ERROR writing command to socket: " << ERRNO << endl;
+        }
+        return -1;
+    }
+
+    for (;;)
+    {
+        mcmdframeheader header;
+        if (!recvAll(thesock, (char *)&header, sizeof( int32_t )))
+        {
+            cerr << "ERROR reading response from server: " << ERRNO << endl;
+            return -1;
+        }
+
+        if (!recvAll(thesock, (char *)&header + sizeof( int32_t ), sizeof( header ) - sizeof( int32_t )))
+        {
+            // a legacy server answers with the id of the socket to connect to and closes the connection
+            int receiveSocket = header.type;
+            SOCKET legacysock = createSocket(receiveSocket);
+            if (socketValid(legacysock))
+            {
+                char buffer[1024];
+                while (recv(legacysock, buffer, sizeof( buffer ), MSG_NOSIGNAL) > 0);
+                closeSocket(legacysock);
+            }
+            legacyServer = true;
+            return -1;
+        }
+
+        string payload;
+        payload.resize(header.length);
+        if (header.length && !recvAll(thesock, (char *)payload.data(), header.length))
+        {
+            cerr << "ERROR reading output: " << ERRNO << endl;
+            return -1;
+        }
+
+        if (header.type == MCMD_FRAME_CONFIRMATION)
+        {
+            int response = MCMDCONFIRM_NO;
+            if (readconfirmationloop != NULL)
+            {
+                response = readconfirmationloop(payload.c_str());
+            }
+
+            if (!sendAll(thesock, (const char *) &response, sizeof( response )))
+            {
+                cerr << "ERROR writing confirm response to socket: " << ERRNO << endl;
+                return -1;
+            }
+            continue;
+        }
+
+        output << payload;
+        if (header.type == MCMD_FRAME_OUTPUT)
+        {
+            output << flush;
+            continue;
+        }
+        return header.outcode;
+    }
+}
+
+int MegaCmdShellCommunications::openSession()
+{
+    if (socketValid(sessionsock))
+    {
+        return 0;
+    }
+
+    SOCKET thesock = createSocket();
+    if (!socketValid(thesock))
+    {
+        return -1;
+    }
+
+    mcmdsessionframeheader header;
+    if (!sendAll(thesock, MCMD_PROTOCOL_SESSION_MAGIC, MCMD_PROTOCOL_V2_MAGIC_SIZE)
+            || !recvAll(thesock, (char *)&header, sizeof( header ))
+            || header.type != MCMD_FRAME_SESSION)
+    {
+        cerr << "Server does not support sessions: " << ERRNO << endl;
+        closeSocket(thesock);
+        return -1;
+    }
+
+    sessionsock = thesock;
+    return 0;
+}
+
+long long MegaCmdShellCommunications::sendSessionCommand(string command)
+{
+    if (!socketValid(sessionsock))
+    {
+        return -1;
+    }
+
+    mcmdsessionframeheader header;
+    header.requestId = nextRequestId++;
+    header.type = MCMD_FRAME_REQUEST;
+    header.outcode = MCMD_OK;
+    header.length = uint32_t(command.size());
+
+    if (!sendAll(sessionsock, (const char *)&header, sizeof( header ))
+            || !sendAll(sessionsock, command.data(), command.size()))
+    {
+        cerr << "ERROR writing command to session: " << ERRNO << endl;
+        return -1;
+    }
+    return header.requestId;
+}
+
+int MegaCmdShellCommunications::receiveSessionResponse(uint32_t *requestId, string *output, int (*readconfirmationloop)(const char *))
+{
+    for (;;)
+    {
+        mcmdsessionframeheader header;
+        if (!socketValid(sessionsock) || !recvAll(sessionsock, (char *)&header, sizeof( header )))
+        {
+            cerr << "ERROR reading response from session: " << ERRNO << endl;
+            return -1;
+        }
+
+        string payload;
+        payload.resize(header.length);
+        if (header.length && !recvAll(sessionsock, (char *)payload.data(), header.length))
+        {
+            cerr << "ERROR reading output: " << ERRNO << endl;
+            return -1;
+        }
+
+        if (header.type == MCMD_FRAME_CONFIRMATION)
+        {
+            mcmdsessionframeheader response;
+            response.requestId = header.requestId;
+            response.type = MCMD_FRAME_CONFIRMATION_RESPONSE;
+            response.outcode = MCMDCONFIRM_NO;
+            response.length = 0;
+            if (readconfirmationloop != NULL)
+            {
+                response.outcode = readconfirmationloop(payload.c_str());
+            }
+
+            if (!sendAll(sessionsock, (const char *)&response, sizeof( response )))
+            {
+                cerr << "ERROR writing confirm response to session: " << ERRNO << endl;
+                return -1;
+            }
+            continue;
+        }
+
+        if (header.type == MCMD_FRAME_OUTPUT)
+        {
+            sessionPartialOutputs[header.requestId].append(payload);
+            continue;
+        }
+
+        *requestId = header.requestId;
+        map<uint32_t, string>::iterator it = sessionPartialOutputs.find(header.requestId);
+        if (it != sessionPartialOutputs.end())
+        {
+            output->swap(it->second);
+            output->append(payload);
+            sessionPartialOutputs.erase(it);
+        }
+        else
+        {
+            *output = payload;
+        }
+        return header.outcode;
+    }
+}
+
+void MegaCmdShellCommunications::closeSession()
+{
+    if (socketValid(sessionsock))
+    {
+        closeSocket(sessionsock);
+        sessionsock = INVALID_SOCKET;
+    }
+    sessionPartialOutputs.clear();
+}
+#endif
+
 void *MegaCmdShellCommunications::listenToStateChangesEntry(void *slsc)
 {
     listenToStateChanges(((sListenStateChanges *)slsc)->receiveSocket,((sListenStateChanges *)slsc)->statechangehandle);
@@ -958,4 +1222,8 @@ MegaCmdShellCommunications::~MegaCmdShellCommunications()
         listenerThread->join();
     }
     delete (MegaThread *)listenerThread;
+
+#ifndef _WIN32
+    closeSession();
+#endif
 }
@@ -23,9 +23,12 @@
 #define MEGACMDSHELLCOMMUNICATIONS_H
 
 #include "mega/thread.h"
+#include "../megacmdprotocol.h"
 
 #include <string>
 #include <iostream>
+#include <map>
+#include <stdint.h>
 
 #ifdef _WIN32
 #include <WinSock2.h>
@@ -130,6 +133,30 @@ public:
 
     virtual void setResponseConfirmation(bool confirmation);
 
+#ifndef _WIN32
+    /**
+     * @brief Opens a long lived connection to send several commands without waiting for their responses
+     * @return 0 if the session was accepted by the server
+     */
+    int openSession();
+
+    /**
+     * @brief Sends a command through the session opened with openSession
+     * @return the id of the request, to match its response, or -1 on failure
+     */
+    long long sendSessionCommand(std::string command);
+
+    /**
+     * @brief Waits for the next response of any of the commands in flight
+     * @param requestId will be set to the id of the request responded
+     * @param output will receive the output of the command
+     * @return the outcode of the command or -1 on failure (e.g. the session was closed)
+     */
+    int receiveSessionResponse(uint32_t *requestId, std::string *output, int (*readconfirmationloop)(const char *) = NULL);
+
+    void closeSession();
+#endif
+
     static bool serverinitiatedfromshell;
     static bool registerAgainRequired;
 
@@ -143,6 +170,24 @@ private:
 
     static bool confirmResponse;
 
+#ifndef _WIN32
+    static bool legacyServer;
+
+    SOCKET sessionsock;
+    uint32_t nextRequestId;
+    std::map<uint32_t, std::string> sessionPartialOutputs; // output streamed for requests not finished yet
+
+    static bool recvAll(SOCKET socket, char *data, size_t size);
+    static bool sendAll(SOCKET socket, const char *data, size_t size);
+
+    /**
+     * @brief executeCommandV2
+     * Sends the command and receives its response through a single connection
+     * @return the outcode of the command or -1 on failure
+     */
+    static int executeCommandV2(SOCKET thesock, std::string command, int (*readconfirmationloop)(const char *), OUTSTREAMTYPE &output);
+#endif
+
     static bool stopListener;
     static mega::Thread *listenerThread;
 
@@ -0,0 +1,651 @@
+/**
+ * @file src/megacmdsizecache.cpp
+ * @brief MEGAcmd: Cache of the sizes of remote folders
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdsizecache.h"
+#include "megacmdlogger.h"
+
+#include <string.h>
+
+#define MAXPENDINGFOLDERSATTEMPTS 3
+
+using namespace std;
+using namespace mega;
+
+enum
+{
+    SIZEENTRY_FILE,
+    SIZEENTRY_FOLDER,
+    SIZEENTRY_TRACKEDFOLDER // a folder already tracked, with the sizes it had when visited
+};
+
+typedef struct sizeentry_struct
+{
+    MegaHandle handle;
+    MegaHandle parent;
+    int type;
+    treesizes sizes;
+} sizeentry;
+
+class SizeEntriesResult : public MegaCmdTreeResult
+{
+public:
+    vector<sizeentry> entries;
+};
+
+/**
+ * @brief Gathers the sizes of the files of a tree, stopping at the folders already tracked
+ */
+class SizeCollectorVisitor : public MegaCmdTreeVisitor
+{
+private:
+    MegaApi *api;
+    MegaCmdSizeCache *cache;
+    int firstDepth;
+
+public:
+    SizeCollectorVisitor(MegaApi *api, MegaCmdSizeCache *cache, int firstDepth)
+    {
+        this->api = api;
+        this->cache = cache;
+        this->firstDepth = firstDepth;
+    }
+
+    MegaCmdTreeResult *newResult()
+    {
+        return new SizeEntriesResult();
+    }
+
+    bool visit(MegaNode *n, int depth, MegaCmdTreeResult *result)
+    {
+        if (depth > firstDepth && n->getType() != MegaNode::TYPE_FILE)
+        {
+            sizeentry e;
+            if (cache->getTrackedSizes(n->getHandle(), &e.sizes))
+            {
+                e.handle = n->getHandle();
+                e.parent = n->getParentHandle();
+                e.type = SIZEENTRY_TRACKEDFOLDER;
+                ((SizeEntriesResult *)result)->entries.push_back(e);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void visitChildren(MegaNode *n, int depth, MegaNodeList *children, MegaCmdTreeResult *result)
+    {
+        vector<sizeentry> &entries = ((SizeEntriesResult *)result)->entries;
+        entries.reserve(entries.size() + children->size());
+        for (int i = 0; i < children->size(); i++)
+        {
+            MegaNode *child = children->get(i);
+            sizeentry e;
+            e.handle = child->getHandle();
+            e.parent = n->getHandle();
+            if (child->getType() == MegaNode::TYPE_FILE)
+            {
+                e.type = SIZEENTRY_FILE;
+                MegaCmdSizeCache::getFileSizes(api, child, &e.sizes);
+            }
+            else
+            {
+                e.type = SIZEENTRY_FOLDER;
+                memset(&e.sizes, 0, sizeof(e.sizes));
+            }
+            entries.push_back(e);
+        }
+    }
+
+    void reduce(MegaCmdTreeResult *into, MegaCmdTreeResult *from)
+    {
+        vector<sizeentry> &fromEntries = ((SizeEntriesResult *)from)->entries;
+        vector<sizeentry> &intoEntries = ((SizeEntriesResult *)into)->entries;
+        intoEntries.insert(intoEntries.end(), fromEntries.begin(), fromEntries.end());
+    }
+};
+
+static void addSizes(treesizes *into, const treesizes &from, int sign)
+{
+    into->bytes += sign * from.bytes;
+    into->versionsBytes += sign * from.versionsBytes;
+    into->files += sign * from.files;
+    into->folders += sign * from.folders;
+}
+
+MegaCmdSizeCache::MegaCmdSizeCache(MegaApi *api, MegaCmdTreeWalker *treeWalker)
+{
+    this->api = api;
+    this->treeWalker = treeWalker;
+    generation = 0;
+    updating = false;
+    hits = 0;
+    misses = 0;
+    mtx.init(false);
+}
+
+void MegaCmdSizeCache::getFileSizes(MegaApi *api, MegaNode *file, treesizes *sizes)
+{
+    memset(sizes, 0, sizeof(*sizes));
+    sizes->bytes = file->getSize();
+    sizes->files = 1;
+
+    MegaNodeList *versionNodes = api->getVersions(file);
+    if (versionNodes)
+    {
+        for (int i = 0; i < versionNodes->size(); i++)
+        {
+            MegaNode *versionNode = versionNodes->get(i);
+            if (versionNode->getHandle() != file->getHandle())
+            {
+                sizes->versionsBytes += versionNode->getSize();
+            }
+        }
+        delete versionNodes;
+    }
+}
+
+bool MegaCmdSizeCache::measureFolder(MegaNode *folder, treesizes *sizes)
+{
+    MegaHandle h = folder->getHandle();
+    unsigned long long startGeneration = generation;
+    misses++;
+    mtx.unlock();
+
+    SizeCollectorVisitor visitor(api, this, 0);
+    SizeEntriesResult *result = (SizeEntriesResult *)treeWalker->walk(folder, &visitor);
+    if (!result)
+    {
+        result = new SizeEntriesResult();
+    }
+    vector<sizeentry> &entries = result->entries;
+
+    // entries are in pre-order: walking them backwards, the contents of a folder come before it
+    map<MegaHandle, treesizes> measured;
+    memset(&measured[h], 0, sizeof(treesizes));
+    for (vector<sizeentry>::reverse_iterator it = entries.rbegin(); it != entries.rend(); it++)
+    {
+        if (it->type == SIZEENTRY_TRACKEDFOLDER)
+        {
+            measured[it->handle] = it->sizes;
+        }
+        else if (it->type == SIZEENTRY_FILE)
+        {
+            addSizes(&measured[it->parent], it->sizes, 1);
+        }
+        else
+        {
+            treesizes contribution = measured[it->handle];
+            contribution.folders++;
+            addSizes(&measured[it->parent], contribution, 1);
+        }
+    }
+    *sizes = measured[h];
+
+    mtx.lock();
+
+    if (generation != startGeneration || updating)
+    {
+        // nodes were updated while walking the tree: these might be already outdated
+        delete result;
+        return false;
+    }
+
+    map<MegaHandle, treesizes>::iterator itfolder = folders.find(h);
+    if (itfolder != folders.end())
+    {
+        // tracked by someone else meanwhile
+        *sizes = itfolder->second;
+        delete result;
+        return true;
+    }
+
+    if (nodes.size() + entries.size() >= MAXSIZECACHENODES)
+    {
+        LOG_debug << "Size cache reached " << nodes.size() << " nodes. Hits: " << hits << " misses: " << misses << ". Discarding it";
+        clearCache();
+    }
+
+    for (unsigned int i = 0; i < entries.size(); i++)
+    {
+        sizeentry &e = entries[i];
+        if (e.type == SIZEENTRY_TRACKEDFOLDER)
+        {
+            continue;
+        }
+
+        trackednode &tn = nodes[e.handle];
+        tn.parent = e.parent;
+        tn.folder = e.type == SIZEENTRY_FOLDER;
+        tn.bytes = e.sizes.bytes;
+        tn.versionsBytes = e.sizes.versionsBytes;
+        if (tn.folder)
+        {
+            folders[e.handle] = measured[e.handle];
+            pendingFolders.erase(e.handle);
+        }
+    }
+    delete result;
+
+    trackednode &tn = nodes[h];
+    tn.parent = folder->getParentHandle();
+    tn.folder = true;
+    tn.bytes = 0;
+    tn.versionsBytes = 0;
+    folders[h] = *sizes;
+    pendingFolders.erase(h);
+
+    // it was not accounted for in its tracked ancestors (if any)
+    treesizes contribution;
+    getContribution(&tn, h, &contribution);
+    addToAncestors(tn.parent, contribution, 1);
+    return true;
+}
+
+void MegaCmdSizeCache::measurePendingFolders()
+{
+    for (int attempt = 0; attempt < MAXPENDINGFOLDERSATTEMPTS && pendingFolders.size(); attempt++)
+    {
+        vector<MegaHandle> handles;
+        for (map<MegaHandle, MegaHandle>::iterator it = pendingFolders.begin(); it != pendingFolders.end(); it++)
+        {
+            handles.push_back(it->first);
+        }
+
+        for (unsigned int i = 0; i < handles.size(); i++)
+        {
+            // the api is not to be used with mtx locked: the thread of its callbacks could be waiting for it
+            mtx.unlock();
+            MegaNode *folder = api->getNodeByHandle(handles[i]);
+            mtx.lock();
+
+            if (!folder)
+            {
+                pendingFolders.erase(handles[i]);
+                continue;
+            }
+
+            if (pendingFolders.find(handles[i]) != pendingFolders.end())
+            {
+                treesizes sizes;
+                measureFolder(folder, &sizes);
+            }
+            delete folder;
+        }
+    }
+
+    if (pendingFolders.size())
+    {
+        LOG_debug << "Size cache could not measure " << pendingFolders.size() << " new folders: nodes keep changing";
+    }
+}
+
+void MegaCmdSizeCache::getContribution(trackednode *tn, MegaHandle h, treesizes *contribution)
+{
+    memset(contribution, 0, sizeof(*contribution));
+    if (tn->folder)
+    {
+        map<MegaHandle, treesizes>::iterator it = folders.find(h);
+        if (it != folders.end())
+        {
+            *contribution = it->second;
+        }
+        contribution->folders++;
+    }
+    else
+    {
+        contribution->bytes = tn->bytes;
+        contribution->versionsBytes = tn->versionsBytes;
+        contribution->files = 1;
+    }
+}
+
+void MegaCmdSizeCache::addToAncestors(MegaHandle parent, const treesizes &contribution, int sign)
+{
+    for (;;)
+    {
+        map<MegaHandle, treesizes>::iterator itfolder = folders.find(parent);
+        if (itfolder == folders.end())
+        {
+            return;
+        }
+        addSizes(&itfolder->second, contribution, sign);
+
+        map<MegaHandle, trackednode>::iterator itnode = nodes.find(parent);
+        if (itnode == nodes.end())
+        {
+            return;
+        }
+        parent = itnode->second.parent;
+    }
+}
+
+void MegaCmdSizeCache::trackFile(MegaHandle h, MegaHandle parent, const treesizes &sizes)
+{
+    trackednode &tn = nodes[h];
+    tn.parent = parent;
+    tn.folder = false;
+    tn.bytes = sizes.bytes;
+    tn.versionsBytes = sizes.versionsBytes;
+    addToAncestors(parent, sizes, 1);
+}
+
+void MegaCmdSizeCache::untrack(MegaHandle h)
+{
+    map<MegaHandle, trackednode>::iterator it = nodes.find(h);
+    if (it == nodes.end())
+    {
+        return;
+    }
+
+    treesizes contribution;
+    getContribution(&it->second, h, &contribution);
+    addToAncestors(it->second.parent, contribution, -1);
+    nodes.erase(it);
+    folders.erase(h);
+}
+
+void MegaCmdSizeCache::onNodeUpdate(MegaNode *n, const map<MegaHandle, treesizes> &fileSizes, set<MegaHandle> *removedFolders)
+{
+    MegaHandle h = n->getHandle();
+    MegaHandle parent = n->getParentHandle();
+    pendingFolders.erase(h);
+
+    map<MegaHandle, trackednode>::iterator it = nodes.find(h);
+    if (it != nodes.end())
+    {
+        if (n->isRemoved() || !it->second.folder)
+        {
+            if (n->isRemoved() && it->second.folder)
+            {
+                removedFolders->insert(h);
+            }
+            // files will be tracked again (if still in a tracked folder) with their current sizes
+            untrack(h);
+        }
+        else if (it->second.parent != parent)
+        {
+            // a folder moved: its sizes go from its former ancestors to the new ones
+            treesizes contribution;
+            getContribution(&it->second, h, &contribution);
+            addToAncestors(it->second.parent, contribution, -1);
+            it->second.parent = parent;
+            addToAncestors(parent, contribution, 1);
+        }
+    }
+
+    if (n->isRemoved() || folders.find(parent) == folders.end())
+    {
+        return;
+    }
+
+    if (n->getType() == MegaNode::TYPE_FILE)
+    {
+        map<MegaHandle, treesizes>::const_iterator itsizes = fileSizes.find(h);
+        if (itsizes != fileSizes.end())
+        {
+            trackFile(h, parent, itsizes->second);
+        }
+    }
+    else if (nodes.find(h) == nodes.end())
+    {
+        // its contents might not have been notified (e.g. moved from an untracked folder)
+        pendingFolders[h] = parent;
+    }
+}
+
+bool MegaCmdSizeCache::isInRemovedFolder(MegaHandle h, map<MegaHandle, bool> *removed)
+{
+    vector<MegaHandle> path;
+    bool toret = false;
+    for (;;)
+    {
+        map<MegaHandle, bool>::iterator itremoved = removed->find(h);
+        if (itremoved != removed->end())
+        {
+            toret = itremoved->second;
+            break;
+        }
+
+        map<MegaHandle, trackednode>::iterator itnode = nodes.find(h);
+        if (itnode == nodes.end())
+        {
+            break;
+        }
+        path.push_back(h);
+        h = itnode->second.parent;
+    }
+
+    for (unsigned int i = 0; i < path.size(); i++)
+    {
+        (*removed)[path[i]] = toret;
+    }
+    return toret;
+}
+
+void MegaCmdSizeCache::forgetDescendants(const set<MegaHandle> &removedFolders)
+{
+    // their sizes were already subtracted from the ancestors along with the removed folders
+    map<MegaHandle, bool> removed;
+    for (set<MegaHandle>::const_iterator it = removedFolders.begin(); it != removedFolders.end(); it++)
+    {
+        removed[*it] = true;
+    }
+
+    for (map<MegaHandle, trackednode>::iterator it = nodes.begin(); it != nodes.end(); )
+    {
+        if (isInRemovedFolder(it->second.parent, &removed))
+        {
+            removed[it->first] = true; // for its descendants not visited yet
+            folders.erase(it->first);
+            pendingFolders.erase(it->first);
+            nodes.erase(it++);
+        }
+        else
+        {
+            it++;
+        }
+    }
+
+    for (map<MegaHandle, MegaHandle>::iterator it = pendingFolders.begin(); it != pendingFolders.end(); )
+    {
+        if (isInRemovedFolder(it->second, &removed))
+        {
+            pendingFolders.erase(it++);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+void MegaCmdSizeCache::clearCache()
+{
+    nodes.clear();
+    folders.clear();
+    pendingFolders.clear();
+}
+
+void MegaCmdSizeCache::getSizes(MegaNode *n, treesizes *sizes)
+{
+    if (n->getType() == MegaNode::TYPE_FILE)
+    {
+        getFileSizes(api, n, sizes);
+        return;
+    }
+
+    mtx.lock();
+    measurePendingFolders();
+
+    map<MegaHandle, treesizes>::iterator it = folders.find(n->getHandle());
+    if (it != folders.end())
+    {
+        hits++;
+        *sizes = it->second;
+    }
+    else
+    {
+        measureFolder(n, sizes);
+    }
+    mtx.unlock();
+}
+
+bool MegaCmdSizeCache::getTrackedSizes(MegaHandle h, treesizes *sizes)
+{
+    mtx.lock();
+    map<MegaHandle, treesizes>::iterator it = folders.find(h);
+    bool tracked = it != folders.end();
+    if (tracked)
+    {
+        *sizes = it->second;
+    }
+    mtx.unlock();
+    return tracked;
+}
+
+void MegaCmdSizeCache::onNodesUpdate(MegaNodeList *nodes)
+{
+    mtx.lock();
+    generation++;
+
+    if (!nodes)
+    {
+        clearCache();
+        mtx.unlock();
+        return;
+    }
+
+    if (!this->nodes.size() && !pendingFolders.size())
+    {
+        mtx.unlock();
+        return;
+    }
+
+    // the api is not to be used with mtx locked: gather the files to measure first
+    vector<MegaNode *> filesToMeasure;
+    set<MegaHandle> versionParents;
+    for (int i = 0; i < nodes->size(); i++)
+    {
+        MegaNode *n = nodes->get(i);
+        if (n->getType() != MegaNode::TYPE_FILE)
+        {
+            continue;
+        }
+
+        if (folders.find(n->getParentHandle()) != folders.end())
+        {
+            if (!n->isRemoved())
+            {
+                filesToMeasure.push_back(n);
+            }
+        }
+        else if (n->getParentHandle() != UNDEF)
+        {
+            // previous versions have the next version as parent
+            versionParents.insert(n->getParentHandle());
+        }
+    }
+    updating = true;
+    mtx.unlock();
+
+    map<MegaHandle, treesizes> fileSizes;
+    for (unsigned int i = 0; i < filesToMeasure.size(); i++)
+    {
+        getFileSizes(api, filesToMeasure[i], &fileSizes[filesToMeasure[i]->getHandle()]);
+    }
+
+    // the current version of files whose versions changed (the first file in the chain of parents)
+    map<MegaHandle, pair<MegaHandle, treesizes> > currentVersions;
+    for (set<MegaHandle>::iterator it = versionParents.begin(); it != versionParents.end(); it++)
+    {
+        MegaNode *p = api->getNodeByHandle(*it);
+        while (p && p->getType() == MegaNode::TYPE_FILE)
+        {
+            MegaNode *next = api->getNodeByHandle(p->getParentHandle());
+            if (!next || next->getType() != MegaNode::TYPE_FILE)
+            {
+                delete next;
+                break;
+            }
+            delete p;
+            p = next;
+        }
+
+        if (p && p->getType() == MegaNode::TYPE_FILE && currentVersions.find(p->getHandle()) == currentVersions.end())
+        {
+            pair<MegaHandle, treesizes> &version = currentVersions[p->getHandle()];
+            version.first = p->getParentHandle();
+            getFileSizes(api, p, &version.second);
+        }
+        delete p;
+    }
+
+    mtx.lock();
+    generation++;
+    updating = false;
+
+    set<MegaHandle> removedFolders;
+    for (int i = 0; i < nodes->size(); i++)
+    {
+        onNodeUpdate(nodes->get(i), fileSizes, &removedFolders);
+    }
+
+    for (map<MegaHandle, pair<MegaHandle, treesizes> >::iterator it = currentVersions.begin(); it != currentVersions.end(); it++)
+    {
+        if (this->nodes.find(it->first) != this->nodes.end())
+        {
+            untrack(it->first);
+            trackFile(it->first, it->second.first, it->second.second);
+        }
+    }
+
+    if (removedFolders.size())
+    {
+        forgetDescendants(removedFolders);
+    }
+    mtx.unlock();
+}
+
+void MegaCmdSizeCache::forget(MegaHandle h)
+{
+    mtx.lock();
+    generation++;
+    if (nodes.find(h) != nodes.end())
+    {
+        // subtracted from its tracked ancestors, which will get it back once measured again
+        untrack(h);
+        set<MegaHandle> forgotten;
+        forgotten.insert(h);
+        forgetDescendants(forgotten);
+    }
+    pendingFolders.erase(h);
+    mtx.unlock();
+}
+
+void MegaCmdSizeCache::clear()
+{
+    mtx.lock();
+    generation++;
+    clearCache();
+    mtx.unlock();
+}
+
+MegaCmdSizeCache::~MegaCmdSizeCache()
+{
+    clear();
+}
@@ -0,0 +1,120 @@
+/**
+ * @file src/megacmdsizecache.h
+ * @brief MEGAcmd: Cache of the sizes of remote folders
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDSIZECACHE_H
+#define MEGACMDSIZECACHE_H
+
+#include "megacmd.h"
+#include "megacmdtreewalker.h"
+
+#include <map>
+#include <set>
+
+#define MAXSIZECACHENODES 1000000 // around 100 bytes each (more for folders)
+
+typedef struct treesizes_struct
+{
+    long long bytes; // of the current version of the files
+    long long versionsBytes; // of the previous versions of the files
+    long long files;
+    long long folders;
+} treesizes;
+
+/**
+ * @brief Sizes of the folders whose tree has been measured (e.g. by du)
+ *
+ * The first time a folder is asked for, its tree is walked and every node in it is tracked:
+ * the sizes of the tracked folders (of all their contents) are kept up to date from then on
+ * with the nodes updated (see onNodesUpdate), adding and subtracting the sizes of the nodes
+ * that come, go or change to their tracked ancestors.
+ * Folders that come into a tracked folder are measured when the next size is asked for.
+ */
+class MegaCmdSizeCache
+{
+private:
+    typedef struct trackednode_struct
+    {
+        mega::MegaHandle parent;
+        bool folder;
+        long long bytes; // for files
+        long long versionsBytes; // for files
+    } trackednode;
+
+    mega::MegaApi *api;
+    MegaCmdTreeWalker *treeWalker;
+    std::map<mega::MegaHandle, trackednode> nodes;
+    std::map<mega::MegaHandle, treesizes> folders; // the sizes of the tracked folders
+    std::map<mega::MegaHandle, mega::MegaHandle> pendingFolders; // untracked folders in tracked ones, and their parent
+    mega::MegaMutex mtx;
+    unsigned long long generation; // to discard measures taken while updates were received
+    bool updating; // measures are discarded while updates are being applied
+
+    long long hits;
+    long long misses;
+
+    /**
+     * @brief Measures the tree of folder and tracks it. mtx must be locked: it is unlocked while walking the tree
+     * @param sizes will receive the sizes of the folder (even if they could not be kept)
+     * @return whether the tree is now tracked
+     */
+    bool measureFolder(mega::MegaNode *folder, treesizes *sizes);
+
+    // the following require mtx to be locked
+    void measurePendingFolders();
+    void getContribution(trackednode *tn, mega::MegaHandle h, treesizes *contribution);
+    void addToAncestors(mega::MegaHandle parent, const treesizes &contribution, int sign);
+    void trackFile(mega::MegaHandle h, mega::MegaHandle parent, const treesizes &sizes);
+    void untrack(mega::MegaHandle h);
+    void onNodeUpdate(mega::MegaNode *n, const std::map<mega::MegaHandle, treesizes> &fileSizes,
+                      std::set<mega::MegaHandle> *removedFolders);
+    bool isInRemovedFolder(mega::MegaHandle h, std::map<mega::MegaHandle, bool> *removed);
+    void forgetDescendants(const std::set<mega::MegaHandle> &removedFolders);
+    void clearCache();
+
+public:
+    MegaCmdSizeCache(mega::MegaApi *api, MegaCmdTreeWalker *treeWalker);
+    ~MegaCmdSizeCache();
+
+    /**
+     * @brief Gets the sizes of all the contents of a node (of the node itself for files).
+     * Not to be called from the thread of the MegaApi callbacks
+     */
+    void getSizes(mega::MegaNode *n, treesizes *sizes);
+
+    /**
+     * @brief Gets the sizes of a tracked folder, if it is tracked
+     */
+    bool getTrackedSizes(mega::MegaHandle h, treesizes *sizes);
+
+    /**
+     * @brief Applies the changes of the nodes updated to the sizes of the tracked folders
+     * @param nodes nodes updated or NULL when everything should be considered outdated
+     */
+    void onNodesUpdate(mega::MegaNodeList *nodes);
+
+    /**
+     * @brief Forgets the tree of a tracked folder, so that it is measured again the next time it is asked for
+     */
+    void forget(mega::MegaHandle h);
+
+    void clear();
+
+    static void getFileSizes(mega::MegaApi *api, mega::MegaNode *file, treesizes *sizes);
+};
+
+#endif // MEGACMDSIZECACHE_H
@@ -0,0 +1,481 @@
+/**
+ * @file src/megacmdsyncrestarter.cpp
+ * @brief MEGAcmd: Concurrent restarts of the configured syncs
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdsyncrestarter.h"
+#include "megacmdlogger.h"
+#include "megacmdutils.h"
+#include "configurationmanager.h"
+
+#include <set>
+
+using namespace std;
+using namespace mega;
+
+MegaCmdSyncRestarter::RestartListener::RestartListener(MegaCmdSyncRestarter *restarter, size_t index)
+{
+    this->restarter = restarter;
+    this->index = index;
+}
+
+void MegaCmdSyncRestarter::RestartListener::onRequestFinish(MegaApi *api, MegaRequest *request, MegaError *e)
+{
+    restarter->onRequestFinished(index, e ? e->getErrorCode() : MegaError::API_EINTERNAL, request ? request->getNumber() : 0);
+}
+
+MegaCmdSyncRestarter::MegaCmdSyncRestarter(MegaApi *api, MegaMutex *mtxSyncs, int maxInFlight)
+{
+    this->api = api;
+    this->mtxSyncs = mtxSyncs;
+    this->maxInFlight = std::max(1, maxInFlight);
+    thread = NULL;
+    inFlight = 0;
+    running = false;
+    stopping = false;
+    waiters = 0;
+    mtx.init(false);
+}
+
+MegaCmdSyncRestarter::~MegaCmdSyncRestarter()
+{
+    stop();
+
+    mtx.lock();
+    if (!inFlight)
+    {
+        clearRound();
+    }
+    mtx.unlock();
+}
+
+void *MegaCmdSyncRestarter::threadEntry(void *param)
+{
+    ((MegaCmdSyncRestarter *)param)->run();
+    return NULL;
+}
+
+int MegaCmdSyncRestarter::schedule(int mode)
+{
+    vector<syncrestart> toschedule;
+    long long now = getMonotonicMicroSeconds();
+
+    mtxSyncs->lock();
+    for (map<string, sync_struct *>::iterator itr = ConfigurationManager::configuredSyncs.begin();
+         itr != ConfigurationManager::configuredSyncs.end(); ++itr)
+    {
+        sync_struct *thesync = itr->second;
+        if (mode == MODE_RESTART && !thesync->active)
+        {
+            continue;
+        }
+
+        syncrestart r;
+        r.localpath = thesync->localpath;
+        r.handle = thesync->handle;
+        r.fingerprint = thesync->fingerprint;
+        r.mode = mode;
+        r.state = STATE_PENDING;
+        r.errorCode = MegaError::API_OK;
+        r.queuedTime = now;
+        r.startTime = 0;
+        r.endTime = 0;
+        toschedule.push_back(r);
+    }
+    mtxSyncs->unlock();
+
+    if (!toschedule.size())
+    {
+        return 0;
+    }
+
+    mtx.lock();
+    if (stopping)
+    {
+        mtx.unlock();
+        return 0;
+    }
+
+    bool start = !running;
+    if (start)
+    {
+        if (thread)
+        {
+            // it finished the previous round already
+            thread->join();
+            delete thread;
+            thread = NULL;
+        }
+        clearRound();
+        running = true;
+    }
+
+    // a sync pending or in flight is not queued again: two requests for it at once would undo each other
+    set<string> ongoing;
+    for (size_t i = 0; i < restarts.size(); i++)
+    {
+        if (restarts[i].state == STATE_PENDING || restarts[i].state == STATE_DISABLING || restarts[i].state == STATE_RESUMING)
+        {
+            ongoing.insert(restarts[i].localpath);
+        }
+    }
+
+    int scheduled = 0;
+    for (size_t i = 0; i < toschedule.size(); i++)
+    {
+        if (ongoing.find(toschedule[i].localpath) != ongoing.end())
+        {
+            LOG_debug << "Sync " << toschedule[i].localpath << " is already being restarted";
+            continue;
+        }
+        pending.push_back(restarts.size());
+        listeners.push_back(new RestartListener(this, restarts.size()));
+        restarts.push_back(toschedule[i]);
+        scheduled++;
+    }
+
+    if (start)
+    {
+        thread = new MegaThread();
+        thread->start(threadEntry, (void *)this);
+    }
+    mtx.unlock();
+
+    events.release();
+
+    LOG_debug << "Scheduled " << scheduled << " syncs to " << (mode == MODE_RESUME ? "resume" : "restart")
+              << " (" << maxInFlight << " at a time)";
+    return scheduled;
+}
+
+void MegaCmdSyncRestarter::clearRound()
+{
+    for (size_t i = 0; i < listeners.size(); i++)
+    {
+        delete listeners[i];
+    }
+    listeners.clear();
+    restarts.clear();
+    pending.clear();
+    finished.clear();
+}
+
+void MegaCmdSyncRestarter::run()
+{
+    long long roundStart = getMonotonicMicroSeconds();
+
+    for (;;)
+    {
+        mtx.lock();
+        if (finished.size())
+        {
+            finishedrequest f = finished.front();
+            finished.pop_front();
+            mtx.unlock();
+            processFinished(f);
+            continue;
+        }
+
+        if (!stopping && pending.size() && inFlight < maxInFlight)
+        {
+            size_t index = pending.front();
+            pending.pop_front();
+            inFlight++;
+            restarts[index].startTime = getMonotonicMicroSeconds();
+            syncrestart r = restarts[index];
+            mtx.unlock();
+            startRequest(index, r);
+            continue;
+        }
+
+        if (stopping || (!inFlight && !pending.size()))
+        {
+            int restarted = 0;
+            int failed = 0;
+            long long totalLatency = 0;
+            long long maxLatency = 0;
+            for (size_t i = 0; i < restarts.size(); i++)
+            {
+                if (!restarts[i].endTime)
+                {
+                    continue; // cancelled (or still in flight when stopping)
+                }
+                if (restarts[i].state == STATE_FAILED)
+                {
+                    failed++;
+                }
+                else
+                {
+                    restarted++;
+                }
+                long long latency = restarts[i].endTime - restarts[i].startTime;
+                totalLatency += latency;
+                maxLatency = std::max(maxLatency, latency);
+            }
+            if (restarted + failed)
+            {
+                LOG_info << "Restarted " << restarted << " syncs (" << failed << " failed) in "
+                         << (getMonotonicMicroSeconds() - roundStart) / 1000 << " ms. Latency per sync: average "
+                         << totalLatency / 1000 / (restarted + failed) << " ms, max " << maxLatency / 1000 << " ms";
+            }
+
+            running = false;
+            int toRelease = waiters;
+            waiters = 0;
+            mtx.unlock();
+
+            for (int i = 0; i < toRelease; i++)
+            {
+                done.release();
+            }
+            return;
+        }
+        mtx.unlock();
+
+        events.timedwait(1000);
+    }
+}
+
+void MegaCmdSyncRestarter::startRequest(size_t index, syncrestart r)
+{
+    MegaNode *n = api->getNodeByHandle(r.handle);
+    if (!n)
+    {
+        LOG_err << "Node not found for sync " << r.localpath << " into handle: " << r.handle;
+        if (r.mode == MODE_RESUME)
+        {
+            updateSync(r, false, false, 0);
+        }
+        finish(index, STATE_FAILED, MegaError::API_ENOENT);
+        return;
+    }
+
+    mtx.lock();
+    restarts[index].state = (r.mode == MODE_RESUME) ? STATE_RESUMING : STATE_DISABLING;
+    RestartListener *listener = listeners[index];
+    mtx.unlock();
+
+    if (r.mode == MODE_RESUME)
+    {
+        api->resumeSync(r.localpath.c_str(), n, r.fingerprint, listener);
+    }
+    else
+    {
+        char *nodepath = api->getNodePath(n);
+        LOG_info << "Restarting sync " << r.localpath << ": " << (nodepath ? nodepath : "");
+        delete []nodepath;
+        api->disableSync(n, listener);
+    }
+    delete n;
+}
+
+void MegaCmdSyncRestarter::onRequestFinished(size_t index, int errorCode, long long number)
+{
+    finishedrequest f;
+    f.index = index;
+    f.errorCode = errorCode;
+    f.number = number;
+
+    mtx.lock();
+    finished.push_back(f);
+    mtx.unlock();
+
+    events.release();
+}
+
+void MegaCmdSyncRestarter::processFinished(finishedrequest f)
+{
+    mtx.lock();
+    syncrestart r = restarts[f.index];
+    RestartListener *listener = listeners[f.index];
+    mtx.unlock();
+
+    MegaNode *n = api->getNodeByHandle(r.handle);
+    char *nodepath = n ? api->getNodePath(n) : NULL;
+    string remotepath = nodepath ? nodepath : "";
+    delete []nodepath;
+
+    if (r.state == STATE_DISABLING)
+    {
+        if (f.errorCode != MegaError::API_OK)
+        {
+            LOG_err << "Failed to stop sync " << r.localpath << ": " << MegaError::getErrorString(f.errorCode);
+            finish(f.index, STATE_FAILED, f.errorCode);
+            delete n;
+            return;
+        }
+
+        updateSync(r, true, false, 0);
+
+        MegaSync *msync = n ? api->getSyncByNode(n) : NULL;
+        if (!n || msync)
+        {
+            LOG_err << "Failed to restart sync: " << r.localpath << ". You will need to manually reenable or restart MEGAcmd";
+            finish(f.index, STATE_FAILED, n ? MegaError::API_EEXIST : MegaError::API_ENOENT);
+            delete msync;
+            delete n;
+            return;
+        }
+
+        mtx.lock();
+        restarts[f.index].state = STATE_RESUMING;
+        mtx.unlock();
+        api->syncFolder(r.localpath.c_str(), n, listener);
+        delete n;
+        return;
+    }
+
+    if (f.errorCode == MegaError::API_OK)
+    {
+        updateSync(r, false, true, f.number);
+        LOG_info << "Loaded sync: " << r.localpath << " to " << remotepath;
+        finish(f.index, STATE_DONE, f.errorCode);
+    }
+    else
+    {
+        updateSync(r, false, false, 0);
+        LOG_err << "Failed to resume sync: " << r.localpath << " to " << remotepath << ": " << MegaError::getErrorString(f.errorCode);
+        finish(f.index, STATE_FAILED, f.errorCode);
+    }
+    delete n;
+}
+
+void MegaCmdSyncRestarter::updateSync(const syncrestart &r, bool disabledOnly, bool resumed, long long fingerprint)
+{
+    mtxSyncs->lock();
+    map<string, sync_struct *>::iterator itr = ConfigurationManager::configuredSyncs.find(r.localpath);
+    // it might have been removed (or logged out) meanwhile
+    if (itr != ConfigurationManager::configuredSyncs.end() && itr->second->handle == r.handle)
+    {
+        sync_struct *thesync = itr->second;
+        thesync->active = resumed;
+        if (!disabledOnly)
+        {
+            thesync->loadedok = resumed;
+        }
+        if (resumed && fingerprint)
+        {
+            thesync->fingerprint = fingerprint;
+        }
+    }
+    mtxSyncs->unlock();
+}
+
+void MegaCmdSyncRestarter::finish(size_t index, int state, int errorCode)
+{
+    mtx.lock();
+    restarts[index].state = state;
+    restarts[index].errorCode = errorCode;
+    restarts[index].endTime = getMonotonicMicroSeconds();
+    inFlight--;
+    mtx.unlock();
+}
+
+void MegaCmdSyncRestarter::cancel()
+{
+    mtx.lock();
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        restarts[pending[i]].state = STATE_CANCELLED;
+    }
+    pending.clear();
+    mtx.unlock();
+
+    events.release();
+}
+
+void MegaCmdSyncRestarter::waitUntilDone()
+{
+    mtx.lock();
+    if (!running)
+    {
+        mtx.unlock();
+        return;
+    }
+    waiters++;
+    mtx.unlock();
+
+    LOG_debug << "Waiting for syncs to be restarted";
+    done.wait();
+}
+
+bool MegaCmdSyncRestarter::isRunning()
+{
+    mtx.lock();
+    bool toret = running;
+    mtx.unlock();
+    return toret;
+}
+
+vector<MegaCmdSyncRestarter::syncrestart> MegaCmdSyncRestarter::getStatus()
+{
+    mtx.lock();
+    vector<syncrestart> toret = restarts;
+    mtx.unlock();
+    return toret;
+}
+
+void MegaCmdSyncRestarter::stop()
+{
+    mtx.lock();
+    stopping = true;
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        restarts[pending[i]].state = STATE_CANCELLED;
+    }
+    pending.clear();
+    MegaThread *toJoin = thread;
+    thread = NULL;
+    mtx.unlock();
+
+    events.release();
+
+    if (!toJoin)
+    {
+        return;
+    }
+    toJoin->join();
+    delete toJoin;
+
+    mtx.lock();
+    if (inFlight)
+    {
+        LOG_debug << "Sync restarter stopped with " << inFlight << " requests in flight";
+        listeners.clear(); // leaked: the requests might still finish
+    }
+    mtx.unlock();
+}
+
+string MegaCmdSyncRestarter::getStateStr(int state)
+{
+    switch (state)
+    {
+        case STATE_PENDING:
+            return "Pending";
+        case STATE_DISABLING:
+            return "Disabling";
+        case STATE_RESUMING:
+            return "Resuming";
+        case STATE_DONE:
+            return "Done";
+        case STATE_FAILED:
+            return "Failed";
+        case STATE_CANCELLED:
+            return "Cancelled";
+        default:
+            return "Unknown";
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * @file src/megacmdsyncrestarter.h
+ * @brief MEGAcmd: Concurrent restarts of the configured syncs
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDSYNCRESTARTER_H
+#define MEGACMDSYNCRESTARTER_H
+
+#include "megacmd.h"
+
+#include <deque>
+#include <vector>
+
+#define DEFAULTSYNCRESTARTCONCURRENCY 8
+
+/**
+ * @brief Resumes (or restarts) the configured syncs in a thread of its own, with a bounded number
+ * of requests in flight, so that the petitions that do not need them are served meanwhile.
+ *
+ * The requests are issued without waiting for each other: a sync restarted is disabled and
+ * resumed as soon as its previous request finishes. The time every sync took is kept until a new
+ * round of restarts is scheduled.
+ */
+class MegaCmdSyncRestarter
+{
+public:
+    enum
+    {
+        MODE_RESUME = 0, // resumeSync with the fingerprint configured (i.e. after fetching nodes)
+        MODE_RESTART // disableSync and syncFolder again (e.g. to apply new exclusions)
+    };
+
+    enum
+    {
+        STATE_PENDING = 0,
+        STATE_DISABLING,
+        STATE_RESUMING,
+        STATE_DONE,
+        STATE_FAILED,
+        STATE_CANCELLED
+    };
+
+    typedef struct syncrestart_struct
+    {
+        std::string localpath;
+        mega::MegaHandle handle;
+        long long fingerprint;
+        int mode;
+        int state;
+        int errorCode;
+        long long queuedTime; // microseconds (monotonic)
+        long long startTime;
+        long long endTime;
+    } syncrestart;
+
+private:
+    class RestartListener : public mega::MegaRequestListener
+    {
+    private:
+        MegaCmdSyncRestarter *restarter;
+        size_t index;
+
+    public:
+        RestartListener(MegaCmdSyncRestarter *restarter, size_t index);
+        void onRequestFinish(mega::MegaApi *api, mega::MegaRequest *request, mega::MegaError *e);
+    };
+
+    typedef struct finishedrequest_struct
+    {
+        size_t index;
+        int errorCode;
+        long long number;
+    } finishedrequest;
+
+    mega::MegaApi *api;
+    mega::MegaMutex *mtxSyncs; // the one protecting ConfigurationManager::configuredSyncs
+    int maxInFlight;
+    mega::MegaThread *thread;
+
+    mega::MegaMutex mtx; // protects all below
+    std::vector<syncrestart> restarts; // of the current (or last) round
+    std::vector<RestartListener *> listeners; // by index in restarts
+    std::deque<size_t> pending;
+    std::deque<finishedrequest> finished;
+    int inFlight;
+    bool running;
+    bool stopping;
+    int waiters;
+
+    mega::MegaSemaphore events; // requests scheduled or finished
+    mega::MegaSemaphore done;
+
+    static void *threadEntry(void *param);
+    void run();
+    void startRequest(size_t index, syncrestart r);
+    void processFinished(finishedrequest f);
+    void finish(size_t index, int state, int errorCode);
+    void updateSync(const syncrestart &r, bool disabledOnly, bool resumed, long long fingerprint);
+    void onRequestFinished(size_t index, int errorCode, long long number);
+    void clearRound();
+
+public:
+    /**
+     * @param mtxSyncs mutex to lock to update the configured syncs
+     * @param maxInFlight maximum number of syncs being restarted at the same time
+     */
+    MegaCmdSyncRestarter(mega::MegaApi *api, mega::MegaMutex *mtxSyncs, int maxInFlight);
+    ~MegaCmdSyncRestarter();
+
+    /**
+     * @brief Queues the configured syncs (all of them to resume, the active ones to restart) and
+     * returns without waiting for them. If a round of restarts is running, they are added to it,
+     * except the ones pending or in flight in it
+     * @return the number of syncs queued
+     */
+    int schedule(int mode);
+
+    /**
+     * @brief Cancels the restarts not started yet (e.g. before the syncs configured are unloaded)
+     */
+    void cancel();
+
+    /**
+     * @brief Waits until the current round of restarts (if any) finishes
+     */
+    void waitUntilDone();
+
+    bool isRunning();
+
+    std::vector<syncrestart> getStatus();
+
+    /**
+     * @brief Stops issuing requests and waits for the thread to end.
+     * Requests still in flight are left behind (their listeners leaked): to be called when exiting
+     */
+    void stop();
+
+    static std::string getStateStr(int state);
+};
+
+#endif // MEGACMDSYNCRESTARTER_H
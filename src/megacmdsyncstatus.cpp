@@ -0,0 +1,244 @@
+/**
+ * @file src/megacmdsyncstatus.cpp
+ * @brief MEGAcmd: Status of the configured syncs, kept from callbacks
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdsyncstatus.h"
+#include "megacmdlogger.h"
+#include "megacmdutils.h"
+
+using namespace std;
+using namespace mega;
+
+MegaCmdSyncStatusTable::MegaCmdSyncStatusTable(MegaApi *api, MegaFileSystemAccess *fsAccess)
+{
+    this->api = api;
+    this->fsAccess = fsAccess;
+    pathsGeneration = 0;
+    hits = 0;
+    misses = 0;
+    mtx.init(false);
+}
+
+string MegaCmdSyncStatusTable::getLocalKey(string localpath)
+{
+    localpath = rtrim(localpath, '/');
+#ifdef _WIN32
+    localpath = rtrim(localpath, '\\');
+#endif
+    string localKey;
+    fsAccess->path2local(&localpath, &localKey);
+    return localKey;
+}
+
+string MegaCmdSyncStatusTable::getRemotePath(MegaHandle handle)
+{
+    string toret;
+    MegaNode *n = api->getNodeByHandle(handle);
+    if (n)
+    {
+        char *nodepath = api->getNodePath(n);
+        toret = nodepath ? nodepath : "";
+        delete []nodepath;
+        delete n;
+    }
+    return toret;
+}
+
+void MegaCmdSyncStatusTable::getStatus(const string &localpath, MegaHandle handle, syncstatus *status)
+{
+    string localKey = getLocalKey(localpath);
+
+    mtx.lock();
+    map<string, syncrow>::iterator it = rows.find(localpath);
+    if (it != rows.end() && it->second.handle == handle && !it->second.loading)
+    {
+        hits++;
+        *status = it->second.status;
+        if (it->second.pathsGeneration == pathsGeneration)
+        {
+            mtx.unlock();
+            return;
+        }
+
+        // folders changed: just the remote path is read again
+        unsigned long long generation = pathsGeneration;
+        mtx.unlock();
+
+        status->remotePath = getRemotePath(handle);
+
+        mtx.lock();
+        it = rows.find(localpath);
+        if (it != rows.end() && it->second.handle == handle)
+        {
+            it->second.status.remotePath = status->remotePath;
+            it->second.pathsGeneration = generation;
+        }
+        mtx.unlock();
+        return;
+    }
+    misses++;
+    unsigned long long generation = pathsGeneration;
+
+    if (it == rows.end() || it->second.handle != handle)
+    {
+        // a placeholder, so that the callbacks received while the sdk is queried are not missed
+        if (it != rows.end())
+        {
+            byLocalKey.erase(it->second.localKey);
+        }
+        syncrow &placeholder = rows[localpath];
+        placeholder.handle = handle;
+        placeholder.localKey = localKey;
+        placeholder.status.hasSync = false;
+        placeholder.status.syncState = MegaSync::SYNC_CANCELED;
+        placeholder.status.pathState = MegaApi::STATE_NONE;
+        placeholder.pathsGeneration = generation;
+        placeholder.loading = true;
+        placeholder.syncStateChanged = false;
+        placeholder.pathStateChanged = false;
+        byLocalKey[localKey] = localpath;
+    }
+    mtx.unlock();
+
+    syncstatus read;
+    read.remotePath = getRemotePath(handle);
+    read.pathState = api->syncPathState(&localKey);
+
+    MegaNode *n = api->getNodeByHandle(handle);
+    MegaSync *msync = n ? api->getSyncByNode(n) : NULL;
+    read.hasSync = msync != NULL;
+    read.syncState = msync ? msync->getState() : MegaSync::SYNC_CANCELED;
+    delete msync;
+    delete n;
+
+    mtx.lock();
+    it = rows.find(localpath);
+    if (it != rows.end() && it->second.handle == handle)
+    {
+        // what callbacks changed meanwhile is at least as recent as what was read
+        syncrow &row = it->second;
+        if (row.loading && row.syncStateChanged)
+        {
+            read.hasSync = row.status.hasSync;
+            read.syncState = row.status.syncState;
+        }
+        if (row.loading && row.pathStateChanged)
+        {
+            read.pathState = row.status.pathState;
+        }
+        row.status = read;
+        row.pathsGeneration = generation;
+        row.loading = false;
+    }
+    *status = read;
+    mtx.unlock();
+}
+
+void MegaCmdSyncStatusTable::invalidate(const string &localpath)
+{
+    mtx.lock();
+    map<string, syncrow>::iterator it = rows.find(localpath);
+    if (it != rows.end())
+    {
+        byLocalKey.erase(it->second.localKey);
+        rows.erase(it);
+    }
+    mtx.unlock();
+}
+
+void MegaCmdSyncStatusTable::clear()
+{
+    mtx.lock();
+    rows.clear();
+    byLocalKey.clear();
+    mtx.unlock();
+}
+
+void MegaCmdSyncStatusTable::onSyncStateChanged(MegaSync *sync)
+{
+    if (!sync)
+    {
+        return;
+    }
+
+    MegaHandle handle = sync->getMegaHandle();
+    int state = sync->getState();
+    mtx.lock();
+    // there are few syncs and their state seldom changes
+    for (map<string, syncrow>::iterator it = rows.begin(); it != rows.end(); ++it)
+    {
+        if (it->second.handle == handle)
+        {
+            // canceled ones are removed by the sdk
+            it->second.status.hasSync = state != MegaSync::SYNC_CANCELED;
+            it->second.status.syncState = state;
+            it->second.syncStateChanged = true;
+        }
+    }
+    mtx.unlock();
+}
+
+void MegaCmdSyncStatusTable::onSyncFileStateChanged(MegaSync *sync, string *localPath, int newState)
+{
+    if (!localPath)
+    {
+        return;
+    }
+
+    mtx.lock();
+    map<string, string>::iterator it = byLocalKey.find(*localPath);
+    if (it != byLocalKey.end())
+    {
+        syncrow &row = rows[it->second];
+        row.status.pathState = newState;
+        row.pathStateChanged = true;
+    }
+    mtx.unlock();
+}
+
+void MegaCmdSyncStatusTable::onNodesUpdate(MegaNodeList *nodes)
+{
+    bool foldersChanged = !nodes;
+    for (int i = 0; nodes && !foldersChanged && i < nodes->size(); i++)
+    {
+        MegaNode *n = nodes->get(i);
+        foldersChanged = n && n->getType() != MegaNode::TYPE_FILE;
+    }
+
+    if (foldersChanged)
+    {
+        mtx.lock();
+        pathsGeneration++;
+        mtx.unlock();
+    }
+}
+
+long long MegaCmdSyncStatusTable::getHits()
+{
+    mtx.lock();
+    long long toret = hits;
+    mtx.unlock();
+    return toret;
+}
+
+long long MegaCmdSyncStatusTable::getMisses()
+{
+    mtx.lock();
+    long long toret = misses;
+    mtx.unlock();
+    return toret;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file src/megacmdsyncstatus.h
+ * @brief MEGAcmd: Status of the configured syncs, kept from callbacks
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDSYNCSTATUS_H
+#define MEGACMDSYNCSTATUS_H
+
+#include "megacmd.h"
+
+#include <map>
+
+typedef struct syncstatus_struct
+{
+    std::string remotePath;
+    bool hasSync; // the sdk has a sync for it (i.e. it has not been removed)
+    int syncState; // MegaSync::SYNC_*, if hasSync
+    int pathState; // MegaApi::STATE_* of the local folder
+} syncstatus;
+
+/**
+ * @brief Status of the configured syncs (as listed by sync), so that listing them does not query the sdk
+ *
+ * The status of a sync is read the first time it is asked for, and kept up to date from then on
+ * with the callbacks of syncs (state and path state of their local folder) and nodes (remote paths
+ * are read again when folders change).
+ */
+class MegaCmdSyncStatusTable
+{
+private:
+    typedef struct syncrow_struct
+    {
+        mega::MegaHandle handle;
+        std::string localKey; // the local folder as sync callbacks give it
+        syncstatus status;
+        unsigned long long pathsGeneration; // of the remote path
+        bool loading; // a placeholder while its status is read from the sdk: callbacks received meanwhile are kept
+        bool syncStateChanged; // by a callback, while loading
+        bool pathStateChanged; // by a callback, while loading
+    } syncrow;
+
+    mega::MegaApi *api;
+    mega::MegaFileSystemAccess *fsAccess;
+    std::map<std::string, syncrow> rows; // by local path (as configured)
+    std::map<std::string, std::string> byLocalKey;
+    unsigned long long pathsGeneration; // increased whenever folders change
+    mega::MegaMutex mtx;
+
+    long long hits;
+    long long misses;
+
+    std::string getLocalKey(std::string localpath);
+    std::string getRemotePath(mega::MegaHandle handle);
+
+public:
+    MegaCmdSyncStatusTable(mega::MegaApi *api, mega::MegaFileSystemAccess *fsAccess);
+
+    /**
+     * @brief Gets the status of a configured sync (read from the sdk the first time).
+     * Not to be called from the thread of the MegaApi callbacks
+     */
+    void getStatus(const std::string &localpath, mega::MegaHandle handle, syncstatus *status);
+
+    /**
+     * @brief Makes the status of a sync be read again the next time (e.g. after adding or removing it)
+     */
+    void invalidate(const std::string &localpath);
+
+    void clear();
+
+    void onSyncStateChanged(mega::MegaSync *sync);
+    void onSyncFileStateChanged(mega::MegaSync *sync, std::string *localPath, int newState);
+
+    /**
+     * @param nodes nodes updated or NULL when everything should be considered outdated
+     */
+    void onNodesUpdate(mega::MegaNodeList *nodes);
+
+    long long getHits();
+    long long getMisses();
+};
+
+#endif // MEGACMDSYNCSTATUS_H
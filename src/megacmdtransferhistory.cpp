@@ -0,0 +1,243 @@
+/**
+ * @file src/megacmdtransferhistory.cpp
+ * @brief MEGAcmd: History of the transfers completed
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdtransferhistory.h"
+
+using namespace std;
+using namespace mega;
+
+MegaCmdTransferHistory::MegaCmdTransferHistory(size_t capacity)
+{
+    this->capacity = std::max(capacity, (size_t)1);
+    lastSequence = 0;
+    mtx.init(false);
+}
+
+unsigned int MegaCmdTransferHistory::intern(const string &s)
+{
+    map<string, unsigned int>::iterator it = stringIds.find(s);
+    if (it != stringIds.end())
+    {
+        references[it->second]++;
+        return it->second;
+    }
+
+    unsigned int id;
+    if (freeIds.size())
+    {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+    else
+    {
+        id = (unsigned int)strings.size();
+        strings.push_back(stringIds.end());
+        references.push_back(0);
+    }
+    strings[id] = stringIds.insert(pair<string, unsigned int>(s, id)).first;
+    references[id] = 1;
+    return id;
+}
+
+void MegaCmdTransferHistory::release(unsigned int id)
+{
+    if (id == NOINTERNEDSTRING)
+    {
+        return;
+    }
+    if (!--references[id])
+    {
+        stringIds.erase(strings[id]);
+        strings[id] = stringIds.end();
+        freeIds.push_back(id);
+    }
+}
+
+void MegaCmdTransferHistory::evict(completedtransfer *r)
+{
+    map<MegaHandle, unsigned long long>::iterator it = byHandle.find(r->nodeHandle);
+    if (it != byHandle.end() && it->second == r->sequence) // a later transfer of the node keeps it indexed
+    {
+        byHandle.erase(it);
+    }
+    release(r->parentPath);
+    release(r->fileName);
+    release(r->remotePath);
+}
+
+completedtransfer *MegaCmdTransferHistory::getRecord(unsigned long long sequence)
+{
+    if (!sequence || sequence > lastSequence || lastSequence - sequence >= records.size())
+    {
+        return NULL;
+    }
+    return &records[(sequence - 1) % capacity];
+}
+
+void MegaCmdTransferHistory::add(MegaTransfer *transfer)
+{
+    completedtransfer r;
+    r.tag = transfer->getTag();
+    r.type = transfer->getType();
+    r.state = transfer->getState();
+    r.sync = transfer->isSyncTransfer();
+    r.transferredBytes = transfer->getTransferredBytes();
+    r.totalBytes = transfer->getTotalBytes();
+    r.nodeHandle = transfer->getNodeHandle();
+    r.parentHandle = transfer->getParentHandle();
+    r.remotePath = NOINTERNEDSTRING;
+
+    mtx.lock();
+    r.sequence = ++lastSequence;
+    r.parentPath = intern(transfer->getParentPath() ? transfer->getParentPath() : "");
+    r.fileName = intern(transfer->getFileName() ? transfer->getFileName() : "");
+
+    if (records.size() < capacity)
+    {
+        records.push_back(r);
+    }
+    else
+    {
+        completedtransfer *slot = &records[(r.sequence - 1) % capacity];
+        evict(slot);
+        *slot = r;
+    }
+    if (r.nodeHandle != INVALID_HANDLE)
+    {
+        byHandle[r.nodeHandle] = r.sequence;
+    }
+    mtx.unlock();
+}
+
+vector<completedtransfer> MegaCmdTransferHistory::getLast(size_t count, bool uploads, bool downloads, bool syncs)
+{
+    vector<completedtransfer> toret;
+    mtx.lock();
+    for (unsigned long long s = lastSequence; toret.size() < count; s--)
+    {
+        completedtransfer *r = getRecord(s);
+        if (!r)
+        {
+            break;
+        }
+        if (((r->type == MegaTransfer::TYPE_UPLOAD && uploads) || (r->type == MegaTransfer::TYPE_DOWNLOAD && downloads))
+                && (syncs || !r->sync))
+        {
+            toret.push_back(*r);
+        }
+    }
+    mtx.unlock();
+    return toret;
+}
+
+bool MegaCmdTransferHistory::getByHandle(MegaHandle h, completedtransfer *record)
+{
+    mtx.lock();
+    map<MegaHandle, unsigned long long>::iterator it = byHandle.find(h);
+    completedtransfer *r = (it != byHandle.end()) ? getRecord(it->second) : NULL;
+    if (r)
+    {
+        *record = *r;
+    }
+    mtx.unlock();
+    return r != NULL;
+}
+
+string MegaCmdTransferHistory::getRemotePath(MegaApi *api, const completedtransfer &record)
+{
+    mtx.lock();
+    completedtransfer *r = getRecord(record.sequence);
+    if (r && r->remotePath != NOINTERNEDSTRING)
+    {
+        string toret = strings[r->remotePath]->first;
+        mtx.unlock();
+        return toret;
+    }
+    mtx.unlock();
+
+    string path;
+    MegaNode *node = api->getNodeByHandle(record.type == MegaTransfer::TYPE_DOWNLOAD ? record.nodeHandle : record.parentHandle);
+    if (node)
+    {
+        char *nodepath = api->getNodePath(node);
+        if (nodepath)
+        {
+            path = nodepath;
+            delete [] nodepath;
+        }
+        delete node;
+    }
+
+    if (path.size())
+    {
+        // kept for when the node is gone
+        mtx.lock();
+        r = getRecord(record.sequence);
+        if (r && r->remotePath == NOINTERNEDSTRING)
+        {
+            r->remotePath = intern(path);
+        }
+        mtx.unlock();
+    }
+    return path;
+}
+
+string MegaCmdTransferHistory::getLocalPath(const completedtransfer &record)
+{
+    mtx.lock();
+    string toret;
+    if (getRecord(record.sequence))
+    {
+        toret = strings[record.parentPath]->first + strings[record.fileName]->first;
+    }
+    mtx.unlock();
+    return toret;
+}
+
+string MegaCmdTransferHistory::getFileName(const completedtransfer &record)
+{
+    mtx.lock();
+    string toret;
+    if (getRecord(record.sequence))
+    {
+        toret = strings[record.fileName]->first;
+    }
+    mtx.unlock();
+    return toret;
+}
+
+size_t MegaCmdTransferHistory::size()
+{
+    mtx.lock();
+    size_t toret = records.size();
+    mtx.unlock();
+    return toret;
+}
+
+size_t MegaCmdTransferHistory::getCapacity()
+{
+    return capacity;
+}
+
+size_t MegaCmdTransferHistory::getNumberOfStrings()
+{
+    mtx.lock();
+    size_t toret = stringIds.size();
+    mtx.unlock();
+    return toret;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file src/megacmdtransferhistory.h
+ * @brief MEGAcmd: History of the transfers completed
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDTRANSFERHISTORY_H
+#define MEGACMDTRANSFERHISTORY_H
+
+#include "megacmd.h"
+
+#include <map>
+#include <vector>
+
+#define DEFAULTCOMPLETEDTRANSFERS 10000
+#define NOINTERNEDSTRING 0xFFFFFFFF
+
+typedef struct completedtransfer_struct
+{
+    unsigned long long sequence; // in the order they were completed, from 1
+    int tag;
+    int type; // MegaTransfer::TYPE_*
+    int state;
+    bool sync;
+    long long transferredBytes;
+    long long totalBytes;
+    mega::MegaHandle nodeHandle;
+    mega::MegaHandle parentHandle;
+    unsigned int parentPath; // local folder (interned)
+    unsigned int fileName; // interned
+    unsigned int remotePath; // of the node for downloads and of the parent for uploads (interned), once resolved
+} completedtransfer;
+
+/**
+ * @brief The last transfers completed, in a ring of fixed-size records
+ *
+ * The strings of the records (local folders and names) are interned, so that the many transfers
+ * of a folder share it. Remote paths are not resolved when the transfers finish (which would lock
+ * the SDK in its own thread) but the first time they are asked for, and kept from then on.
+ * The last record of every node is indexed by its handle.
+ */
+class MegaCmdTransferHistory
+{
+private:
+    std::vector<completedtransfer> records; // the one of sequence s is at (s - 1) % capacity
+    unsigned long long lastSequence;
+    size_t capacity;
+    std::map<mega::MegaHandle, unsigned long long> byHandle; // sequence of the last record of every node
+
+    std::map<std::string, unsigned int> stringIds;
+    std::vector<std::map<std::string, unsigned int>::iterator> strings; // by id
+    std::vector<unsigned int> references; // records using every string
+    std::vector<unsigned int> freeIds;
+
+    mega::MegaMutex mtx;
+
+    // the following require mtx to be locked
+    unsigned int intern(const std::string &s);
+    void release(unsigned int id);
+    void evict(completedtransfer *r);
+    completedtransfer *getRecord(unsigned long long sequence);
+
+public:
+    MegaCmdTransferHistory(size_t capacity);
+
+    void add(mega::MegaTransfer *transfer);
+
+    /**
+     * @brief Gets the last records (most recent first)
+     * @param count maximum number of them
+     * @param uploads, downloads, syncs types of the ones to get
+     */
+    std::vector<completedtransfer> getLast(size_t count, bool uploads, bool downloads, bool syncs);
+
+    /**
+     * @brief Gets the last record of a node
+     * @return false if there is none
+     */
+    bool getByHandle(mega::MegaHandle h, completedtransfer *record);
+
+    /**
+     * @brief Gets the remote path of a record, resolving it if it has not been yet
+     * @return the path, empty if it cannot be resolved (e.g. the node was removed before)
+     */
+    std::string getRemotePath(mega::MegaApi *api, const completedtransfer &record);
+
+    std::string getLocalPath(const completedtransfer &record);
+    std::string getFileName(const completedtransfer &record);
+
+    size_t size();
+    size_t getCapacity();
+    size_t getNumberOfStrings();
+};
+
+#endif // MEGACMDTRANSFERHISTORY_H
@@ -0,0 +1,280 @@
+/**
+ * @file src/megacmdtreewalker.cpp
+ * @brief MEGAcmd: Parallel traversal of remote trees
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdtreewalker.h"
+#include "megacmdlogger.h"
+
+using namespace std;
+using namespace mega;
+
+MegaCmdTreeWalker::MegaCmdTreeWalker(MegaApi *api, int threads)
+{
+    this->api = api;
+    pool = NULL;
+    if (threads > 1)
+    {
+        // depth first for the owner of a subtree, breadth first for thieves: bigger subtrees are stolen
+        pool = new MegaCmdWorkerPool(min(threads, MAXTRAVERSALTHREADS), true);
+    }
+}
+
+void *MegaCmdTreeWalker::runTask(void *arg)
+{
+    treetask *t = (treetask *)arg;
+    t->context->walker->processTask(t);
+    return NULL;
+}
+
+MegaCmdTreeWalker::treetask *MegaCmdTreeWalker::newTask(walkcontext *context, MegaNode *n, int depth, treetask *parent)
+{
+    treetask *t = new treetask;
+    t->context = context;
+    t->node = n;
+    t->depth = depth;
+    t->parent = parent;
+    t->result = NULL;
+    t->childrenList = NULL;
+    t->pendingChildren = 0;
+    t->done = false;
+    return t;
+}
+
+void MegaCmdTreeWalker::queueTask(treetask *t)
+{
+    if (pool)
+    {
+        pool->submit(runTask, t);
+    }
+    else
+    {
+        processTask(t);
+    }
+}
+
+void MegaCmdTreeWalker::processTask(treetask *t)
+{
+    MegaCmdTreeVisitor *visitor = t->context->visitor;
+
+    t->result = visitor->newResult();
+    if (visitor->visit(t->node, t->depth, t->result) && t->node->getType() != MegaNode::TYPE_FILE)
+    {
+        t->childrenList = api->getChildren(t->node);
+        if (t->childrenList)
+        {
+            visitor->visitChildren(t->node, t->depth, t->childrenList, t->result);
+        }
+    }
+
+    vector<treetask *> folders;
+    if (t->childrenList)
+    {
+        t->children.reserve(t->childrenList->size());
+        for (int i = 0; i < t->childrenList->size(); i++)
+        {
+            MegaNode *child = t->childrenList->get(i);
+            treetask *ct = newTask(t->context, child, t->depth + 1, t);
+            t->children.push_back(ct);
+
+            if (child->getType() == MegaNode::TYPE_FILE)
+            {
+                // not worth a task of its own
+                ct->result = visitor->newResult();
+                visitor->visit(child, ct->depth, ct->result);
+                ct->done = true;
+            }
+            else
+            {
+                folders.push_back(ct);
+            }
+        }
+    }
+
+    if (folders.empty())
+    {
+        completeTask(t);
+        return;
+    }
+
+    t->pendingChildren = int(folders.size());
+    // t might be completed (and deleted) by another thread as soon as the last subfolder is queued.
+    // Queued in reverse order so that the owner (LIFO) takes the first ones first
+    for (int i = int(folders.size()) - 1; i >= 0; i--)
+    {
+        queueTask(folders[i]);
+    }
+}
+
+void MegaCmdTreeWalker::reduceChildren(treetask *t)
+{
+    MegaCmdTreeVisitor *visitor = t->context->visitor;
+
+    MegaCmdTreeResult *into = t->result;
+    if (visitor->postOrder() && t->children.size())
+    {
+        into = visitor->newResult();
+    }
+
+    for (unsigned int i = 0; i < t->children.size(); i++)
+    {
+        treetask *ct = t->children[i];
+        if (ct->result)
+        {
+            visitor->reduce(into, ct->result);
+            delete ct->result;
+        }
+        delete ct;
+    }
+    t->children.clear();
+
+    if (into != t->result)
+    {
+        visitor->reduce(into, t->result);
+        delete t->result;
+        t->result = into;
+    }
+
+    delete t->childrenList;
+    t->childrenList = NULL;
+}
+
+void MegaCmdTreeWalker::completeTask(treetask *t)
+{
+    walkcontext *context = t->context;
+    while (t)
+    {
+        reduceChildren(t);
+
+        treetask *parent = t->parent;
+        if (!parent)
+        {
+            // a subtree of the first node: its thread is waiting for it
+            context->mtx.lock();
+            t->done = true;
+            context->mtx.unlock();
+            context->subtreeCompleted.release();
+            return;
+        }
+
+        context->mtx.lock();
+        bool lastOne = --parent->pendingChildren == 0;
+        context->mtx.unlock();
+
+        t = lastOne ? parent : NULL;
+    }
+}
+
+MegaCmdTreeResult *MegaCmdTreeWalker::walk(MegaNode *n, MegaCmdTreeVisitor *visitor, int depth)
+{
+    if (!n)
+    {
+        return NULL;
+    }
+
+    walkcontext context;
+    context.walker = this;
+    context.visitor = visitor;
+    context.mtx.init(false);
+
+    bool streaming = visitor->streams() && !visitor->postOrder();
+
+    // the first node is visited here, its subtrees are the ones spread among the pool
+    treetask *root = newTask(&context, n, depth, NULL);
+    root->result = visitor->newResult();
+    if (visitor->visit(n, depth, root->result) && n->getType() != MegaNode::TYPE_FILE)
+    {
+        root->childrenList = api->getChildren(n);
+        if (root->childrenList)
+        {
+            visitor->visitChildren(n, depth, root->childrenList, root->result);
+        }
+    }
+
+    if (streaming)
+    {
+        visitor->consume(root->result);
+        delete root->result;
+        root->result = NULL;
+    }
+
+    if (root->childrenList)
+    {
+        root->children.reserve(root->childrenList->size());
+        for (int i = 0; i < root->childrenList->size(); i++)
+        {
+            root->children.push_back(newTask(&context, root->childrenList->get(i), depth + 1, NULL));
+        }
+        for (unsigned int i = 0; i < root->children.size(); i++)
+        {
+            queueTask(root->children[i]);
+        }
+
+        // results are gathered in order, whatever the order they are completed in
+        for (unsigned int i = 0; i < root->children.size(); i++)
+        {
+            treetask *ct = root->children[i];
+            context.mtx.lock();
+            while (!ct->done)
+            {
+                context.mtx.unlock();
+                context.subtreeCompleted.wait();
+                context.mtx.lock();
+            }
+            context.mtx.unlock();
+
+            if (streaming)
+            {
+                visitor->consume(ct->result);
+                delete ct->result;
+                ct->result = NULL;
+            }
+        }
+    }
+
+    if (streaming)
+    {
+        root->result = NULL;
+        for (unsigned int i = 0; i < root->children.size(); i++)
+        {
+            delete root->children[i];
+        }
+        root->children.clear();
+        delete root->childrenList;
+    }
+    else
+    {
+        reduceChildren(root);
+    }
+
+    MegaCmdTreeResult *toret = root->result;
+    delete root;
+    return toret;
+}
+
+int MegaCmdTreeWalker::getNumberOfThreads()
+{
+    return pool ? pool->getNumberOfWorkers() : 1;
+}
+
+MegaCmdTreeWalker::~MegaCmdTreeWalker()
+{
+    if (pool)
+    {
+        pool->stop();
+        delete pool;
+    }
+}
@@ -0,0 +1,157 @@
+/**
+ * @file src/megacmdtreewalker.h
+ * @brief MEGAcmd: Parallel traversal of remote trees
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDTREEWALKER_H
+#define MEGACMDTREEWALKER_H
+
+#include "megacmd.h"
+#include "megacmdworkerpool.h"
+
+#include <vector>
+
+#define MAXTRAVERSALTHREADS 64
+
+/**
+ * @brief Partial result of a traversal: what has been gathered from a node (and its subtree)
+ */
+class MegaCmdTreeResult
+{
+public:
+    virtual ~MegaCmdTreeResult() {}
+};
+
+/**
+ * @brief What to do with every node of a traversal.
+ *
+ * visit will be called concurrently for different nodes, so it must only write to the result
+ * it receives. Results are reduced in the order of the tree (the one of MegaApi::getChildren),
+ * regardless of the order in which nodes were visited.
+ */
+class MegaCmdTreeVisitor
+{
+public:
+    virtual ~MegaCmdTreeVisitor() {}
+
+    virtual MegaCmdTreeResult *newResult() = 0;
+
+    /**
+     * @brief Gathers the results of a node
+     * @param depth depth of the node (the one given to MegaCmdTreeWalker::walk for the first node)
+     * @return whether to descend into its children
+     */
+    virtual bool visit(mega::MegaNode *n, int depth, MegaCmdTreeResult *result) = 0;
+
+    /**
+     * @brief Gathers the results of a node that require its children. Called after visit
+     * when descending into them
+     */
+    virtual void visitChildren(mega::MegaNode *n, int depth, mega::MegaNodeList *children, MegaCmdTreeResult *result) {}
+
+    /**
+     * @brief Appends the results in "from" to "into". "from" will be deleted afterwards
+     */
+    virtual void reduce(MegaCmdTreeResult *into, MegaCmdTreeResult *from) = 0;
+
+    /**
+     * @brief Whether the results of a node go after the ones of its children (default: before)
+     */
+    virtual bool postOrder()
+    {
+        return false;
+    }
+
+    /**
+     * @brief Whether the results of the subtrees of the first node are to be given to consume
+     * (in order, as soon as they are completed) instead of being reduced into the final result.
+     * To keep output flowing and memory bounded when the results are only to be printed.
+     * Not compatible with postOrder.
+     */
+    virtual bool streams()
+    {
+        return false;
+    }
+
+    /**
+     * @brief Receives the results of the first node and then the ones of each of its subtrees,
+     * from the thread that called MegaCmdTreeWalker::walk. Only used when streams returns true
+     */
+    virtual void consume(MegaCmdTreeResult *result) {}
+};
+
+/**
+ * @brief Traverses remote trees spreading their subtrees among a pool of threads
+ *
+ * Every folder is a task of the pool. A task visits its node and the files in it, and queues
+ * its subfolders. The last of its subfolders to be completed reduces the results of all its
+ * children in order and completes its parent, up to the first node, whose subtrees are
+ * awaited by the calling thread.
+ */
+class MegaCmdTreeWalker
+{
+private:
+    typedef struct walkcontext_struct
+    {
+        MegaCmdTreeWalker *walker;
+        MegaCmdTreeVisitor *visitor;
+        mega::MegaMutex mtx; // protects pendingChildren & done of the tasks of the walk
+        mega::MegaSemaphore subtreeCompleted;
+    } walkcontext;
+
+    typedef struct treetask_struct
+    {
+        walkcontext *context;
+        mega::MegaNode *node;
+        int depth;
+        struct treetask_struct *parent; // NULL for the subtrees of the first node
+        MegaCmdTreeResult *result;
+        mega::MegaNodeList *childrenList;
+        std::vector<struct treetask_struct *> children; // in the order of childrenList
+        int pendingChildren;
+        bool done;
+    } treetask;
+
+    mega::MegaApi *api;
+    MegaCmdWorkerPool *pool; // NULL to traverse in the calling thread
+
+    static void *runTask(void *arg);
+
+    treetask *newTask(walkcontext *context, mega::MegaNode *n, int depth, treetask *parent);
+    void queueTask(treetask *t);
+    void processTask(treetask *t);
+    void completeTask(treetask *t);
+    void reduceChildren(treetask *t);
+
+public:
+    /**
+     * @param threads number of threads to traverse with. With less than 2, trees are traversed
+     * by the calling thread
+     */
+    MegaCmdTreeWalker(mega::MegaApi *api, int threads);
+    ~MegaCmdTreeWalker();
+
+    /**
+     * @brief Traverses the tree of n
+     * @return the results of the whole tree (to be deleted by the caller), or NULL when the
+     * visitor streams (everything will have been consumed)
+     */
+    MegaCmdTreeResult *walk(mega::MegaNode *n, MegaCmdTreeVisitor *visitor, int depth = 0);
+
+    int getNumberOfThreads();
+};
+
+#endif // MEGACMDTREEWALKER_H
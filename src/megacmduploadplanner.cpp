@@ -0,0 +1,558 @@
+/**
+ * @file src/megacmduploadplanner.cpp
+ * @brief MEGAcmd: Planning of uploads of local trees
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmduploadplanner.h"
+#include "megacmdfoldercreator.h"
+#include "megacmdutils.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace mega;
+
+#ifdef _WIN32
+#define LOCALSEPARATOR "\\"
+#else
+#define LOCALSEPARATOR "/"
+#endif
+
+static int sizeBucket(long long size)
+{
+    int bucket = 0;
+    while (size >= 4)
+    {
+        size >>= 2;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * @brief Gets a node by its handle, keeping it in nodes to be reused
+ */
+static MegaNode *getCachedNode(MegaApi *api, map<MegaHandle, MegaNode *> *nodes, MegaHandle h)
+{
+    map<MegaHandle, MegaNode *>::iterator it = nodes->find(h);
+    if (it != nodes->end())
+    {
+        return it->second;
+    }
+    MegaNode *n = api->getNodeByHandle(h);
+    (*nodes)[h] = n;
+    return n;
+}
+
+static void deleteCachedNodes(map<MegaHandle, MegaNode *> *nodes)
+{
+    for (map<MegaHandle, MegaNode *>::iterator it = nodes->begin(); it != nodes->end(); it++)
+    {
+        delete it->second;
+    }
+    nodes->clear();
+}
+
+MegaCmdUploadPlanner::MegaCmdUploadPlanner(MegaApi *api, MegaFileSystemAccess *fsAccess, MegaCmdWorkerPool *pool)
+{
+    this->api = api;
+    this->fsAccess = fsAccess;
+    this->pool = pool;
+    totalBytes = 0;
+    fingerprintCache = NULL;
+    skipped = 0;
+}
+
+MegaCmdUploadPlanner::~MegaCmdUploadPlanner()
+{
+    clear();
+}
+
+bool MegaCmdUploadPlanner::add(string localPath, MegaNode *parent, string newname)
+{
+#ifdef _WIN32
+    replaceAll(localPath, "/", "\\");
+#endif
+    string localpath;
+    fsAccess->path2local(&localPath, &localpath);
+    FileAccess *fa = fsAccess->newfileaccess();
+
+    addedpath a;
+    a.folder = NULL;
+    if (fa->isfolder(&localpath))
+    {
+        while (localPath.size() > 1 && (localPath[localPath.size() - 1] == '/' || localPath[localPath.size() - 1] == '\\'))
+        {
+            localPath.resize(localPath.size() - 1);
+        }
+        size_t lastSeparator = localPath.find_last_of("/\\");
+        a.folder = new plannedfolder;
+        a.folder->localPath = localPath;
+        a.folder->name = newname.size() ? newname : localPath.substr(lastSeparator == string::npos ? 0 : lastSeparator + 1);
+        a.folder->parent = NULL;
+        a.folder->remoteParent = parent->getHandle();
+        a.folder->handle = UNDEF;
+        a.folder->depth = 0;
+    }
+    else if (fa->fopen(&localpath, true, false))
+    {
+        a.file.localPath = localPath;
+        a.file.newname = newname;
+        a.file.folder = NULL;
+        a.file.parent = parent->getHandle();
+        a.file.position = 0;
+        a.file.started = false;
+        a.file.replaced = UNDEF;
+        readAttributes(fa, &a.file);
+    }
+    else
+    {
+        delete fa;
+        return false;
+    }
+    delete fa;
+
+    added.push_back(a);
+    return true;
+}
+
+void MegaCmdUploadPlanner::readAttributes(FileAccess *fa, plannedupload *pu)
+{
+    pu->size = fa->size;
+    pu->mtime = fa->mtime;
+    pu->inode = fa->fsidvalid ? fa->fsid : 0;
+}
+
+void *MegaCmdUploadPlanner::runScanTask(void *arg)
+{
+    scantask *t = (scantask *)arg;
+    t->context->planner->scanFolder(t->context, t->folder);
+    delete t;
+    return NULL;
+}
+
+void MegaCmdUploadPlanner::queueScan(scancontext *context, plannedfolder *folder)
+{
+    if (pool)
+    {
+        scantask *t = new scantask;
+        t->context = context;
+        t->folder = folder;
+        pool->submit(runScanTask, t);
+    }
+    else
+    {
+        scanFolder(context, folder);
+    }
+}
+
+void MegaCmdUploadPlanner::scanFolder(scancontext *context, plannedfolder *folder)
+{
+    string localpath;
+    fsAccess->path2local(&folder->localPath, &localpath);
+
+    DirAccess *da = fsAccess->newdiraccess();
+    if (da->dopen(&localpath, NULL, false))
+    {
+        string localname;
+        nodetype_t type;
+        while (da->dnext(&localpath, &localname, false, &type))
+        {
+            string name;
+            fsAccess->local2path(&localname, &name);
+            string childPath = folder->localPath + LOCALSEPARATOR + name;
+
+            if (type == FOLDERNODE)
+            {
+                plannedfolder *subfolder = new plannedfolder;
+                subfolder->localPath = childPath;
+                subfolder->name = name;
+                subfolder->parent = folder;
+                subfolder->remoteParent = UNDEF;
+                subfolder->handle = UNDEF;
+                subfolder->depth = folder->depth + 1;
+                folder->subfolders.push_back(subfolder);
+            }
+            else if (type == FILENODE)
+            {
+                plannedupload pu;
+                pu.localPath = childPath;
+                pu.folder = folder;
+                pu.parent = UNDEF;
+                pu.position = 0;
+                pu.started = false;
+                pu.replaced = UNDEF;
+
+                string childlocalpath;
+                fsAccess->path2local(&childPath, &childlocalpath);
+                FileAccess *fa = fsAccess->newfileaccess();
+                if (fa->fopen(&childlocalpath, true, false))
+                {
+                    readAttributes(fa, &pu);
+                    folder->files.push_back(pu);
+                }
+                else
+                {
+                    LOG_warn << "Unable to read local file: " << childPath;
+                }
+                delete fa;
+            }
+        }
+    }
+    else
+    {
+        LOG_err << "Unable to list local folder: " << folder->localPath;
+    }
+    delete da;
+
+    context->mtx.lock();
+    context->pending += int(folder->subfolders.size());
+    context->mtx.unlock();
+
+    for (unsigned int i = 0; i < folder->subfolders.size(); i++)
+    {
+        queueScan(context, folder->subfolders[i]);
+    }
+
+    // released holding the lock, which scan takes before the context goes away: nothing of it is used after the unlock
+    context->mtx.lock();
+    if (--context->pending == 0)
+    {
+        context->scanned.release();
+    }
+    context->mtx.unlock();
+}
+
+void MegaCmdUploadPlanner::gather(plannedfolder *folder)
+{
+    folders.push_back(folder);
+    for (unsigned int i = 0; i < folder->files.size(); i++)
+    {
+        plannedupload &pu = folder->files[i];
+        pu.position = uploads.size();
+        uploads.push_back(pu);
+        totalBytes += pu.size;
+    }
+    folder->files.clear();
+
+    for (unsigned int i = 0; i < folder->subfolders.size(); i++)
+    {
+        gather(folder->subfolders[i]);
+    }
+}
+
+void MegaCmdUploadPlanner::scan(int order)
+{
+    scancontext context;
+    context.planner = this;
+    context.mtx.init(false);
+    context.pending = 0;
+
+    for (unsigned int i = 0; i < added.size(); i++)
+    {
+        if (added[i].folder)
+        {
+            context.pending++;
+        }
+    }
+
+    if (context.pending)
+    {
+        for (unsigned int i = 0; i < added.size(); i++)
+        {
+            if (added[i].folder)
+            {
+                queueScan(&context, added[i].folder);
+            }
+        }
+        context.scanned.wait();
+        context.mtx.lock(); // so that the last task is done with the context
+        context.mtx.unlock();
+    }
+
+    for (unsigned int i = 0; i < added.size(); i++)
+    {
+        if (added[i].folder)
+        {
+            gather(added[i].folder);
+        }
+        else
+        {
+            added[i].file.position = uploads.size();
+            uploads.push_back(added[i].file);
+            totalBytes += added[i].file.size;
+        }
+    }
+
+    if (order == ORDER_SMALLEST_FIRST)
+    {
+        std::sort(uploads.begin(), uploads.end(), smallerFirst);
+    }
+    else if (order == ORDER_SIZE_BUCKETS)
+    {
+        std::sort(uploads.begin(), uploads.end(), smallerBucketFirst);
+    }
+    std::stable_sort(folders.begin(), folders.end(), byDepth);
+}
+
+string MegaCmdUploadPlanner::getRemotePath(const plannedfolder *folder, MegaHandle *base)
+{
+    string path = folder->name;
+    while (folder->parent)
+    {
+        folder = folder->parent;
+        path = folder->name + "/" + path;
+    }
+    *base = folder->remoteParent;
+    return path;
+}
+
+int MegaCmdUploadPlanner::createRemoteFolders()
+{
+    MegaCmdFolderCreator creator(api);
+    vector<MegaHandle> bases(folders.size());
+    vector<string> paths(folders.size());
+    for (unsigned int i = 0; i < folders.size(); i++)
+    {
+        paths[i] = getRemotePath(folders[i], &bases[i]);
+        creator.add(bases[i], paths[i]);
+    }
+
+    int failed = creator.create();
+    for (unsigned int i = 0; i < folders.size(); i++)
+    {
+        folders[i]->handle = creator.getHandle(bases[i], paths[i]);
+        if (folders[i]->handle == UNDEF)
+        {
+            LOG_err << "Unable to create remote folder for " << folders[i]->localPath;
+        }
+    }
+    LOG_debug << "Remote folders created: " << creator.getNumberCreated() << " of " << folders.size();
+    return failed;
+}
+
+void MegaCmdUploadPlanner::start(MegaCmdMultiTransferListener *listener, int window)
+{
+    if (listener)
+    {
+        listener->expectTransfers(int(uploads.size()), totalBytes);
+    }
+
+    map<MegaHandle, MegaNode *> parents;
+    for (size_t i = 0; i < uploads.size(); i++)
+    {
+        plannedupload &pu = uploads[i];
+        MegaHandle h = pu.folder ? pu.folder->handle : pu.parent;
+        MegaNode *parent = (h != UNDEF) ? getCachedNode(api, &parents, h) : NULL; // UNDEF if its folder could not be created
+        bool skip = !parent;
+        if (parent && fingerprintCache && isUnchanged(pu, parent))
+        {
+            LOG_debug << "Skipping unchanged file: " << pu.localPath;
+            skipped++;
+            skip = true;
+        }
+        if (skip)
+        {
+            if (listener)
+            {
+                listener->expectTransfers(-1, -pu.size);
+            }
+            continue;
+        }
+
+        LOG_debug << "Starting upload: " << pu.localPath << " to : " << parent->getName() << (pu.newname.size() ? "/" : "") << pu.newname;
+        if (listener)
+        {
+            listener->waitForSlot(std::max(window, 1));
+            listener->onNewTransfer();
+        }
+        pu.started = true;
+        if (pu.newname.size())
+        {
+            api->startUpload(pu.localPath.c_str(), parent, pu.newname.c_str(), listener);
+        }
+        else
+        {
+            api->startUpload(pu.localPath.c_str(), parent, listener);
+        }
+    }
+
+    deleteCachedNodes(&parents);
+}
+
+string MegaCmdUploadPlanner::getRemoteName(const plannedupload &pu)
+{
+    if (pu.newname.size())
+    {
+        return pu.newname;
+    }
+    size_t lastSeparator = pu.localPath.find_last_of("/\\");
+    return pu.localPath.substr(lastSeparator == string::npos ? 0 : lastSeparator + 1);
+}
+
+bool MegaCmdUploadPlanner::isUnchanged(plannedupload &pu, MegaNode *parent)
+{
+    MegaNode *remote = api->getChildNode(parent, getRemoteName(pu).c_str());
+    if (remote && remote->getType() == MegaNode::TYPE_FILE)
+    {
+        pu.replaced = remote->getHandle();
+    }
+    if (!remote || remote->getType() != MegaNode::TYPE_FILE || !remote->getFingerprint() || remote->getSize() != pu.size)
+    {
+        delete remote;
+        return false;
+    }
+    string remoteFingerprint = remote->getFingerprint();
+    MegaHandle remoteHandle = remote->getHandle();
+    delete remote;
+
+    string fingerprint;
+    if (fingerprintCache->get(pu.localPath, pu.size, pu.mtime, pu.inode, &fingerprint, NULL))
+    {
+        return fingerprint == remoteFingerprint;
+    }
+
+    // not cached (or changed since): the file needs to be read
+    char *fp = api->getFingerprint(pu.localPath.c_str());
+    if (!fp)
+    {
+        return false;
+    }
+    fingerprint = fp;
+    delete [] fp;
+
+    bool unchanged = fingerprint == remoteFingerprint;
+    fingerprintCache->put(pu.localPath, pu.size, pu.mtime, pu.inode, fingerprint, unchanged ? remoteHandle : UNDEF);
+    return unchanged;
+}
+
+void MegaCmdUploadPlanner::setSkipUnchanged(MegaCmdFingerprintCache *cache)
+{
+    fingerprintCache = cache;
+}
+
+void MegaCmdUploadPlanner::recordUploads()
+{
+    if (!fingerprintCache)
+    {
+        return;
+    }
+
+    map<MegaHandle, MegaNode *> parents;
+    for (size_t i = 0; i < uploads.size(); i++)
+    {
+        plannedupload &pu = uploads[i];
+        if (!pu.started)
+        {
+            continue;
+        }
+        MegaNode *parent = getCachedNode(api, &parents, pu.folder ? pu.folder->handle : pu.parent);
+        if (!parent)
+        {
+            continue;
+        }
+
+        // the fingerprint of an uploaded file is the one of its local file when it was read.
+        // If the upload failed, the file found is the one it was to replace (or none)
+        MegaNode *remote = api->getChildNode(parent, getRemoteName(pu).c_str());
+        if (remote && remote->getType() == MegaNode::TYPE_FILE && remote->getHandle() != pu.replaced
+                && remote->getFingerprint() && remote->getSize() == pu.size && remote->getModificationTime() == pu.mtime)
+        {
+            fingerprintCache->put(pu.localPath, pu.size, pu.mtime, pu.inode, remote->getFingerprint(), remote->getHandle());
+        }
+        delete remote;
+    }
+    deleteCachedNodes(&parents);
+}
+
+void MegaCmdUploadPlanner::deleteFolder(plannedfolder *folder)
+{
+    for (unsigned int i = 0; i < folder->subfolders.size(); i++)
+    {
+        deleteFolder(folder->subfolders[i]);
+    }
+    delete folder;
+}
+
+void MegaCmdUploadPlanner::clear()
+{
+    for (unsigned int i = 0; i < added.size(); i++)
+    {
+        if (added[i].folder)
+        {
+            deleteFolder(added[i].folder);
+        }
+    }
+    added.clear();
+    folders.clear();
+    uploads.clear();
+    totalBytes = 0;
+    skipped = 0;
+}
+
+bool MegaCmdUploadPlanner::byDepth(const plannedfolder *a, const plannedfolder *b)
+{
+    return a->depth < b->depth;
+}
+
+bool MegaCmdUploadPlanner::smallerFirst(const plannedupload &a, const plannedupload &b)
+{
+    return a.size < b.size || (a.size == b.size && a.position < b.position);
+}
+
+bool MegaCmdUploadPlanner::smallerBucketFirst(const plannedupload &a, const plannedupload &b)
+{
+    int ba = sizeBucket(a.size);
+    int bb = sizeBucket(b.size);
+    return ba < bb || (ba == bb && a.position < b.position);
+}
+
+size_t MegaCmdUploadPlanner::getNumberOfUploads() const
+{
+    return uploads.size();
+}
+
+size_t MegaCmdUploadPlanner::getNumberOfFolders() const
+{
+    return folders.size();
+}
+
+size_t MegaCmdUploadPlanner::getNumberOfSkipped() const
+{
+    return skipped;
+}
+
+long long MegaCmdUploadPlanner::getTotalBytes() const
+{
+    return totalBytes;
+}
+
+int MegaCmdUploadPlanner::getOrder(string name)
+{
+    if (name == "tree")
+    {
+        return ORDER_TREE;
+    }
+    if (name == "smallest")
+    {
+        return ORDER_SMALLEST_FIRST;
+    }
+    if (name == "buckets")
+    {
+        return ORDER_SIZE_BUCKETS;
+    }
+    return -1;
+}
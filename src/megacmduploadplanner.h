@@ -0,0 +1,183 @@
+/**
+ * @file src/megacmduploadplanner.h
+ * @brief MEGAcmd: Planning of uploads of local trees
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDUPLOADPLANNER_H
+#define MEGACMDUPLOADPLANNER_H
+
+#include "megacmd.h"
+#include "megacmdworkerpool.h"
+#include "listeners.h"
+#include "megacmdfingerprintcache.h"
+
+#include <vector>
+
+#define DEFAULTUPLOADCONCURRENCY 32
+
+/**
+ * @brief The uploads of a set of local paths (e.g. the ones given to put), planned before any is started
+ *
+ * Local folders are scanned in parallel (every folder is a task of a pool of threads) into the
+ * remote folders to create and the files to upload into them. Remote folders are then created a
+ * level of the tree at a time (see MegaCmdFolderCreator), and files are submitted in the order
+ * requested, keeping a bounded number of them ongoing.
+ */
+class MegaCmdUploadPlanner
+{
+public:
+    enum
+    {
+        ORDER_TREE = 0, // as the local folders were listed
+        ORDER_SMALLEST_FIRST,
+        ORDER_SIZE_BUCKETS // by powers of 4 of their size, smaller first, keeping the order of the tree within each
+    };
+
+private:
+    struct plannedfolder_struct;
+    typedef struct plannedfolder_struct plannedfolder;
+
+    typedef struct plannedupload_struct
+    {
+        std::string localPath;
+        std::string newname; // empty to keep the local name
+        plannedfolder *folder; // where to upload it, or NULL for the remote parent it was added for
+        mega::MegaHandle parent;
+        long long size;
+        long long mtime;
+        unsigned long long inode; // 0 if unknown
+        size_t position; // in the order of the tree
+        bool started;
+        mega::MegaHandle replaced; // remote file with its name before starting it, when skipping unchanged files
+    } plannedupload;
+
+    struct plannedfolder_struct
+    {
+        std::string localPath;
+        std::string name;
+        plannedfolder *parent; // NULL for the ones added
+        mega::MegaHandle remoteParent; // for the ones added
+        mega::MegaHandle handle; // once created (or found)
+        int depth;
+        std::vector<plannedfolder *> subfolders; // in the order they were listed
+        std::vector<plannedupload> files;
+    };
+
+    typedef struct addedpath_struct
+    {
+        plannedfolder *folder; // NULL for files
+        plannedupload file;
+    } addedpath;
+
+    typedef struct scancontext_struct
+    {
+        MegaCmdUploadPlanner *planner;
+        mega::MegaMutex mtx; // protects pending
+        int pending; // folders still to be scanned
+        mega::MegaSemaphore scanned;
+    } scancontext;
+
+    typedef struct scantask_struct
+    {
+        scancontext *context;
+        plannedfolder *folder;
+    } scantask;
+
+    mega::MegaApi *api;
+    mega::MegaFileSystemAccess *fsAccess;
+    MegaCmdWorkerPool *pool; // NULL to scan in the calling thread
+    std::vector<addedpath> added; // in the order they were added
+    std::vector<plannedfolder *> folders; // all of them, by depth once scanned
+    std::vector<plannedupload> uploads; // all of them, once scanned
+    long long totalBytes;
+    MegaCmdFingerprintCache *fingerprintCache; // to skip unchanged files, NULL to upload all of them
+    size_t skipped;
+
+    static void *runScanTask(void *arg);
+    void scanFolder(scancontext *context, plannedfolder *folder);
+    void queueScan(scancontext *context, plannedfolder *folder);
+    void gather(plannedfolder *folder);
+    void deleteFolder(plannedfolder *folder);
+    std::string getRemotePath(const plannedfolder *folder, mega::MegaHandle *base);
+    void readAttributes(mega::FileAccess *fa, plannedupload *pu);
+    std::string getRemoteName(const plannedupload &pu);
+    bool isUnchanged(plannedupload &pu, mega::MegaNode *parent);
+
+    static bool byDepth(const plannedfolder *a, const plannedfolder *b);
+    static bool smallerFirst(const plannedupload &a, const plannedupload &b);
+    static bool smallerBucketFirst(const plannedupload &a, const plannedupload &b);
+
+public:
+    /**
+     * @param pool threads to scan local folders with (a folder per task), NULL to scan them in the
+     * calling thread. It must outlive the scans: their last tasks may still be finishing when they return
+     */
+    MegaCmdUploadPlanner(mega::MegaApi *api, mega::MegaFileSystemAccess *fsAccess, MegaCmdWorkerPool *pool);
+    ~MegaCmdUploadPlanner();
+
+    /**
+     * @brief Plans the upload of a local path into the remote folder parent, as uploadNode would do it
+     * @param newname name for the uploaded node (empty to keep the local one)
+     * @return false if the local path does not exist
+     */
+    bool add(std::string localPath, mega::MegaNode *parent, std::string newname);
+
+    /**
+     * @brief Lists the local folders added (in parallel) and sorts the uploads found
+     * @param order one of ORDER_TREE, ORDER_SMALLEST_FIRST, ORDER_SIZE_BUCKETS
+     */
+    void scan(int order);
+
+    /**
+     * @brief Creates (or finds) the remote folders of the local ones scanned, a level of the tree at a time
+     * @return the number of folders that could not be created (their contents will not be uploaded)
+     */
+    int createRemoteFolders();
+
+    /**
+     * @brief Starts the uploads planned, keeping at most "window" of them ongoing.
+     * Returns once all of them have been started (in background if there is no listener)
+     */
+    void start(MegaCmdMultiTransferListener *listener, int window);
+
+    /**
+     * @brief Makes start skip the files whose remote counterpart (a file with the same name in the
+     * remote folder) already has their fingerprint. The fingerprints of the local files are taken
+     * from cache when their size, modification time and inode did not change, and read otherwise
+     */
+    void setSkipUnchanged(MegaCmdFingerprintCache *cache);
+
+    /**
+     * @brief Caches the fingerprints (and handles) of the files uploaded by start.
+     * To be called once their transfers finished
+     */
+    void recordUploads();
+
+    void clear();
+
+    size_t getNumberOfUploads() const;
+    size_t getNumberOfFolders() const;
+    size_t getNumberOfSkipped() const;
+    long long getTotalBytes() const;
+
+    /**
+     * @brief Parses an order name ("tree", "smallest" or "buckets")
+     * @return the order or -1 if unknown
+     */
+    static int getOrder(std::string name);
+};
+
+#endif // MEGACMDUPLOADPLANNER_H
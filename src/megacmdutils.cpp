@@ -25,12 +25,17 @@
 #endif
 
 #ifdef _WIN32
+#include <io.h> // _commit
 #else
 #include <sys/ioctl.h> // console size
+#include <sys/time.h> // gettimeofday
+#include <unistd.h> // sysconf, fsync
+#include <fcntl.h> // open
 #endif
 
 #include <iomanip>
 #include <fstream>
+#include <stdio.h>
 #include <time.h>
 
 using namespace std;
@@ -544,6 +549,15 @@ bool hasWildCards(string &what)
     return what.find('*') != string::npos || what.find('?') != string::npos;
 }
 
+bool isAbsolutePath(string localPath)
+{
+#ifdef _WIN32
+    return (localPath.size() > 1 && localPath[1] == ':') || (localPath.size() && (localPath[0] == '\\' || localPath[0] == '/'));
+#else
+    return localPath.size() && localPath[0] == '/';
+#endif
+}
+
 const char *fillStructWithSYYmdHMS(string &stime, struct tm &dt)
 {
     memset(&dt, 0, sizeof(struct tm));
@@ -1267,46 +1281,132 @@ bool megacmdWildcardMatch(const char *pszString, const char *pszMatch)
 
 bool patternMatches(const char *what, const char *pattern, bool usepcre)
 {
+    PatternMatcher matcher(pattern, usepcre);
+    return matcher.matches(what);
+}
+
+PatternMatcher::PatternMatcher(const string &pattern, bool usepcre)
+{
+    this->pattern = pattern;
+    regex = NULL;
+
     if (usepcre)
     {
+        type = MATCHER_NONE;
 #ifdef USE_PCRE
-        pcrecpp::RE re(pattern);
-        if (re.error().length())
+        pcrecpp::RE *re = new pcrecpp::RE(pattern);
+        if (re->error().length())
         {
             //In case the user supplied non-pcre regexp with * or ? in it.
             string newpattern(pattern);
             replaceAll(newpattern,"*",".*");
             replaceAll(newpattern,"?",".");
-            re=pcrecpp::RE(newpattern);
+            delete re;
+            re = new pcrecpp::RE(newpattern);
         }
 
-        if (!re.error().length())
+        if (!re->error().length())
         {
-            bool toret = re.FullMatch(what);
-
-            return toret;
+            regex = re;
+            type = MATCHER_REGEX;
         }
         else
         {
-            LOG_warn << "Invalid PCRE regex: " << re.error();
-            return false;
+            LOG_warn << "Invalid PCRE regex: " << re->error();
+            delete re;
         }
 #elif __cplusplus >= 201103L && !defined(__MINGW32__)
         try
         {
-            return std::regex_match(what, std::regex(pattern));
+            regex = new std::regex(pattern);
+            type = MATCHER_REGEX;
         }
         catch (std::regex_error e)
         {
             LOG_warn << "Couldn't compile regex: " << pattern;
-            return false;
         }
-#endif
+#else
         LOG_warn << " PCRE not supported";
-        return false;
+#endif
+        return;
     }
 
-    return megacmdWildcardMatch(what,pattern);
+    size_t firstwildcard = pattern.find_first_of("*?");
+    if (firstwildcard == string::npos)
+    {
+        type = MATCHER_LITERAL;
+    }
+    else if (pattern.find('?') == string::npos && pattern.find('*') == pattern.rfind('*'))
+    {
+        if (pattern.size() == 1)
+        {
+            type = MATCHER_ANY;
+        }
+        else
+        {
+            type = MATCHER_PREFIXSUFFIX;
+            prefix = pattern.substr(0, firstwildcard);
+            suffix = pattern.substr(firstwildcard + 1);
+        }
+    }
+    else
+    {
+        type = MATCHER_WILDCARD;
+    }
+}
+
+PatternMatcher::~PatternMatcher()
+{
+    if (regex)
+    {
+#ifdef USE_PCRE
+        delete (pcrecpp::RE *)regex;
+#elif __cplusplus >= 201103L && !defined(__MINGW32__)
+        delete (std::regex *)regex;
+#endif
+    }
+}
+
+bool PatternMatcher::matches(const char *what) const
+{
+    switch (type)
+    {
+        case MATCHER_ANY:
+            return true;
+
+        case MATCHER_LITERAL:
+            return pattern == what;
+
+        case MATCHER_PREFIXSUFFIX:
+        {
+            size_t len = strlen(what);
+            return len >= prefix.size() + suffix.size()
+                    && !prefix.compare(0, prefix.size(), what, prefix.size())
+                    && !suffix.compare(0, suffix.size(), what + len - suffix.size(), suffix.size());
+        }
+
+        case MATCHER_WILDCARD:
+            return megacmdWildcardMatch(what, pattern.c_str());
+
+        case MATCHER_REGEX:
+#ifdef USE_PCRE
+            return ((pcrecpp::RE *)regex)->FullMatch(what);
+#elif __cplusplus >= 201103L && !defined(__MINGW32__)
+            return std::regex_match(what, *(std::regex *)regex);
+#endif
+        default:
+            return false;
+    }
+}
+
+bool PatternMatcher::isLiteral() const
+{
+    return type == MATCHER_LITERAL;
+}
+
+const string &PatternMatcher::getPattern() const
+{
+    return pattern;
 }
 
 int toInteger(string what, int failValue)
@@ -1713,6 +1813,18 @@ unsigned int getNumberOfCols(unsigned int defaultwidth)
     return defaultwidth;
 }
 
+unsigned int getNumberOfCores()
+{
+#ifdef _WIN32
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    return sysinfo.dwNumberOfProcessors ? sysinfo.dwNumberOfProcessors : 1;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (unsigned int)cores : 1;
+#endif
+}
+
 void sleepSeconds(int seconds)
 {
 #ifdef _WIN32
@@ -1731,6 +1843,29 @@ void sleepMicroSeconds(long microseconds)
 #endif
 }
 
+long long getMonotonicMicroSeconds()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    if (!frequency.QuadPart)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (long long)(counter.QuadPart / frequency.QuadPart * 1000000
+                       + (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+#elif defined(__MACH__)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
 bool isValidEmail(string email)
 {
     return !( (email.find("@") == string::npos)
@@ -1745,6 +1880,67 @@ string &ltrimProperty(string &s, const char &c)
     return s;
 }
 
+bool writeFileAtomically(string path, const string &contents, bool binary)
+{
+    string temporaryPath = path + ".tmp";
+    FILE *fo = fopen(temporaryPath.c_str(), binary ? "wb" : "w");
+    if (!fo)
+    {
+        return false;
+    }
+
+    // the contents must be on disk before the rename: otherwise a crash could leave an empty file behind
+    bool written = fwrite(contents.data(), 1, contents.size(), fo) == contents.size() && flushFileToDisk(fo);
+    if (fclose(fo) || !written)
+    {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    if (!MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+#else
+    if (rename(temporaryPath.c_str(), path.c_str()))
+#endif
+    {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    flushParentFolderToDisk(path);
+    return true;
+}
+
+bool flushFileToDisk(FILE *file)
+{
+    if (fflush(file))
+    {
+        return false;
+    }
+#ifdef _WIN32
+    return !_commit(_fileno(file));
+#else
+    return !fsync(fileno(file));
+#endif
+}
+
+bool flushParentFolderToDisk(string path)
+{
+#ifdef _WIN32
+    return true;
+#else
+    size_t pos = path.find_last_of('/');
+    string folder = pos == string::npos ? "." : ( pos ? path.substr(0, pos) : "/" );
+    int fd = open(folder.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool flushed = !fsync(fd);
+    close(fd);
+    return flushed;
+#endif
+}
+
 string &rtrimProperty(string &s, const char &c)
 {
     size_t pos = s.find_last_not_of(c);
@@ -1851,3 +2047,18 @@ bool nodeNameIsVersion(string &nodeName)
     }
     return isversion;
 }
+
+string escapeNodeName(const string &name)
+{
+    string escaped;
+    escaped.reserve(name.size());
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        if (name[i] == '\\' || name[i] == '/')
+        {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(name[i]);
+    }
+    return escaped;
+}
@@ -21,6 +21,8 @@
 
 #include "megacmd.h"
 
+#include <stdio.h>
+
 /* mega::MegaNode info extracting*/
 void getNumFolderFiles(mega::MegaNode *, mega::MegaApi *, long long *nfiles, long long *nfolders);
 
@@ -66,6 +68,25 @@ bool isPublicLink(std::string link);
 
 bool hasWildCards(std::string &what);
 
+bool isAbsolutePath(std::string localPath);
+
+/**
+ * @brief Replaces the contents of a file so that it is never seen half written:
+ * they are written to a temporary file first and it is then renamed to the one given
+ */
+bool writeFileAtomically(std::string path, const std::string &contents, bool binary);
+
+/**
+ * @brief Flushes a file opened with fopen all the way to the disk
+ */
+bool flushFileToDisk(FILE *file);
+
+/**
+ * @brief Flushes the entries of the folder containing path (e.g. that file, just renamed) to the disk.
+ * Renames are already durable in Windows: it does nothing there
+ */
+bool flushParentFolderToDisk(std::string path);
+
 
 /* Time related */
 const char *fillStructWithSYYmdHMS(std::string &stime, struct tm &dt);
@@ -87,6 +108,12 @@ bool getMinAndMaxTime(std::string timestring, time_t *minTime, time_t *maxTime);
 
 bool getMinAndMaxTime(time_t initial, std::string timestring, time_t *minTime, time_t *maxTime);
 
+/**
+ * @brief getMonotonicMicroSeconds
+ * @return microseconds elapsed since an unspecified starting point. Only meant to measure intervals
+ */
+long long getMonotonicMicroSeconds();
+
 
 /* Strings related */
 
@@ -112,6 +139,43 @@ std::string unquote(std::string what);
 
 bool patternMatches(const char *what, const char *pattern, bool usepcre);
 
+/**
+ * @brief Pattern prepared once to be matched against many strings, with the semantics of patternMatches.
+ * Regular expressions are compiled in the constructor, and globs consisting of a literal prefix and/or
+ * suffix around a single '*' are matched without megacmdWildcardMatch.
+ */
+class PatternMatcher
+{
+private:
+    enum
+    {
+        MATCHER_ANY,           // "*"
+        MATCHER_LITERAL,       // "abc"
+        MATCHER_PREFIXSUFFIX,  // "abc*", "*xyz" or "abc*xyz"
+        MATCHER_WILDCARD,      // other globs
+        MATCHER_REGEX,
+        MATCHER_NONE,          // invalid or unsupported regular expression
+    };
+
+    int type;
+    std::string pattern;
+    std::string prefix;
+    std::string suffix;
+    void *regex;
+
+    PatternMatcher(const PatternMatcher &);
+    PatternMatcher &operator=(const PatternMatcher &);
+
+public:
+    PatternMatcher(const std::string &pattern, bool usepcre);
+    ~PatternMatcher();
+
+    bool matches(const char *what) const;
+
+    bool isLiteral() const;
+    const std::string &getPattern() const;
+};
+
 int toInteger(std::string what, int failValue = -1);
 
 std::string joinStrings(const std::vector<std::string>& vec, const char* delim = " ", bool quoted=true);
@@ -122,6 +186,12 @@ std::string getRightAlignedString(const std::string origin, unsigned int minsize
 
 bool nodeNameIsVersion(std::string &nodeName);
 
+/**
+ * @brief Escapes a node name so that it can be a component of the remote paths parsed by the executer
+ * (e.g. nodebypath): '\' and '/' are preceded by '\'
+ */
+std::string escapeNodeName(const std::string &name);
+
 /* Flags and Options */
 int getFlag(std::map<std::string, int> *flags, const char * optname);
 
@@ -148,6 +218,7 @@ std::string readablePermissions(int permvalue);
 int permissionsFromReadable(std::string permissions);
 
 unsigned int getNumberOfCols(unsigned int defaultwidth = 90);
+unsigned int getNumberOfCores();
 
 void sleepSeconds(int seconds);
 void sleepMicroSeconds(long microseconds);
@@ -0,0 +1,246 @@
+/**
+ * @file src/megacmdworkerpool.cpp
+ * @brief MEGAcmd: Pool of persistent threads to process petitions
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "megacmdworkerpool.h"
+#include "megacmdlogger.h"
+#include "megacmdutils.h"
+
+using namespace std;
+using namespace mega;
+
+// worker run by the current thread (if any): the tasks it submits are queued to itself
+static THREADLOCAL void *currentWorker = NULL;
+
+MegaCmdWorkerPool::MegaCmdWorkerPool(int numberOfWorkers, bool lifo)
+{
+    nextWorker = 0;
+    this->lifo = lifo;
+    stopping = false;
+    memset(&stats, 0, sizeof(stats));
+    mtx.init(false);
+    mtxStats.init(false);
+
+    numberOfWorkers = max(1, numberOfWorkers);
+    for (int i = 0; i < numberOfWorkers; i++)
+    {
+        worker *w = new worker;
+        w->pool = this;
+        w->index = i;
+        w->busy = false;
+        w->joined = false;
+        workers.push_back(w);
+    }
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+    {
+        workers[i]->thread.start(workerEntry, (void *)workers[i]);
+    }
+
+    LOG_debug << "Worker pool started with " << workers.size() << " threads";
+}
+
+void *MegaCmdWorkerPool::workerEntry(void *param)
+{
+    worker *w = (worker *)param;
+    w->pool->run(w);
+    return NULL;
+}
+
+void MegaCmdWorkerPool::run(worker *w)
+{
+    currentWorker = w;
+
+    for (;; )
+    {
+        pendingTasks.wait();
+
+        // queues are only changed with mtx held, so a wake up (released after queueing) always finds
+        // its task: nothing found means the wake up came from stop()
+        task t;
+        mtx.lock();
+        if (stopping || !getTask(w, &t))
+        {
+            bool exiting = stopping;
+            mtx.unlock();
+            if (exiting)
+            {
+                return;
+            }
+            continue;
+        }
+        w->busy = true;
+        mtx.unlock();
+
+        long long startTime = getMonotonicMicroSeconds();
+        t.function(t.arg);
+        long long endTime = getMonotonicMicroSeconds();
+
+        mtx.lock();
+        w->busy = false;
+        mtx.unlock();
+
+        recordLatency(startTime - t.enqueuedTime, endTime - startTime);
+    }
+}
+
+bool MegaCmdWorkerPool::getTask(worker *w, task *t)
+{
+    // own queue first
+    if (w->tasks.size())
+    {
+        if (lifo)
+        {
+            *t = w->tasks.back();
+            w->tasks.pop_back();
+        }
+        else
+        {
+            *t = w->tasks.front();
+            w->tasks.pop_front();
+        }
+        return true;
+    }
+
+    // steal from the rest, starting with the next one to spread them evenly
+    for (unsigned int i = 1; i < workers.size(); i++)
+    {
+        worker *victim = workers[( w->index + i ) % workers.size()];
+        if (victim->tasks.size())
+        {
+            *t = victim->tasks.front();
+            victim->tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void MegaCmdWorkerPool::recordLatency(long long queueWait, long long execution)
+{
+    // only aggregated: per task figures would flood the log (e.g. one task per folder traversed)
+    mtxStats.lock();
+    stats.tasksDone++;
+    stats.totalQueueWait += queueWait;
+    stats.maxQueueWait = max(stats.maxQueueWait, queueWait);
+    stats.totalExecution += execution;
+    stats.maxExecution = max(stats.maxExecution, execution);
+    mtxStats.unlock();
+}
+
+void MegaCmdWorkerPool::submit(workertask_t function, void *arg)
+{
+    task t;
+    t.function = function;
+    t.arg = arg;
+    t.enqueuedTime = getMonotonicMicroSeconds();
+
+    worker *w = getCurrentWorker();
+    mtx.lock();
+    if (!w)
+    {
+        w = workers[nextWorker];
+        nextWorker = ( nextWorker + 1 ) % workers.size();
+    }
+    w->tasks.push_back(t);
+    mtx.unlock();
+
+    pendingTasks.release();
+}
+
+MegaCmdWorkerPool::worker *MegaCmdWorkerPool::getCurrentWorker()
+{
+    worker *w = (worker *)currentWorker;
+    return ( w && w->pool == this ) ? w : NULL;
+}
+
+void MegaCmdWorkerPool::stop()
+{
+    mtx.lock();
+    if (stopping)
+    {
+        mtx.unlock();
+        return;
+    }
+    stopping = true;
+    mtx.unlock();
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+    {
+        pendingTasks.release();
+    }
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+    {
+        // once stopping is set, an idle worker will not take any other task: it is safe to join it
+        worker *w = workers[i];
+        mtx.lock();
+        bool busy = w->busy;
+        mtx.unlock();
+
+        if (busy)
+        {
+            LOG_debug << "Not waiting for busy worker " << w->index;
+        }
+        else
+        {
+            w->thread.join();
+            w->joined = true;
+        }
+    }
+
+    workerpool_stats s = getStats();
+    if (s.tasksDone)
+    {
+        LOG_debug << "Worker pool processed " << s.tasksDone << " tasks."
+                  << " Average queue wait: " << s.totalQueueWait / s.tasksDone << " us (max " << s.maxQueueWait << " us)."
+                  << " Average execution: " << s.totalExecution / s.tasksDone << " us (max " << s.maxExecution << " us).";
+    }
+}
+
+int MegaCmdWorkerPool::getNumberOfWorkers() const
+{
+    return int(workers.size());
+}
+
+workerpool_stats MegaCmdWorkerPool::getStats()
+{
+    mtxStats.lock();
+    workerpool_stats toret = stats;
+    mtxStats.unlock();
+    return toret;
+}
+
+MegaCmdWorkerPool::~MegaCmdWorkerPool()
+{
+    stop();
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+    {
+        if (!workers[i]->joined)
+        {
+            // a busy worker still holds a pointer to this pool: leak it all, we are exiting anyway
+            LOG_debug << "Worker pool left with running tasks";
+            return;
+        }
+    }
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+    {
+        delete workers[i];
+    }
+}
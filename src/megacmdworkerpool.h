@@ -0,0 +1,109 @@
+/**
+ * @file src/megacmdworkerpool.h
+ * @brief MEGAcmd: Pool of persistent threads to process petitions
+ *
+ * (c) 2013-2016 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGAcmd.
+ *
+ * MEGAcmd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGACMDWORKERPOOL_H
+#define MEGACMDWORKERPOOL_H
+
+#include "megacmd.h"
+
+#include <deque>
+#include <vector>
+
+typedef void *(*workertask_t)(void *);
+
+/**
+ * @brief Latency figures gathered by a MegaCmdWorkerPool. Times are in microseconds
+ */
+typedef struct workerpool_stats_struct
+{
+    long long tasksDone;
+    long long totalQueueWait;
+    long long maxQueueWait;
+    long long totalExecution;
+    long long maxExecution;
+} workerpool_stats;
+
+/**
+ * @brief Fixed size pool of threads that run tasks (e.g. doProcessLine)
+ *
+ * Every worker owns a queue. Tasks are distributed among them in a round robin fashion
+ * and a worker that runs out of tasks will steal the oldest pending task of the others.
+ * Tasks submitted from a worker (e.g. subtasks) are queued to that same worker.
+ */
+class MegaCmdWorkerPool
+{
+private:
+    typedef struct task_struct
+    {
+        workertask_t function;
+        void *arg;
+        long long enqueuedTime;
+    } task;
+
+    typedef struct worker_struct
+    {
+        MegaCmdWorkerPool *pool;
+        int index;
+        bool busy;
+        bool joined;
+        std::deque<task> tasks;
+        mega::MegaThread thread;
+    } worker;
+
+    std::vector<worker *> workers;
+    mega::MegaSemaphore pendingTasks; // released once per task queued (and per worker on stop)
+    mega::MegaMutex mtx; // guards the queues, the busy flags, nextWorker and stopping
+    mega::MegaMutex mtxStats;
+    workerpool_stats stats;
+    int nextWorker;
+    bool lifo;
+    bool stopping;
+
+    static void *workerEntry(void *param);
+    void run(worker *w);
+    bool getTask(worker *w, task *t);
+    void recordLatency(long long queueWait, long long execution);
+    worker *getCurrentWorker();
+
+public:
+    /**
+     * @brief MegaCmdWorkerPool
+     * @param numberOfWorkers number of threads to spawn (at least one will be created)
+     * @param lifo whether workers take the newest task of their own queue first (depth first,
+     * for tasks that spawn subtasks). Stolen tasks are always the oldest ones
+     */
+    MegaCmdWorkerPool(int numberOfWorkers, bool lifo = false);
+    ~MegaCmdWorkerPool();
+
+    /**
+     * @brief Queues a task to be executed by one of the workers. It may be called from any thread
+     */
+    void submit(workertask_t function, void *arg);
+
+    /**
+     * @brief Wakes up the workers and joins the idle ones.
+     * Workers running a task will be left behind: they are not waited for.
+     */
+    void stop();
+
+    int getNumberOfWorkers() const;
+
+    workerpool_stats getStats();
+};
+
+#endif // MEGACMDWORKERPOOL_H
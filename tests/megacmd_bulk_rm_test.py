@@ -0,0 +1,53 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /bulk_rm_test is created and removed
+#the nodes matched by all the patterns given to rm are removed together, the ones within removed folders along with them
+
+import sys, os, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/bulk_rm_test"
+FILES=50
+FOLDERS=10
+MCMD_NOTFOUND=-53
+MCMD_INVALIDTYPE=-55
+
+def remote_paths():
+    output,outcode=server_ec("find "+BASE)
+    if outcode != 0:
+        return outcode
+    return sorted([l.strip()[len(BASE)+1:] for l in output.split("\n") if l.strip() and l.strip() != BASE])
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE)
+workdir=tempfile.mkdtemp()
+tree=os.path.join(workdir, "tree")
+os.makedirs(os.path.join(tree, "files"))
+for k in range(FILES):
+    out("%d" % k, os.path.join(tree, "files", "f"+str(k)))
+out("keep", os.path.join(tree, "files", "keep"))
+for i in range(FOLDERS):
+    os.makedirs(os.path.join(tree, "d"+str(i), "s"))
+    out("x", os.path.join(tree, "d"+str(i), "s", "f"))
+cmd_ef("mega-put "+" ".join([os.path.join(tree, n) for n in sorted(os.listdir(tree))])+" "+BASE)
+folders=sorted(sum([["d"+str(i), "d"+str(i)+"/s", "d"+str(i)+"/s/f"] for i in range(FOLDERS)], []))
+
+#Test 01 #all the files matched are removed, the rest kept
+output,outcode=server_ec("rm "+BASE+"/files/f*")
+check(outcode == 0 and remote_paths() == sorted(["files", "files/keep"]+folders), output)
+
+#Test 02 #folders matched are not removed without -r
+output,outcode=server_ec("rm "+BASE+"/d*")
+check(outcode == MCMD_INVALIDTYPE and remote_paths() == sorted(["files", "files/keep"]+folders), output)
+
+#Test 03 #the nodes matched within folders also matched are removed along with them, with no errors
+output,outcode=server_ec("rm -rf "+BASE+"/d* "+BASE+"/d*/* "+BASE+"/d*/s/*")
+check(outcode == 0 and remote_paths() == ["files", "files/keep"], output)
+
+#Test 04 #a pattern with no matches is reported, the matches of the others removed
+output,outcode=server_ec("rm "+BASE+"/files/k* "+BASE+"/files/missing*")
+check(outcode == MCMD_NOTFOUND and remote_paths() == ["files"], output)
+
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(workdir, ignore_errors=True)
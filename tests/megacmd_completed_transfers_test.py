@@ -0,0 +1,47 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /ct_test is created and removed
+#completed transfers are kept in a ring: transfers --show-completed lists the last ones, of the kinds requested
+
+import sys, os, re, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/ct_test"
+FILES=40
+LIMIT=15
+
+def completed(flags, limit):
+    output,outcode=server_ec("transfers --show-completed --only-completed "+flags+" --limit="+str(limit))
+    if outcode != 0:
+        return outcode
+    return sorted(set(re.findall(re.escape(BASE)+"/tree/(f[0-9]+)", output)))
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE)
+workdir=tempfile.mkdtemp()
+tree=os.path.join(workdir, "tree")
+os.mkdir(tree)
+for k in range(FILES):
+    out("x"*(k+1), os.path.join(tree, "f"+str(k)))
+allfiles=sorted(["f"+str(k) for k in range(FILES)])
+
+output,outcode=server_ec("put "+tree+" "+BASE)
+if outcode != 0:
+    print("unable to upload the files: "+output)
+    exit(1)
+
+#Test 01 #the limit is honoured
+check(len(completed("--only-uploads", LIMIT)) == LIMIT, str(completed("--only-uploads", LIMIT)))
+
+#Test 02 #every upload is listed once it fits
+check(completed("--only-uploads", 2*FILES) == allfiles)
+
+#Test 03 #downloads are listed apart from uploads
+target=os.path.join(workdir, "target")
+os.mkdir(target)
+output,outcode=server_ec("get "+BASE+"/tree "+target)
+check(outcode == 0 and completed("--only-downloads", 2*FILES) == allfiles and len(completed("--only-downloads", LIMIT)) == LIMIT)
+
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(workdir, ignore_errors=True)
@@ -0,0 +1,77 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Measures how many configuration changes per second a running mega-cmd-server takes
+# (speedlimit, which saves one or two properties, and exclude, which saves the excluded names),
+# and how many reads (speedlimit without arguments), with several petitions at once.
+# Meanwhile, megacmd.cfg is read continuously to check that it is never seen half written.
+# The speed limits and excluded names are restored afterwards.
+#
+# Usage: megacmd_config_benchmark.py [PETITIONS] [CONCURRENCY]
+
+import sys, os, time
+from megacmd_tests_common import *
+
+CONFIGFILE=os.path.join(os.path.expanduser("~"), ".megaCmd", "megacmd.cfg")
+
+def speedlimits():
+    output,outcode=server_ec("speedlimit")
+    return [l for l in output.splitlines() if l.strip()]
+
+def throughput(commands, concurrency):
+    start=time.time()
+    failed=len([r for r in server_ec_all(commands, concurrency) if r[1] != 0])
+    elapsed=time.time()-start
+    return len(commands)/elapsed if elapsed else 0, failed
+
+def main():
+    petitions=int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+    concurrency=int(sys.argv[2]) if len(sys.argv) > 2 else 16
+
+    previous=speedlimits()
+    server_ec("speedlimit 0")
+
+    checking=[True]
+    torn=[0]
+    def check_file():
+        while checking[0]:
+            try:
+                with open(CONFIGFILE) as f:
+                    contents=f.read()
+            except IOError:
+                continue
+            if "maxspeedupload=" not in contents or "maxspeeddownload=" not in contents:
+                torn[0]+=1
+    checker=threading.Thread(target=check_file)
+    checker.start()
+
+    results=[]
+    results.append(("set (1 property)", throughput(["speedlimit -u "+str(1000+i) for i in range(petitions)], concurrency)))
+    results.append(("set (2 properties)", throughput(["speedlimit "+str(1000+i) for i in range(petitions)], concurrency)))
+    results.append(("get", throughput(["speedlimit" for i in range(petitions)], concurrency)))
+    names=["bench_excluded_"+str(i) for i in range(10)]
+    results.append(("exclude 10 names", throughput(["exclude -a "+" ".join(names) if i%2 == 0 else "exclude -d "+" ".join(names)
+                                                    for i in range(petitions)], concurrency)))
+    server_ec("exclude -d "+" ".join(names))
+
+    checking[0]=False
+    checker.join()
+
+    # restore the limits (listed as e.g. "Upload speed limit = 1000 B/s" or "... = unlimited")
+    for line in previous:
+        if "=" in line:
+            value=line.split("=")[1].split()[0]
+            server_ec(("speedlimit -u " if line.startswith("Upload") else "speedlimit -d ")+(value if value.isdigit() else "0"))
+
+    failures=0
+    print("%-20s %12s %8s" % ("operation", "petitions/s", "failed"))
+    for name,(rate,failed) in results:
+        print("%-20s %12.0f %8d" % (name, rate, failed))
+        failures+=failed
+    print("megacmd.cfg seen half written: %d times" % torn[0])
+
+    if failures or torn[0]:
+        exit(1)
+
+if __name__ == "__main__":
+    main()
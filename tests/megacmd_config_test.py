@@ -0,0 +1,66 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. The speed limits and excluded names are restored afterwards
+#megacmd.cfg is kept in memory and replaced atomically: concurrent changes must all be kept, and the file never seen half written
+
+import sys, os, re, threading
+from megacmd_tests_common import *
+
+CONFIGFILE=os.path.join(os.path.expanduser("~"), ".megaCmd", "megacmd.cfg")
+PETITIONS=500
+
+def speedlimits():
+    return [l for l in server_ec("speedlimit")[0].split("\n") if "=" in l]
+
+def excluded():
+    return server_ec("exclude")[0].split()
+
+previous=speedlimits()
+checking=[True]
+torn=[]
+def check_file():
+    while checking[0]:
+        try:
+            with open(CONFIGFILE) as f:
+                contents=f.read()
+        except IOError:
+            continue
+        if "maxspeedupload=" not in contents or "maxspeeddownload=" not in contents:
+            torn.append(contents)
+server_ec("speedlimit 1000")
+checker=threading.Thread(target=check_file)
+checker.start()
+
+#Test 01 #concurrent changes of several properties
+results=server_ec_all(["speedlimit "+str(1000+i) for i in range(PETITIONS)])
+check(all(r[1] == 0 for r in results))
+
+#Test 02 #reads while changing: always a value that was set
+results=server_ec_all(["speedlimit" if i%2 else "speedlimit -u "+str(2000+i) for i in range(PETITIONS)])
+values=[int(v) for r in results for v in re.findall("([0-9]+) B/s", r[0])]
+check(values and all(1000 <= v < 2000+PETITIONS for v in values), str(values[:10]))
+
+#Test 03 #concurrent exclusions are all kept
+names=["config_test_excluded_"+str(i) for i in range(50)]
+server_ec_all(["exclude -a "+n for n in names])
+check(set(names) <= set(excluded()))
+
+#Test 04 #and written to the file
+with open(CONFIGFILE) as f:
+    contents=f.read()
+check(all(n in contents for n in names))
+
+#Test 05 #concurrent removals
+server_ec_all(["exclude -d "+n for n in names])
+check(not set(names) & set(excluded()))
+
+checking[0]=False
+checker.join()
+
+#Test 06 #megacmd.cfg was never seen half written
+check(not torn, str(len(torn))+" times: "+str(torn[:1]))
+
+#restore the limits (listed as e.g. "Upload speed limit = 1000 B/s" or "... = unlimited")
+for line in previous:
+    value=line.split("=")[1].split()[0]
+    server_ec(("speedlimit -u " if line.startswith("Upload") else "speedlimit -d ")+(value if value.isdigit() else "0"))
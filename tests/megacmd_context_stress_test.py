@@ -0,0 +1,50 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /context_stress is created and removed
+#many petitions at once: the context of each one (where its output goes, its outcode, its log level) must not leak into others
+#
+#Meant to be run against a server built with ThreadSanitizer (./configure --enable-tsan), started with
+#e.g. TSAN_OPTIONS="log_path=/tmp/megacmd_tsan halt_on_error=0". Reports found there make the test fail.
+#
+#Usage: megacmd_context_stress_test.py [PETITIONS] [CONCURRENCY] [TSAN_LOG_PREFIX]
+
+import sys, glob
+from megacmd_tests_common import *
+
+BASE="/context_stress"
+FOLDERS=8
+MCMD_OK=0
+MCMD_NOTFOUND=-53
+
+PETITIONS=int(sys.argv[1]) if len(sys.argv) > 1 else 5000
+CONCURRENCY=int(sys.argv[2]) if len(sys.argv) > 2 else 64
+TSANLOG=sys.argv[3] if len(sys.argv) > 3 else "/tmp/megacmd_tsan"
+
+#alternates successful listings of different folders, failures and verbose petitions
+def petition(i):
+    kind=i%3
+    if kind == 0:
+        return "ls "+BASE+"/folder"+str(i%FOLDERS), MCMD_OK, "child"+str(i%FOLDERS), ["child"+str(j) for j in range(FOLDERS) if j != i%FOLDERS]
+    if kind == 1:
+        return "ls "+BASE+"/missing"+str(i), MCMD_NOTFOUND, "missing"+str(i), ["child"]
+    return "ls -v "+BASE+"/folder0", MCMD_OK, "child0", ["missing"]
+
+def wrongcontext(i, result):
+    command, expectedcode, expected, unexpected = petition(i)
+    output, outcode = result
+    return outcode != expectedcode or expected not in output or [u for u in unexpected if u in output]
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+" ".join([BASE+"/folder"+str(j)+"/child"+str(j) for j in range(FOLDERS)]))
+
+#Test 01 #every petition gets its own output and outcode
+results=server_ec_all([petition(i)[0] for i in range(PETITIONS)], CONCURRENCY)
+failures=[(petition(i)[0], r[1], r[0][:200]) for i, r in enumerate(results) if wrongcontext(i, r)]
+check(not failures, str(len(failures))+" petitions with a wrong context: "+str(failures[:20]))
+
+#Test 02 #no data races found by ThreadSanitizer
+reports=glob.glob(TSANLOG+"*")
+check(not reports, "ThreadSanitizer reports: "+" ".join(reports))
+
+cmd_ec("mega-rm -rf "+BASE)
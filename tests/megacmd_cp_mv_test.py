@@ -0,0 +1,57 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /cp_mv_test is created and removed
+#the nodes matched by the patterns given to cp and mv are copied or moved together, skipping the ones that cannot be
+
+import sys, os, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/cp_mv_test"
+FILES=50
+
+def remote_names(path):
+    output,outcode=server_ec("ls "+path)
+    return sorted(output.split()) if outcode == 0 else outcode
+
+def summary(output):
+    return [l.strip() for l in output.split("\n") if l.startswith("Copied:") or l.startswith("Moved:")]
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE+"/copies "+BASE+"/moved")
+workdir=tempfile.mkdtemp()
+tree=os.path.join(workdir, "src")
+os.makedirs(tree)
+for k in range(FILES):
+    out("%d" % k, os.path.join(tree, "f"+str(k)))
+out("keep", os.path.join(tree, "keep"))
+cmd_ef("mega-put "+tree+" "+BASE)
+names=sorted(["f"+str(k) for k in range(FILES)])
+
+#Test 01 #all the files matched are copied
+output,outcode=server_ec("cp "+BASE+"/src/f* "+BASE+"/copies")
+check(outcode == 0 and summary(output) == ["Copied: %d. Skipped: 0. Failed: 0" % FILES] and remote_names(BASE+"/copies") == names, output)
+
+#Test 02 #files replace the ones of their names in the destination: one node per name
+output,outcode=server_ec("cp "+BASE+"/src/* "+BASE+"/copies")
+check(outcode == 0 and summary(output) == ["Copied: %d. Skipped: 0. Failed: 0" % (FILES+1)] and remote_names(BASE+"/copies") == sorted(names+["keep"]), output)
+
+#Test 03 #the destination and its ancestors are skipped when matched
+output,outcode=server_ec("cp "+BASE+"/co* "+BASE+"/copies")
+check(outcode == 0 and summary(output) == ["Copied: 0. Skipped: 1. Failed: 0"] and remote_names(BASE+"/copies") == sorted(names+["keep"]), output)
+
+#Test 04 #all the files matched are moved, the rest kept
+output,outcode=server_ec("mv "+BASE+"/src/f* "+BASE+"/moved")
+check(outcode == 0 and summary(output) == ["Moved: %d. Skipped: 0. Failed: 0" % FILES] and remote_names(BASE+"/moved") == names and remote_names(BASE+"/src") == ["keep"], output)
+
+#Test 05 #moved files replace the ones of their names too, and leave the source
+output,outcode=server_ec("mv "+BASE+"/copies/f* "+BASE+"/moved")
+check(outcode == 0 and summary(output) == ["Moved: %d. Skipped: 0. Failed: 0" % FILES] and remote_names(BASE+"/moved") == names and remote_names(BASE+"/copies") == ["keep"], output)
+
+#Test 06 #a folder does not replace a file of its name
+cmd_ef("mega-mkdir -p "+BASE+"/folders/f0 "+BASE+"/folders/other")
+output,outcode=server_ec("cp "+BASE+"/folders/* "+BASE+"/moved")
+check(outcode == 0 and summary(output) == ["Copied: 1. Skipped: 1. Failed: 0"] and remote_names(BASE+"/moved") == sorted(names+["other"]), output)
+
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(workdir, ignore_errors=True)
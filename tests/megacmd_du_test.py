@@ -0,0 +1,76 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /du_test is created and removed
+#the sizes of a folder are measured once (by du) and then kept up to date from the nodes updated
+
+import sys, os, time, tempfile
+from megacmd_tests_common import *
+
+BASE="/du_test"
+FOLDERS=4
+FILES=3
+FILESIZE=1000
+
+def du(path, versions=False):
+    output,outcode=server_ec("du "+("--versions " if versions else "")+path)
+    for line in output.split("\n"):
+        if line.startswith("Total storage used:"):
+            return [int(x) for x in line.split(":")[1].split()]
+    return outcode
+
+#node updates are received asynchronously
+def wait_for(path, expected, versions=False, timeout=30):
+    start=time.time()
+    current=du(path, versions)
+    while current != expected and time.time()-start < timeout:
+        time.sleep(0.5)
+        current=du(path, versions)
+    return current == expected
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+" ".join([BASE+"/d"+str(i)+"/sub" for i in range(FOLDERS)]))
+
+localfolder=tempfile.mkdtemp()
+localfile=os.path.join(localfolder, "f")
+out("x"*FILESIZE, localfile)
+otherfile=os.path.join(localfolder, "g")
+out("y"*(2*FILESIZE), otherfile)
+results=server_ec_all(["put "+localfile+" "+BASE+"/d"+str(i)+"/sub/f"+str(j) for i in range(FOLDERS) for j in range(FILES)])
+if [r for r in results if r[1] != 0]:
+    print("unable to upload the files: "+str(results[:5]))
+    exit(1)
+TOTAL=FOLDERS*FILES*FILESIZE
+
+#Test 01 #first measure of the tree, and of a folder inside it
+check(du(BASE) == [TOTAL] and du(BASE+"/d1") == [FILES*FILESIZE], str(du(BASE)))
+
+#Test 02 #a new file is added to every tracked ancestor
+server_ec("put "+localfile+" "+BASE+"/d0/sub/extra")
+check(wait_for(BASE, [TOTAL+FILESIZE]) and wait_for(BASE+"/d0", [(FILES+1)*FILESIZE]))
+
+#Test 03 #a moved file goes from its former ancestors to the new ones
+server_ec("mv "+BASE+"/d0/sub/extra "+BASE+"/d1/")
+check(wait_for(BASE+"/d0", [FILES*FILESIZE]) and wait_for(BASE+"/d1", [(FILES+1)*FILESIZE]) and wait_for(BASE, [TOTAL+FILESIZE]))
+
+#Test 04 #a moved folder takes all its sizes along
+server_ec("mv "+BASE+"/d2/sub "+BASE+"/d3/moved")
+check(wait_for(BASE+"/d2", [0]) and wait_for(BASE+"/d3", [2*FILES*FILESIZE]) and wait_for(BASE, [TOTAL+FILESIZE]))
+
+#Test 05 #a removed folder is subtracted, and a new one with its name starts from scratch
+server_ec("rm -r "+BASE+"/d3/moved")
+server_ec("mkdir "+BASE+"/d3/moved")
+server_ec("put "+localfile+" "+BASE+"/d3/moved/f0")
+check(wait_for(BASE+"/d3", [FILES*FILESIZE+FILESIZE]) and wait_for(BASE, [TOTAL-FILES*FILESIZE+FILESIZE+FILESIZE]))
+
+#Test 06 #a file replaced by a newer version: the old one counts as a version
+server_ec("put "+otherfile+" "+BASE+"/d1/extra")
+total=TOTAL-FILES*FILESIZE+FILESIZE+2*FILESIZE
+check(wait_for(BASE, [total]) and wait_for(BASE, [total, total+FILESIZE], True))
+
+#Test 07 #removing the versions
+server_ec("deleteversions -f "+BASE+"/d1/extra")
+check(wait_for(BASE, [total, total], True))
+
+shutil.rmtree(localfolder)
+cmd_ec("mega-rm -rf "+BASE)
@@ -0,0 +1,84 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Measures how long a running (and logged in) mega-cmd-server takes to download with get a
+# synthetic folder of many small files, both as a whole and through a pattern matching the files
+# of one of its subfolders, and checks that every file is downloaded with its contents.
+# Compare runs of the server with different values of "download_concurrency" and "download_order"
+# in megacmd.cfg.
+#
+# Usage: megacmd_get_benchmark.py [FOLDERS] [FILES_PER_FOLDER] [REPETITIONS]
+#
+# WARNING: Use an empty account: a folder /get_bench is created and removed afterwards
+
+import sys, os, time, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/get_bench"
+CONTENTS=b"0123456789"*10
+
+def local_files(folder):
+    found={}
+    for root, dirs, files in os.walk(folder):
+        for f in files:
+            path=os.path.join(root, f)
+            with open(path, "rb") as fd:
+                found[os.path.relpath(path, folder)]=fd.read()
+    return found
+
+def timed_get(command, folder):
+    shutil.rmtree(folder, ignore_errors=True)
+    os.mkdir(folder)
+    start=time.time()
+    output,outcode=server_ec(command+" "+folder)
+    elapsed=time.time()-start
+    if outcode != 0:
+        print(command+" failed: "+str(outcode)+" "+output)
+    return elapsed, local_files(folder)
+
+def main():
+    folders=int(sys.argv[1]) if len(sys.argv) > 1 else 20
+    filesperfolder=int(sys.argv[2]) if len(sys.argv) > 2 else 100
+    repetitions=int(sys.argv[3]) if len(sys.argv) > 3 else 3
+
+    workdir=tempfile.mkdtemp()
+    localfile=os.path.join(workdir, "source")
+    with open(localfile, "wb") as fd:
+        fd.write(CONTENTS)
+
+    server_ec("mkdir -p "+BASE)
+    if [r for r in server_ec_all(["mkdir "+BASE+"/d"+str(i) for i in range(folders)]) if r[1] != 0]:
+        print("unable to create the tree")
+        exit(1)
+    if [r for r in server_ec_all(["put "+localfile+" "+BASE+"/d"+str(i)+"/f"+str(j) for i in range(folders) for j in range(filesperfolder)]) if r[1] != 0]:
+        print("unable to upload the files")
+        exit(1)
+
+    expected=dict((os.path.join("get_bench", "d"+str(i), "f"+str(j)), CONTENTS) for i in range(folders) for j in range(filesperfolder))
+    target=os.path.join(workdir, "target")
+
+    failures=0
+    print("%-10s %8s %10s %10s %12s" % ("get", "files", "p50 ms", "files/s", "KB/s"))
+    for name, command, files in [("folder", "get "+BASE, folders*filesperfolder), ("pattern", "get "+BASE+"/d0/f*", filesperfolder)]:
+        times=[]
+        for i in range(repetitions):
+            elapsed, found=timed_get(command, target)
+            times.append(elapsed)
+            if name == "pattern":
+                ok=found == dict(("f"+str(j), CONTENTS) for j in range(filesperfolder))
+            else:
+                ok=found == expected
+            if not ok:
+                print("%s: unexpected local files (%d found)" % (command, len(found)))
+                failures+=1
+        times.sort()
+        p50=times[len(times)//2]
+        print("%-10s %8d %10.2f %10.0f %12.0f" % (name, files, p50*1000, files/p50 if p50 else 0, files*len(CONTENTS)/1024.0/p50 if p50 else 0))
+
+    server_ec("rm -rf "+BASE)
+    shutil.rmtree(workdir, ignore_errors=True)
+    if failures:
+        exit(1)
+
+if __name__ == "__main__":
+    main()
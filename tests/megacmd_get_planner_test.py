@@ -0,0 +1,90 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /get_test is created and removed
+#the nodes to get are planned at once: folders are expanded into the local tree and the files to download into it
+
+import sys, os, time, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/get_test"
+FOLDERS=5
+FILES=10
+CONTENTS="0123456789"*10
+
+def local_files(folder):
+    found={}
+    for root, dirs, files in os.walk(folder):
+        for f in files:
+            path=os.path.join(root, f)
+            with open(path, "rb") as fd:
+                found[os.path.relpath(path, folder)]=fd.read()
+    return found
+
+def get(what, folder):
+    shutil.rmtree(folder, ignore_errors=True)
+    os.mkdir(folder)
+    output,outcode=server_ec("get "+what+" "+folder)
+    return outcode, local_files(folder)
+
+#background downloads are not waited for
+def wait_for_files(folder, expected, timeout=60):
+    start=time.time()
+    while local_files(folder) != expected and time.time()-start < timeout:
+        time.sleep(0.5)
+    return local_files(folder) == expected
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+workdir=tempfile.mkdtemp()
+localfile=os.path.join(workdir, "source")
+out(CONTENTS, localfile)
+target=os.path.join(workdir, "target")
+
+cmd_ef("mega-mkdir -p "+" ".join([BASE+"/d"+str(i) for i in range(FOLDERS)]+[BASE+"/empty/sub", BASE+"/dup"]))
+results=server_ec_all(["put "+localfile+" "+BASE+"/d"+str(i)+"/f"+str(j) for i in range(FOLDERS) for j in range(FILES)])
+if [r for r in results if r[1] != 0]:
+    print("unable to upload the files: "+str(results[:5]))
+    exit(1)
+expected=dict((os.path.join("get_test", "d"+str(i), "f"+str(j)), CONTENTS) for i in range(FOLDERS) for j in range(FILES))
+
+#Test 01 #a whole folder, with every file in its place
+outcode,found=get(BASE, target)
+check(outcode == 0 and found == expected and os.path.isdir(os.path.join(target, "get_test", "empty", "sub")), str(len(found))+" files")
+
+#Test 02 #the files matched by a pattern
+outcode,found=get(BASE+"/d0/f*", target)
+check(outcode == 0 and found == dict(("f"+str(j), CONTENTS) for j in range(FILES)))
+
+#Test 03 #a single file, with a new name
+shutil.rmtree(target, ignore_errors=True)
+os.mkdir(target)
+output,outcode=server_ec("get "+BASE+"/d1/f1 "+os.path.join(target, "renamed"))
+check(outcode == 0 and local_files(target) == {"renamed": CONTENTS})
+
+#Test 04 #children with the same name are downloaded under distinct local names
+server_ec("cp "+BASE+"/d0/f0 "+BASE+"/dup/")
+server_ec("cp "+BASE+"/d1/f0 "+BASE+"/dup/")
+server_ec("put "+localfile+" \""+BASE+"/dup/f0 (1)\"")
+outcode,found=get(BASE+"/dup", target)
+check(outcode == 0 and sorted(found.keys()) == sorted([os.path.join("dup", n) for n in ["f0", "f0 (1)", "f0 (2)"]]), str(sorted(found.keys())))
+
+#Test 05 #in background, every file is downloaded too
+shutil.rmtree(target, ignore_errors=True)
+os.mkdir(target)
+output,outcode=server_ec("get -q "+BASE+" "+target)
+check(outcode == 0 and wait_for_files(target, expected))
+
+#Test 06 #in background, every file is handed over at once: all of them are listed and cancelled with transfers
+shutil.rmtree(target, ignore_errors=True)
+os.mkdir(target)
+server_ec("transfers -p -a --only-downloads")
+output,outcode=server_ec("get -q "+BASE+" "+target)
+listed,code=server_ec("transfers --only-downloads --limit=1000 --path-display-size=200")
+listed=len([l for l in listed.split("\n") if BASE+"/d" in l])
+server_ec("transfers -c -a --only-downloads")
+server_ec("transfers -r -a --only-downloads")
+time.sleep(5)
+check(outcode == 0 and listed == FOLDERS*FILES and local_files(target) == {}, str(listed))
+
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(workdir, ignore_errors=True)
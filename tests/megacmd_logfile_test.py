@@ -0,0 +1,51 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server with "log_file" set in megacmd.cfg ("log_file_format" json, the default)
+#every record written to the log file must be a whole JSON object, one per line
+
+import sys, os, re, json, time
+from megacmd_tests_common import *
+
+MAXLOGRECORD=512
+MCMD_NOTFOUND=-53
+
+logfile=re.findall("Log file: (.*), [0-9]+ lines dropped", server_ec("log")[0])
+if not logfile:
+    print >>sys.stderr, "The server is not writing a log file: set log_file in megacmd.cfg"
+    exit(1)
+logfile=logfile[0]
+
+ensure_logged_in()
+previous=re.findall("CMD log level = (.*)", server_ec("log")[0])
+server_ec("log -c debug")
+start=os.path.getsize(logfile)
+
+longname="é"*MAXLOGRECORD
+results=server_ec_all(["ls /missing"+str(i) for i in range(500)]+["ls /"+longname], 16)
+server_ec("log -c "+(previous[0].strip() if previous else "err"))
+time.sleep(1) #written by a thread of its own
+f=open(logfile)
+f.seek(start)
+lines=[l for l in f.read().split("\n") if l]
+f.close()
+
+def parse(line):
+    try:
+        return json.loads(line)
+    except ValueError:
+        return None
+
+records=[parse(l) for l in lines]
+
+#Test 01 #every line is a JSON object with the expected fields
+check(lines and all(r and set(["mono", "thread", "petition", "level", "origin", "time", "source", "message"]) <= set(r.keys()) for r in records),
+      str([l for l, r in zip(lines, records) if not r][:3]))
+
+#Test 02 #the records of the petitions are there, with the petition that logged them
+errors=[r for r in records if r and "Couldn't find /missing" in r["message"]]
+dropped=int(re.findall("Log file: .*, ([0-9]+) lines dropped", server_ec("log")[0])[0])
+check(len(errors)+dropped >= 500 and all(r["petition"] for r in errors), str(len(errors))+" logged, "+str(dropped)+" dropped")
+
+#Test 03 #long messages are shortened, keeping the record (and its UTF-8 characters) well formed
+long=[(l, r) for l, r in zip(lines, records) if r and "ééé" in r["message"]]
+check(long and all(len(l)+1 <= MAXLOGRECORD for l, r in long), str([len(l) for l, r in long]))
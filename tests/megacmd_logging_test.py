@@ -0,0 +1,54 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server with "async_logging" set to true in megacmd.cfg, whose output is
+#redirected to the file in $MEGACMDSERVEROUTPUT (e.g. mega-cmd-server > /tmp/megacmdserver.log)
+#log lines are queued by the petitions and written by a single thread: they must come out whole, one per line
+
+import sys, os, re
+from megacmd_tests_common import *
+
+MAXLOGRECORD=512
+MCMD_NOTFOUND=-53
+PETITIONS=2000
+
+def log_levels():
+    levels={}
+    for line in server_ec("log")[0].split("\n"):
+        if " log level = " in line:
+            name,level=line.split(" log level = ")
+            levels[name]=level.strip()
+    return levels
+
+if not osvar("MEGACMDSERVEROUTPUT"):
+    print >>sys.stderr, "You must define MEGACMDSERVEROUTPUT with the file the output of the server is redirected to"
+    exit(1)
+if "Async logging:" not in server_ec("log")[0]:
+    print >>sys.stderr, "Async logging is not enabled in the server"
+    exit(1)
+
+ensure_logged_in()
+previous=log_levels()
+server_ec("log -c debug")
+outputfile=open(osvar("MEGACMDSERVEROUTPUT"))
+outputfile.seek(0, 2)
+
+#Test 01 #petitions keep working while logging from many threads
+results=server_ec_all(["ls /missing"+str(i) for i in range(PETITIONS)], 32)
+check(all(r[1] == MCMD_NOTFOUND for r in results), str(results[:5]))
+
+#Test 02 #a line is logged for each of them, whole
+longname="x"*(2*MAXLOGRECORD)
+server_ec("ls /"+longname)
+server_ec("log -c "+previous.get("CMD", "err"))
+lines=outputfile.read().split("\n")
+outputfile.close()
+logged=set([m for l in lines for m in re.findall("Couldn't find /missing([0-9]+)$", l)])
+dropped=int(re.findall("([0-9]+) lines dropped", server_ec("log")[0])[0])
+check(len(logged)+dropped >= PETITIONS, str(len(logged))+" logged, "+str(dropped)+" dropped")
+
+#Test 03 #every line has its own prefix: no lines written in between others
+check(all(l.startswith("[") for l in lines if l), str([l for l in lines if l and not l.startswith("[")][:5]))
+
+#Test 04 #long lines are truncated, keeping their line break
+long=[l for l in lines if longname[:100] in l]
+check(long and all(len(l)+1 <= MAXLOGRECORD for l in long), str([len(l) for l in long]))
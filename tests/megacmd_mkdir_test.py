@@ -0,0 +1,62 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /mkdir_test is created and removed
+#the folders of all the paths given to mkdir are created together, a level of the tree at a time
+
+import sys, os
+from megacmd_tests_common import *
+
+BASE="/mkdir_test"
+FOLDERS=10
+SUBFOLDERS=5
+MCMD_INVALIDSTATE=-54
+
+def remote_paths():
+    output,outcode=server_ec("find "+BASE)
+    if outcode != 0:
+        return outcode
+    return sorted([l.strip()[len(BASE)+1:] for l in output.split("\n") if l.strip() and l.strip() != BASE])
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE)
+tree=["d"+str(i)+"/s"+str(j) for i in range(FOLDERS) for j in range(SUBFOLDERS)]
+expected=sorted(tree+["d"+str(i) for i in range(FOLDERS)])
+
+#Test 01 #a whole tree with mkdir -p
+output,outcode=server_ec("mkdir -p "+" ".join([BASE+"/"+p for p in tree]))
+check(outcode == 0 and remote_paths() == expected, str(remote_paths())[:200])
+
+#Test 02 #existing folders are reused, new leaves created among them
+output,outcode=server_ec("mkdir -p "+" ".join([BASE+"/"+p for p in tree[:5]]+[BASE+"/d0/new", BASE+"/d9/s4/deeper"]))
+expected=sorted(expected+["d0/new", "d9/s4/deeper"])
+check(remote_paths() == expected)
+
+#Test 03 #. and .. within the paths created
+output,outcode=server_ec("mkdir -p "+BASE+"/d1/a/./b/../c")
+expected=sorted(expected+["d1/a", "d1/a/c"])
+check(outcode == 0 and remote_paths() == expected)
+
+#Test 04 #a path repeated is reported as existing the second time
+output,outcode=server_ec("mkdir "+BASE+"/x "+BASE+"/x")
+expected=sorted(expected+["x"])
+check(outcode == MCMD_INVALIDSTATE and "already exists" in output and remote_paths() == expected, output)
+
+#Test 05 #an existing folder is reported as such
+output,outcode=server_ec("mkdir "+BASE+"/d2")
+check(outcode == MCMD_INVALIDSTATE and "already exists" in output)
+
+#Test 06 #.. above the first folder that does not exist is rejected, not dropped
+output,outcode=server_ec("mkdir -p "+BASE+"/d3/new/../../../escaped")
+check(outcode == MCMD_INVALIDSTATE and remote_paths() == expected and server_ec("ls /escaped")[1] != 0)
+
+#Test 07 #without -p, missing parents are not created
+output,outcode=server_ec("mkdir "+BASE+"/missing/leaf")
+check(outcode != 0 and remote_paths() == expected)
+
+#Test 08 #.. right after an existing folder, in the folders created by cp -c
+output,outcode=server_ec("cp -c "+BASE+"/d0/s0 "+BASE+"/d5/../made/copied")
+expected=sorted(expected+["made", "made/copied"])
+check(outcode == 0 and remote_paths() == expected, output)
+
+cmd_ec("mega-rm -rf "+BASE)
@@ -0,0 +1,70 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Measures how long a running (and logged in) mega-cmd-server takes to resolve remote paths
+# in synthetic trees of different fan-out (folders per level) and depth.
+# Petitions are sent directly through the server socket (protocol v2), so that spawning
+# mega-* processes does not hide the resolution time.
+#
+# Usage: megacmd_pathresolution_benchmark.py [FANOUTS] [DEPTHS] [REPETITIONS]
+#  e.g.: megacmd_pathresolution_benchmark.py 10,1000,10000 1,4,16 50
+#
+# WARNING: Use an empty account: trees are created in /pathresolution_bench_* and removed afterwards
+
+import sys, os, time
+from megacmd_tests_common import *
+
+def create_tree(base, fanout, depth):
+    # every level has "fanout" folders. Only the first one of each level goes deeper
+    current=base
+    server_ec("mkdir -p "+base)
+    for level in range(depth):
+        if [r for r in server_ec_all(["mkdir "+current+"/l"+str(level)+"_"+str(i) for i in range(fanout)]) if r[1] != 0]:
+            raise Exception("unable to create the tree")
+        current=current+"/l"+str(level)+"_0"
+    return current
+
+def measure(command, repetitions):
+    start=time.time()
+    outcode=server_ec(command)[1]
+    first=time.time()-start
+
+    times=[]
+    for i in range(repetitions):
+        start=time.time()
+        server_ec(command)
+        times.append(time.time()-start)
+    times.sort()
+    return outcode, first, times[len(times)//2] if times else 0, times[-1] if times else 0
+
+def main():
+    fanouts=[int(x) for x in (sys.argv[1] if len(sys.argv) > 1 else "10,1000,10000").split(",")]
+    depths=[int(x) for x in (sys.argv[2] if len(sys.argv) > 2 else "1,4,16").split(",")]
+    repetitions=int(sys.argv[3]) if len(sys.argv) > 3 else 50
+
+    failures=0
+    print("%8s %6s %-10s %10s %10s %10s" % ("fanout", "depth", "lookup", "first ms", "p50 ms", "max ms"))
+    for fanout in fanouts:
+        for depth in depths:
+            base="/pathresolution_bench_"+str(fanout)+"_"+str(depth)
+            deepest=create_tree(base, fanout, depth)
+            parent=deepest.rsplit("/",1)[0]
+            lastlevel="l"+str(depth-1)
+
+            lookups=[("exact", "ls -a "+deepest),
+                     ("last", "ls -a "+parent+"/"+lastlevel+"_"+str(fanout-1)),
+                     ("pattern", "ls -a "+parent+"/"+lastlevel+"_"+str(fanout-1)+"*"),
+                     ("missing", "ls -a "+parent+"/doesnotexist")]
+            for name, command in lookups:
+                outcode, first, p50, maximum = measure(command, repetitions)
+                if outcode != 0 and name != "missing":
+                    failures+=1
+                print("%8d %6d %-10s %10.2f %10.2f %10.2f" % (fanout, depth, name, first*1000, p50*1000, maximum*1000))
+
+            server_ec("rm -rf "+base)
+
+    if failures:
+        exit(1)
+
+if __name__ == "__main__":
+    main()
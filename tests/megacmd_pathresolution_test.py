@@ -0,0 +1,61 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /pathresolution_test is created and removed
+#petitions are sent straight through the server socket, so that every one is resolved right after the previous one finished
+
+import sys, os, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/pathresolution_test"
+MCMD_NOTFOUND=-53
+
+def ls(path):
+    output,outcode=server_ec("ls "+path)
+    return sorted(output.split()) if outcode == 0 else outcode
+
+#paths matched by a wildcard: ls prints a header for each folder matched
+def matches(pattern):
+    output,outcode=server_ec("ls "+pattern)
+    return sorted([l.strip().rstrip(":").split("/")[-1] for l in output.split("\n") if l.strip().endswith(":")])
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+" ".join([BASE+"/sub/level"+str(i) for i in range(20)]+[BASE+"/dest"]))
+
+#Test 01 #literal and wildcard lookups among siblings
+check(ls(BASE+"/sub/level7") == [] and matches(BASE+"/sub/level1*") == sorted(["level1"]+["level1"+str(i) for i in range(10)]))
+
+#Test 02 #missing children are reported as such
+check(ls(BASE+"/sub/missing") == MCMD_NOTFOUND)
+
+#Test 03 #a folder created right after its parent was indexed is found
+ls(BASE+"/sub")
+server_ec("mkdir "+BASE+"/sub/created")
+check(ls(BASE+"/sub/created") == [] and "created" in ls(BASE+"/sub"))
+
+#Test 04 #a moved folder is found in its new parent and no longer in the old one
+ls(BASE+"/dest")
+server_ec("mv "+BASE+"/sub/level3 "+BASE+"/dest/")
+check(ls(BASE+"/sub/level3") == MCMD_NOTFOUND and ls(BASE+"/dest") == ["level3"])
+
+#Test 05 #a renamed folder is only found by its new name
+server_ec("mv "+BASE+"/sub/level4 "+BASE+"/sub/renamed")
+check(ls(BASE+"/sub/level4") == MCMD_NOTFOUND and ls(BASE+"/sub/renamed") == [])
+
+#Test 06 #a copied folder is found in its new parent
+server_ec("cp "+BASE+"/sub/level5 "+BASE+"/dest/copied")
+check(ls(BASE+"/dest/copied") == [] and ls(BASE+"/sub/level5") == [])
+
+#Test 07 #a removed folder is no longer found
+server_ec("rm -r "+BASE+"/sub/level6")
+check(ls(BASE+"/sub/level6") == MCMD_NOTFOUND)
+
+#Test 08 #a file uploaded right after its folder was indexed is found
+ls(BASE+"/dest")
+workdir=tempfile.mkdtemp()
+out("uploaded", os.path.join(workdir, "uploaded"))
+server_ec("put "+os.path.join(workdir, "uploaded")+" "+BASE+"/dest/")
+check(ls(BASE+"/dest/uploaded") == ["uploaded"] and "uploaded" in ls(BASE+"/dest"))
+shutil.rmtree(workdir, ignore_errors=True)
+
+cmd_ec("mega-rm -rf "+BASE)
@@ -0,0 +1,56 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Compares how fast a running (and logged in) mega-cmd-server matches node names against
+# literal, glob and PCRE patterns, by timing "find --pattern" over a synthetic folder.
+# Reports nodes tested per second (find tests every node of the tree).
+#
+# Usage: megacmd_pattern_benchmark.py [NUMBER_OF_NODES] [REPETITIONS]
+#
+# WARNING: Use an empty account: a folder /pattern_bench is created and removed afterwards
+
+import sys, time
+from megacmd_tests_common import *
+
+BASE="/pattern_bench"
+
+PATTERNS=[("literal", "node_777", False),
+          ("any", "*", False),
+          ("prefix", "node_7*", False),
+          ("suffix", "*_777", False),
+          ("prefixsuffix", "node*7", False),
+          ("wildcard", "n?de_*7*", False),
+          ("pcre", "node_7[0-9]*", True)]
+
+def main():
+    nodes=int(sys.argv[1]) if len(sys.argv) > 1 else 10000
+    repetitions=int(sys.argv[2]) if len(sys.argv) > 2 else 5
+
+    server_ec("mkdir -p "+BASE)
+    if [r for r in server_ec_all(["mkdir "+BASE+"/node_"+str(i) for i in range(nodes)]) if r[1] != 0]:
+        print("unable to create the tree")
+        exit(1)
+
+    failures=0
+    print("%-14s %-14s %10s %10s %14s" % ("type", "pattern", "matches", "p50 ms", "nodes/s"))
+    for name, pattern, usepcre in PATTERNS:
+        command="find "+BASE+' --pattern="'+pattern+'"'+(" --use-pcre" if usepcre else "")
+        times=[]
+        matches=0
+        for i in range(repetitions):
+            start=time.time()
+            output,outcode=server_ec(command)
+            times.append(time.time()-start)
+            if outcode != 0:
+                failures+=1
+            matches=len(output.splitlines())
+        times.sort()
+        p50=times[len(times)//2]
+        print("%-14s %-14s %10d %10.2f %14.0f" % (name, pattern, matches, p50*1000, (nodes+1)/p50 if p50 else 0))
+
+    server_ec("rm -rf "+BASE)
+    if failures:
+        exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,43 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /pattern_test is created and removed
+#every kind of pattern (literal, *, prefix*, *suffix, prefix*suffix, wildcards and pcre) must match the same names as before it was compiled once per command
+
+import sys, os, re, fnmatch
+from megacmd_tests_common import *
+
+BASE="/pattern_test"
+NAMES=["node_"+str(i) for i in range(120)]+["n0de_7", "node", "_7", "node_7_node_7", "nodé_7"]
+
+def found(pattern, usepcre=False):
+    output,outcode=server_ec("find "+BASE+' --pattern="'+pattern+'"'+(" --use-pcre" if usepcre else ""))
+    return sorted([l.strip().split("/")[-1].encode("utf-8") for l in output.split("\n") if l.strip()]) if outcode == 0 else outcode
+
+def expected(pattern, usepcre=False):
+    names=NAMES+[BASE[1:]]
+    if usepcre:
+        return sorted([n for n in names if re.match("(?:"+pattern+")\\Z", n.decode("utf-8"), re.UNICODE)])
+    return sorted([n for n in names if fnmatch.fnmatchcase(n, pattern)])
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE)
+results=server_ec_all(["mkdir "+BASE+"/"+n for n in NAMES])
+if [r for r in results if r[1] != 0]:
+    print("unable to create the tree: "+str(results[:5]))
+    exit(1)
+
+for pattern in ["node_77", "node_777", "*", "node_7*", "*_7", "node*7", "*7*", "n?de_7", "n?de_*7*", "*_7_*", "nod?_?", "node_7_node_7*"]:
+    #Test 01-12 #glob patterns
+    check(found(pattern) == expected(pattern), pattern+": "+str(found(pattern))+" != "+str(expected(pattern)))
+
+#Test 13 #non ascii names
+check(found("nodé*") == ["nodé_7"])
+
+#Test 14 #pcre patterns must match the whole name
+if "PCRE" in server_ec("version -l")[0]:
+    check(found("node_7[0-9]*", True) == expected("node_7[0-9]*", True))
+else:
+    check(True)
+
+cmd_ec("mega-rm -rf "+BASE)
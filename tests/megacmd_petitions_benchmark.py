@@ -0,0 +1,114 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Fires concurrent petitions directly against the sockets of a running
+# mega-cmd-server (no mega-* process is spawned) and reports throughput and latencies.
+#
+# Usage: megacmd_petitions_benchmark.py [NUMBER_OF_PETITIONS] [CONCURRENCY] [COMMAND] [PROTOCOL]
+#  PROTOCOL: 1 (a socket per petition), 2 (single connection, framed), "session" (all petitions
+#  multiplexed through one connection per concurrent client) or "both" to compare 1 and 2 (default)
+
+import sys, os, time
+from megacmd_tests_common import *
+
+PROTOCOLSESSIONMAGIC=b"\0MCS"
+FRAMEREQUEST=3
+FRAMECONFIRMATIONRESPONSE=4
+FRAMESESSION=5
+
+def percentile(values, p):
+    if not values: return 0
+    return values[min(len(values)-1, int(len(values)*p/100.0))]
+
+def report(name, total, concurrency, command, failures, latencies, elapsed):
+    latencies.sort()
+    print("protocol: %s petitions: %d concurrency: %d command: %s failed: %d" % (name, total, concurrency, command, failures))
+    print("total time: %.3f s throughput: %.1f petitions/s" % (elapsed, len(latencies)/elapsed if elapsed else 0))
+    print("latency ms: p50=%.2f p90=%.2f p99=%.2f max=%.2f" % (percentile(latencies,50)*1000, percentile(latencies,90)*1000,
+                                                               percentile(latencies,99)*1000, (latencies[-1] if latencies else 0)*1000))
+
+def run(name, petition, total, concurrency, command):
+    latencies=[]
+    failures=[0]
+    lock=threading.Lock()
+    remaining=[total]
+
+    def worker():
+        while True:
+            with lock:
+                if remaining[0] <= 0: return
+                remaining[0]-=1
+            start=time.time()
+            try:
+                petition(command)
+                elapsed=time.time()-start
+                with lock: latencies.append(elapsed)
+            except Exception as e:
+                with lock: failures[0]+=1
+
+    threads=[threading.Thread(target=worker) for i in range(concurrency)]
+    start=time.time()
+    for t in threads: t.start()
+    for t in threads: t.join()
+    report(name, total, concurrency, command, failures[0], latencies, time.time()-start)
+    return failures[0]
+
+def run_session(total, concurrency, command):
+    # every client keeps a single connection and sends all its petitions without waiting
+    latencies=[]
+    failures=[0]
+    lock=threading.Lock()
+    encoded=command.encode("utf-8")
+
+    def client(count):
+        received=[0]
+        try:
+            s=server_connect()
+            s.sendall(PROTOCOLSESSIONMAGIC)
+            if struct.unpack("IiiI",recvexact(s,16))[1] != FRAMESESSION:
+                raise Exception("session not accepted")
+            sent={}
+            for i in range(1,count+1):
+                sent[i]=time.time()
+                s.sendall(struct.pack("IiiI",i,FRAMEREQUEST,0,len(encoded))+encoded)
+            while sent:
+                requestid,frametype,outcode,length=struct.unpack("IiiI",recvexact(s,16))
+                recvexact(s,length)
+                if frametype == FRAMECONFIRMATION:
+                    s.sendall(struct.pack("IiiI",requestid,FRAMECONFIRMATIONRESPONSE,CONFIRMNO,0))
+                    continue
+                if frametype == FRAMEOUTPUT:
+                    continue
+                elapsed=time.time()-sent.pop(requestid)
+                received[0]+=1
+                with lock: latencies.append(elapsed)
+            s.close()
+        except Exception as e:
+            with lock: failures[0]+=count-received[0]
+
+    counts=[total//concurrency + (1 if i < total%concurrency else 0) for i in range(concurrency)]
+    threads=[threading.Thread(target=client, args=(c,)) for c in counts if c]
+    start=time.time()
+    for t in threads: t.start()
+    for t in threads: t.join()
+    report("session", total, concurrency, command, failures[0], latencies, time.time()-start)
+    return failures[0]
+
+def main():
+    total=int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+    concurrency=int(sys.argv[2]) if len(sys.argv) > 2 else 32
+    command=sys.argv[3] if len(sys.argv) > 3 else "pwd"
+    protocol=sys.argv[4] if len(sys.argv) > 4 else "both"
+
+    failures=0
+    if protocol in ["1","both"]:
+        failures+=run("v1", server_ec_v1, total, concurrency, command)
+    if protocol in ["2","both"]:
+        failures+=run("v2", server_ec, total, concurrency, command)
+    if protocol == "session":
+        failures+=run_session(total, concurrency, command)
+    if failures:
+        exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,31 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /petitions_test is created and removed
+
+import sys, os
+from megacmd_tests_common import *
+
+BASE="/petitions_test"
+FOLDERS=8
+MCMD_NOTFOUND=-53
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+" ".join([BASE+"/f"+str(i)+"/child"+str(i) for i in range(FOLDERS)]))
+
+#Test 01 #many more concurrent petitions than workers: every one gets its own output
+commands=["ls "+BASE+"/f"+str(i%FOLDERS) for i in range(500)]
+results=server_ec_all(commands, 64)
+wrong=[(c,r) for c,r in zip(commands,results) if r[1] != 0 or r[0].strip() != "child"+c[-1]]
+check(not wrong, str(wrong[:5]))
+
+#Test 02 #failures keep their outcode when mixed with successful petitions
+commands=["ls "+BASE+("/missing" if i%2 else "/f0") for i in range(200)]
+results=server_ec_all(commands, 32)
+wrong=[(c,r) for c,r in zip(commands,results) if r[1] != (MCMD_NOTFOUND if "missing" in c else 0)]
+check(not wrong, str(wrong[:5]))
+
+#Test 03 #sequential petitions after the burst: workers went back to wait for new tasks
+check(all(server_ec_v1("ls "+BASE+"/f1")[0].strip() == "child1" for i in range(20)))
+
+cmd_ec("mega-rm -rf "+BASE)
@@ -0,0 +1,81 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /protocol_test is created and removed
+
+import sys, os, time
+from megacmd_tests_common import *
+
+BASE="/protocol_test"
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE+"/child")
+
+def answered_in_time(what, expected, seconds=10):
+    finished=[]
+    def run():
+        finished.append(server_ec(what))
+    t=threading.Thread(target=run)
+    t.daemon=True
+    t.start()
+    t.join(seconds)
+    return finished and finished[0][1] == 0 and finished[0][0].strip() == expected
+
+#Test 01 #v2 petition
+output,outcode=server_ec("ls "+BASE)
+check(outcode == 0 and output.strip() == "child", output)
+
+#Test 02 #v1 and v2 petitions give the same output
+check(server_ec_v1("ls "+BASE)[0].strip() == server_ec("ls "+BASE)[0].strip())
+
+#Test 03 #a petition written byte by byte is gathered until complete
+what=("ls "+BASE).encode("utf-8")
+s=server_connect()
+for c in PROTOCOLV2MAGIC+struct.pack("I",len(what))+what:
+    s.sendall(c if isinstance(c,bytes) else bytes([c]))
+    time.sleep(0.01)
+frametype,outcode,length=struct.unpack("iiI",recvexact(s,12))
+check(frametype == FRAMERESPONSE and outcode == 0 and recvexact(s,length).strip() == b"child")
+s.close()
+
+#Test 04 #a client that stalls after the magic does not hold up the others
+stalled=server_connect()
+stalled.sendall(PROTOCOLV2MAGIC)
+check(answered_in_time("ls "+BASE, "child"))
+
+#Test 05 #a client that stalls in the middle of its petition does not hold up the others
+stalled2=server_connect()
+stalled2.sendall(PROTOCOLV2MAGIC+struct.pack("I",100)+b"ls")
+check(answered_in_time("ls "+BASE, "child"))
+stalled.close()
+stalled2.close()
+
+#Test 06 #petitions longer than the maximum are refused: the connection is closed without allocating them
+s=server_connect()
+s.sendall(PROTOCOLV2MAGIC+struct.pack("I",0xFFFFFFFF))
+s.settimeout(10)
+check(recvall(s) == b"" and answered_in_time("ls "+BASE, "child"))
+s.close()
+
+#Test 07 #a connection closed before completing its petition is discarded
+s=server_connect()
+s.sendall(PROTOCOLV2MAGIC+struct.pack("I",10)+b"ls")
+s.close()
+check(answered_in_time("ls "+BASE, "child"))
+
+#Test 08 #output is streamed as it is flushed: lines arrive in output frames ahead of the trailer
+cmd_ef("mega-mkdir -p "+" ".join([BASE+"/many/c"+str(i) for i in range(20)]))
+what=("ls "+BASE+"/many").encode("utf-8")
+s=server_connect()
+s.sendall(PROTOCOLV2MAGIC+struct.pack("I",len(what))+what)
+frames=[]
+while True:
+    frametype,outcode,length=struct.unpack("iiI",recvexact(s,12))
+    frames.append((frametype,recvexact(s,length)))
+    if frametype == FRAMERESPONSE: break
+s.close()
+streamed=b"".join([f[1] for f in frames]).decode("utf-8")
+check(len([f for f in frames if f[0] == FRAMEOUTPUT]) > 1 and outcode == 0
+      and streamed == server_ec_v1("ls "+BASE+"/many")[0], str(frames[:5]))
+
+cmd_ec("mega-rm -rf "+BASE)
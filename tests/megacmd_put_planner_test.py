@@ -0,0 +1,60 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /put_planner_test is created and removed
+#the local folders uploaded are scanned in parallel and their remote folders created a level at a time before the files are
+
+import sys, os, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/put_planner_test"
+FOLDERS=4
+SUBFOLDERS=3
+FILES=5
+SIZES=[10, 1000, 20000]
+
+def create_tree(root):
+    paths=["tree"]
+    for i in range(FOLDERS):
+        paths.append(os.path.join("tree", "d"+str(i)))
+        for j in range(SUBFOLDERS):
+            folder=os.path.join("tree", "d"+str(i), "s"+str(j))
+            os.makedirs(os.path.join(root, folder))
+            paths.append(folder)
+            for k in range(FILES):
+                out("x"*SIZES[k%len(SIZES)], os.path.join(root, folder, "f"+str(k)))
+                paths.append(os.path.join(folder, "f"+str(k)))
+    os.makedirs(os.path.join(root, "tree", "empty", "sub"))
+    paths+=[os.path.join("tree", "empty"), os.path.join("tree", "empty", "sub")]
+    return sorted(paths)
+
+def remote_paths(folder):
+    output,outcode=server_ec("find "+folder)
+    if outcode != 0:
+        return outcode
+    return sorted([l.strip()[len(folder)+1:] for l in output.split("\n") if l.strip() and l.strip() != folder])
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+workdir=tempfile.mkdtemp()
+expected=create_tree(workdir)
+tree=os.path.join(workdir, "tree")
+cmd_ef("mega-mkdir -p "+BASE+"/first "+BASE+"/several "+" ".join([BASE+"/concurrent"+str(i) for i in range(8)]))
+
+#Test 01 #a whole tree, empty folders included
+output,outcode=server_ec("put "+tree+" "+BASE+"/first")
+check(outcode == 0 and remote_paths(BASE+"/first") == expected, str(remote_paths(BASE+"/first"))[:200])
+
+#Test 02 #uploading it again reuses the existing folders
+output,outcode=server_ec("put "+tree+" "+BASE+"/first")
+check(outcode == 0 and remote_paths(BASE+"/first") == expected)
+
+#Test 03 #files and folders at once
+output,outcode=server_ec("put "+os.path.join(tree, "d0", "s0", "f1")+" "+os.path.join(tree, "d1")+" "+BASE+"/several")
+check(outcode == 0 and remote_paths(BASE+"/several") == sorted(["f1"]+[p[len("tree/"):] for p in expected if p.startswith(os.path.join("tree", "d1"))]))
+
+#Test 04 #several trees scanned at the same time, sharing the threads
+results=server_ec_all(["put "+tree+" "+BASE+"/concurrent"+str(i) for i in range(8)])
+check(not [r for r in results if r[1] != 0] and all(remote_paths(BASE+"/concurrent"+str(i)) == expected for i in range(8)))
+
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(workdir, ignore_errors=True)
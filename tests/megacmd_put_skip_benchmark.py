@@ -0,0 +1,99 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Measures how long a running (and logged in) mega-cmd-server takes to upload again with
+# put --skip-unchanged a synthetic local tree already uploaded: the first time the local files
+# are read to get their fingerprints, and the next ones these are taken from the cache (see
+# "fingerprints" in the configuration folder). Then a few files are modified, and it is checked
+# that just those are uploaded again.
+# The tree has FOLDERS*FILES_PER_FOLDER files (e.g. 1000 1000 for a million of them).
+#
+# Usage: megacmd_put_skip_benchmark.py [FOLDERS] [FILES_PER_FOLDER] [REPETITIONS] [MODIFIED]
+#
+# WARNING: Use an empty account: a folder /put_skip_bench is created and removed afterwards
+
+import sys, os, time, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/put_skip_bench"
+
+def create_tree(root, folders, filesperfolder):
+    for i in range(folders):
+        folder=os.path.join(root, "d"+str(i))
+        os.makedirs(folder)
+        for k in range(filesperfolder):
+            with open(os.path.join(folder, "f"+str(k)), "wb") as fd:
+                fd.write(("%d/%d" % (i, k)).encode("utf-8"))
+
+def remote_count():
+    output,outcode=server_ec("find "+BASE)
+    if outcode != 0:
+        return -1
+    return len([l for l in output.splitlines() if l.strip()])
+
+def timed_put(tree):
+    start=time.time()
+    output,outcode=server_ec("put --skip-unchanged "+tree+" "+BASE)
+    elapsed=time.time()-start
+    if outcode != 0:
+        print("put failed: "+str(outcode)+" "+output)
+    return outcode, elapsed
+
+def main():
+    folders=int(sys.argv[1]) if len(sys.argv) > 1 else 20
+    filesperfolder=int(sys.argv[2]) if len(sys.argv) > 2 else 500
+    repetitions=int(sys.argv[3]) if len(sys.argv) > 3 else 3
+    modified=int(sys.argv[4]) if len(sys.argv) > 4 else 10
+
+    workdir=tempfile.mkdtemp()
+    tree=os.path.join(workdir, "tree")
+    create_tree(tree, folders, filesperfolder)
+    files=folders*filesperfolder
+    # BASE, tree, its folders and the files
+    expected=2+folders+files
+
+    server_ec("rm -rf "+BASE)
+    server_ec("mkdir -p "+BASE)
+
+    failures=0
+    print("%-12s %8s %10s %10s" % ("put", "files", "ms", "files/s"))
+    for i in range(repetitions+1):
+        outcode, elapsed=timed_put(tree)
+        if outcode != 0:
+            failures+=1
+        found=remote_count()
+        if found != expected:
+            print("unexpected number of remote nodes: %d (expected %d)" % (found, expected))
+            failures+=1
+        print("%-12s %8d %10.2f %10.0f" % ("first" if i == 0 else "unchanged", files, elapsed*1000, files/elapsed if elapsed else 0))
+
+    # a different size, so that they are found modified regardless of the resolution of modification times
+    changed=[(i%folders, i//folders) for i in range(min(modified, files))]
+    for i, k in changed:
+        with open(os.path.join(tree, "d"+str(i), "f"+str(k)), "ab") as fd:
+            fd.write(b" modified")
+    outcode, elapsed=timed_put(tree)
+    if outcode != 0:
+        failures+=1
+    print("%-12s %8d %10.2f %10.0f" % ("modified", files, elapsed*1000, files/elapsed if elapsed else 0))
+
+    target=os.path.join(workdir, "target")
+    os.mkdir(target)
+    for i, k in changed:
+        output,outcode=server_ec("get "+BASE+"/tree/d"+str(i)+"/f"+str(k)+" "+target)
+        with open(os.path.join(tree, "d"+str(i), "f"+str(k)), "rb") as fd:
+            local=fd.read()
+        downloaded=os.path.join(target, "f"+str(k))
+        if outcode != 0 or not os.path.exists(downloaded) or open(downloaded, "rb").read() != local:
+            print("modified file not uploaded again: d%d/f%d" % (i, k))
+            failures+=1
+        if os.path.exists(downloaded):
+            os.remove(downloaded)
+
+    server_ec("rm -rf "+BASE)
+    shutil.rmtree(workdir, ignore_errors=True)
+    if failures:
+        exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,66 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /put_skip_test is created and removed
+#put --skip-unchanged does not upload again the files whose fingerprints (cached in the configuration folder) match their nodes
+
+import sys, os, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/put_skip_test"
+FOLDERS=3
+FILES=20
+
+def du_versions(path):
+    output,outcode=server_ec("du --versions "+path)
+    for line in output.split("\n"):
+        if line.startswith("Total storage used:"):
+            return [int(x) for x in line.split(":")[1].split()]
+    return outcode
+
+def put(tree):
+    output,outcode=server_ec("put --skip-unchanged "+tree+" "+BASE)
+    return outcode
+
+def remote_contents(remotepath, target):
+    if os.path.exists(target):
+        os.remove(target)
+    output,outcode=server_ec("get "+remotepath+" "+target)
+    return open(target, "rb").read() if outcode == 0 and os.path.exists(target) else outcode
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE)
+workdir=tempfile.mkdtemp()
+tree=os.path.join(workdir, "tree")
+for i in range(FOLDERS):
+    os.makedirs(os.path.join(tree, "d"+str(i)))
+    for k in range(FILES):
+        out("%d/%d" % (i, k), os.path.join(tree, "d"+str(i), "f"+str(k)))
+target=os.path.join(workdir, "downloaded")
+
+#Test 01 #the first time, every file is uploaded
+outcode=put(tree)
+uploaded=du_versions(BASE)
+check(outcode == 0 and remote_contents(BASE+"/tree/d1/f7", target) == "1/7", str(uploaded))
+
+#Test 02 #unchanged files are skipped: no new versions
+check(put(tree) == 0 and du_versions(BASE) == uploaded and put(tree) == 0 and du_versions(BASE) == uploaded, str(du_versions(BASE)))
+
+#Test 03 #modified files are uploaded again, with the new contents
+with open(os.path.join(tree, "d0", "f3"), "ab") as fd:
+    fd.write(" modified")
+check(put(tree) == 0 and remote_contents(BASE+"/tree/d0/f3", target) == "0/3 modified" and du_versions(BASE) != uploaded)
+
+#Test 04 #a file whose node was removed is uploaded again
+server_ec("rm "+BASE+"/tree/d2/f5")
+check(put(tree) == 0 and remote_contents(BASE+"/tree/d2/f5", target) == "2/5")
+
+#Test 05 #a file replaced by another of the same size is uploaded again
+replaced=os.path.join(tree, "d1", "f1")
+mtime=os.path.getmtime(replaced)
+out("X/Y", replaced)
+os.utime(replaced, (mtime+10, mtime+10)) #regardless of the resolution of modification times
+check(put(tree) == 0 and remote_contents(BASE+"/tree/d1/f1", target) == "X/Y")
+
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(workdir, ignore_errors=True)
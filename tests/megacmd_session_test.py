@@ -0,0 +1,120 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /session_test is created and removed
+
+import sys, os, time
+from megacmd_tests_common import *
+
+BASE="/session_test"
+FOLDERS=8
+PROTOCOLSESSIONMAGIC=b"\0MCS"
+FRAMEREQUEST=3
+FRAMECONFIRMATIONRESPONSE=4
+FRAMESESSION=5
+MCMD_NOTPERMITTED=-56
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+" ".join([BASE+"/f"+str(i)+"/child"+str(i) for i in range(FOLDERS)]))
+
+def open_session():
+    s=server_connect()
+    s.sendall(PROTOCOLSESSIONMAGIC)
+    if struct.unpack("IiiI",recvexact(s,16))[1] != FRAMESESSION:
+        raise Exception("session not accepted")
+    return s
+
+def request_frame(requestid, what):
+    what=what.encode("utf-8")
+    return struct.pack("IiiI",requestid,FRAMEREQUEST,0,len(what))+what
+
+#reads frames until the responses of all the ids given have arrived: returns {id: (output,outcode)}
+def read_responses(s, ids):
+    outputs={}
+    responses={}
+    while len(responses) < len(ids):
+        requestid,frametype,outcode,length=struct.unpack("IiiI",recvexact(s,16))
+        payload=recvexact(s,length)
+        if frametype == FRAMECONFIRMATION:
+            s.sendall(struct.pack("IiiI",requestid,FRAMECONFIRMATIONRESPONSE,CONFIRMNO,0))
+            continue
+        outputs[requestid]=outputs.get(requestid,b"")+payload
+        if frametype == FRAMERESPONSE:
+            responses[requestid]=(outputs.pop(requestid).decode("utf-8","replace"),outcode)
+    return responses
+
+#Test 01 #several requests in flight in a session, each answered with its own output
+s=open_session()
+ids=range(1,33)
+s.sendall(b"".join([request_frame(i,"ls "+BASE+"/f"+str(i%FOLDERS)) for i in ids]))
+responses=read_responses(s, ids)
+check(all(responses[i] == ("child"+str(i%FOLDERS)+"\n",0) for i in ids), str(responses))
+
+#Test 02 #requests split across writes are gathered until complete
+frames=b"".join([request_frame(i,"ls "+BASE+"/f1") for i in range(100,104)])
+for i in range(0,len(frames),5):
+    s.sendall(frames[i:i+5])
+    time.sleep(0.005)
+responses=read_responses(s, range(100,104))
+check(all(r == ("child1\n",0) for r in responses.values()))
+
+#Test 03 #a session stalled in the middle of a frame does not hold up other clients nor its own session
+stalled=open_session()
+stalled.sendall(request_frame(1,"ls "+BASE)[:10])
+output,outcode=server_ec("ls "+BASE+"/f2")
+check(outcode == 0 and output.strip() == "child2")
+s.sendall(request_frame(200,"ls "+BASE+"/f3"))
+check(read_responses(s,[200])[200] == ("child3\n",0))
+stalled.close()
+
+#Test 04 #frames longer than the maximum close the session
+big=open_session()
+big.sendall(struct.pack("IiiI",1,FRAMEREQUEST,0,0xFFFFFFFF))
+big.settimeout(10)
+check(recvall(big) == b"")
+big.close()
+s.close()
+
+#Test 05 #mega-exec --pipeline: many more commands than those sent ahead, output in the order given
+commands=["ls "+BASE+"/f"+str(i%FOLDERS) for i in range(300)]
+process=subprocess.Popen("mega-exec --pipeline", shell=True, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+output=process.communicate(("\n".join(commands)+"\n").encode("utf-8"))[0].decode("utf-8")
+check(process.returncode == 0 and output.split() == ["child"+str(i%FOLDERS) for i in range(300)], output[:300])
+
+#Test 06 #mega-exec --pipeline keeps the first failure as its outcode
+process=subprocess.Popen("mega-exec --pipeline", shell=True, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+process.communicate(("ls "+BASE+"/f0\nls "+BASE+"/missing\nls "+BASE+"/f1\n").encode("utf-8"))
+check(process.returncode != 0)
+
+#Test 07 #state listeners cannot be registered within a session
+s=open_session()
+s.sendall(request_frame(1,"registerstatelistener"))
+check(read_responses(s,[1])[1][1] == MCMD_NOTPERMITTED)
+s.close()
+
+#Test 08 #a session that does not read its responses does not hold up the rest, even when it keeps writing
+idle=open_session()
+idle.sendall(b"".join([request_frame(i,"help -f") for i in range(1,41)]))
+time.sleep(2)
+idle.sendall(struct.pack("IiiI",1000,FRAMECONFIRMATIONRESPONSE,CONFIRMNO,0))
+finished=[]
+t=threading.Thread(target=lambda: finished.append(server_ec("ls "+BASE+"/f4")))
+t.daemon=True
+t.start()
+t.join(10)
+check(finished and finished[0][1] == 0 and finished[0][0].strip() == "child4")
+idle.close()
+
+#Test 09 #more requests waiting for confirmations than workers: the responses to them are still read
+cmd_ef("mega-mkdir -p "+" ".join([BASE+"/confirm/c"+str(i)+"/child" for i in range(1,151)]))
+s=open_session()
+s.settimeout(60)
+s.sendall(b"".join([request_frame(i,"rm -r "+BASE+"/confirm/c"+str(i)) for i in range(1,151)]))
+try:
+    responses=read_responses(s, range(1,151))
+except Exception as e:
+    responses={}
+check(len(responses) == 150 and server_ec("ls "+BASE+"/confirm/c150")[0].strip() == "child", str(len(responses)))
+s.close()
+
+cmd_ec("mega-rm -rf "+BASE)
@@ -0,0 +1,66 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account without syncs: /sync_list_test is created and removed
+#the status and sizes of the syncs listed are kept up to date from callbacks, instead of being queried on every listing
+
+import sys, os, time, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/sync_list_test"
+SYNCS=5
+FILES=10
+
+#local path: (remote path, files)
+def listed(flags=""):
+    output,outcode=server_ec("sync "+flags)
+    syncs={}
+    for line in output.split("\n"):
+        fields=line.split()
+        if len(fields) > 6 and fields[2].startswith(BASE):
+            syncs[fields[1]]=(fields[2], int(fields[-2]))
+    return syncs
+
+def wait_for(expected, flags="", timeout=120):
+    start=time.time()
+    while listed(flags) != expected and time.time()-start < timeout:
+        time.sleep(0.5)
+    return listed(flags) == expected
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE)
+workdir=tempfile.mkdtemp()
+locals=[os.path.join(workdir, "s"+str(i)) for i in range(SYNCS)]
+for l in locals:
+    os.mkdir(l)
+    for k in range(FILES):
+        out("x"*(k+1), os.path.join(l, "f"+str(k)))
+server_ec_all(["mkdir "+BASE+"/s"+str(i) for i in range(SYNCS)])
+for i in range(SYNCS):
+    server_ec("sync "+locals[i]+" "+BASE+"/s"+str(i))
+expected=dict((locals[i], (BASE+"/s"+str(i), FILES)) for i in range(SYNCS))
+
+#Test 01 #every sync is listed with its remote path and its files, once uploaded
+check(wait_for(expected), str(listed()))
+
+#Test 02 #a file added is counted without refreshing
+out("new", os.path.join(locals[0], "new"))
+expected[locals[0]]=(BASE+"/s0", FILES+1)
+check(wait_for(expected))
+
+#Test 03 #a renamed remote folder is listed with its new path
+server_ec("mv "+BASE+"/s1 "+BASE+"/renamed1")
+expected[locals[1]]=(BASE+"/renamed1", FILES)
+check(wait_for(expected))
+
+#Test 04 #refreshing gives the same listing, for all the syncs or for one of them
+check(listed("--refresh") == expected and listed("--refresh "+locals[2]) == {locals[2]: expected[locals[2]]})
+
+#Test 05 #a removed sync is no longer listed
+server_ec("sync -d "+locals[3])
+del expected[locals[3]]
+check(listed() == expected)
+
+server_ec_all(["sync -d "+l for l in locals if l in expected])
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(workdir, ignore_errors=True)
@@ -0,0 +1,56 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account without syncs: /sync_restart_test is created and removed
+#configured syncs are restarted in background, a bounded number at a time, and never twice at once
+
+import sys, os, re, time, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/sync_restart_test"
+SYNCS=20
+
+def restart_summary(timeout=120):
+    start=time.time()
+    output,outcode=server_ec("sync --restart-status")
+    while "being restarted" in output and time.time()-start < timeout:
+        time.sleep(0.2)
+        output,outcode=server_ec("sync --restart-status")
+    found=re.search("([0-9]+) syncs restarted: ([0-9]+) done, ([0-9]+) failed", output)
+    return [int(x) for x in found.groups()] if found else output
+
+def disabled_syncs():
+    output,outcode=server_ec("sync")
+    return len([l for l in output.split("\n") if "Disabled" in l])
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE)
+workdir=tempfile.mkdtemp()
+locals=[os.path.join(workdir, "s"+str(i)) for i in range(SYNCS)]
+for l in locals: os.mkdir(l)
+server_ec_all(["mkdir "+BASE+"/s"+str(i) for i in range(SYNCS)])
+results=[server_ec("sync "+locals[i]+" "+BASE+"/s"+str(i)) for i in range(SYNCS)]
+if [r for r in results if r[1] != 0]:
+    print("unable to configure the syncs: "+str(results[:5]))
+    exit(1)
+
+#Test 01 #every sync is restarted once
+output,outcode=server_ec("exclude -a restart_test_1 --restart-syncs")
+check(restart_summary() == [SYNCS, SYNCS, 0] and not disabled_syncs(), str(restart_summary()))
+
+#Test 02 #restarts requested while others are ongoing skip the syncs being restarted
+server_ec_all(["exclude -a restart_test_"+str(i)+" --restart-syncs" for i in range(2, 6)])
+check(restart_summary() == [SYNCS, SYNCS, 0] and not disabled_syncs(), str(restart_summary()))
+
+#Test 03 #on reload, the syncs are resumed
+server_ec("reload")
+check(restart_summary() == [SYNCS, SYNCS, 0] and not disabled_syncs(), str(restart_summary()))
+
+#Test 04 #petitions are served while syncs are restarted
+server_ec("exclude -d "+" ".join(["restart_test_"+str(i) for i in range(1, 6)])+" --restart-syncs")
+output,outcode=server_ec("pwd")
+check(outcode == 0 and restart_summary() == [SYNCS, SYNCS, 0])
+
+server_ec_all(["sync -d "+l for l in locals])
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(workdir, ignore_errors=True)
@@ -0,0 +1,94 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /syncs_store is created and removed
+#configures many syncs, removing some of them as it goes, and checks after every step that the syncs file
+#(~/.megaCmd/syncs) is a valid store (see src/megacmdrecordstore.h) with the syncs configured
+#
+#Usage: megacmd_syncs_store_test.py [SYNCS]
+
+import sys, os, struct, tempfile, shutil, binascii
+from megacmd_tests_common import *
+
+STOREFILE=os.path.join(os.path.expanduser("~"), ".megaCmd", "syncs")
+BASE="/syncs_store"
+
+def crc32(data):
+    return binascii.crc32(data) & 0xffffffff
+
+def read_store(path):
+    with open(path, "rb") as f:
+        data=f.read()
+    magic,version,rtype,count,length,snapshotcrc,headercrc=struct.unpack_from("<8sIIIIII", data, 0)
+    if magic != b"MCMDSTOR": raise Exception("not a store")
+    if crc32(data[:28]) != headercrc: raise Exception("bad header checksum")
+    snapshot=data[32:32+length]
+    if crc32(snapshot) != snapshotcrc: raise Exception("bad snapshot checksum")
+    records={}
+    offset=0
+    for i in range(count):
+        keylength,valuelength=struct.unpack_from("<II", snapshot, offset)
+        offset+=8
+        records[snapshot[offset:offset+keylength]]=snapshot[offset+keylength:offset+keylength+valuelength]
+        offset+=keylength+valuelength
+    journal=data[32+length:]
+    offset=0
+    entries=0
+    while offset < len(journal):
+        operation,keylength,valuelength=struct.unpack_from("<BII", journal, offset)
+        size=9+keylength+valuelength
+        if struct.unpack_from("<I", journal, offset+size)[0] != crc32(journal[offset:offset+size]):
+            raise Exception("bad journal entry")
+        key=journal[offset+9:offset+9+keylength]
+        if operation == 1:
+            records[key]=journal[offset+9+keylength:offset+size]
+        else:
+            del records[key]
+        offset+=size+4
+        entries+=1
+    return records, entries
+
+SYNCS=int(sys.argv[1]) if len(sys.argv) > 1 else 200
+RECORDSTOREMINJOURNAL=64
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+localbase=tempfile.mkdtemp()
+locals=[os.path.join(localbase, "s"+str(i)) for i in range(SYNCS)]
+for l in locals: os.mkdir(l)
+cmd_ef("mega-mkdir -p "+BASE)
+server_ec_all(["mkdir "+BASE+"/s"+str(i) for i in range(SYNCS)])
+
+initial=set(read_store(STOREFILE)[0]) if os.path.exists(STOREFILE) else set()
+configured=set(initial)
+failures=[]
+maxentries=0
+for i in range(SYNCS):
+    server_ec("sync "+locals[i]+" "+BASE+"/s"+str(i))
+    configured.add(locals[i].encode("utf-8"))
+    if i%3 == 2:
+        server_ec("sync -d "+locals[i-1])
+        configured.discard(locals[i-1].encode("utf-8"))
+    try:
+        records,entries=read_store(STOREFILE)
+        maxentries=max(maxentries, entries)
+        if set(records) != configured:
+            failures.append("step %d: unexpected syncs in the file" % i)
+    except Exception as e:
+        failures.append("step %d: %s" % (i, e))
+
+#Test 01 #the file is a valid store with the syncs configured after every change
+check(not failures, str(failures[:5]))
+
+#Test 02 #the journal is compacted once it grows too long
+check(maxentries <= max(RECORDSTOREMINJOURNAL, len(configured)), str(maxentries)+" entries")
+
+#Test 03 #no temporary files nor migration backups left behind
+check(not os.path.exists(STOREFILE+".tmp") and not os.path.exists(STOREFILE+".bak"))
+
+server_ec_all(["sync -d "+l for l in locals])
+
+#Test 04 #removed syncs are removed from the file
+check(set(read_store(STOREFILE)[0]) == initial)
+
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(localbase)
@@ -1,7 +1,7 @@
 #!/usr/bin/python
 # -*- coding: utf-8 -*-
 
-import sys, os, subprocess, shutil, re
+import sys, os, subprocess, shutil, re, socket, struct, threading
 import fnmatch
 
 try:
@@ -211,3 +211,110 @@ def out(what, where):
     #~ print(what, file=where)
     with open(where, 'w') as f:
         f.write(what)
+
+#petitions sent straight through the server socket, without spawning a mega-* process
+SOCKETSFOLDER="/tmp/megaCMD_"+str(os.getuid())
+
+def recvexact(sock, size):
+    data=b""
+    while len(data) < size:
+        chunk=sock.recv(size-len(data))
+        if not chunk: raise Exception("connection closed")
+        data+=chunk
+    return data
+
+def recvall(sock):
+    data=b""
+    while True:
+        chunk=sock.recv(4096)
+        if not chunk: break
+        data+=chunk
+    return data
+
+def recvint(sock):
+    return struct.unpack("i",recvexact(sock,4))[0]
+
+#execute through the server socket (a socket per petition): returns output and outcode, as ec
+def server_ec_v1(what):
+    s=socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    s.connect(SOCKETSFOLDER+"/srv")
+    s.sendall(what.encode("utf-8"))
+    socketid=recvint(s)
+    s.close()
+
+    o=socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    o.connect(SOCKETSFOLDER+"/srv_"+str(socketid))
+    outcode=recvint(o)
+    output=recvall(o)
+    o.close()
+    return output.decode("utf-8","replace"),outcode
+
+PROTOCOLV2MAGIC=b"\0MC2"
+FRAMERESPONSE=1
+FRAMECONFIRMATION=2
+FRAMEOUTPUT=6
+CONFIRMNO=0
+
+def server_connect():
+    s=socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    s.connect(SOCKETSFOLDER+"/srv")
+    return s
+
+#execute through the server socket (protocol v2: a single connection): returns output and outcode, as ec
+def server_ec(what, confirmation=CONFIRMNO):
+    s=server_connect()
+    what=what.encode("utf-8")
+    s.sendall(PROTOCOLV2MAGIC+struct.pack("I",len(what))+what)
+    output=b""
+    while True:
+        frametype,outcode,length=struct.unpack("iiI",recvexact(s,12))
+        payload=recvexact(s,length)
+        if frametype == FRAMECONFIRMATION:
+            s.sendall(struct.pack("i",confirmation))
+            continue
+        output+=payload
+        if frametype == FRAMERESPONSE:
+            s.close()
+            return output.decode("utf-8","replace"),outcode
+
+#execute all the petitions, concurrency at a time: returns the results in the same order
+def server_ec_all(commands, concurrency=16, petition=server_ec):
+    results=[None]*len(commands)
+    pending=list(range(len(commands)))
+    lock=threading.Lock()
+
+    def worker():
+        while True:
+            with lock:
+                if not pending: return
+                i=pending.pop()
+            try:
+                results[i]=petition(commands[i])
+            except Exception as e:
+                results[i]=(str(e),None)
+
+    threads=[threading.Thread(target=worker) for i in range(concurrency)]
+    for t in threads: t.start()
+    for t in threads: t.join()
+    return results
+
+currentTest=1
+
+#report the result of the current test, exit if failed
+def check(succeeded, details=""):
+    global currentTest
+    if succeeded:
+        print("test "+str(currentTest)+" succesful!")
+    else:
+        print("test "+str(currentTest)+" failed!")
+        if details: print(details)
+        exit(1)
+    currentTest+=1
+
+def ensure_logged_in():
+    if not osvar("MEGA_EMAIL") or not osvar("MEGA_PWD"):
+        print >>sys.stderr, "You must define variables MEGA_EMAIL MEGA_PWD. WARNING: Use an empty account for $MEGA_EMAIL"
+        exit(1)
+    if cmd_es("mega-whoami") != osvar("MEGA_EMAIL"):
+        cmd_ec("mega-logout")
+        cmd_ef("mega-login "+osvar("MEGA_EMAIL")+" "+osvar("MEGA_PWD"))
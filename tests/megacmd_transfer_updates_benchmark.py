@@ -0,0 +1,77 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Measures the CPU time a running (and logged in) mega-cmd-server spends on a single put and a
+# single get of a synthetic folder with many small files (10000 by default), all of them in the
+# same batch: every transfer produces a few updates (start, progress and finish) that are
+# accounted in the listener of the batch, so the cost of each of them shows in the CPU time per
+# transfer. Compare runs with different values of "upload_concurrency" and "download_concurrency"
+# in megacmd.cfg: the cost of an update should not grow with the number of ongoing transfers.
+#
+# Usage: megacmd_transfer_updates_benchmark.py [FOLDERS] [FILES_PER_FOLDER] [REPETITIONS]
+#
+# WARNING: Use an empty account: a folder /transfer_updates_bench is created and removed afterwards
+
+import sys, os, time, shutil, tempfile, subprocess
+from megacmd_tests_common import *
+
+BASE="/transfer_updates_bench"
+
+def server_cpu_seconds():
+    try:
+        pid=subprocess.check_output(["pgrep", "-o", "mega-cmd-server"]).split()[0].decode("utf-8")
+        with open("/proc/"+pid+"/stat") as fd:
+            fields=fd.read().rsplit(")", 1)[1].split()
+        return (int(fields[11])+int(fields[12]))/float(os.sysconf("SC_CLK_TCK"))
+    except Exception:
+        return -1
+
+def measure(command):
+    cpu=server_cpu_seconds()
+    start=time.time()
+    output,outcode=server_ec(command)
+    elapsed=time.time()-start
+    if outcode != 0:
+        print(command+" failed: "+str(outcode)+" "+output)
+    return outcode, elapsed, server_cpu_seconds()-cpu if cpu >= 0 else -1
+
+def main():
+    folders=int(sys.argv[1]) if len(sys.argv) > 1 else 10
+    filesperfolder=int(sys.argv[2]) if len(sys.argv) > 2 else 1000
+    repetitions=int(sys.argv[3]) if len(sys.argv) > 3 else 3
+
+    workdir=tempfile.mkdtemp()
+    tree=os.path.join(workdir, "tree")
+    for i in range(folders):
+        os.makedirs(os.path.join(tree, "d"+str(i)))
+        for k in range(filesperfolder):
+            with open(os.path.join(tree, "d"+str(i), "f"+str(k)), "wb") as fd:
+                fd.write(b"x"*(k%100+1))
+    files=folders*filesperfolder
+    target=os.path.join(workdir, "target")
+
+    failures=0
+    print("%-6s %8s %10s %10s %14s" % ("", "files", "ms", "cpu ms", "cpu us/file"))
+    for i in range(repetitions):
+        server_ec("rm -rf "+BASE)
+        server_ec("mkdir -p "+BASE)
+        for name, command in [("put", "put "+tree+" "+BASE), ("get", "get "+BASE+"/tree "+target)]:
+            shutil.rmtree(target, ignore_errors=True)
+            os.mkdir(target)
+            outcode, elapsed, cpu=measure(command)
+            if outcode != 0:
+                failures+=1
+            print("%-6s %8d %10.2f %10.2f %14.2f" % (name, files, elapsed*1000, cpu*1000, cpu*1000000/files))
+
+        found=sum(len(f) for r, d, f in os.walk(target))
+        if found != files:
+            print("unexpected number of files downloaded: %d (expected %d)" % (found, files))
+            failures+=1
+
+    server_ec("rm -rf "+BASE)
+    shutil.rmtree(workdir, ignore_errors=True)
+    if failures:
+        exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,50 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /transfer_updates_test is created and removed
+#the transfers of a put or a get are accounted together: every one of them, and all their bytes, once finished
+
+import sys, os, re, shutil, tempfile
+from megacmd_tests_common import *
+
+BASE="/transfer_updates_test"
+FOLDERS=4
+FILES=50
+
+def transferred(action, output):
+    found=re.search(action+" ([0-9]+) files \\(([^)]*)\\)", output)
+    return (int(found.group(1)), found.group(2)) if found else None
+
+def local_count(folder):
+    return sum(len(f) for r, d, f in os.walk(folder))
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE)
+workdir=tempfile.mkdtemp()
+tree=os.path.join(workdir, "tree")
+for i in range(FOLDERS):
+    os.makedirs(os.path.join(tree, "d"+str(i)))
+    for k in range(FILES):
+        out("x"*(k%100+1), os.path.join(tree, "d"+str(i), "f"+str(k)))
+
+#Test 01 #every upload is accounted once
+output,outcode=server_ec("put "+tree+" "+BASE)
+uploaded=transferred("Uploaded", output)
+check(outcode == 0 and uploaded and uploaded[0] == FOLDERS*FILES, str(uploaded))
+
+#Test 02 #every download is accounted once, with the same bytes as the uploads
+target=os.path.join(workdir, "target")
+os.mkdir(target)
+output,outcode=server_ec("get "+BASE+"/tree "+target)
+downloaded=transferred("Downloaded", output)
+check(outcode == 0 and downloaded == uploaded and local_count(target) == FOLDERS*FILES, str(downloaded))
+
+#Test 03 #concurrent gets account their own transfers only
+targets=[os.path.join(workdir, "target"+str(i)) for i in range(FOLDERS)]
+for t in targets: os.mkdir(t)
+results=server_ec_all(["get "+BASE+"/tree/d"+str(i)+" "+targets[i] for i in range(FOLDERS)])
+check(all(r[1] == 0 and transferred("Downloaded", r[0]) and transferred("Downloaded", r[0])[0] == FILES for r in results)
+      and all(local_count(t) == FILES for t in targets))
+
+cmd_ec("mega-rm -rf "+BASE)
+shutil.rmtree(workdir, ignore_errors=True)
@@ -0,0 +1,71 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+#needs a running mega-cmd-server. WARNING: Use an empty account: /traversal_test is created and removed
+#find, du and ls -R traverse subtrees in parallel: their results must cover the whole tree, in the same order every time
+
+import sys, os, re, tempfile
+from megacmd_tests_common import *
+
+BASE="/traversal_test"
+FANOUT=4
+DEPTH=3
+FILESIZE=1000
+
+ensure_logged_in()
+cmd_ec("mega-rm -rf "+BASE)
+cmd_ef("mega-mkdir -p "+BASE)
+
+folders=[]
+level=[BASE]
+for d in range(DEPTH):
+    level=[parent+"/f"+str(d)+"_"+str(i) for parent in level for i in range(FANOUT)]
+    folders+=level
+results=server_ec_all(["mkdir -p "+f for f in folders])
+if [r for r in results if r[1] != 0]:
+    print("unable to create the tree: "+str(results[:5]))
+    exit(1)
+
+#a file in every deepest folder
+localfile=os.path.join(tempfile.mkdtemp(), "file_1")
+out("x"*FILESIZE, localfile)
+for f in level:
+    cmd_ef("mega-put "+localfile+" "+f+"/")
+shutil.rmtree(os.path.dirname(localfile))
+files=[f+"/file_1" for f in level]
+
+def lines(command):
+    output,outcode=server_ec(command)
+    return [l.strip() for l in output.split("\n") if l.strip()] if outcode == 0 else outcode
+
+#Test 01 #find lists every node once
+found=lines("find "+BASE)
+check(isinstance(found, list) and sorted(found) == sorted([BASE]+folders+files), str(found)[:500])
+
+#Test 02 #a parent is always listed before its children
+check(all(found.index(p.rsplit("/",1)[0]) < found.index(p) for p in folders+files))
+
+#Test 03 #the order does not change between runs, even when run concurrently
+results=server_ec_all(["find "+BASE]*16, 8)
+check(all(r == results[0] and r[1] == 0 for r in results) and lines("find "+BASE) == found)
+
+#Test 04 #patterns are applied to every node
+check(sorted(lines("find "+BASE+' --pattern="*_1"')) == sorted([p for p in folders+files if p.endswith("_1")]))
+
+#Test 05 #du adds up the files of every subtree
+output=lines("du "+BASE)
+check(isinstance(output, list) and int(re.findall("[0-9]+", output[-1])[-1]) == FILESIZE*len(files), str(output))
+
+#Test 06 #du --versions counts the same size for files with no versions
+output=lines("du --versions "+BASE)
+check(isinstance(output, list) and int(re.findall("[0-9]+", output[-1])[-1]) == FILESIZE*len(files), str(output))
+
+#Test 07 #ls -R shows every name, and its output is stable
+output=server_ec("ls -R "+BASE)
+names=re.findall("[^ \n/:]+", output[0])
+check(output[1] == 0 and all(p.split("/")[-1] in names for p in folders+files) and server_ec("ls -R "+BASE) == output)
+
+#Test 08 #ls -lR is stable
+output=server_ec("ls -lR "+BASE)
+check(output[1] == 0 and "file_1" in output[0] and server_ec("ls -lR "+BASE) == output)
+
+cmd_ec("mega-rm -rf "+BASE)